@@ -133,6 +133,9 @@ HRESULT WINAPI D3D11CoreCreateDevice(IDXGIFactory *factory, IDXGIAdapter *adapte
         return E_FAIL;
     }
 
+    /* dxgi doesn't pass the creation flags on to the device layer. */
+    impl_from_ID3D11Device2((ID3D11Device2 *)*device)->create_flags = flags;
+
     return S_OK;
 }
 
@@ -37,6 +37,7 @@
 #endif
 #include "wine/wined3d.h"
 #include "wine/winedxgi.h"
+#include "wine/list.h"
 #include "wine/rbtree.h"
 
 #include "wine/wined3d-interop.h"
@@ -507,6 +508,92 @@ struct d3d11_immediate_context
     struct wined3d_private_store private_store;
 };
 
+/* Pipeline state tracked by deferred contexts. */
+struct d3d11_context_state
+{
+    ID3D11DeviceChild *shaders[WINED3D_SHADER_TYPE_COUNT];
+    ID3D11Buffer *constant_buffers[WINED3D_SHADER_TYPE_COUNT][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+    ID3D11ShaderResourceView *shader_resources[WINED3D_SHADER_TYPE_COUNT][D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+    ID3D11SamplerState *samplers[WINED3D_SHADER_TYPE_COUNT][D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+
+    ID3D11InputLayout *input_layout;
+    ID3D11Buffer *vertex_buffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    UINT strides[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    UINT offsets[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    ID3D11Buffer *index_buffer;
+    DXGI_FORMAT index_format;
+    UINT index_offset;
+    D3D11_PRIMITIVE_TOPOLOGY topology;
+
+    ID3D11RenderTargetView *render_targets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    ID3D11DepthStencilView *depth_stencil;
+    ID3D11UnorderedAccessView *unordered_access_views[D3D11_PS_CS_UAV_REGISTER_COUNT];
+    ID3D11UnorderedAccessView *cs_unordered_access_views[D3D11_PS_CS_UAV_REGISTER_COUNT];
+    ID3D11BlendState *blend_state;
+    float blend_factor[4];
+    UINT sample_mask;
+    ID3D11DepthStencilState *depth_stencil_state;
+    UINT stencil_ref;
+
+    ID3D11RasterizerState *rasterizer_state;
+    D3D11_VIEWPORT viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+    UINT viewport_count;
+    D3D11_RECT scissor_rects[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+    UINT scissor_rect_count;
+
+    ID3D11Buffer *so_buffers[D3D11_SO_BUFFER_SLOT_COUNT];
+    ID3D11Predicate *predicate;
+    BOOL predicate_value;
+};
+
+/* Recorded commands, together with references to the objects they use. */
+struct d3d11_command_buffer
+{
+    BYTE *data;
+    SIZE_T size;
+    SIZE_T capacity;
+
+    IUnknown **objects;
+    SIZE_T object_count;
+    SIZE_T objects_size;
+
+    BOOL out_of_memory;
+};
+
+/* ID3D11CommandList */
+struct d3d11_command_list
+{
+    ID3D11CommandList ID3D11CommandList_iface;
+    LONG refcount;
+
+    struct wined3d_private_store private_store;
+    ID3D11Device2 *device;
+    UINT context_flags;
+    struct d3d11_command_buffer commands;
+};
+
+struct d3d11_command_list *unsafe_impl_from_ID3D11CommandList(ID3D11CommandList *iface) DECLSPEC_HIDDEN;
+void d3d11_command_list_execute(struct d3d11_command_list *list, ID3D11DeviceContext1 *context,
+        BOOL restore_state) DECLSPEC_HIDDEN;
+
+/* ID3D11DeviceContext - deferred context */
+struct d3d11_deferred_context
+{
+    ID3D11DeviceContext1 ID3D11DeviceContext1_iface;
+    LONG refcount;
+
+    struct wined3d_private_store private_store;
+    struct d3d_device *device;
+    UINT flags;
+
+    struct d3d11_context_state state;
+    struct d3d11_command_buffer commands;
+    struct list mappings;
+};
+
+HRESULT d3d11_deferred_context_create(struct d3d_device *device, UINT flags,
+        struct d3d11_deferred_context **context) DECLSPEC_HIDDEN;
+
 /* ID3D11Device, ID3D10Device1 */
 struct d3d_device
 {
@@ -520,6 +607,7 @@ struct d3d_device
     LONG refcount;
 
     D3D_FEATURE_LEVEL feature_level;
+    UINT create_flags;
 
     struct d3d11_immediate_context immediate_context;
 
@@ -0,0 +1,3739 @@
+/*
+ * Direct3D 11 deferred contexts and command lists
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include "d3d11_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d11);
+
+/* Deferred contexts record their commands into a d3d11_command_buffer.
+ * FinishCommandList() hands the buffer over to a command list, which is
+ * replayed against the immediate context by ExecuteCommandList(). Since
+ * every deferred context owns its buffer, any number of threads can record
+ * concurrently without taking the wined3d mutex. */
+
+enum d3d11_command_op
+{
+    D3D11_COMMAND_SET_SHADER,
+    D3D11_COMMAND_SET_CONSTANT_BUFFERS,
+    D3D11_COMMAND_SET_SHADER_RESOURCES,
+    D3D11_COMMAND_SET_SAMPLERS,
+    D3D11_COMMAND_SET_CS_UNORDERED_ACCESS_VIEWS,
+    D3D11_COMMAND_SET_INPUT_LAYOUT,
+    D3D11_COMMAND_SET_VERTEX_BUFFERS,
+    D3D11_COMMAND_SET_INDEX_BUFFER,
+    D3D11_COMMAND_SET_PRIMITIVE_TOPOLOGY,
+    D3D11_COMMAND_SET_RENDER_TARGETS_AND_UNORDERED_ACCESS_VIEWS,
+    D3D11_COMMAND_SET_BLEND_STATE,
+    D3D11_COMMAND_SET_DEPTH_STENCIL_STATE,
+    D3D11_COMMAND_SET_RASTERIZER_STATE,
+    D3D11_COMMAND_SET_VIEWPORTS,
+    D3D11_COMMAND_SET_SCISSOR_RECTS,
+    D3D11_COMMAND_SET_STREAM_OUTPUT_TARGETS,
+    D3D11_COMMAND_SET_PREDICATION,
+    D3D11_COMMAND_DRAW,
+    D3D11_COMMAND_DRAW_AUTO,
+    D3D11_COMMAND_DRAW_INDIRECT,
+    D3D11_COMMAND_DISPATCH,
+    D3D11_COMMAND_DISPATCH_INDIRECT,
+    D3D11_COMMAND_BEGIN_QUERY,
+    D3D11_COMMAND_END_QUERY,
+    D3D11_COMMAND_UPLOAD,
+    D3D11_COMMAND_UPDATE_SUBRESOURCE,
+    D3D11_COMMAND_COPY_SUBRESOURCE_REGION,
+    D3D11_COMMAND_COPY_RESOURCE,
+    D3D11_COMMAND_COPY_STRUCTURE_COUNT,
+    D3D11_COMMAND_CLEAR_RENDER_TARGET_VIEW,
+    D3D11_COMMAND_CLEAR_UNORDERED_ACCESS_VIEW_UINT,
+    D3D11_COMMAND_CLEAR_UNORDERED_ACCESS_VIEW_FLOAT,
+    D3D11_COMMAND_CLEAR_DEPTH_STENCIL_VIEW,
+    D3D11_COMMAND_CLEAR_VIEW,
+    D3D11_COMMAND_GENERATE_MIPS,
+    D3D11_COMMAND_SET_RESOURCE_MIN_LOD,
+    D3D11_COMMAND_RESOLVE_SUBRESOURCE,
+    D3D11_COMMAND_CLEAR_STATE,
+    D3D11_COMMAND_EXECUTE_COMMAND_LIST,
+};
+
+struct d3d11_command
+{
+    enum d3d11_command_op opcode;
+    unsigned int size;
+};
+
+struct d3d11_command_set_shader
+{
+    struct d3d11_command header;
+    enum wined3d_shader_type type;
+    ID3D11DeviceChild *shader;
+};
+
+/* Used for constant buffers, shader resource views and samplers. */
+struct d3d11_command_set_objects
+{
+    struct d3d11_command header;
+    enum wined3d_shader_type type;
+    UINT start_slot;
+    UINT count;
+    void *objects[1];
+};
+
+struct d3d11_command_set_cs_unordered_access_views
+{
+    struct d3d11_command header;
+    UINT start_slot;
+    UINT count;
+    ID3D11UnorderedAccessView *views[D3D11_PS_CS_UAV_REGISTER_COUNT];
+    UINT initial_counts[D3D11_PS_CS_UAV_REGISTER_COUNT];
+    BOOL has_initial_counts;
+};
+
+struct d3d11_command_set_input_layout
+{
+    struct d3d11_command header;
+    ID3D11InputLayout *layout;
+};
+
+struct d3d11_command_set_vertex_buffers
+{
+    struct d3d11_command header;
+    UINT start_slot;
+    UINT count;
+    struct
+    {
+        ID3D11Buffer *buffer;
+        UINT stride;
+        UINT offset;
+    } buffers[1];
+};
+
+struct d3d11_command_set_index_buffer
+{
+    struct d3d11_command header;
+    ID3D11Buffer *buffer;
+    DXGI_FORMAT format;
+    UINT offset;
+};
+
+struct d3d11_command_set_primitive_topology
+{
+    struct d3d11_command header;
+    D3D11_PRIMITIVE_TOPOLOGY topology;
+};
+
+struct d3d11_command_set_render_targets_and_unordered_access_views
+{
+    struct d3d11_command header;
+    UINT render_target_view_count;
+    ID3D11RenderTargetView *render_target_views[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    ID3D11DepthStencilView *depth_stencil_view;
+    UINT unordered_access_view_start_slot;
+    UINT unordered_access_view_count;
+    ID3D11UnorderedAccessView *unordered_access_views[D3D11_PS_CS_UAV_REGISTER_COUNT];
+    UINT initial_counts[D3D11_PS_CS_UAV_REGISTER_COUNT];
+    BOOL has_initial_counts;
+};
+
+struct d3d11_command_set_blend_state
+{
+    struct d3d11_command header;
+    ID3D11BlendState *state;
+    float blend_factor[4];
+    UINT sample_mask;
+};
+
+struct d3d11_command_set_depth_stencil_state
+{
+    struct d3d11_command header;
+    ID3D11DepthStencilState *state;
+    UINT stencil_ref;
+};
+
+struct d3d11_command_set_rasterizer_state
+{
+    struct d3d11_command header;
+    ID3D11RasterizerState *state;
+};
+
+struct d3d11_command_set_viewports
+{
+    struct d3d11_command header;
+    UINT count;
+    D3D11_VIEWPORT viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+};
+
+struct d3d11_command_set_scissor_rects
+{
+    struct d3d11_command header;
+    UINT count;
+    D3D11_RECT rects[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+};
+
+struct d3d11_command_set_stream_output_targets
+{
+    struct d3d11_command header;
+    UINT count;
+    ID3D11Buffer *buffers[D3D11_SO_BUFFER_SLOT_COUNT];
+    UINT offsets[D3D11_SO_BUFFER_SLOT_COUNT];
+};
+
+struct d3d11_command_set_predication
+{
+    struct d3d11_command header;
+    ID3D11Predicate *predicate;
+    BOOL value;
+};
+
+struct d3d11_command_draw
+{
+    struct d3d11_command header;
+    BOOL indexed;
+    UINT count;
+    UINT instance_count;
+    UINT start_idx;
+    INT base_vertex_idx;
+    UINT start_instance;
+};
+
+struct d3d11_command_draw_indirect
+{
+    struct d3d11_command header;
+    BOOL indexed;
+    ID3D11Buffer *buffer;
+    UINT offset;
+};
+
+struct d3d11_command_dispatch
+{
+    struct d3d11_command header;
+    UINT x, y, z;
+};
+
+struct d3d11_command_dispatch_indirect
+{
+    struct d3d11_command header;
+    ID3D11Buffer *buffer;
+    UINT offset;
+};
+
+struct d3d11_command_query
+{
+    struct d3d11_command header;
+    ID3D11Asynchronous *asynchronous;
+};
+
+struct d3d11_command_upload
+{
+    struct d3d11_command header;
+    ID3D11Resource *resource;
+    UINT sub_resource_idx;
+    D3D11_MAP map_type;
+    UINT offset;
+    UINT size;
+    UINT row_pitch;
+    UINT slice_pitch;
+    UINT row_count;
+    UINT slice_count;
+    BYTE data[1];
+};
+
+struct d3d11_command_update_subresource
+{
+    struct d3d11_command header;
+    ID3D11Resource *resource;
+    UINT sub_resource_idx;
+    BOOL has_box;
+    D3D11_BOX box;
+    UINT row_pitch;
+    UINT depth_pitch;
+    UINT flags;
+    BYTE data[1];
+};
+
+struct d3d11_command_copy_subresource_region
+{
+    struct d3d11_command header;
+    ID3D11Resource *dst_resource;
+    UINT dst_sub_resource_idx;
+    UINT dst_x, dst_y, dst_z;
+    ID3D11Resource *src_resource;
+    UINT src_sub_resource_idx;
+    BOOL has_box;
+    D3D11_BOX box;
+    UINT flags;
+};
+
+struct d3d11_command_copy_resource
+{
+    struct d3d11_command header;
+    ID3D11Resource *dst_resource;
+    ID3D11Resource *src_resource;
+};
+
+struct d3d11_command_copy_structure_count
+{
+    struct d3d11_command header;
+    ID3D11Buffer *dst_buffer;
+    UINT dst_offset;
+    ID3D11UnorderedAccessView *src_view;
+};
+
+struct d3d11_command_clear_render_target_view
+{
+    struct d3d11_command header;
+    ID3D11RenderTargetView *view;
+    float color[4];
+};
+
+struct d3d11_command_clear_unordered_access_view
+{
+    struct d3d11_command header;
+    ID3D11UnorderedAccessView *view;
+    union
+    {
+        UINT u[4];
+        float f[4];
+    } values;
+};
+
+struct d3d11_command_clear_depth_stencil_view
+{
+    struct d3d11_command header;
+    ID3D11DepthStencilView *view;
+    UINT flags;
+    float depth;
+    UINT8 stencil;
+};
+
+struct d3d11_command_clear_view
+{
+    struct d3d11_command header;
+    ID3D11View *view;
+    float color[4];
+    UINT rect_count;
+    D3D11_RECT rects[1];
+};
+
+struct d3d11_command_generate_mips
+{
+    struct d3d11_command header;
+    ID3D11ShaderResourceView *view;
+};
+
+struct d3d11_command_set_resource_min_lod
+{
+    struct d3d11_command header;
+    ID3D11Resource *resource;
+    float min_lod;
+};
+
+struct d3d11_command_resolve_subresource
+{
+    struct d3d11_command header;
+    ID3D11Resource *dst_resource;
+    UINT dst_sub_resource_idx;
+    ID3D11Resource *src_resource;
+    UINT src_sub_resource_idx;
+    DXGI_FORMAT format;
+};
+
+struct d3d11_command_execute_command_list
+{
+    struct d3d11_command header;
+    ID3D11CommandList *command_list;
+    BOOL restore_state;
+};
+
+/* A resource mapped on a deferred context. The application writes to
+ * "data"; "shadow" keeps the contents uploaded by the previous map of the
+ * same sub-resource, so that D3D11_MAP_WRITE_NO_OVERWRITE only needs to
+ * record the bytes that actually changed. */
+struct d3d11_deferred_mapping
+{
+    struct list entry;
+    ID3D11Resource *resource;
+    UINT sub_resource_idx;
+    BYTE *data;
+    BYTE *shadow;
+    UINT size;
+    UINT row_pitch;
+    UINT slice_pitch;
+    D3D11_MAP map_type;
+    BOOL mapped;
+    BOOL buffer;
+};
+
+static BOOL d3d11_array_reserve(void **elements, SIZE_T *capacity, SIZE_T count, SIZE_T size)
+{
+    SIZE_T max_capacity, new_capacity;
+    void *new_elements;
+
+    if (count <= *capacity)
+        return TRUE;
+
+    max_capacity = ~(SIZE_T)0 / size;
+    if (count > max_capacity)
+        return FALSE;
+
+    new_capacity = max(1, *capacity);
+    while (new_capacity < count && new_capacity <= max_capacity / 2)
+        new_capacity *= 2;
+    if (new_capacity < count)
+        new_capacity = count;
+
+    if (!(new_elements = heap_realloc(*elements, new_capacity * size)))
+        return FALSE;
+
+    *elements = new_elements;
+    *capacity = new_capacity;
+    return TRUE;
+}
+
+static void d3d11_command_buffer_cleanup(struct d3d11_command_buffer *buffer)
+{
+    SIZE_T i;
+
+    for (i = 0; i < buffer->object_count; ++i)
+        IUnknown_Release(buffer->objects[i]);
+    heap_free(buffer->objects);
+    heap_free(buffer->data);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+/* Keeps "object" alive for as long as the buffer references it. Any COM
+ * interface pointer can be passed here, since they all derive from IUnknown. */
+static void d3d11_command_buffer_add_object(struct d3d11_command_buffer *buffer, void *object)
+{
+    if (!object)
+        return;
+
+    if (!d3d11_array_reserve((void **)&buffer->objects, &buffer->objects_size,
+            buffer->object_count + 1, sizeof(*buffer->objects)))
+    {
+        ERR("Failed to grow the object array.\n");
+        buffer->out_of_memory = TRUE;
+        return;
+    }
+
+    IUnknown_AddRef((IUnknown *)object);
+    buffer->objects[buffer->object_count++] = object;
+}
+
+static void *d3d11_command_buffer_require_space(struct d3d11_command_buffer *buffer,
+        enum d3d11_command_op opcode, SIZE_T size)
+{
+    struct d3d11_command *command;
+
+    size = (size + 7) & ~(SIZE_T)7;
+    if (!d3d11_array_reserve((void **)&buffer->data, &buffer->capacity, buffer->size + size, 1))
+    {
+        ERR("Failed to grow the command buffer.\n");
+        buffer->out_of_memory = TRUE;
+        return NULL;
+    }
+
+    command = (struct d3d11_command *)&buffer->data[buffer->size];
+    memset(command, 0, size);
+    command->opcode = opcode;
+    command->size = size;
+    buffer->size += size;
+
+    return command;
+}
+
+static void d3d11_context_set_shader(ID3D11DeviceContext1 *context,
+        enum wined3d_shader_type type, ID3D11DeviceChild *shader)
+{
+    switch (type)
+    {
+        case WINED3D_SHADER_TYPE_VERTEX:
+            ID3D11DeviceContext1_VSSetShader(context, (ID3D11VertexShader *)shader, NULL, 0);
+            break;
+        case WINED3D_SHADER_TYPE_HULL:
+            ID3D11DeviceContext1_HSSetShader(context, (ID3D11HullShader *)shader, NULL, 0);
+            break;
+        case WINED3D_SHADER_TYPE_DOMAIN:
+            ID3D11DeviceContext1_DSSetShader(context, (ID3D11DomainShader *)shader, NULL, 0);
+            break;
+        case WINED3D_SHADER_TYPE_GEOMETRY:
+            ID3D11DeviceContext1_GSSetShader(context, (ID3D11GeometryShader *)shader, NULL, 0);
+            break;
+        case WINED3D_SHADER_TYPE_PIXEL:
+            ID3D11DeviceContext1_PSSetShader(context, (ID3D11PixelShader *)shader, NULL, 0);
+            break;
+        case WINED3D_SHADER_TYPE_COMPUTE:
+            ID3D11DeviceContext1_CSSetShader(context, (ID3D11ComputeShader *)shader, NULL, 0);
+            break;
+        default:
+            ERR("Invalid shader type %#x.\n", type);
+            break;
+    }
+}
+
+static ID3D11DeviceChild *d3d11_context_get_shader(ID3D11DeviceContext1 *context, enum wined3d_shader_type type)
+{
+    ID3D11DeviceChild *shader = NULL;
+
+    switch (type)
+    {
+        case WINED3D_SHADER_TYPE_VERTEX:
+            ID3D11DeviceContext1_VSGetShader(context, (ID3D11VertexShader **)&shader, NULL, NULL);
+            break;
+        case WINED3D_SHADER_TYPE_HULL:
+            ID3D11DeviceContext1_HSGetShader(context, (ID3D11HullShader **)&shader, NULL, NULL);
+            break;
+        case WINED3D_SHADER_TYPE_DOMAIN:
+            ID3D11DeviceContext1_DSGetShader(context, (ID3D11DomainShader **)&shader, NULL, NULL);
+            break;
+        case WINED3D_SHADER_TYPE_GEOMETRY:
+            ID3D11DeviceContext1_GSGetShader(context, (ID3D11GeometryShader **)&shader, NULL, NULL);
+            break;
+        case WINED3D_SHADER_TYPE_PIXEL:
+            ID3D11DeviceContext1_PSGetShader(context, (ID3D11PixelShader **)&shader, NULL, NULL);
+            break;
+        case WINED3D_SHADER_TYPE_COMPUTE:
+            ID3D11DeviceContext1_CSGetShader(context, (ID3D11ComputeShader **)&shader, NULL, NULL);
+            break;
+        default:
+            ERR("Invalid shader type %#x.\n", type);
+            break;
+    }
+
+    return shader;
+}
+
+#define D3D11_CONTEXT_STAGE_ACCESSOR(name, method, object_type) \
+static void d3d11_context_##name(ID3D11DeviceContext1 *context, enum wined3d_shader_type type, \
+        UINT start_slot, UINT count, object_type objects) \
+{ \
+    switch (type) \
+    { \
+        case WINED3D_SHADER_TYPE_VERTEX:   ID3D11DeviceContext1_VS##method(context, start_slot, count, objects); break; \
+        case WINED3D_SHADER_TYPE_HULL:     ID3D11DeviceContext1_HS##method(context, start_slot, count, objects); break; \
+        case WINED3D_SHADER_TYPE_DOMAIN:   ID3D11DeviceContext1_DS##method(context, start_slot, count, objects); break; \
+        case WINED3D_SHADER_TYPE_GEOMETRY: ID3D11DeviceContext1_GS##method(context, start_slot, count, objects); break; \
+        case WINED3D_SHADER_TYPE_PIXEL:    ID3D11DeviceContext1_PS##method(context, start_slot, count, objects); break; \
+        case WINED3D_SHADER_TYPE_COMPUTE:  ID3D11DeviceContext1_CS##method(context, start_slot, count, objects); break; \
+        default: ERR("Invalid shader type %#x.\n", type); break; \
+    } \
+}
+
+D3D11_CONTEXT_STAGE_ACCESSOR(set_constant_buffers, SetConstantBuffers, ID3D11Buffer *const *)
+D3D11_CONTEXT_STAGE_ACCESSOR(get_constant_buffers, GetConstantBuffers, ID3D11Buffer **)
+D3D11_CONTEXT_STAGE_ACCESSOR(set_shader_resources, SetShaderResources, ID3D11ShaderResourceView *const *)
+D3D11_CONTEXT_STAGE_ACCESSOR(get_shader_resources, GetShaderResources, ID3D11ShaderResourceView **)
+D3D11_CONTEXT_STAGE_ACCESSOR(set_samplers, SetSamplers, ID3D11SamplerState *const *)
+D3D11_CONTEXT_STAGE_ACCESSOR(get_samplers, GetSamplers, ID3D11SamplerState **)
+
+#undef D3D11_CONTEXT_STAGE_ACCESSOR
+
+static void d3d11_context_state_init(struct d3d11_context_state *state)
+{
+    unsigned int i;
+
+    memset(state, 0, sizeof(*state));
+    for (i = 0; i < ARRAY_SIZE(state->blend_factor); ++i)
+        state->blend_factor[i] = 1.0f;
+    state->sample_mask = D3D11_DEFAULT_SAMPLE_MASK;
+    state->index_format = DXGI_FORMAT_UNKNOWN;
+    state->topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+}
+
+static void d3d11_release_objects(void *objects, unsigned int count)
+{
+    IUnknown **o = objects;
+    unsigned int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (o[i])
+            IUnknown_Release(o[i]);
+    }
+}
+
+static void d3d11_context_state_cleanup(struct d3d11_context_state *state)
+{
+    unsigned int i;
+
+    d3d11_release_objects(state->shaders, ARRAY_SIZE(state->shaders));
+    for (i = 0; i < WINED3D_SHADER_TYPE_COUNT; ++i)
+    {
+        d3d11_release_objects(state->constant_buffers[i], ARRAY_SIZE(state->constant_buffers[i]));
+        d3d11_release_objects(state->shader_resources[i], ARRAY_SIZE(state->shader_resources[i]));
+        d3d11_release_objects(state->samplers[i], ARRAY_SIZE(state->samplers[i]));
+    }
+    d3d11_release_objects(&state->input_layout, 1);
+    d3d11_release_objects(state->vertex_buffers, ARRAY_SIZE(state->vertex_buffers));
+    d3d11_release_objects(&state->index_buffer, 1);
+    d3d11_release_objects(state->render_targets, ARRAY_SIZE(state->render_targets));
+    d3d11_release_objects(&state->depth_stencil, 1);
+    d3d11_release_objects(state->unordered_access_views, ARRAY_SIZE(state->unordered_access_views));
+    d3d11_release_objects(state->cs_unordered_access_views, ARRAY_SIZE(state->cs_unordered_access_views));
+    d3d11_release_objects(&state->blend_state, 1);
+    d3d11_release_objects(&state->depth_stencil_state, 1);
+    d3d11_release_objects(&state->rasterizer_state, 1);
+    d3d11_release_objects(state->so_buffers, ARRAY_SIZE(state->so_buffers));
+    d3d11_release_objects(&state->predicate, 1);
+}
+
+/* Reads back the state of "context" for ExecuteCommandList(restore_state = TRUE). */
+static void d3d11_context_state_capture(struct d3d11_context_state *state, ID3D11DeviceContext1 *context)
+{
+    enum wined3d_shader_type type;
+
+    d3d11_context_state_init(state);
+
+    for (type = 0; type < WINED3D_SHADER_TYPE_COUNT; ++type)
+    {
+        state->shaders[type] = d3d11_context_get_shader(context, type);
+        d3d11_context_get_constant_buffers(context, type, 0,
+                ARRAY_SIZE(state->constant_buffers[type]), state->constant_buffers[type]);
+        d3d11_context_get_shader_resources(context, type, 0,
+                ARRAY_SIZE(state->shader_resources[type]), state->shader_resources[type]);
+        d3d11_context_get_samplers(context, type, 0,
+                ARRAY_SIZE(state->samplers[type]), state->samplers[type]);
+    }
+
+    ID3D11DeviceContext1_IAGetInputLayout(context, &state->input_layout);
+    /* wined3d only supports 16 vertex streams. */
+    ID3D11DeviceContext1_IAGetVertexBuffers(context, 0, 16,
+            state->vertex_buffers, state->strides, state->offsets);
+    ID3D11DeviceContext1_IAGetIndexBuffer(context, &state->index_buffer,
+            &state->index_format, &state->index_offset);
+    ID3D11DeviceContext1_IAGetPrimitiveTopology(context, &state->topology);
+
+    ID3D11DeviceContext1_OMGetRenderTargetsAndUnorderedAccessViews(context,
+            ARRAY_SIZE(state->render_targets), state->render_targets, &state->depth_stencil,
+            0, ARRAY_SIZE(state->unordered_access_views), state->unordered_access_views);
+    ID3D11DeviceContext1_CSGetUnorderedAccessViews(context, 0,
+            ARRAY_SIZE(state->cs_unordered_access_views), state->cs_unordered_access_views);
+    ID3D11DeviceContext1_OMGetBlendState(context, &state->blend_state,
+            state->blend_factor, &state->sample_mask);
+    ID3D11DeviceContext1_OMGetDepthStencilState(context, &state->depth_stencil_state, &state->stencil_ref);
+
+    ID3D11DeviceContext1_RSGetState(context, &state->rasterizer_state);
+    state->viewport_count = ARRAY_SIZE(state->viewports);
+    ID3D11DeviceContext1_RSGetViewports(context, &state->viewport_count, state->viewports);
+    ID3D11DeviceContext1_RSGetScissorRects(context, &state->scissor_rect_count, NULL);
+    ID3D11DeviceContext1_RSGetScissorRects(context, &state->scissor_rect_count, state->scissor_rects);
+
+    ID3D11DeviceContext1_SOGetTargets(context, ARRAY_SIZE(state->so_buffers), state->so_buffers);
+    ID3D11DeviceContext1_GetPredication(context, &state->predicate, &state->predicate_value);
+}
+
+/* Applies "state" to "context". For a deferred context this records the
+ * corresponding commands. */
+static void d3d11_context_state_apply(const struct d3d11_context_state *state, ID3D11DeviceContext1 *context)
+{
+    static const UINT so_offsets[D3D11_SO_BUFFER_SLOT_COUNT] = {~0u, ~0u, ~0u, ~0u};
+    enum wined3d_shader_type type;
+
+    for (type = 0; type < WINED3D_SHADER_TYPE_COUNT; ++type)
+    {
+        d3d11_context_set_shader(context, type, state->shaders[type]);
+        d3d11_context_set_constant_buffers(context, type, 0,
+                ARRAY_SIZE(state->constant_buffers[type]), state->constant_buffers[type]);
+        d3d11_context_set_shader_resources(context, type, 0,
+                ARRAY_SIZE(state->shader_resources[type]), state->shader_resources[type]);
+        d3d11_context_set_samplers(context, type, 0,
+                ARRAY_SIZE(state->samplers[type]), state->samplers[type]);
+    }
+
+    ID3D11DeviceContext1_IASetInputLayout(context, state->input_layout);
+    ID3D11DeviceContext1_IASetVertexBuffers(context, 0, 16,
+            state->vertex_buffers, state->strides, state->offsets);
+    ID3D11DeviceContext1_IASetIndexBuffer(context, state->index_buffer, state->index_format, state->index_offset);
+    ID3D11DeviceContext1_IASetPrimitiveTopology(context, state->topology);
+
+    ID3D11DeviceContext1_CSSetUnorderedAccessViews(context, 0,
+            ARRAY_SIZE(state->cs_unordered_access_views), state->cs_unordered_access_views, NULL);
+    ID3D11DeviceContext1_OMSetRenderTargetsAndUnorderedAccessViews(context,
+            ARRAY_SIZE(state->render_targets), state->render_targets, state->depth_stencil,
+            0, ARRAY_SIZE(state->unordered_access_views), state->unordered_access_views, NULL);
+    ID3D11DeviceContext1_OMSetBlendState(context, state->blend_state, state->blend_factor, state->sample_mask);
+    ID3D11DeviceContext1_OMSetDepthStencilState(context, state->depth_stencil_state, state->stencil_ref);
+
+    ID3D11DeviceContext1_RSSetState(context, state->rasterizer_state);
+    ID3D11DeviceContext1_RSSetViewports(context, state->viewport_count, state->viewports);
+    ID3D11DeviceContext1_RSSetScissorRects(context, state->scissor_rect_count, state->scissor_rects);
+
+    ID3D11DeviceContext1_SOSetTargets(context, ARRAY_SIZE(state->so_buffers), state->so_buffers, so_offsets);
+    ID3D11DeviceContext1_SetPredication(context, state->predicate, state->predicate_value);
+}
+
+static void d3d11_command_upload_replay(const struct d3d11_command_upload *command, ID3D11DeviceContext1 *context)
+{
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    const BYTE *src = command->data;
+    unsigned int row_size, i, j;
+    BYTE *dst;
+    HRESULT hr;
+
+    if (FAILED(hr = ID3D11DeviceContext1_Map(context, command->resource,
+            command->sub_resource_idx, command->map_type, 0, &map_desc)))
+    {
+        ERR("Failed to map resource %p, hr %#x.\n", command->resource, hr);
+        return;
+    }
+
+    if (!command->row_count)
+    {
+        memcpy((BYTE *)map_desc.pData + command->offset, src, command->size);
+    }
+    else
+    {
+        row_size = min(command->row_pitch, map_desc.RowPitch);
+        for (i = 0; i < command->slice_count; ++i)
+        {
+            dst = (BYTE *)map_desc.pData + i * map_desc.DepthPitch;
+            for (j = 0; j < command->row_count; ++j)
+                memcpy(dst + j * map_desc.RowPitch, src + i * command->slice_pitch + j * command->row_pitch, row_size);
+        }
+    }
+
+    ID3D11DeviceContext1_Unmap(context, command->resource, command->sub_resource_idx);
+}
+
+static void d3d11_command_buffer_replay(const struct d3d11_command_buffer *buffer, ID3D11DeviceContext1 *context)
+{
+    const struct d3d11_command *header;
+    SIZE_T offset;
+
+    for (offset = 0; offset < buffer->size; offset += header->size)
+    {
+        header = (const struct d3d11_command *)&buffer->data[offset];
+
+        switch (header->opcode)
+        {
+            case D3D11_COMMAND_SET_SHADER:
+            {
+                const struct d3d11_command_set_shader *command = (const void *)header;
+                d3d11_context_set_shader(context, command->type, command->shader);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_CONSTANT_BUFFERS:
+            {
+                const struct d3d11_command_set_objects *command = (const void *)header;
+                d3d11_context_set_constant_buffers(context, command->type, command->start_slot,
+                        command->count, (ID3D11Buffer *const *)command->objects);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_SHADER_RESOURCES:
+            {
+                const struct d3d11_command_set_objects *command = (const void *)header;
+                d3d11_context_set_shader_resources(context, command->type, command->start_slot,
+                        command->count, (ID3D11ShaderResourceView *const *)command->objects);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_SAMPLERS:
+            {
+                const struct d3d11_command_set_objects *command = (const void *)header;
+                d3d11_context_set_samplers(context, command->type, command->start_slot,
+                        command->count, (ID3D11SamplerState *const *)command->objects);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_CS_UNORDERED_ACCESS_VIEWS:
+            {
+                const struct d3d11_command_set_cs_unordered_access_views *command = (const void *)header;
+                ID3D11DeviceContext1_CSSetUnorderedAccessViews(context, command->start_slot, command->count,
+                        command->views, command->has_initial_counts ? command->initial_counts : NULL);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_INPUT_LAYOUT:
+            {
+                const struct d3d11_command_set_input_layout *command = (const void *)header;
+                ID3D11DeviceContext1_IASetInputLayout(context, command->layout);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_VERTEX_BUFFERS:
+            {
+                const struct d3d11_command_set_vertex_buffers *command = (const void *)header;
+                unsigned int i;
+
+                for (i = 0; i < command->count; ++i)
+                {
+                    ID3D11DeviceContext1_IASetVertexBuffers(context, command->start_slot + i, 1,
+                            &command->buffers[i].buffer, &command->buffers[i].stride, &command->buffers[i].offset);
+                }
+                break;
+            }
+
+            case D3D11_COMMAND_SET_INDEX_BUFFER:
+            {
+                const struct d3d11_command_set_index_buffer *command = (const void *)header;
+                ID3D11DeviceContext1_IASetIndexBuffer(context, command->buffer, command->format, command->offset);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_PRIMITIVE_TOPOLOGY:
+            {
+                const struct d3d11_command_set_primitive_topology *command = (const void *)header;
+                ID3D11DeviceContext1_IASetPrimitiveTopology(context, command->topology);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_RENDER_TARGETS_AND_UNORDERED_ACCESS_VIEWS:
+            {
+                const struct d3d11_command_set_render_targets_and_unordered_access_views *command
+                        = (const void *)header;
+                ID3D11DeviceContext1_OMSetRenderTargetsAndUnorderedAccessViews(context,
+                        command->render_target_view_count, command->render_target_views,
+                        command->depth_stencil_view, command->unordered_access_view_start_slot,
+                        command->unordered_access_view_count, command->unordered_access_views,
+                        command->has_initial_counts ? command->initial_counts : NULL);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_BLEND_STATE:
+            {
+                const struct d3d11_command_set_blend_state *command = (const void *)header;
+                ID3D11DeviceContext1_OMSetBlendState(context, command->state,
+                        command->blend_factor, command->sample_mask);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_DEPTH_STENCIL_STATE:
+            {
+                const struct d3d11_command_set_depth_stencil_state *command = (const void *)header;
+                ID3D11DeviceContext1_OMSetDepthStencilState(context, command->state, command->stencil_ref);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_RASTERIZER_STATE:
+            {
+                const struct d3d11_command_set_rasterizer_state *command = (const void *)header;
+                ID3D11DeviceContext1_RSSetState(context, command->state);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_VIEWPORTS:
+            {
+                const struct d3d11_command_set_viewports *command = (const void *)header;
+                ID3D11DeviceContext1_RSSetViewports(context, command->count, command->viewports);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_SCISSOR_RECTS:
+            {
+                const struct d3d11_command_set_scissor_rects *command = (const void *)header;
+                ID3D11DeviceContext1_RSSetScissorRects(context, command->count, command->rects);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_STREAM_OUTPUT_TARGETS:
+            {
+                const struct d3d11_command_set_stream_output_targets *command = (const void *)header;
+                ID3D11DeviceContext1_SOSetTargets(context, command->count, command->buffers, command->offsets);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_PREDICATION:
+            {
+                const struct d3d11_command_set_predication *command = (const void *)header;
+                ID3D11DeviceContext1_SetPredication(context, command->predicate, command->value);
+                break;
+            }
+
+            case D3D11_COMMAND_DRAW:
+            {
+                const struct d3d11_command_draw *command = (const void *)header;
+
+                if (command->indexed)
+                    ID3D11DeviceContext1_DrawIndexedInstanced(context, command->count, command->instance_count,
+                            command->start_idx, command->base_vertex_idx, command->start_instance);
+                else
+                    ID3D11DeviceContext1_DrawInstanced(context, command->count, command->instance_count,
+                            command->start_idx, command->start_instance);
+                break;
+            }
+
+            case D3D11_COMMAND_DRAW_AUTO:
+                ID3D11DeviceContext1_DrawAuto(context);
+                break;
+
+            case D3D11_COMMAND_DRAW_INDIRECT:
+            {
+                const struct d3d11_command_draw_indirect *command = (const void *)header;
+
+                if (command->indexed)
+                    ID3D11DeviceContext1_DrawIndexedInstancedIndirect(context, command->buffer, command->offset);
+                else
+                    ID3D11DeviceContext1_DrawInstancedIndirect(context, command->buffer, command->offset);
+                break;
+            }
+
+            case D3D11_COMMAND_DISPATCH:
+            {
+                const struct d3d11_command_dispatch *command = (const void *)header;
+                ID3D11DeviceContext1_Dispatch(context, command->x, command->y, command->z);
+                break;
+            }
+
+            case D3D11_COMMAND_DISPATCH_INDIRECT:
+            {
+                const struct d3d11_command_dispatch_indirect *command = (const void *)header;
+                ID3D11DeviceContext1_DispatchIndirect(context, command->buffer, command->offset);
+                break;
+            }
+
+            case D3D11_COMMAND_BEGIN_QUERY:
+            {
+                const struct d3d11_command_query *command = (const void *)header;
+                ID3D11DeviceContext1_Begin(context, command->asynchronous);
+                break;
+            }
+
+            case D3D11_COMMAND_END_QUERY:
+            {
+                const struct d3d11_command_query *command = (const void *)header;
+                ID3D11DeviceContext1_End(context, command->asynchronous);
+                break;
+            }
+
+            case D3D11_COMMAND_UPLOAD:
+                d3d11_command_upload_replay((const struct d3d11_command_upload *)header, context);
+                break;
+
+            case D3D11_COMMAND_UPDATE_SUBRESOURCE:
+            {
+                const struct d3d11_command_update_subresource *command = (const void *)header;
+                ID3D11DeviceContext1_UpdateSubresource1(context, command->resource, command->sub_resource_idx,
+                        command->has_box ? &command->box : NULL, command->data,
+                        command->row_pitch, command->depth_pitch, command->flags);
+                break;
+            }
+
+            case D3D11_COMMAND_COPY_SUBRESOURCE_REGION:
+            {
+                const struct d3d11_command_copy_subresource_region *command = (const void *)header;
+                ID3D11DeviceContext1_CopySubresourceRegion1(context, command->dst_resource,
+                        command->dst_sub_resource_idx, command->dst_x, command->dst_y, command->dst_z,
+                        command->src_resource, command->src_sub_resource_idx,
+                        command->has_box ? &command->box : NULL, command->flags);
+                break;
+            }
+
+            case D3D11_COMMAND_COPY_RESOURCE:
+            {
+                const struct d3d11_command_copy_resource *command = (const void *)header;
+                ID3D11DeviceContext1_CopyResource(context, command->dst_resource, command->src_resource);
+                break;
+            }
+
+            case D3D11_COMMAND_COPY_STRUCTURE_COUNT:
+            {
+                const struct d3d11_command_copy_structure_count *command = (const void *)header;
+                ID3D11DeviceContext1_CopyStructureCount(context, command->dst_buffer,
+                        command->dst_offset, command->src_view);
+                break;
+            }
+
+            case D3D11_COMMAND_CLEAR_RENDER_TARGET_VIEW:
+            {
+                const struct d3d11_command_clear_render_target_view *command = (const void *)header;
+                ID3D11DeviceContext1_ClearRenderTargetView(context, command->view, command->color);
+                break;
+            }
+
+            case D3D11_COMMAND_CLEAR_UNORDERED_ACCESS_VIEW_UINT:
+            {
+                const struct d3d11_command_clear_unordered_access_view *command = (const void *)header;
+                ID3D11DeviceContext1_ClearUnorderedAccessViewUint(context, command->view, command->values.u);
+                break;
+            }
+
+            case D3D11_COMMAND_CLEAR_UNORDERED_ACCESS_VIEW_FLOAT:
+            {
+                const struct d3d11_command_clear_unordered_access_view *command = (const void *)header;
+                ID3D11DeviceContext1_ClearUnorderedAccessViewFloat(context, command->view, command->values.f);
+                break;
+            }
+
+            case D3D11_COMMAND_CLEAR_DEPTH_STENCIL_VIEW:
+            {
+                const struct d3d11_command_clear_depth_stencil_view *command = (const void *)header;
+                ID3D11DeviceContext1_ClearDepthStencilView(context, command->view,
+                        command->flags, command->depth, command->stencil);
+                break;
+            }
+
+            case D3D11_COMMAND_CLEAR_VIEW:
+            {
+                const struct d3d11_command_clear_view *command = (const void *)header;
+                ID3D11DeviceContext1_ClearView(context, command->view, command->color,
+                        command->rect_count ? command->rects : NULL, command->rect_count);
+                break;
+            }
+
+            case D3D11_COMMAND_GENERATE_MIPS:
+            {
+                const struct d3d11_command_generate_mips *command = (const void *)header;
+                ID3D11DeviceContext1_GenerateMips(context, command->view);
+                break;
+            }
+
+            case D3D11_COMMAND_SET_RESOURCE_MIN_LOD:
+            {
+                const struct d3d11_command_set_resource_min_lod *command = (const void *)header;
+                ID3D11DeviceContext1_SetResourceMinLOD(context, command->resource, command->min_lod);
+                break;
+            }
+
+            case D3D11_COMMAND_RESOLVE_SUBRESOURCE:
+            {
+                const struct d3d11_command_resolve_subresource *command = (const void *)header;
+                ID3D11DeviceContext1_ResolveSubresource(context, command->dst_resource,
+                        command->dst_sub_resource_idx, command->src_resource,
+                        command->src_sub_resource_idx, command->format);
+                break;
+            }
+
+            case D3D11_COMMAND_CLEAR_STATE:
+                ID3D11DeviceContext1_ClearState(context);
+                break;
+
+            case D3D11_COMMAND_EXECUTE_COMMAND_LIST:
+            {
+                const struct d3d11_command_execute_command_list *command = (const void *)header;
+                d3d11_command_list_execute(unsafe_impl_from_ID3D11CommandList(command->command_list),
+                        context, command->restore_state);
+                break;
+            }
+
+            default:
+                ERR("Unhandled command %#x.\n", header->opcode);
+                break;
+        }
+    }
+}
+
+/* ID3D11CommandList methods */
+
+static inline struct d3d11_command_list *impl_from_ID3D11CommandList(ID3D11CommandList *iface)
+{
+    return CONTAINING_RECORD(iface, struct d3d11_command_list, ID3D11CommandList_iface);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_command_list_QueryInterface(ID3D11CommandList *iface,
+        REFIID iid, void **out)
+{
+    TRACE("iface %p, iid %s, out %p.\n", iface, debugstr_guid(iid), out);
+
+    if (IsEqualGUID(iid, &IID_ID3D11CommandList)
+            || IsEqualGUID(iid, &IID_ID3D11DeviceChild)
+            || IsEqualGUID(iid, &IID_IUnknown))
+    {
+        ID3D11CommandList_AddRef(iface);
+        *out = iface;
+        return S_OK;
+    }
+
+    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(iid));
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE d3d11_command_list_AddRef(ID3D11CommandList *iface)
+{
+    struct d3d11_command_list *list = impl_from_ID3D11CommandList(iface);
+    ULONG refcount = InterlockedIncrement(&list->refcount);
+
+    TRACE("%p increasing refcount to %u.\n", list, refcount);
+
+    return refcount;
+}
+
+static ULONG STDMETHODCALLTYPE d3d11_command_list_Release(ID3D11CommandList *iface)
+{
+    struct d3d11_command_list *list = impl_from_ID3D11CommandList(iface);
+    ULONG refcount = InterlockedDecrement(&list->refcount);
+
+    TRACE("%p decreasing refcount to %u.\n", list, refcount);
+
+    if (!refcount)
+    {
+        ID3D11Device2 *device = list->device;
+
+        d3d11_command_buffer_cleanup(&list->commands);
+        wined3d_private_store_cleanup(&list->private_store);
+        heap_free(list);
+        ID3D11Device2_Release(device);
+    }
+
+    return refcount;
+}
+
+static void STDMETHODCALLTYPE d3d11_command_list_GetDevice(ID3D11CommandList *iface, ID3D11Device **device)
+{
+    struct d3d11_command_list *list = impl_from_ID3D11CommandList(iface);
+
+    TRACE("iface %p, device %p.\n", iface, device);
+
+    *device = (ID3D11Device *)list->device;
+    ID3D11Device_AddRef(*device);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_command_list_GetPrivateData(ID3D11CommandList *iface,
+        REFGUID guid, UINT *data_size, void *data)
+{
+    struct d3d11_command_list *list = impl_from_ID3D11CommandList(iface);
+
+    TRACE("iface %p, guid %s, data_size %p, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+
+    return d3d_get_private_data(&list->private_store, guid, data_size, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_command_list_SetPrivateData(ID3D11CommandList *iface,
+        REFGUID guid, UINT data_size, const void *data)
+{
+    struct d3d11_command_list *list = impl_from_ID3D11CommandList(iface);
+
+    TRACE("iface %p, guid %s, data_size %u, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+
+    return d3d_set_private_data(&list->private_store, guid, data_size, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_command_list_SetPrivateDataInterface(ID3D11CommandList *iface,
+        REFGUID guid, const IUnknown *data)
+{
+    struct d3d11_command_list *list = impl_from_ID3D11CommandList(iface);
+
+    TRACE("iface %p, guid %s, data %p.\n", iface, debugstr_guid(guid), data);
+
+    return d3d_set_private_data_interface(&list->private_store, guid, data);
+}
+
+static UINT STDMETHODCALLTYPE d3d11_command_list_GetContextFlags(ID3D11CommandList *iface)
+{
+    struct d3d11_command_list *list = impl_from_ID3D11CommandList(iface);
+
+    TRACE("iface %p.\n", iface);
+
+    return list->context_flags;
+}
+
+static const struct ID3D11CommandListVtbl d3d11_command_list_vtbl =
+{
+    /* IUnknown methods */
+    d3d11_command_list_QueryInterface,
+    d3d11_command_list_AddRef,
+    d3d11_command_list_Release,
+    /* ID3D11DeviceChild methods */
+    d3d11_command_list_GetDevice,
+    d3d11_command_list_GetPrivateData,
+    d3d11_command_list_SetPrivateData,
+    d3d11_command_list_SetPrivateDataInterface,
+    /* ID3D11CommandList methods */
+    d3d11_command_list_GetContextFlags,
+};
+
+struct d3d11_command_list *unsafe_impl_from_ID3D11CommandList(ID3D11CommandList *iface)
+{
+    if (!iface)
+        return NULL;
+    assert(iface->lpVtbl == &d3d11_command_list_vtbl);
+    return impl_from_ID3D11CommandList(iface);
+}
+
+/* Command lists are replayed by the thread calling ExecuteCommandList(),
+ * under the wined3d mutex. Replaying only turns the recorded calls into
+ * wined3d command stream operations; the rendering itself still happens on
+ * the command stream thread. A command list always starts from the default
+ * pipeline state. */
+void d3d11_command_list_execute(struct d3d11_command_list *list, ID3D11DeviceContext1 *context,
+        BOOL restore_state)
+{
+    struct d3d11_context_state *state = NULL;
+
+    if (!list)
+    {
+        WARN("No command list.\n");
+        return;
+    }
+
+    if (restore_state && !(state = heap_alloc(sizeof(*state))))
+        ERR("Failed to allocate state, the context state will not be restored.\n");
+    if (state)
+        d3d11_context_state_capture(state, context);
+
+    ID3D11DeviceContext1_ClearState(context);
+    d3d11_command_buffer_replay(&list->commands, context);
+
+    if (state)
+    {
+        d3d11_context_state_apply(state, context);
+        d3d11_context_state_cleanup(state);
+        heap_free(state);
+    }
+    else
+    {
+        ID3D11DeviceContext1_ClearState(context);
+    }
+}
+
+static HRESULT d3d11_command_list_create(struct d3d11_deferred_context *context,
+        struct d3d11_command_list **list)
+{
+    struct d3d11_command_list *object;
+
+    if (!(object = heap_alloc_zero(sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    object->ID3D11CommandList_iface.lpVtbl = &d3d11_command_list_vtbl;
+    object->refcount = 1;
+    wined3d_private_store_init(&object->private_store);
+    object->device = &context->device->ID3D11Device2_iface;
+    ID3D11Device2_AddRef(object->device);
+    object->context_flags = context->flags;
+    object->commands = context->commands;
+    memset(&context->commands, 0, sizeof(context->commands));
+
+    TRACE("Created command list %p.\n", object);
+    *list = object;
+
+    return S_OK;
+}
+
+/* ID3D11DeviceContext - deferred context methods */
+
+static inline struct d3d11_deferred_context *impl_from_ID3D11DeviceContext1(ID3D11DeviceContext1 *iface)
+{
+    return CONTAINING_RECORD(iface, struct d3d11_deferred_context, ID3D11DeviceContext1_iface);
+}
+
+static void d3d11_set_object(void *slot, void *object)
+{
+    IUnknown **s = slot;
+
+    if (object)
+        IUnknown_AddRef((IUnknown *)object);
+    if (*s)
+        IUnknown_Release(*s);
+    *s = object;
+}
+
+static void d3d11_get_objects(void *const *slots, unsigned int slot_count,
+        unsigned int start_slot, unsigned int count, void **objects)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (start_slot + i >= slot_count)
+        {
+            objects[i] = NULL;
+            continue;
+        }
+        if ((objects[i] = slots[start_slot + i]))
+            IUnknown_AddRef((IUnknown *)objects[i]);
+    }
+}
+
+static void d3d11_deferred_mapping_destroy(struct d3d11_deferred_mapping *mapping)
+{
+    list_remove(&mapping->entry);
+    ID3D11Resource_Release(mapping->resource);
+    heap_free(mapping->shadow);
+    heap_free(mapping->data);
+    heap_free(mapping);
+}
+
+static void d3d11_deferred_context_reset_state(struct d3d11_deferred_context *context)
+{
+    d3d11_context_state_cleanup(&context->state);
+    d3d11_context_state_init(&context->state);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_deferred_context_QueryInterface(ID3D11DeviceContext1 *iface,
+        REFIID iid, void **out)
+{
+    TRACE("iface %p, iid %s, out %p.\n", iface, debugstr_guid(iid), out);
+
+    if (IsEqualGUID(iid, &IID_ID3D11DeviceContext1)
+            || IsEqualGUID(iid, &IID_ID3D11DeviceContext)
+            || IsEqualGUID(iid, &IID_ID3D11DeviceChild)
+            || IsEqualGUID(iid, &IID_IUnknown))
+    {
+        ID3D11DeviceContext1_AddRef(iface);
+        *out = iface;
+        return S_OK;
+    }
+
+    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(iid));
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE d3d11_deferred_context_AddRef(ID3D11DeviceContext1 *iface)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    ULONG refcount = InterlockedIncrement(&context->refcount);
+
+    TRACE("%p increasing refcount to %u.\n", context, refcount);
+
+    return refcount;
+}
+
+static ULONG STDMETHODCALLTYPE d3d11_deferred_context_Release(ID3D11DeviceContext1 *iface)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    ULONG refcount = InterlockedDecrement(&context->refcount);
+
+    TRACE("%p decreasing refcount to %u.\n", context, refcount);
+
+    if (!refcount)
+    {
+        struct d3d11_deferred_mapping *mapping, *next;
+        struct d3d_device *device = context->device;
+
+        LIST_FOR_EACH_ENTRY_SAFE(mapping, next, &context->mappings, struct d3d11_deferred_mapping, entry)
+        {
+            d3d11_deferred_mapping_destroy(mapping);
+        }
+        d3d11_command_buffer_cleanup(&context->commands);
+        d3d11_context_state_cleanup(&context->state);
+        wined3d_private_store_cleanup(&context->private_store);
+        heap_free(context);
+        ID3D11Device2_Release(&device->ID3D11Device2_iface);
+    }
+
+    return refcount;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GetDevice(ID3D11DeviceContext1 *iface, ID3D11Device **device)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, device %p.\n", iface, device);
+
+    *device = (ID3D11Device *)&context->device->ID3D11Device2_iface;
+    ID3D11Device_AddRef(*device);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_deferred_context_GetPrivateData(ID3D11DeviceContext1 *iface,
+        REFGUID guid, UINT *data_size, void *data)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, guid %s, data_size %p, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+
+    return d3d_get_private_data(&context->private_store, guid, data_size, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_deferred_context_SetPrivateData(ID3D11DeviceContext1 *iface,
+        REFGUID guid, UINT data_size, const void *data)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, guid %s, data_size %u, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+
+    return d3d_set_private_data(&context->private_store, guid, data_size, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_deferred_context_SetPrivateDataInterface(ID3D11DeviceContext1 *iface,
+        REFGUID guid, const IUnknown *data)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, guid %s, data %p.\n", iface, debugstr_guid(guid), data);
+
+    return d3d_set_private_data_interface(&context->private_store, guid, data);
+}
+
+static void d3d11_deferred_context_set_shader(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, void *shader, UINT class_instance_count)
+{
+    struct d3d11_command_set_shader *command;
+
+    if (class_instance_count)
+        FIXME("Dynamic linking is not implemented yet.\n");
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_SHADER, sizeof(*command))))
+    {
+        command->type = type;
+        command->shader = shader;
+        d3d11_command_buffer_add_object(&context->commands, shader);
+    }
+    d3d11_set_object(&context->state.shaders[type], shader);
+}
+
+static void d3d11_deferred_context_get_shader(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, void **shader, UINT *class_instance_count)
+{
+    if (class_instance_count)
+        *class_instance_count = 0;
+    if ((*shader = context->state.shaders[type]))
+        IUnknown_AddRef((IUnknown *)*shader);
+}
+
+static void d3d11_deferred_context_set_objects(struct d3d11_deferred_context *context,
+        enum d3d11_command_op opcode, enum wined3d_shader_type type, UINT start_slot, UINT count,
+        void *const *objects, void **slots, unsigned int slot_count)
+{
+    struct d3d11_command_set_objects *command;
+    unsigned int i;
+
+    if (start_slot > slot_count || count > slot_count - start_slot)
+    {
+        WARN("Invalid slot range %u, count %u.\n", start_slot, count);
+        return;
+    }
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands, opcode,
+            FIELD_OFFSET(struct d3d11_command_set_objects, objects[count]))))
+    {
+        command->type = type;
+        command->start_slot = start_slot;
+        command->count = count;
+        for (i = 0; i < count; ++i)
+        {
+            command->objects[i] = objects[i];
+            d3d11_command_buffer_add_object(&context->commands, objects[i]);
+        }
+    }
+    for (i = 0; i < count; ++i)
+        d3d11_set_object(&slots[start_slot + i], objects[i]);
+}
+
+static void d3d11_deferred_context_set_constant_buffers(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers)
+{
+    d3d11_deferred_context_set_objects(context, D3D11_COMMAND_SET_CONSTANT_BUFFERS, type,
+            start_slot, buffer_count, (void *const *)buffers, (void **)context->state.constant_buffers[type],
+            ARRAY_SIZE(context->state.constant_buffers[type]));
+}
+
+static void d3d11_deferred_context_set_shader_resources(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, UINT start_slot, UINT view_count, ID3D11ShaderResourceView *const *views)
+{
+    d3d11_deferred_context_set_objects(context, D3D11_COMMAND_SET_SHADER_RESOURCES, type,
+            start_slot, view_count, (void *const *)views, (void **)context->state.shader_resources[type],
+            ARRAY_SIZE(context->state.shader_resources[type]));
+}
+
+static void d3d11_deferred_context_set_samplers(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, UINT start_slot, UINT sampler_count, ID3D11SamplerState *const *samplers)
+{
+    d3d11_deferred_context_set_objects(context, D3D11_COMMAND_SET_SAMPLERS, type,
+            start_slot, sampler_count, (void *const *)samplers, (void **)context->state.samplers[type],
+            ARRAY_SIZE(context->state.samplers[type]));
+}
+
+static void d3d11_deferred_context_get_constant_buffers(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers)
+{
+    d3d11_get_objects((void *const *)context->state.constant_buffers[type],
+            ARRAY_SIZE(context->state.constant_buffers[type]), start_slot, buffer_count, (void **)buffers);
+}
+
+static void d3d11_deferred_context_get_shader_resources(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, UINT start_slot, UINT view_count, ID3D11ShaderResourceView **views)
+{
+    d3d11_get_objects((void *const *)context->state.shader_resources[type],
+            ARRAY_SIZE(context->state.shader_resources[type]), start_slot, view_count, (void **)views);
+}
+
+static void d3d11_deferred_context_get_samplers(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, UINT start_slot, UINT sampler_count, ID3D11SamplerState **samplers)
+{
+    d3d11_get_objects((void *const *)context->state.samplers[type],
+            ARRAY_SIZE(context->state.samplers[type]), start_slot, sampler_count, (void **)samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSSetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_set_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSSetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView *const *views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_set_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSSetShader(ID3D11DeviceContext1 *iface,
+        ID3D11PixelShader *shader, ID3D11ClassInstance *const *class_instances, UINT class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %u.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_set_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSSetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState *const *samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_set_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSSetShader(ID3D11DeviceContext1 *iface,
+        ID3D11VertexShader *shader, ID3D11ClassInstance *const *class_instances, UINT class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %u.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_set_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, shader, class_instance_count);
+}
+
+static void d3d11_deferred_context_draw(struct d3d11_deferred_context *context, BOOL indexed,
+        UINT count, UINT instance_count, UINT start_idx, INT base_vertex_idx, UINT start_instance)
+{
+    struct d3d11_command_draw *command;
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands, D3D11_COMMAND_DRAW, sizeof(*command))))
+        return;
+
+    command->indexed = indexed;
+    command->count = count;
+    command->instance_count = instance_count;
+    command->start_idx = start_idx;
+    command->base_vertex_idx = base_vertex_idx;
+    command->start_instance = start_instance;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DrawIndexed(ID3D11DeviceContext1 *iface,
+        UINT index_count, UINT start_index_location, INT base_vertex_location)
+{
+    TRACE("iface %p, index_count %u, start_index_location %u, base_vertex_location %d.\n",
+            iface, index_count, start_index_location, base_vertex_location);
+
+    d3d11_deferred_context_draw(impl_from_ID3D11DeviceContext1(iface), TRUE,
+            index_count, 1, start_index_location, base_vertex_location, 0);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_Draw(ID3D11DeviceContext1 *iface,
+        UINT vertex_count, UINT start_vertex_location)
+{
+    TRACE("iface %p, vertex_count %u, start_vertex_location %u.\n",
+            iface, vertex_count, start_vertex_location);
+
+    d3d11_deferred_context_draw(impl_from_ID3D11DeviceContext1(iface), FALSE,
+            vertex_count, 1, start_vertex_location, 0, 0);
+}
+
+static struct d3d11_deferred_mapping *d3d11_deferred_context_find_mapping(struct d3d11_deferred_context *context,
+        ID3D11Resource *resource, UINT sub_resource_idx)
+{
+    struct d3d11_deferred_mapping *mapping;
+
+    LIST_FOR_EACH_ENTRY(mapping, &context->mappings, struct d3d11_deferred_mapping, entry)
+    {
+        if (mapping->resource == resource && mapping->sub_resource_idx == sub_resource_idx)
+            return mapping;
+    }
+
+    return NULL;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_deferred_context_Map(ID3D11DeviceContext1 *iface, ID3D11Resource *resource,
+        UINT subresource_idx, D3D11_MAP map_type, UINT map_flags, D3D11_MAPPED_SUBRESOURCE *mapped_subresource)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_deferred_mapping *mapping;
+    struct wined3d_sub_resource_desc sub_desc;
+    struct wined3d_resource *wined3d_resource;
+    struct wined3d_resource_desc desc;
+    unsigned int row_pitch, slice_pitch;
+    struct wined3d_texture *texture;
+    UINT size;
+
+    TRACE("iface %p, resource %p, subresource_idx %u, map_type %u, map_flags %#x, mapped_subresource %p.\n",
+            iface, resource, subresource_idx, map_type, map_flags, mapped_subresource);
+
+    /* Deferred maps never wait for the GPU, so D3D11_MAP_FLAG_DO_NOT_WAIT
+     * has nothing to do. */
+    if (map_flags & ~D3D11_MAP_FLAG_DO_NOT_WAIT)
+    {
+        WARN("Invalid map flags %#x.\n", map_flags);
+        return E_INVALIDARG;
+    }
+
+    if (map_type != D3D11_MAP_WRITE_DISCARD && map_type != D3D11_MAP_WRITE_NO_OVERWRITE)
+    {
+        WARN("Invalid map type %#x for a deferred context.\n", map_type);
+        return E_INVALIDARG;
+    }
+
+    wined3d_resource = wined3d_resource_from_d3d11_resource(resource);
+
+    wined3d_mutex_lock();
+    wined3d_resource_get_desc(wined3d_resource, &desc);
+    if (desc.resource_type == WINED3D_RTYPE_BUFFER)
+    {
+        size = row_pitch = slice_pitch = desc.size;
+    }
+    else
+    {
+        texture = wined3d_texture_from_resource(wined3d_resource);
+        wined3d_texture_get_pitch(texture, subresource_idx % wined3d_texture_get_level_count(texture),
+                &row_pitch, &slice_pitch);
+        if (FAILED(wined3d_texture_get_sub_resource_desc(texture, subresource_idx, &sub_desc)))
+        {
+            wined3d_mutex_unlock();
+            WARN("Invalid sub-resource index %u.\n", subresource_idx);
+            return E_INVALIDARG;
+        }
+        size = slice_pitch * sub_desc.depth;
+    }
+    wined3d_mutex_unlock();
+
+    if ((mapping = d3d11_deferred_context_find_mapping(context, resource, subresource_idx)))
+    {
+        if (mapping->mapped)
+        {
+            WARN("Sub-resource %u of resource %p is already mapped.\n", subresource_idx, resource);
+            return E_INVALIDARG;
+        }
+    }
+    else
+    {
+        /* Only the data written since a previous discard on this command
+         * list can be appended to. */
+        if (map_type == D3D11_MAP_WRITE_NO_OVERWRITE)
+        {
+            WARN("D3D11_MAP_WRITE_NO_OVERWRITE without a prior D3D11_MAP_WRITE_DISCARD.\n");
+            return E_INVALIDARG;
+        }
+
+        if (!(mapping = heap_alloc_zero(sizeof(*mapping))))
+            return E_OUTOFMEMORY;
+        if (!(mapping->data = heap_alloc(size)) || (desc.resource_type == WINED3D_RTYPE_BUFFER
+                && !(mapping->shadow = heap_alloc(size))))
+        {
+            heap_free(mapping->data);
+            heap_free(mapping);
+            return E_OUTOFMEMORY;
+        }
+        mapping->resource = resource;
+        ID3D11Resource_AddRef(resource);
+        mapping->sub_resource_idx = subresource_idx;
+        mapping->size = size;
+        mapping->row_pitch = row_pitch;
+        mapping->slice_pitch = slice_pitch;
+        mapping->buffer = desc.resource_type == WINED3D_RTYPE_BUFFER;
+        list_add_tail(&context->mappings, &mapping->entry);
+    }
+
+    if (map_type == D3D11_MAP_WRITE_NO_OVERWRITE && !mapping->buffer)
+    {
+        WARN("D3D11_MAP_WRITE_NO_OVERWRITE is only supported for buffers.\n");
+        return E_INVALIDARG;
+    }
+
+    mapping->map_type = map_type;
+    mapping->mapped = TRUE;
+
+    mapped_subresource->pData = mapping->data;
+    mapped_subresource->RowPitch = mapping->row_pitch;
+    mapped_subresource->DepthPitch = mapping->slice_pitch;
+
+    return S_OK;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_Unmap(ID3D11DeviceContext1 *iface, ID3D11Resource *resource,
+        UINT subresource_idx)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_deferred_mapping *mapping;
+    struct d3d11_command_upload *command;
+    UINT start, end;
+
+    TRACE("iface %p, resource %p, subresource_idx %u.\n", iface, resource, subresource_idx);
+
+    if (!(mapping = d3d11_deferred_context_find_mapping(context, resource, subresource_idx)) || !mapping->mapped)
+    {
+        WARN("Sub-resource %u of resource %p is not mapped.\n", subresource_idx, resource);
+        return;
+    }
+    mapping->mapped = FALSE;
+
+    start = 0;
+    end = mapping->size;
+    if (mapping->map_type == D3D11_MAP_WRITE_NO_OVERWRITE)
+    {
+        /* Only upload the range that changed since the previous map. */
+        while (start < end && mapping->data[start] == mapping->shadow[start])
+            ++start;
+        while (end > start && mapping->data[end - 1] == mapping->shadow[end - 1])
+            --end;
+        if (start == end)
+            return;
+    }
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands, D3D11_COMMAND_UPLOAD,
+            FIELD_OFFSET(struct d3d11_command_upload, data[end - start]))))
+        return;
+
+    command->resource = resource;
+    d3d11_command_buffer_add_object(&context->commands, resource);
+    command->sub_resource_idx = subresource_idx;
+    command->map_type = mapping->map_type;
+    command->offset = start;
+    command->size = end - start;
+    memcpy(command->data, &mapping->data[start], end - start);
+    if (mapping->buffer)
+    {
+        memcpy(&mapping->shadow[start], &mapping->data[start], end - start);
+    }
+    else
+    {
+        command->row_pitch = mapping->row_pitch;
+        command->slice_pitch = mapping->slice_pitch;
+        command->row_count = mapping->slice_pitch / mapping->row_pitch;
+        command->slice_count = mapping->size / mapping->slice_pitch;
+    }
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSSetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_set_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_IASetInputLayout(ID3D11DeviceContext1 *iface,
+        ID3D11InputLayout *input_layout)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_input_layout *command;
+
+    TRACE("iface %p, input_layout %p.\n", iface, input_layout);
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_INPUT_LAYOUT, sizeof(*command))))
+    {
+        command->layout = input_layout;
+        d3d11_command_buffer_add_object(&context->commands, input_layout);
+    }
+    d3d11_set_object(&context->state.input_layout, input_layout);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_IASetVertexBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers, const UINT *strides, const UINT *offsets)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_vertex_buffers *command;
+    unsigned int i;
+
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, strides %p, offsets %p.\n",
+            iface, start_slot, buffer_count, buffers, strides, offsets);
+
+    if (start_slot > ARRAY_SIZE(context->state.vertex_buffers)
+            || buffer_count > ARRAY_SIZE(context->state.vertex_buffers) - start_slot)
+    {
+        WARN("Invalid slot range %u, count %u.\n", start_slot, buffer_count);
+        return;
+    }
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands, D3D11_COMMAND_SET_VERTEX_BUFFERS,
+            FIELD_OFFSET(struct d3d11_command_set_vertex_buffers, buffers[buffer_count]))))
+    {
+        command->start_slot = start_slot;
+        command->count = buffer_count;
+        for (i = 0; i < buffer_count; ++i)
+        {
+            command->buffers[i].buffer = buffers[i];
+            command->buffers[i].stride = strides[i];
+            command->buffers[i].offset = offsets[i];
+            d3d11_command_buffer_add_object(&context->commands, buffers[i]);
+        }
+    }
+    for (i = 0; i < buffer_count; ++i)
+    {
+        d3d11_set_object(&context->state.vertex_buffers[start_slot + i], buffers[i]);
+        context->state.strides[start_slot + i] = strides[i];
+        context->state.offsets[start_slot + i] = offsets[i];
+    }
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_IASetIndexBuffer(ID3D11DeviceContext1 *iface,
+        ID3D11Buffer *buffer, DXGI_FORMAT format, UINT offset)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_index_buffer *command;
+
+    TRACE("iface %p, buffer %p, format %s, offset %u.\n", iface, buffer, debug_dxgi_format(format), offset);
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_INDEX_BUFFER, sizeof(*command))))
+    {
+        command->buffer = buffer;
+        command->format = format;
+        command->offset = offset;
+        d3d11_command_buffer_add_object(&context->commands, buffer);
+    }
+    d3d11_set_object(&context->state.index_buffer, buffer);
+    context->state.index_format = format;
+    context->state.index_offset = offset;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DrawIndexedInstanced(ID3D11DeviceContext1 *iface,
+        UINT instance_index_count, UINT instance_count, UINT start_index_location, INT base_vertex_location,
+        UINT start_instance_location)
+{
+    TRACE("iface %p, instance_index_count %u, instance_count %u, start_index_location %u, "
+            "base_vertex_location %d, start_instance_location %u.\n",
+            iface, instance_index_count, instance_count, start_index_location,
+            base_vertex_location, start_instance_location);
+
+    d3d11_deferred_context_draw(impl_from_ID3D11DeviceContext1(iface), TRUE, instance_index_count,
+            instance_count, start_index_location, base_vertex_location, start_instance_location);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DrawInstanced(ID3D11DeviceContext1 *iface,
+        UINT instance_vertex_count, UINT instance_count, UINT start_vertex_location, UINT start_instance_location)
+{
+    TRACE("iface %p, instance_vertex_count %u, instance_count %u, start_vertex_location %u, "
+            "start_instance_location %u.\n",
+            iface, instance_vertex_count, instance_count, start_vertex_location,
+            start_instance_location);
+
+    d3d11_deferred_context_draw(impl_from_ID3D11DeviceContext1(iface), FALSE, instance_vertex_count,
+            instance_count, start_vertex_location, 0, start_instance_location);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSSetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_set_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSSetShader(ID3D11DeviceContext1 *iface,
+        ID3D11GeometryShader *shader, ID3D11ClassInstance *const *class_instances, UINT class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %u.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_set_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_IASetPrimitiveTopology(ID3D11DeviceContext1 *iface,
+        D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_primitive_topology *command;
+
+    TRACE("iface %p, topology %#x.\n", iface, topology);
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_PRIMITIVE_TOPOLOGY, sizeof(*command))))
+        command->topology = topology;
+    context->state.topology = topology;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSSetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView *const *views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_set_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSSetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState *const *samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_set_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, start_slot, sampler_count, samplers);
+}
+
+static void d3d11_deferred_context_query(struct d3d11_deferred_context *context,
+        enum d3d11_command_op opcode, ID3D11Asynchronous *asynchronous)
+{
+    struct d3d11_command_query *command;
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands, opcode, sizeof(*command))))
+        return;
+
+    command->asynchronous = asynchronous;
+    d3d11_command_buffer_add_object(&context->commands, asynchronous);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_Begin(ID3D11DeviceContext1 *iface,
+        ID3D11Asynchronous *asynchronous)
+{
+    TRACE("iface %p, asynchronous %p.\n", iface, asynchronous);
+
+    d3d11_deferred_context_query(impl_from_ID3D11DeviceContext1(iface), D3D11_COMMAND_BEGIN_QUERY, asynchronous);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_End(ID3D11DeviceContext1 *iface,
+        ID3D11Asynchronous *asynchronous)
+{
+    TRACE("iface %p, asynchronous %p.\n", iface, asynchronous);
+
+    d3d11_deferred_context_query(impl_from_ID3D11DeviceContext1(iface), D3D11_COMMAND_END_QUERY, asynchronous);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_deferred_context_GetData(ID3D11DeviceContext1 *iface,
+        ID3D11Asynchronous *asynchronous, void *data, UINT data_size, UINT data_flags)
+{
+    TRACE("iface %p, asynchronous %p, data %p, data_size %u, data_flags %#x.\n",
+            iface, asynchronous, data, data_size, data_flags);
+
+    WARN("Query data cannot be retrieved from a deferred context.\n");
+
+    return DXGI_ERROR_INVALID_CALL;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_SetPredication(ID3D11DeviceContext1 *iface,
+        ID3D11Predicate *predicate, BOOL value)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_predication *command;
+
+    TRACE("iface %p, predicate %p, value %#x.\n", iface, predicate, value);
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_PREDICATION, sizeof(*command))))
+    {
+        command->predicate = predicate;
+        command->value = value;
+        d3d11_command_buffer_add_object(&context->commands, predicate);
+    }
+    d3d11_set_object(&context->state.predicate, predicate);
+    context->state.predicate_value = value;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSSetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView *const *views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_set_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSSetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState *const *samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_set_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_OMSetRenderTargetsAndUnorderedAccessViews(
+        ID3D11DeviceContext1 *iface, UINT render_target_view_count,
+        ID3D11RenderTargetView *const *render_target_views, ID3D11DepthStencilView *depth_stencil_view,
+        UINT unordered_access_view_start_slot, UINT unordered_access_view_count,
+        ID3D11UnorderedAccessView *const *unordered_access_views, const UINT *initial_counts)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_render_targets_and_unordered_access_views *command;
+    struct d3d11_context_state *state = &context->state;
+    BOOL set_rtvs, set_uavs;
+    unsigned int i;
+
+    TRACE("iface %p, render_target_view_count %u, render_target_views %p, depth_stencil_view %p, "
+            "unordered_access_view_start_slot %u, unordered_access_view_count %u, unordered_access_views %p, "
+            "initial_counts %p.\n",
+            iface, render_target_view_count, render_target_views, depth_stencil_view,
+            unordered_access_view_start_slot, unordered_access_view_count, unordered_access_views,
+            initial_counts);
+
+    set_rtvs = render_target_view_count != D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL;
+    set_uavs = unordered_access_view_count != D3D11_KEEP_UNORDERED_ACCESS_VIEWS;
+
+    if (set_rtvs && render_target_view_count > ARRAY_SIZE(state->render_targets))
+    {
+        WARN("Invalid render target view count %u.\n", render_target_view_count);
+        return;
+    }
+    if (set_uavs && (unordered_access_view_start_slot > ARRAY_SIZE(state->unordered_access_views)
+            || unordered_access_view_count
+            > ARRAY_SIZE(state->unordered_access_views) - unordered_access_view_start_slot))
+    {
+        WARN("Invalid unordered access view range %u, count %u.\n",
+                unordered_access_view_start_slot, unordered_access_view_count);
+        return;
+    }
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_RENDER_TARGETS_AND_UNORDERED_ACCESS_VIEWS, sizeof(*command))))
+    {
+        command->render_target_view_count = render_target_view_count;
+        command->unordered_access_view_start_slot = unordered_access_view_start_slot;
+        command->unordered_access_view_count = unordered_access_view_count;
+        if (set_rtvs)
+        {
+            for (i = 0; i < render_target_view_count; ++i)
+            {
+                command->render_target_views[i] = render_target_views[i];
+                d3d11_command_buffer_add_object(&context->commands, render_target_views[i]);
+            }
+            command->depth_stencil_view = depth_stencil_view;
+            d3d11_command_buffer_add_object(&context->commands, depth_stencil_view);
+        }
+        if (set_uavs)
+        {
+            for (i = 0; i < unordered_access_view_count; ++i)
+            {
+                command->unordered_access_views[i] = unordered_access_views[i];
+                d3d11_command_buffer_add_object(&context->commands, unordered_access_views[i]);
+                if (initial_counts)
+                    command->initial_counts[i] = initial_counts[i];
+            }
+            command->has_initial_counts = !!initial_counts;
+        }
+    }
+
+    if (set_rtvs)
+    {
+        for (i = 0; i < ARRAY_SIZE(state->render_targets); ++i)
+            d3d11_set_object(&state->render_targets[i],
+                    i < render_target_view_count ? render_target_views[i] : NULL);
+        d3d11_set_object(&state->depth_stencil, depth_stencil_view);
+    }
+    if (set_uavs)
+    {
+        for (i = 0; i < ARRAY_SIZE(state->unordered_access_views); ++i)
+        {
+            ID3D11UnorderedAccessView *view = NULL;
+
+            if (i >= unordered_access_view_start_slot
+                    && i - unordered_access_view_start_slot < unordered_access_view_count)
+                view = unordered_access_views[i - unordered_access_view_start_slot];
+            d3d11_set_object(&state->unordered_access_views[i], view);
+        }
+    }
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_OMSetRenderTargets(ID3D11DeviceContext1 *iface,
+        UINT render_target_view_count, ID3D11RenderTargetView *const *render_target_views,
+        ID3D11DepthStencilView *depth_stencil_view)
+{
+    TRACE("iface %p, render_target_view_count %u, render_target_views %p, depth_stencil_view %p.\n",
+            iface, render_target_view_count, render_target_views, depth_stencil_view);
+
+    d3d11_deferred_context_OMSetRenderTargetsAndUnorderedAccessViews(iface, render_target_view_count,
+            render_target_views, depth_stencil_view, 0, D3D11_KEEP_UNORDERED_ACCESS_VIEWS, NULL, NULL);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_OMSetBlendState(ID3D11DeviceContext1 *iface,
+        ID3D11BlendState *blend_state, const float blend_factor[4], UINT sample_mask)
+{
+    static const float default_blend_factor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_blend_state *command;
+
+    TRACE("iface %p, blend_state %p, blend_factor %s, sample_mask 0x%08x.\n",
+            iface, blend_state, debug_float4(blend_factor), sample_mask);
+
+    if (!blend_factor)
+        blend_factor = default_blend_factor;
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_BLEND_STATE, sizeof(*command))))
+    {
+        command->state = blend_state;
+        memcpy(command->blend_factor, blend_factor, sizeof(command->blend_factor));
+        command->sample_mask = sample_mask;
+        d3d11_command_buffer_add_object(&context->commands, blend_state);
+    }
+    d3d11_set_object(&context->state.blend_state, blend_state);
+    memmove(context->state.blend_factor, blend_factor, sizeof(context->state.blend_factor));
+    context->state.sample_mask = sample_mask;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_OMSetDepthStencilState(ID3D11DeviceContext1 *iface,
+        ID3D11DepthStencilState *depth_stencil_state, UINT stencil_ref)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_depth_stencil_state *command;
+
+    TRACE("iface %p, depth_stencil_state %p, stencil_ref %u.\n",
+            iface, depth_stencil_state, stencil_ref);
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_DEPTH_STENCIL_STATE, sizeof(*command))))
+    {
+        command->state = depth_stencil_state;
+        command->stencil_ref = stencil_ref;
+        d3d11_command_buffer_add_object(&context->commands, depth_stencil_state);
+    }
+    d3d11_set_object(&context->state.depth_stencil_state, depth_stencil_state);
+    context->state.stencil_ref = stencil_ref;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_SOSetTargets(ID3D11DeviceContext1 *iface, UINT buffer_count,
+        ID3D11Buffer *const *buffers, const UINT *offsets)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_stream_output_targets *command;
+    unsigned int count, i;
+
+    TRACE("iface %p, buffer_count %u, buffers %p, offsets %p.\n", iface, buffer_count, buffers, offsets);
+
+    count = min(buffer_count, D3D11_SO_BUFFER_SLOT_COUNT);
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_STREAM_OUTPUT_TARGETS, sizeof(*command))))
+    {
+        command->count = count;
+        for (i = 0; i < count; ++i)
+        {
+            command->buffers[i] = buffers[i];
+            command->offsets[i] = offsets ? offsets[i] : 0;
+            d3d11_command_buffer_add_object(&context->commands, buffers[i]);
+        }
+    }
+    for (i = 0; i < D3D11_SO_BUFFER_SLOT_COUNT; ++i)
+        d3d11_set_object(&context->state.so_buffers[i], i < count ? buffers[i] : NULL);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DrawAuto(ID3D11DeviceContext1 *iface)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p.\n", iface);
+
+    d3d11_command_buffer_require_space(&context->commands, D3D11_COMMAND_DRAW_AUTO, sizeof(struct d3d11_command));
+}
+
+static void d3d11_deferred_context_draw_indirect(struct d3d11_deferred_context *context,
+        BOOL indexed, ID3D11Buffer *buffer, UINT offset)
+{
+    struct d3d11_command_draw_indirect *command;
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_DRAW_INDIRECT, sizeof(*command))))
+        return;
+
+    command->indexed = indexed;
+    command->buffer = buffer;
+    command->offset = offset;
+    d3d11_command_buffer_add_object(&context->commands, buffer);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DrawIndexedInstancedIndirect(ID3D11DeviceContext1 *iface,
+        ID3D11Buffer *buffer, UINT offset)
+{
+    TRACE("iface %p, buffer %p, offset %u.\n", iface, buffer, offset);
+
+    d3d11_deferred_context_draw_indirect(impl_from_ID3D11DeviceContext1(iface), TRUE, buffer, offset);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DrawInstancedIndirect(ID3D11DeviceContext1 *iface,
+        ID3D11Buffer *buffer, UINT offset)
+{
+    TRACE("iface %p, buffer %p, offset %u.\n", iface, buffer, offset);
+
+    d3d11_deferred_context_draw_indirect(impl_from_ID3D11DeviceContext1(iface), FALSE, buffer, offset);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_Dispatch(ID3D11DeviceContext1 *iface,
+        UINT thread_group_count_x, UINT thread_group_count_y, UINT thread_group_count_z)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_dispatch *command;
+
+    TRACE("iface %p, thread_group_count_x %u, thread_group_count_y %u, thread_group_count_z %u.\n",
+            iface, thread_group_count_x, thread_group_count_y, thread_group_count_z);
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_DISPATCH, sizeof(*command))))
+        return;
+
+    command->x = thread_group_count_x;
+    command->y = thread_group_count_y;
+    command->z = thread_group_count_z;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DispatchIndirect(ID3D11DeviceContext1 *iface,
+        ID3D11Buffer *buffer, UINT offset)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_dispatch_indirect *command;
+
+    TRACE("iface %p, buffer %p, offset %u.\n", iface, buffer, offset);
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_DISPATCH_INDIRECT, sizeof(*command))))
+        return;
+
+    command->buffer = buffer;
+    command->offset = offset;
+    d3d11_command_buffer_add_object(&context->commands, buffer);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_RSSetState(ID3D11DeviceContext1 *iface,
+        ID3D11RasterizerState *rasterizer_state)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_rasterizer_state *command;
+
+    TRACE("iface %p, rasterizer_state %p.\n", iface, rasterizer_state);
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_RASTERIZER_STATE, sizeof(*command))))
+    {
+        command->state = rasterizer_state;
+        d3d11_command_buffer_add_object(&context->commands, rasterizer_state);
+    }
+    d3d11_set_object(&context->state.rasterizer_state, rasterizer_state);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_RSSetViewports(ID3D11DeviceContext1 *iface,
+        UINT viewport_count, const D3D11_VIEWPORT *viewports)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_viewports *command;
+
+    TRACE("iface %p, viewport_count %u, viewports %p.\n", iface, viewport_count, viewports);
+
+    if (viewport_count > ARRAY_SIZE(context->state.viewports))
+    {
+        WARN("Invalid viewport count %u.\n", viewport_count);
+        return;
+    }
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_VIEWPORTS, sizeof(*command))))
+    {
+        command->count = viewport_count;
+        memcpy(command->viewports, viewports, viewport_count * sizeof(*viewports));
+    }
+    memmove(context->state.viewports, viewports, viewport_count * sizeof(*viewports));
+    context->state.viewport_count = viewport_count;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_RSSetScissorRects(ID3D11DeviceContext1 *iface,
+        UINT rect_count, const D3D11_RECT *rects)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_scissor_rects *command;
+
+    TRACE("iface %p, rect_count %u, rects %p.\n", iface, rect_count, rects);
+
+    if (rect_count > ARRAY_SIZE(context->state.scissor_rects))
+    {
+        WARN("Invalid scissor rect count %u.\n", rect_count);
+        return;
+    }
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_SCISSOR_RECTS, sizeof(*command))))
+    {
+        command->count = rect_count;
+        memcpy(command->rects, rects, rect_count * sizeof(*rects));
+    }
+    memmove(context->state.scissor_rects, rects, rect_count * sizeof(*rects));
+    context->state.scissor_rect_count = rect_count;
+}
+
+static void d3d11_deferred_context_copy_subresource_region(struct d3d11_deferred_context *context,
+        ID3D11Resource *dst_resource, UINT dst_subresource_idx, UINT dst_x, UINT dst_y, UINT dst_z,
+        ID3D11Resource *src_resource, UINT src_subresource_idx, const D3D11_BOX *src_box, UINT flags)
+{
+    struct d3d11_command_copy_subresource_region *command;
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_COPY_SUBRESOURCE_REGION, sizeof(*command))))
+        return;
+
+    command->dst_resource = dst_resource;
+    command->dst_sub_resource_idx = dst_subresource_idx;
+    command->dst_x = dst_x;
+    command->dst_y = dst_y;
+    command->dst_z = dst_z;
+    command->src_resource = src_resource;
+    command->src_sub_resource_idx = src_subresource_idx;
+    if ((command->has_box = !!src_box))
+        command->box = *src_box;
+    command->flags = flags;
+    d3d11_command_buffer_add_object(&context->commands, dst_resource);
+    d3d11_command_buffer_add_object(&context->commands, src_resource);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CopySubresourceRegion(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *dst_resource, UINT dst_subresource_idx, UINT dst_x, UINT dst_y, UINT dst_z,
+        ID3D11Resource *src_resource, UINT src_subresource_idx, const D3D11_BOX *src_box)
+{
+    TRACE("iface %p, dst_resource %p, dst_subresource_idx %u, dst_x %u, dst_y %u, dst_z %u, "
+            "src_resource %p, src_subresource_idx %u, src_box %p.\n",
+            iface, dst_resource, dst_subresource_idx, dst_x, dst_y, dst_z,
+            src_resource, src_subresource_idx, src_box);
+
+    d3d11_deferred_context_copy_subresource_region(impl_from_ID3D11DeviceContext1(iface),
+            dst_resource, dst_subresource_idx, dst_x, dst_y, dst_z,
+            src_resource, src_subresource_idx, src_box, 0);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CopyResource(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *dst_resource, ID3D11Resource *src_resource)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_copy_resource *command;
+
+    TRACE("iface %p, dst_resource %p, src_resource %p.\n", iface, dst_resource, src_resource);
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_COPY_RESOURCE, sizeof(*command))))
+        return;
+
+    command->dst_resource = dst_resource;
+    command->src_resource = src_resource;
+    d3d11_command_buffer_add_object(&context->commands, dst_resource);
+    d3d11_command_buffer_add_object(&context->commands, src_resource);
+}
+
+static unsigned int wined3d_format_block_height(enum wined3d_format_id format_id)
+{
+    switch (format_id)
+    {
+        case WINED3DFMT_BC1_TYPELESS:
+        case WINED3DFMT_BC1_UNORM:
+        case WINED3DFMT_BC1_UNORM_SRGB:
+        case WINED3DFMT_BC2_TYPELESS:
+        case WINED3DFMT_BC2_UNORM:
+        case WINED3DFMT_BC2_UNORM_SRGB:
+        case WINED3DFMT_BC3_TYPELESS:
+        case WINED3DFMT_BC3_UNORM:
+        case WINED3DFMT_BC3_UNORM_SRGB:
+        case WINED3DFMT_BC4_TYPELESS:
+        case WINED3DFMT_BC4_UNORM:
+        case WINED3DFMT_BC4_SNORM:
+        case WINED3DFMT_BC5_TYPELESS:
+        case WINED3DFMT_BC5_UNORM:
+        case WINED3DFMT_BC5_SNORM:
+        case WINED3DFMT_BC6H_TYPELESS:
+        case WINED3DFMT_BC6H_UF16:
+        case WINED3DFMT_BC6H_SF16:
+        case WINED3DFMT_BC7_TYPELESS:
+        case WINED3DFMT_BC7_UNORM:
+        case WINED3DFMT_BC7_UNORM_SRGB:
+            return 4;
+
+        default:
+            return 1;
+    }
+}
+
+/* Returns the number of bytes UpdateSubresource() reads from the source
+ * data, or 0 if the destination region is empty. */
+static SIZE_T d3d11_deferred_context_get_update_size(struct d3d11_deferred_context *context,
+        ID3D11Resource *resource, UINT subresource_idx, const D3D11_BOX *box, UINT row_pitch, UINT depth_pitch)
+{
+    struct wined3d_device_creation_parameters params;
+    unsigned int width, height, depth, block_height;
+    struct wined3d_sub_resource_desc sub_desc;
+    struct wined3d_resource *wined3d_resource;
+    struct wined3d_resource_desc desc;
+    SIZE_T row_size, size;
+
+    wined3d_resource = wined3d_resource_from_d3d11_resource(resource);
+
+    wined3d_mutex_lock();
+    wined3d_resource_get_desc(wined3d_resource, &desc);
+    if (desc.resource_type == WINED3D_RTYPE_BUFFER)
+    {
+        wined3d_mutex_unlock();
+        if (!box)
+            return desc.size;
+        return box->right > box->left ? box->right - box->left : 0;
+    }
+
+    if (FAILED(wined3d_texture_get_sub_resource_desc(wined3d_texture_from_resource(wined3d_resource),
+            subresource_idx, &sub_desc)))
+    {
+        wined3d_mutex_unlock();
+        WARN("Invalid sub-resource index %u.\n", subresource_idx);
+        return 0;
+    }
+
+    if (box)
+    {
+        if (box->right <= box->left || box->bottom <= box->top || box->back <= box->front)
+        {
+            wined3d_mutex_unlock();
+            return 0;
+        }
+        width = box->right - box->left;
+        height = box->bottom - box->top;
+        depth = box->back - box->front;
+    }
+    else
+    {
+        width = sub_desc.width;
+        height = sub_desc.height;
+        depth = sub_desc.depth;
+    }
+
+    wined3d_device_get_creation_parameters(context->device->wined3d_device, &params);
+    row_size = wined3d_calculate_format_pitch(wined3d_device_get_wined3d(context->device->wined3d_device),
+            params.adapter_idx, desc.format, width);
+    wined3d_mutex_unlock();
+
+    block_height = wined3d_format_block_height(desc.format);
+    height = (height + block_height - 1) / block_height;
+    size = (SIZE_T)(depth - 1) * depth_pitch + (SIZE_T)(height - 1) * row_pitch + row_size;
+
+    return size;
+}
+
+static void d3d11_deferred_context_update_subresource(struct d3d11_deferred_context *context,
+        ID3D11Resource *resource, UINT subresource_idx, const D3D11_BOX *box, const void *data,
+        UINT row_pitch, UINT depth_pitch, UINT flags)
+{
+    struct d3d11_command_update_subresource *command;
+    SIZE_T size;
+
+    if (!(size = d3d11_deferred_context_get_update_size(context, resource,
+            subresource_idx, box, row_pitch, depth_pitch)))
+        return;
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_UPDATE_SUBRESOURCE, FIELD_OFFSET(struct d3d11_command_update_subresource, data[size]))))
+        return;
+
+    command->resource = resource;
+    command->sub_resource_idx = subresource_idx;
+    if ((command->has_box = !!box))
+        command->box = *box;
+    command->row_pitch = row_pitch;
+    command->depth_pitch = depth_pitch;
+    command->flags = flags;
+    memcpy(command->data, data, size);
+    d3d11_command_buffer_add_object(&context->commands, resource);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_UpdateSubresource(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *resource, UINT subresource_idx, const D3D11_BOX *box,
+        const void *data, UINT row_pitch, UINT depth_pitch)
+{
+    TRACE("iface %p, resource %p, subresource_idx %u, box %p, data %p, row_pitch %u, depth_pitch %u.\n",
+            iface, resource, subresource_idx, box, data, row_pitch, depth_pitch);
+
+    d3d11_deferred_context_update_subresource(impl_from_ID3D11DeviceContext1(iface),
+            resource, subresource_idx, box, data, row_pitch, depth_pitch, 0);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CopyStructureCount(ID3D11DeviceContext1 *iface,
+        ID3D11Buffer *dst_buffer, UINT dst_offset, ID3D11UnorderedAccessView *src_view)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_copy_structure_count *command;
+
+    TRACE("iface %p, dst_buffer %p, dst_offset %u, src_view %p.\n",
+            iface, dst_buffer, dst_offset, src_view);
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_COPY_STRUCTURE_COUNT, sizeof(*command))))
+        return;
+
+    command->dst_buffer = dst_buffer;
+    command->dst_offset = dst_offset;
+    command->src_view = src_view;
+    d3d11_command_buffer_add_object(&context->commands, dst_buffer);
+    d3d11_command_buffer_add_object(&context->commands, src_view);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_ClearRenderTargetView(ID3D11DeviceContext1 *iface,
+        ID3D11RenderTargetView *render_target_view, const float color_rgba[4])
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_clear_render_target_view *command;
+
+    TRACE("iface %p, render_target_view %p, color_rgba %s.\n",
+            iface, render_target_view, debug_float4(color_rgba));
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_CLEAR_RENDER_TARGET_VIEW, sizeof(*command))))
+        return;
+
+    command->view = render_target_view;
+    memcpy(command->color, color_rgba, sizeof(command->color));
+    d3d11_command_buffer_add_object(&context->commands, render_target_view);
+}
+
+static void d3d11_deferred_context_clear_unordered_access_view(struct d3d11_deferred_context *context,
+        enum d3d11_command_op opcode, ID3D11UnorderedAccessView *view, const void *values)
+{
+    struct d3d11_command_clear_unordered_access_view *command;
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands, opcode, sizeof(*command))))
+        return;
+
+    command->view = view;
+    memcpy(&command->values, values, sizeof(command->values));
+    d3d11_command_buffer_add_object(&context->commands, view);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_ClearUnorderedAccessViewUint(ID3D11DeviceContext1 *iface,
+        ID3D11UnorderedAccessView *unordered_access_view, const UINT values[4])
+{
+    TRACE("iface %p, unordered_access_view %p, values {%u, %u, %u, %u}.\n",
+            iface, unordered_access_view, values[0], values[1], values[2], values[3]);
+
+    d3d11_deferred_context_clear_unordered_access_view(impl_from_ID3D11DeviceContext1(iface),
+            D3D11_COMMAND_CLEAR_UNORDERED_ACCESS_VIEW_UINT, unordered_access_view, values);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_ClearUnorderedAccessViewFloat(ID3D11DeviceContext1 *iface,
+        ID3D11UnorderedAccessView *unordered_access_view, const float values[4])
+{
+    TRACE("iface %p, unordered_access_view %p, values %s.\n",
+            iface, unordered_access_view, debug_float4(values));
+
+    d3d11_deferred_context_clear_unordered_access_view(impl_from_ID3D11DeviceContext1(iface),
+            D3D11_COMMAND_CLEAR_UNORDERED_ACCESS_VIEW_FLOAT, unordered_access_view, values);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_ClearDepthStencilView(ID3D11DeviceContext1 *iface,
+        ID3D11DepthStencilView *depth_stencil_view, UINT flags, FLOAT depth, UINT8 stencil)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_clear_depth_stencil_view *command;
+
+    TRACE("iface %p, depth_stencil_view %p, flags %#x, depth %.8e, stencil %u.\n",
+            iface, depth_stencil_view, flags, depth, stencil);
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_CLEAR_DEPTH_STENCIL_VIEW, sizeof(*command))))
+        return;
+
+    command->view = depth_stencil_view;
+    command->flags = flags;
+    command->depth = depth;
+    command->stencil = stencil;
+    d3d11_command_buffer_add_object(&context->commands, depth_stencil_view);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GenerateMips(ID3D11DeviceContext1 *iface,
+        ID3D11ShaderResourceView *view)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_generate_mips *command;
+
+    TRACE("iface %p, view %p.\n", iface, view);
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_GENERATE_MIPS, sizeof(*command))))
+        return;
+
+    command->view = view;
+    d3d11_command_buffer_add_object(&context->commands, view);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_SetResourceMinLOD(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *resource, FLOAT min_lod)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_resource_min_lod *command;
+
+    TRACE("iface %p, resource %p, min_lod %.8e.\n", iface, resource, min_lod);
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_RESOURCE_MIN_LOD, sizeof(*command))))
+        return;
+
+    command->resource = resource;
+    command->min_lod = min_lod;
+    d3d11_command_buffer_add_object(&context->commands, resource);
+}
+
+static FLOAT STDMETHODCALLTYPE d3d11_deferred_context_GetResourceMinLOD(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *resource)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, resource %p.\n", iface, resource);
+
+    /* The minimum LOD is a property of the resource, not of the context. */
+    return ID3D11DeviceContext1_GetResourceMinLOD(&context->device->immediate_context.ID3D11DeviceContext1_iface,
+            resource);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_ResolveSubresource(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *dst_resource, UINT dst_subresource_idx,
+        ID3D11Resource *src_resource, UINT src_subresource_idx,
+        DXGI_FORMAT format)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_resolve_subresource *command;
+
+    TRACE("iface %p, dst_resource %p, dst_subresource_idx %u, src_resource %p, src_subresource_idx %u, "
+            "format %s.\n",
+            iface, dst_resource, dst_subresource_idx, src_resource, src_subresource_idx,
+            debug_dxgi_format(format));
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_RESOLVE_SUBRESOURCE, sizeof(*command))))
+        return;
+
+    command->dst_resource = dst_resource;
+    command->dst_sub_resource_idx = dst_subresource_idx;
+    command->src_resource = src_resource;
+    command->src_sub_resource_idx = src_subresource_idx;
+    command->format = format;
+    d3d11_command_buffer_add_object(&context->commands, dst_resource);
+    d3d11_command_buffer_add_object(&context->commands, src_resource);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_ExecuteCommandList(ID3D11DeviceContext1 *iface,
+        ID3D11CommandList *command_list, BOOL restore_state)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_execute_command_list *command;
+
+    TRACE("iface %p, command_list %p, restore_state %#x.\n", iface, command_list, restore_state);
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_EXECUTE_COMMAND_LIST, sizeof(*command))))
+    {
+        command->command_list = command_list;
+        command->restore_state = restore_state;
+        d3d11_command_buffer_add_object(&context->commands, command_list);
+    }
+    if (!restore_state)
+        d3d11_deferred_context_reset_state(context);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSSetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView *const *views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_set_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSSetShader(ID3D11DeviceContext1 *iface,
+        ID3D11HullShader *shader, ID3D11ClassInstance *const *class_instances, UINT class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %u.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_set_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSSetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState *const *samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_set_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSSetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_set_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSSetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView *const *views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_set_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSSetShader(ID3D11DeviceContext1 *iface,
+        ID3D11DomainShader *shader, ID3D11ClassInstance *const *class_instances, UINT class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %u.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_set_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSSetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState *const *samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_set_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSSetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_set_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSSetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView *const *views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_set_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSSetUnorderedAccessViews(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11UnorderedAccessView *const *views, const UINT *initial_counts)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_set_cs_unordered_access_views *command;
+    unsigned int i;
+
+    TRACE("iface %p, start_slot %u, view_count %u, views %p, initial_counts %p.\n",
+            iface, start_slot, view_count, views, initial_counts);
+
+    if (start_slot > ARRAY_SIZE(context->state.cs_unordered_access_views)
+            || view_count > ARRAY_SIZE(context->state.cs_unordered_access_views) - start_slot)
+    {
+        WARN("Invalid slot range %u, count %u.\n", start_slot, view_count);
+        return;
+    }
+
+    if ((command = d3d11_command_buffer_require_space(&context->commands,
+            D3D11_COMMAND_SET_CS_UNORDERED_ACCESS_VIEWS, sizeof(*command))))
+    {
+        command->start_slot = start_slot;
+        command->count = view_count;
+        for (i = 0; i < view_count; ++i)
+        {
+            command->views[i] = views[i];
+            d3d11_command_buffer_add_object(&context->commands, views[i]);
+            if (initial_counts)
+                command->initial_counts[i] = initial_counts[i];
+        }
+        command->has_initial_counts = !!initial_counts;
+    }
+    for (i = 0; i < view_count; ++i)
+        d3d11_set_object(&context->state.cs_unordered_access_views[start_slot + i], views[i]);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSSetShader(ID3D11DeviceContext1 *iface,
+        ID3D11ComputeShader *shader, ID3D11ClassInstance *const *class_instances, UINT class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %u.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_set_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSSetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState *const *samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_set_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSSetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_set_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSGetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_get_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSGetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView **views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_get_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSGetShader(ID3D11DeviceContext1 *iface,
+        ID3D11PixelShader **shader, ID3D11ClassInstance **class_instances, UINT *class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %p.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_get_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, (void **)shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSGetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState **samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_get_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSGetShader(ID3D11DeviceContext1 *iface,
+        ID3D11VertexShader **shader, ID3D11ClassInstance **class_instances, UINT *class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %p.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_get_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, (void **)shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSGetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_get_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_IAGetInputLayout(ID3D11DeviceContext1 *iface,
+        ID3D11InputLayout **input_layout)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, input_layout %p.\n", iface, input_layout);
+
+    if ((*input_layout = context->state.input_layout))
+        ID3D11InputLayout_AddRef(*input_layout);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_IAGetVertexBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers, UINT *strides, UINT *offsets)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_context_state *state = &context->state;
+    unsigned int i;
+
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, strides %p, offsets %p.\n",
+            iface, start_slot, buffer_count, buffers, strides, offsets);
+
+    if (buffers)
+        d3d11_get_objects((void *const *)state->vertex_buffers, ARRAY_SIZE(state->vertex_buffers),
+                start_slot, buffer_count, (void **)buffers);
+    for (i = 0; i < buffer_count; ++i)
+    {
+        BOOL valid = start_slot + i < ARRAY_SIZE(state->vertex_buffers);
+
+        if (strides)
+            strides[i] = valid ? state->strides[start_slot + i] : 0;
+        if (offsets)
+            offsets[i] = valid ? state->offsets[start_slot + i] : 0;
+    }
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_IAGetIndexBuffer(ID3D11DeviceContext1 *iface,
+        ID3D11Buffer **buffer, DXGI_FORMAT *format, UINT *offset)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, buffer %p, format %p, offset %p.\n", iface, buffer, format, offset);
+
+    if (buffer && (*buffer = context->state.index_buffer))
+        ID3D11Buffer_AddRef(*buffer);
+    if (format)
+        *format = context->state.index_format;
+    if (offset)
+        *offset = context->state.index_offset;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSGetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_get_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSGetShader(ID3D11DeviceContext1 *iface,
+        ID3D11GeometryShader **shader, ID3D11ClassInstance **class_instances, UINT *class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %p.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_get_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, (void **)shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_IAGetPrimitiveTopology(ID3D11DeviceContext1 *iface,
+        D3D11_PRIMITIVE_TOPOLOGY *topology)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, topology %p.\n", iface, topology);
+
+    *topology = context->state.topology;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSGetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView **views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_get_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSGetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState **samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_get_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GetPredication(ID3D11DeviceContext1 *iface,
+        ID3D11Predicate **predicate, BOOL *value)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, predicate %p, value %p.\n", iface, predicate, value);
+
+    if (predicate && (*predicate = context->state.predicate))
+        ID3D11Predicate_AddRef(*predicate);
+    if (value)
+        *value = context->state.predicate_value;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSGetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView **views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_get_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSGetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState **samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_get_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_OMGetRenderTargets(ID3D11DeviceContext1 *iface,
+        UINT render_target_view_count, ID3D11RenderTargetView **render_target_views,
+        ID3D11DepthStencilView **depth_stencil_view)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, render_target_view_count %u, render_target_views %p, depth_stencil_view %p.\n",
+            iface, render_target_view_count, render_target_views, depth_stencil_view);
+
+    if (render_target_views)
+        d3d11_get_objects((void *const *)context->state.render_targets,
+                ARRAY_SIZE(context->state.render_targets), 0, render_target_view_count,
+                (void **)render_target_views);
+    if (depth_stencil_view && (*depth_stencil_view = context->state.depth_stencil))
+        ID3D11DepthStencilView_AddRef(*depth_stencil_view);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_OMGetRenderTargetsAndUnorderedAccessViews(
+        ID3D11DeviceContext1 *iface,
+        UINT render_target_view_count, ID3D11RenderTargetView **render_target_views,
+        ID3D11DepthStencilView **depth_stencil_view,
+        UINT unordered_access_view_start_slot, UINT unordered_access_view_count,
+        ID3D11UnorderedAccessView **unordered_access_views)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, render_target_view_count %u, render_target_views %p, depth_stencil_view %p, "
+            "unordered_access_view_start_slot %u, unordered_access_view_count %u, "
+            "unordered_access_views %p.\n",
+            iface, render_target_view_count, render_target_views, depth_stencil_view,
+            unordered_access_view_start_slot, unordered_access_view_count, unordered_access_views);
+
+    d3d11_deferred_context_OMGetRenderTargets(iface, render_target_view_count,
+            render_target_views, depth_stencil_view);
+    if (unordered_access_views)
+        d3d11_get_objects((void *const *)context->state.unordered_access_views,
+                ARRAY_SIZE(context->state.unordered_access_views), unordered_access_view_start_slot,
+                unordered_access_view_count, (void **)unordered_access_views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_OMGetBlendState(ID3D11DeviceContext1 *iface,
+        ID3D11BlendState **blend_state, FLOAT blend_factor[4], UINT *sample_mask)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, blend_state %p, blend_factor %p, sample_mask %p.\n",
+            iface, blend_state, blend_factor, sample_mask);
+
+    if (blend_state && (*blend_state = context->state.blend_state))
+        ID3D11BlendState_AddRef(*blend_state);
+    if (blend_factor)
+        memcpy(blend_factor, context->state.blend_factor, sizeof(context->state.blend_factor));
+    if (sample_mask)
+        *sample_mask = context->state.sample_mask;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_OMGetDepthStencilState(ID3D11DeviceContext1 *iface,
+        ID3D11DepthStencilState **depth_stencil_state, UINT *stencil_ref)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, depth_stencil_state %p, stencil_ref %p.\n",
+            iface, depth_stencil_state, stencil_ref);
+
+    if (depth_stencil_state && (*depth_stencil_state = context->state.depth_stencil_state))
+        ID3D11DepthStencilState_AddRef(*depth_stencil_state);
+    if (stencil_ref)
+        *stencil_ref = context->state.stencil_ref;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_SOGetTargets(ID3D11DeviceContext1 *iface,
+        UINT buffer_count, ID3D11Buffer **buffers)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, buffer_count %u, buffers %p.\n", iface, buffer_count, buffers);
+
+    d3d11_get_objects((void *const *)context->state.so_buffers, ARRAY_SIZE(context->state.so_buffers),
+            0, buffer_count, (void **)buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_RSGetState(ID3D11DeviceContext1 *iface,
+        ID3D11RasterizerState **rasterizer_state)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, rasterizer_state %p.\n", iface, rasterizer_state);
+
+    if ((*rasterizer_state = context->state.rasterizer_state))
+        ID3D11RasterizerState_AddRef(*rasterizer_state);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_RSGetViewports(ID3D11DeviceContext1 *iface,
+        UINT *viewport_count, D3D11_VIEWPORT *viewports)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    unsigned int actual_count = context->state.viewport_count;
+
+    TRACE("iface %p, viewport_count %p, viewports %p.\n", iface, viewport_count, viewports);
+
+    if (!viewport_count)
+        return;
+
+    if (!viewports)
+    {
+        *viewport_count = actual_count;
+        return;
+    }
+
+    if (*viewport_count > actual_count)
+        memset(&viewports[actual_count], 0, (*viewport_count - actual_count) * sizeof(*viewports));
+
+    *viewport_count = min(actual_count, *viewport_count);
+    memcpy(viewports, context->state.viewports, *viewport_count * sizeof(*viewports));
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_RSGetScissorRects(ID3D11DeviceContext1 *iface,
+        UINT *rect_count, D3D11_RECT *rects)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    unsigned int actual_count = context->state.scissor_rect_count;
+
+    TRACE("iface %p, rect_count %p, rects %p.\n", iface, rect_count, rects);
+
+    if (!rect_count)
+        return;
+
+    if (!rects)
+    {
+        *rect_count = actual_count;
+        return;
+    }
+
+    memcpy(rects, context->state.scissor_rects, min(actual_count, *rect_count) * sizeof(*rects));
+    if (*rect_count > actual_count)
+        memset(&rects[actual_count], 0, (*rect_count - actual_count) * sizeof(*rects));
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSGetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView **views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_get_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSGetShader(ID3D11DeviceContext1 *iface,
+        ID3D11HullShader **shader, ID3D11ClassInstance **class_instances, UINT *class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %p.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_get_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, (void **)shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSGetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState **samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_get_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSGetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_get_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSGetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView **views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_get_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSGetShader(ID3D11DeviceContext1 *iface,
+        ID3D11DomainShader **shader, ID3D11ClassInstance **class_instances, UINT *class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %p.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_get_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, (void **)shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSGetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState **samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_get_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSGetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_get_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSGetShaderResources(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11ShaderResourceView **views)
+{
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_deferred_context_get_shader_resources(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, start_slot, view_count, views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSGetUnorderedAccessViews(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT view_count, ID3D11UnorderedAccessView **views)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p, start_slot %u, view_count %u, views %p.\n", iface, start_slot, view_count, views);
+
+    d3d11_get_objects((void *const *)context->state.cs_unordered_access_views,
+            ARRAY_SIZE(context->state.cs_unordered_access_views), start_slot, view_count, (void **)views);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSGetShader(ID3D11DeviceContext1 *iface,
+        ID3D11ComputeShader **shader, ID3D11ClassInstance **class_instances, UINT *class_instance_count)
+{
+    TRACE("iface %p, shader %p, class_instances %p, class_instance_count %p.\n",
+            iface, shader, class_instances, class_instance_count);
+
+    d3d11_deferred_context_get_shader(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, (void **)shader, class_instance_count);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSGetSamplers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT sampler_count, ID3D11SamplerState **samplers)
+{
+    TRACE("iface %p, start_slot %u, sampler_count %u, samplers %p.\n",
+            iface, start_slot, sampler_count, samplers);
+
+    d3d11_deferred_context_get_samplers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, start_slot, sampler_count, samplers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSGetConstantBuffers(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p.\n",
+            iface, start_slot, buffer_count, buffers);
+
+    d3d11_deferred_context_get_constant_buffers(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, start_slot, buffer_count, buffers);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_ClearState(ID3D11DeviceContext1 *iface)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p.\n", iface);
+
+    d3d11_command_buffer_require_space(&context->commands, D3D11_COMMAND_CLEAR_STATE, sizeof(struct d3d11_command));
+    d3d11_deferred_context_reset_state(context);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_Flush(ID3D11DeviceContext1 *iface)
+{
+    TRACE("iface %p.\n", iface);
+}
+
+static D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE d3d11_deferred_context_GetType(ID3D11DeviceContext1 *iface)
+{
+    TRACE("iface %p.\n", iface);
+
+    return D3D11_DEVICE_CONTEXT_DEFERRED;
+}
+
+static UINT STDMETHODCALLTYPE d3d11_deferred_context_GetContextFlags(ID3D11DeviceContext1 *iface)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+
+    TRACE("iface %p.\n", iface);
+
+    return context->flags;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d11_deferred_context_FinishCommandList(ID3D11DeviceContext1 *iface,
+        BOOL restore, ID3D11CommandList **command_list)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_deferred_mapping *mapping, *next;
+    struct d3d11_command_list *object;
+    HRESULT hr;
+
+    TRACE("iface %p, restore %#x, command_list %p.\n", iface, restore, command_list);
+
+    LIST_FOR_EACH_ENTRY_SAFE(mapping, next, &context->mappings, struct d3d11_deferred_mapping, entry)
+    {
+        if (mapping->mapped)
+            WARN("Sub-resource %u of resource %p is still mapped.\n", mapping->sub_resource_idx, mapping->resource);
+        d3d11_deferred_mapping_destroy(mapping);
+    }
+
+    if (context->commands.out_of_memory)
+    {
+        ERR("Ran out of memory while recording, discarding the command list.\n");
+        d3d11_command_buffer_cleanup(&context->commands);
+        hr = E_OUTOFMEMORY;
+    }
+    else if (SUCCEEDED(hr = d3d11_command_list_create(context, &object)))
+    {
+        if (command_list)
+            *command_list = &object->ID3D11CommandList_iface;
+        else
+            ID3D11CommandList_Release(&object->ID3D11CommandList_iface);
+    }
+
+    /* The next command list starts from the current state when "restore" is
+     * set, and from the default state otherwise. */
+    if (restore)
+        d3d11_context_state_apply(&context->state, iface);
+    else
+        d3d11_deferred_context_reset_state(context);
+
+    return hr;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CopySubresourceRegion1(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *dst_resource, UINT dst_subresource_idx, UINT dst_x, UINT dst_y, UINT dst_z,
+        ID3D11Resource *src_resource, UINT src_subresource_idx, const D3D11_BOX *src_box, UINT flags)
+{
+    TRACE("iface %p, dst_resource %p, dst_subresource_idx %u, dst_x %u, dst_y %u, dst_z %u, "
+            "src_resource %p, src_subresource_idx %u, src_box %p, flags %#x.\n",
+            iface, dst_resource, dst_subresource_idx, dst_x, dst_y, dst_z,
+            src_resource, src_subresource_idx, src_box, flags);
+
+    d3d11_deferred_context_copy_subresource_region(impl_from_ID3D11DeviceContext1(iface),
+            dst_resource, dst_subresource_idx, dst_x, dst_y, dst_z,
+            src_resource, src_subresource_idx, src_box, flags);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_UpdateSubresource1(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *resource, UINT subresource_idx, const D3D11_BOX *box, const void *data,
+        UINT row_pitch, UINT depth_pitch, UINT flags)
+{
+    TRACE("iface %p, resource %p, subresource_idx %u, box %p, data %p, row_pitch %u, depth_pitch %u, "
+            "flags %#x.\n",
+            iface, resource, subresource_idx, box, data, row_pitch, depth_pitch, flags);
+
+    d3d11_deferred_context_update_subresource(impl_from_ID3D11DeviceContext1(iface),
+            resource, subresource_idx, box, data, row_pitch, depth_pitch, flags);
+}
+
+/* Discarding only tells the driver that the contents are no longer needed,
+ * so recording nothing is a valid implementation. */
+static void STDMETHODCALLTYPE d3d11_deferred_context_DiscardResource(ID3D11DeviceContext1 *iface,
+        ID3D11Resource *resource)
+{
+    TRACE("iface %p, resource %p.\n", iface, resource);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DiscardView(ID3D11DeviceContext1 *iface, ID3D11View *view)
+{
+    TRACE("iface %p, view %p.\n", iface, view);
+}
+
+/* wined3d always binds whole constant buffers, so constant ranges other than
+ * the whole buffer can't be honoured yet. */
+static void d3d11_deferred_context_set_constant_buffers1(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, UINT start_slot, UINT buffer_count, ID3D11Buffer *const *buffers,
+        const UINT *first_constant, const UINT *num_constants)
+{
+    if (first_constant || num_constants)
+        FIXME("Ignoring constant buffer ranges.\n");
+
+    d3d11_deferred_context_set_constant_buffers(context, type, start_slot, buffer_count, buffers);
+}
+
+static void d3d11_deferred_context_get_constant_buffers1(struct d3d11_deferred_context *context,
+        enum wined3d_shader_type type, UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers,
+        UINT *first_constant, UINT *num_constants)
+{
+    ID3D11Buffer *const *slots = context->state.constant_buffers[type];
+    D3D11_BUFFER_DESC desc;
+    ID3D11Buffer *buffer;
+    unsigned int i;
+
+    for (i = 0; i < buffer_count; ++i)
+    {
+        buffer = start_slot + i < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT ? slots[start_slot + i] : NULL;
+
+        if (buffers && (buffers[i] = buffer))
+            ID3D11Buffer_AddRef(buffer);
+        if (first_constant)
+            first_constant[i] = 0;
+        if (num_constants)
+        {
+            num_constants[i] = 0;
+            if (buffer)
+            {
+                ID3D11Buffer_GetDesc(buffer, &desc);
+                num_constants[i] = desc.ByteWidth / (4 * sizeof(float));
+            }
+        }
+    }
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSSetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer * const *buffers, const UINT *first_constant,
+        const UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_set_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSSetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer * const *buffers, const UINT *first_constant,
+        const UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_set_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSSetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer * const *buffers, const UINT *first_constant,
+        const UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_set_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSSetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer * const *buffers, const UINT *first_constant,
+        const UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_set_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSSetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer * const *buffers, const UINT *first_constant,
+        const UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_set_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSSetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer * const *buffers, const UINT *first_constant,
+        const UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_set_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_VSGetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers, UINT *first_constant, UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_get_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_VERTEX, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_HSGetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers, UINT *first_constant, UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_get_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_HULL, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DSGetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers, UINT *first_constant, UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_get_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_DOMAIN, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_GSGetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers, UINT *first_constant, UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_get_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_GEOMETRY, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_PSGetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers, UINT *first_constant, UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_get_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_PIXEL, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_CSGetConstantBuffers1(ID3D11DeviceContext1 *iface,
+        UINT start_slot, UINT buffer_count, ID3D11Buffer **buffers, UINT *first_constant, UINT *num_constants)
+{
+    TRACE("iface %p, start_slot %u, buffer_count %u, buffers %p, first_constant %p, num_constants %p.\n",
+            iface, start_slot, buffer_count, buffers, first_constant, num_constants);
+
+    d3d11_deferred_context_get_constant_buffers1(impl_from_ID3D11DeviceContext1(iface),
+            WINED3D_SHADER_TYPE_COMPUTE, start_slot, buffer_count, buffers, first_constant, num_constants);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_SwapDeviceContextState(ID3D11DeviceContext1 *iface,
+        ID3DDeviceContextState *state, ID3DDeviceContextState **prev_state)
+{
+    TRACE("iface %p, state %p, prev_state %p.\n", iface, state, prev_state);
+
+    WARN("Device context states cannot be swapped on a deferred context.\n");
+
+    if (prev_state)
+        *prev_state = NULL;
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_ClearView(ID3D11DeviceContext1 *iface, ID3D11View *view,
+        const FLOAT color[4], const D3D11_RECT *rect, UINT num_rects)
+{
+    struct d3d11_deferred_context *context = impl_from_ID3D11DeviceContext1(iface);
+    struct d3d11_command_clear_view *command;
+
+    TRACE("iface %p, view %p, color %s, rect %p, num_rects %u.\n",
+            iface, view, debug_float4(color), rect, num_rects);
+
+    if (!rect)
+        num_rects = 0;
+
+    if (!(command = d3d11_command_buffer_require_space(&context->commands, D3D11_COMMAND_CLEAR_VIEW,
+            FIELD_OFFSET(struct d3d11_command_clear_view, rects[max(num_rects, 1)]))))
+        return;
+
+    command->view = view;
+    memcpy(command->color, color, sizeof(command->color));
+    if ((command->rect_count = num_rects))
+        memcpy(command->rects, rect, num_rects * sizeof(*rect));
+    d3d11_command_buffer_add_object(&context->commands, view);
+}
+
+static void STDMETHODCALLTYPE d3d11_deferred_context_DiscardView1(ID3D11DeviceContext1 *iface, ID3D11View *view,
+        const D3D11_RECT *rects, UINT num_rects)
+{
+    TRACE("iface %p, view %p, rects %p, num_rects %u.\n", iface, view, rects, num_rects);
+}
+
+
+static const struct ID3D11DeviceContext1Vtbl d3d11_deferred_context_vtbl =
+{
+    /* IUnknown methods */
+    d3d11_deferred_context_QueryInterface,
+    d3d11_deferred_context_AddRef,
+    d3d11_deferred_context_Release,
+    /* ID3D11DeviceChild methods */
+    d3d11_deferred_context_GetDevice,
+    d3d11_deferred_context_GetPrivateData,
+    d3d11_deferred_context_SetPrivateData,
+    d3d11_deferred_context_SetPrivateDataInterface,
+    /* ID3D11DeviceContext methods */
+    d3d11_deferred_context_VSSetConstantBuffers,
+    d3d11_deferred_context_PSSetShaderResources,
+    d3d11_deferred_context_PSSetShader,
+    d3d11_deferred_context_PSSetSamplers,
+    d3d11_deferred_context_VSSetShader,
+    d3d11_deferred_context_DrawIndexed,
+    d3d11_deferred_context_Draw,
+    d3d11_deferred_context_Map,
+    d3d11_deferred_context_Unmap,
+    d3d11_deferred_context_PSSetConstantBuffers,
+    d3d11_deferred_context_IASetInputLayout,
+    d3d11_deferred_context_IASetVertexBuffers,
+    d3d11_deferred_context_IASetIndexBuffer,
+    d3d11_deferred_context_DrawIndexedInstanced,
+    d3d11_deferred_context_DrawInstanced,
+    d3d11_deferred_context_GSSetConstantBuffers,
+    d3d11_deferred_context_GSSetShader,
+    d3d11_deferred_context_IASetPrimitiveTopology,
+    d3d11_deferred_context_VSSetShaderResources,
+    d3d11_deferred_context_VSSetSamplers,
+    d3d11_deferred_context_Begin,
+    d3d11_deferred_context_End,
+    d3d11_deferred_context_GetData,
+    d3d11_deferred_context_SetPredication,
+    d3d11_deferred_context_GSSetShaderResources,
+    d3d11_deferred_context_GSSetSamplers,
+    d3d11_deferred_context_OMSetRenderTargets,
+    d3d11_deferred_context_OMSetRenderTargetsAndUnorderedAccessViews,
+    d3d11_deferred_context_OMSetBlendState,
+    d3d11_deferred_context_OMSetDepthStencilState,
+    d3d11_deferred_context_SOSetTargets,
+    d3d11_deferred_context_DrawAuto,
+    d3d11_deferred_context_DrawIndexedInstancedIndirect,
+    d3d11_deferred_context_DrawInstancedIndirect,
+    d3d11_deferred_context_Dispatch,
+    d3d11_deferred_context_DispatchIndirect,
+    d3d11_deferred_context_RSSetState,
+    d3d11_deferred_context_RSSetViewports,
+    d3d11_deferred_context_RSSetScissorRects,
+    d3d11_deferred_context_CopySubresourceRegion,
+    d3d11_deferred_context_CopyResource,
+    d3d11_deferred_context_UpdateSubresource,
+    d3d11_deferred_context_CopyStructureCount,
+    d3d11_deferred_context_ClearRenderTargetView,
+    d3d11_deferred_context_ClearUnorderedAccessViewUint,
+    d3d11_deferred_context_ClearUnorderedAccessViewFloat,
+    d3d11_deferred_context_ClearDepthStencilView,
+    d3d11_deferred_context_GenerateMips,
+    d3d11_deferred_context_SetResourceMinLOD,
+    d3d11_deferred_context_GetResourceMinLOD,
+    d3d11_deferred_context_ResolveSubresource,
+    d3d11_deferred_context_ExecuteCommandList,
+    d3d11_deferred_context_HSSetShaderResources,
+    d3d11_deferred_context_HSSetShader,
+    d3d11_deferred_context_HSSetSamplers,
+    d3d11_deferred_context_HSSetConstantBuffers,
+    d3d11_deferred_context_DSSetShaderResources,
+    d3d11_deferred_context_DSSetShader,
+    d3d11_deferred_context_DSSetSamplers,
+    d3d11_deferred_context_DSSetConstantBuffers,
+    d3d11_deferred_context_CSSetShaderResources,
+    d3d11_deferred_context_CSSetUnorderedAccessViews,
+    d3d11_deferred_context_CSSetShader,
+    d3d11_deferred_context_CSSetSamplers,
+    d3d11_deferred_context_CSSetConstantBuffers,
+    d3d11_deferred_context_VSGetConstantBuffers,
+    d3d11_deferred_context_PSGetShaderResources,
+    d3d11_deferred_context_PSGetShader,
+    d3d11_deferred_context_PSGetSamplers,
+    d3d11_deferred_context_VSGetShader,
+    d3d11_deferred_context_PSGetConstantBuffers,
+    d3d11_deferred_context_IAGetInputLayout,
+    d3d11_deferred_context_IAGetVertexBuffers,
+    d3d11_deferred_context_IAGetIndexBuffer,
+    d3d11_deferred_context_GSGetConstantBuffers,
+    d3d11_deferred_context_GSGetShader,
+    d3d11_deferred_context_IAGetPrimitiveTopology,
+    d3d11_deferred_context_VSGetShaderResources,
+    d3d11_deferred_context_VSGetSamplers,
+    d3d11_deferred_context_GetPredication,
+    d3d11_deferred_context_GSGetShaderResources,
+    d3d11_deferred_context_GSGetSamplers,
+    d3d11_deferred_context_OMGetRenderTargets,
+    d3d11_deferred_context_OMGetRenderTargetsAndUnorderedAccessViews,
+    d3d11_deferred_context_OMGetBlendState,
+    d3d11_deferred_context_OMGetDepthStencilState,
+    d3d11_deferred_context_SOGetTargets,
+    d3d11_deferred_context_RSGetState,
+    d3d11_deferred_context_RSGetViewports,
+    d3d11_deferred_context_RSGetScissorRects,
+    d3d11_deferred_context_HSGetShaderResources,
+    d3d11_deferred_context_HSGetShader,
+    d3d11_deferred_context_HSGetSamplers,
+    d3d11_deferred_context_HSGetConstantBuffers,
+    d3d11_deferred_context_DSGetShaderResources,
+    d3d11_deferred_context_DSGetShader,
+    d3d11_deferred_context_DSGetSamplers,
+    d3d11_deferred_context_DSGetConstantBuffers,
+    d3d11_deferred_context_CSGetShaderResources,
+    d3d11_deferred_context_CSGetUnorderedAccessViews,
+    d3d11_deferred_context_CSGetShader,
+    d3d11_deferred_context_CSGetSamplers,
+    d3d11_deferred_context_CSGetConstantBuffers,
+    d3d11_deferred_context_ClearState,
+    d3d11_deferred_context_Flush,
+    d3d11_deferred_context_GetType,
+    d3d11_deferred_context_GetContextFlags,
+    d3d11_deferred_context_FinishCommandList,
+    /* ID3D11DeviceContext1 methods */
+    d3d11_deferred_context_CopySubresourceRegion1,
+    d3d11_deferred_context_UpdateSubresource1,
+    d3d11_deferred_context_DiscardResource,
+    d3d11_deferred_context_DiscardView,
+    d3d11_deferred_context_VSSetConstantBuffers1,
+    d3d11_deferred_context_HSSetConstantBuffers1,
+    d3d11_deferred_context_DSSetConstantBuffers1,
+    d3d11_deferred_context_GSSetConstantBuffers1,
+    d3d11_deferred_context_PSSetConstantBuffers1,
+    d3d11_deferred_context_CSSetConstantBuffers1,
+    d3d11_deferred_context_VSGetConstantBuffers1,
+    d3d11_deferred_context_HSGetConstantBuffers1,
+    d3d11_deferred_context_DSGetConstantBuffers1,
+    d3d11_deferred_context_GSGetConstantBuffers1,
+    d3d11_deferred_context_PSGetConstantBuffers1,
+    d3d11_deferred_context_CSGetConstantBuffers1,
+    d3d11_deferred_context_SwapDeviceContextState,
+    d3d11_deferred_context_ClearView,
+    d3d11_deferred_context_DiscardView1,
+};
+
+HRESULT d3d11_deferred_context_create(struct d3d_device *device, UINT flags,
+        struct d3d11_deferred_context **context)
+{
+    struct d3d11_deferred_context *object;
+
+    if (device->create_flags & D3D11_CREATE_DEVICE_SINGLETHREADED)
+    {
+        WARN("Deferred contexts are not supported on single-threaded devices.\n");
+        return DXGI_ERROR_INVALID_CALL;
+    }
+
+    if (!(object = heap_alloc_zero(sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    object->ID3D11DeviceContext1_iface.lpVtbl = &d3d11_deferred_context_vtbl;
+    object->refcount = 1;
+    wined3d_private_store_init(&object->private_store);
+    object->device = device;
+    ID3D11Device2_AddRef(&device->ID3D11Device2_iface);
+    object->flags = flags;
+    d3d11_context_state_init(&object->state);
+    list_init(&object->mappings);
+
+    TRACE("Created deferred context %p.\n", object);
+    *context = object;
+
+    return S_OK;
+}
@@ -21,6 +21,7 @@
 #include <float.h>
 #include <limits.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #define COBJMACROS
 #include "initguid.h"
@@ -2230,7 +2231,7 @@ static void test_create_deferred_context(void)
     }
 
     hr = ID3D11Device_CreateDeferredContext(device, 0, &context);
-    todo_wine ok(hr == DXGI_ERROR_INVALID_CALL, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == DXGI_ERROR_INVALID_CALL, "Failed to create deferred context, hr %#x.\n", hr);
 
     refcount = ID3D11Device_Release(device);
     ok(!refcount, "Device has %u references left.\n", refcount);
@@ -2243,7 +2244,7 @@ static void test_create_deferred_context(void)
 
     expected_refcount = get_refcount(device) + 1;
     hr = ID3D11Device_CreateDeferredContext(device, 0, &context);
-    todo_wine ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
     if (FAILED(hr))
         goto done;
     refcount = get_refcount(device);
@@ -2264,6 +2265,275 @@ done:
     ok(!refcount, "Device has %u references left.\n", refcount);
 }
 
+static ID3D11CommandList *record_color_quad(struct d3d11_test_context *test_context,
+        ID3D11DeviceContext *context, ID3D11RenderTargetView *rtv, ID3D11Buffer *cb,
+        const struct vec4 *color, BOOL restore)
+{
+    static const float red[] = {1.0f, 0.0f, 0.0f, 1.0f};
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    unsigned int stride, offset;
+    ID3D11CommandList *list;
+    HRESULT hr;
+
+    ID3D11DeviceContext_ClearRenderTargetView(context, rtv, red);
+    ID3D11DeviceContext_OMSetRenderTargets(context, 1, &rtv, NULL);
+    set_viewport(context, 0.0f, 0.0f, 32.0f, 32.0f, 0.0f, 1.0f);
+    ID3D11DeviceContext_IASetInputLayout(context, test_context->input_layout);
+    ID3D11DeviceContext_IASetPrimitiveTopology(context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    stride = sizeof(struct vec3);
+    offset = 0;
+    ID3D11DeviceContext_IASetVertexBuffers(context, 0, 1, &test_context->vb, &stride, &offset);
+    ID3D11DeviceContext_VSSetShader(context, test_context->vs, NULL, 0);
+    ID3D11DeviceContext_PSSetShader(context, test_context->ps, NULL, 0);
+    ID3D11DeviceContext_PSSetConstantBuffers(context, 0, 1, &cb);
+
+    hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)cb, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+    ok(hr == S_OK, "Failed to map constant buffer, hr %#x.\n", hr);
+    if (SUCCEEDED(hr))
+    {
+        memcpy(map_desc.pData, color, sizeof(*color));
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)cb, 0);
+    }
+    ID3D11DeviceContext_Draw(context, 4, 0);
+
+    hr = ID3D11DeviceContext_FinishCommandList(context, restore, &list);
+    ok(hr == S_OK, "Failed to finish command list, hr %#x.\n", hr);
+
+    return list;
+}
+
+static ID3D11Texture2D *create_small_render_target(ID3D11Device *device, ID3D11RenderTargetView **rtv)
+{
+    D3D11_TEXTURE2D_DESC texture_desc;
+    ID3D11Texture2D *texture;
+    HRESULT hr;
+
+    texture_desc.Width = 32;
+    texture_desc.Height = 32;
+    texture_desc.MipLevels = 1;
+    texture_desc.ArraySize = 1;
+    texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    texture_desc.SampleDesc.Count = 1;
+    texture_desc.SampleDesc.Quality = 0;
+    texture_desc.Usage = D3D11_USAGE_DEFAULT;
+    texture_desc.BindFlags = D3D11_BIND_RENDER_TARGET;
+    texture_desc.CPUAccessFlags = 0;
+    texture_desc.MiscFlags = 0;
+    hr = ID3D11Device_CreateTexture2D(device, &texture_desc, NULL, &texture);
+    ok(hr == S_OK, "Failed to create texture, hr %#x.\n", hr);
+    hr = ID3D11Device_CreateRenderTargetView(device, (ID3D11Resource *)texture, NULL, rtv);
+    ok(hr == S_OK, "Failed to create render target view, hr %#x.\n", hr);
+
+    return texture;
+}
+
+static ID3D11Buffer *create_dynamic_constant_buffer(ID3D11Device *device)
+{
+    D3D11_BUFFER_DESC buffer_desc;
+    ID3D11Buffer *buffer;
+    HRESULT hr;
+
+    buffer_desc.ByteWidth = sizeof(struct vec4);
+    buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+    buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    buffer_desc.MiscFlags = 0;
+    buffer_desc.StructureByteStride = 0;
+    hr = ID3D11Device_CreateBuffer(device, &buffer_desc, NULL, &buffer);
+    ok(hr == S_OK, "Failed to create buffer, hr %#x.\n", hr);
+
+    return buffer;
+}
+
+static void test_deferred_context_rendering(void)
+{
+    static const struct vec4 green = {0.0f, 1.0f, 0.0f, 1.0f};
+    static const struct vec4 blue = {0.0f, 0.0f, 1.0f, 1.0f};
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    struct d3d11_test_context test_context;
+    ID3D11RenderTargetView *rtv, *tmp_rtv;
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    ID3D11DeviceContext *context;
+    ID3D11CommandList *list;
+    ID3D11Texture2D *texture;
+    ID3D11Device *device;
+    ID3D11Buffer *cb, *tmp_cb;
+    HRESULT hr;
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+    device = test_context.device;
+
+    /* Creates the shaders and buffers used below. */
+    draw_color_quad(&test_context, &green);
+    check_texture_color(test_context.backbuffer, 0xff00ff00, 1);
+
+    hr = ID3D11DeviceContext_FinishCommandList(test_context.immediate_context, FALSE, &list);
+    ok(hr == DXGI_ERROR_INVALID_CALL, "Got unexpected hr %#x.\n", hr);
+
+    hr = ID3D11Device_CreateDeferredContext(device, 0, &context);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(ID3D11DeviceContext_GetType(context) == D3D11_DEVICE_CONTEXT_DEFERRED,
+            "Got unexpected context type %#x.\n", ID3D11DeviceContext_GetType(context));
+
+    texture = create_small_render_target(device, &rtv);
+    cb = create_dynamic_constant_buffer(device);
+    ID3D11DeviceContext_ClearRenderTargetView(test_context.immediate_context, rtv, white);
+
+    /* Nothing reaches the device before the list is executed. */
+    list = record_color_quad(&test_context, context, rtv, cb, &blue, FALSE);
+    check_texture_color(texture, 0xffffffff, 0);
+
+    /* Recording does not touch the immediate context. */
+    ID3D11DeviceContext_PSGetConstantBuffers(test_context.immediate_context, 0, 1, &tmp_cb);
+    ok(tmp_cb == test_context.ps_cb, "Got unexpected constant buffer %p.\n", tmp_cb);
+    ID3D11Buffer_Release(tmp_cb);
+
+    /* The recorded state was reset by FinishCommandList(). */
+    ID3D11DeviceContext_OMGetRenderTargets(context, 1, &tmp_rtv, NULL);
+    ok(!tmp_rtv, "Got unexpected render target view %p.\n", tmp_rtv);
+
+    ID3D11DeviceContext_ExecuteCommandList(test_context.immediate_context, list, TRUE);
+    check_texture_color(texture, 0xffff0000, 1);
+
+    ID3D11DeviceContext_OMGetRenderTargets(test_context.immediate_context, 1, &tmp_rtv, NULL);
+    ok(tmp_rtv == test_context.backbuffer_rtv, "Got unexpected render target view %p.\n", tmp_rtv);
+    ID3D11RenderTargetView_Release(tmp_rtv);
+    ID3D11DeviceContext_PSGetConstantBuffers(test_context.immediate_context, 0, 1, &tmp_cb);
+    ok(tmp_cb == test_context.ps_cb, "Got unexpected constant buffer %p.\n", tmp_cb);
+    ID3D11Buffer_Release(tmp_cb);
+
+    /* A command list can be executed more than once. */
+    ID3D11DeviceContext_ClearRenderTargetView(test_context.immediate_context, rtv, white);
+    ID3D11DeviceContext_ExecuteCommandList(test_context.immediate_context, list, FALSE);
+    check_texture_color(texture, 0xffff0000, 1);
+
+    ID3D11DeviceContext_OMGetRenderTargets(test_context.immediate_context, 1, &tmp_rtv, NULL);
+    ok(!tmp_rtv, "Got unexpected render target view %p.\n", tmp_rtv);
+    ID3D11DeviceContext_PSGetConstantBuffers(test_context.immediate_context, 0, 1, &tmp_cb);
+    ok(!tmp_cb, "Got unexpected constant buffer %p.\n", tmp_cb);
+    ID3D11CommandList_Release(list);
+
+    /* With "restore" set, the next command list starts from the current state. */
+    list = record_color_quad(&test_context, context, rtv, cb, &blue, TRUE);
+    ID3D11CommandList_Release(list);
+    ID3D11DeviceContext_OMGetRenderTargets(context, 1, &tmp_rtv, NULL);
+    ok(tmp_rtv == rtv, "Got unexpected render target view %p.\n", tmp_rtv);
+    ID3D11RenderTargetView_Release(tmp_rtv);
+    ID3D11DeviceContext_Draw(context, 4, 0);
+    hr = ID3D11DeviceContext_FinishCommandList(context, FALSE, &list);
+    ok(hr == S_OK, "Failed to finish command list, hr %#x.\n", hr);
+    hr = ID3D11DeviceContext_Map(test_context.immediate_context, (ID3D11Resource *)cb,
+            0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+    ok(hr == S_OK, "Failed to map constant buffer, hr %#x.\n", hr);
+    memcpy(map_desc.pData, &green, sizeof(green));
+    ID3D11DeviceContext_Unmap(test_context.immediate_context, (ID3D11Resource *)cb, 0);
+    ID3D11DeviceContext_ClearRenderTargetView(test_context.immediate_context, rtv, white);
+    ID3D11DeviceContext_ExecuteCommandList(test_context.immediate_context, list, FALSE);
+    check_texture_color(texture, 0xff00ff00, 1);
+    ID3D11CommandList_Release(list);
+
+    ID3D11Buffer_Release(cb);
+    ID3D11RenderTargetView_Release(rtv);
+    ID3D11Texture2D_Release(texture);
+    ID3D11DeviceContext_Release(context);
+    release_test_context(&test_context);
+}
+
+struct deferred_context_thread_data
+{
+    struct d3d11_test_context *test_context;
+    ID3D11DeviceContext *context;
+    ID3D11RenderTargetView *rtv;
+    ID3D11Buffer *cb;
+    struct vec4 color;
+    ID3D11CommandList *list;
+};
+
+static DWORD WINAPI deferred_context_thread(void *param)
+{
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    struct deferred_context_thread_data *data = param;
+    unsigned int i;
+
+    /* Record a long list, so that both threads are recording at the same time. */
+    for (i = 0; i < 500; ++i)
+        ID3D11DeviceContext_ClearRenderTargetView(data->context, data->rtv, white);
+    data->list = record_color_quad(data->test_context, data->context, data->rtv, data->cb, &data->color, FALSE);
+
+    return 0;
+}
+
+static void test_deferred_context_multithreaded(void)
+{
+    static const struct vec4 green = {0.0f, 1.0f, 0.0f, 1.0f};
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    static const struct
+    {
+        struct vec4 color;
+        DWORD expected;
+    }
+    colors[] =
+    {
+        {{0.0f, 0.0f, 1.0f, 1.0f}, 0xffff0000},
+        {{1.0f, 1.0f, 0.0f, 1.0f}, 0xff00ffff},
+    };
+    struct deferred_context_thread_data data[ARRAY_SIZE(colors)];
+    struct d3d11_test_context test_context;
+    ID3D11Texture2D *textures[ARRAY_SIZE(colors)];
+    HANDLE threads[ARRAY_SIZE(colors)];
+    unsigned int i;
+    HRESULT hr;
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    draw_color_quad(&test_context, &green);
+
+    for (i = 0; i < ARRAY_SIZE(colors); ++i)
+    {
+        data[i].test_context = &test_context;
+        hr = ID3D11Device_CreateDeferredContext(test_context.device, 0, &data[i].context);
+        ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+        textures[i] = create_small_render_target(test_context.device, &data[i].rtv);
+        data[i].cb = create_dynamic_constant_buffer(test_context.device);
+        data[i].color = colors[i].color;
+        data[i].list = NULL;
+        ID3D11DeviceContext_ClearRenderTargetView(test_context.immediate_context, data[i].rtv, white);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(colors); ++i)
+        threads[i] = CreateThread(NULL, 0, deferred_context_thread, &data[i], 0, NULL);
+    WaitForMultipleObjects(ARRAY_SIZE(threads), threads, TRUE, INFINITE);
+
+    for (i = 0; i < ARRAY_SIZE(colors); ++i)
+    {
+        CloseHandle(threads[i]);
+        ok(!!data[i].list, "Test %u: No command list.\n", i);
+        check_texture_color(textures[i], 0xffffffff, 0);
+    }
+
+    /* Execute in reverse order, each list only touches its own target. */
+    for (i = ARRAY_SIZE(colors); i--;)
+    {
+        if (data[i].list)
+            ID3D11DeviceContext_ExecuteCommandList(test_context.immediate_context, data[i].list, FALSE);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(colors); ++i)
+    {
+        check_texture_color(textures[i], colors[i].expected, 1);
+        if (data[i].list)
+            ID3D11CommandList_Release(data[i].list);
+        ID3D11Buffer_Release(data[i].cb);
+        ID3D11RenderTargetView_Release(data[i].rtv);
+        ID3D11Texture2D_Release(textures[i]);
+        ID3D11DeviceContext_Release(data[i].context);
+    }
+
+    release_test_context(&test_context);
+}
+
 static void test_create_texture1d(void)
 {
     ULONG refcount, expected_refcount;
@@ -24841,6 +25111,31 @@ static void test_stream_output_components(void)
     release_test_context(&test_context);
 }
 
+static void test_stream_output_program_cache(void)
+{
+    char path[MAX_PATH], file[MAX_PATH], config[MAX_PATH + 16];
+    unsigned int i;
+
+    /* wined3d reads its settings when it is loaded, so the tests that use
+     * several stream output declarations with the same geometry shader run
+     * in child processes. The second one uses the programs stored by the
+     * first one. */
+    GetTempPathA(ARRAY_SIZE(path), path);
+    GetTempFileNameA(path, "wsc", 0, file);
+    DeleteFileA(file);
+    sprintf(config, "ShaderCache=%s", file);
+
+    for (i = 0; i < 2; ++i)
+    {
+        if (!winetest_run_wine_child("--so-program-cache", "WINE_D3D_CONFIG", config))
+        {
+            skip("The shader cache is specific to Wine.\n");
+            break;
+        }
+    }
+    DeleteFileA(file);
+}
+
 static void test_stream_output_vs(void)
 {
     const D3D11_SO_DECLARATION_ENTRY *current_so_declaration;
@@ -29387,6 +29682,12 @@ START_TEST(d3d11)
             use_adapter_idx = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--single"))
             use_mt = FALSE;
+        else if (!strcmp(argv[i], "--so-program-cache"))
+        {
+            test_stream_output();
+            test_stream_output_components();
+            return;
+        }
     }
 
     print_adapter_info();
@@ -29395,6 +29696,8 @@ START_TEST(d3d11)
     queue_for_each_feature_level(test_device_interfaces);
     queue_test(test_get_immediate_context);
     queue_test(test_create_deferred_context);
+    queue_test(test_deferred_context_rendering);
+    queue_test(test_deferred_context_multithreaded);
     queue_test(test_create_texture1d);
     queue_test(test_texture1d_interfaces);
     queue_test(test_create_texture2d);
@@ -29505,6 +29808,7 @@ START_TEST(d3d11)
     queue_test(test_fl10_stream_output_desc);
     queue_test(test_stream_output_resume);
     queue_test(test_stream_output_components);
+    queue_test(test_stream_output_program_cache);
     queue_test(test_stream_output_vs);
     queue_test(test_gather);
     queue_test(test_gather_c);
@@ -2951,6 +2951,16 @@ static HRESULT WINAPI d3d9_device_DrawPrimitiveUP(IDirect3DDevice9Ex *iface,
         return D3DERR_INVALIDCALL;
     }
 
+    d3d9_generate_auto_mipmaps(device);
+    wined3d_device_set_primitive_type(device->wined3d_device, primitive_type, 0);
+
+    /* wined3d may be able to merge this with adjacent draws. */
+    if (SUCCEEDED(hr = wined3d_device_draw_primitive_up(device->wined3d_device, data, vtx_count, stride)))
+    {
+        d3d9_rts_flag_auto_gen_mipmap(device);
+        goto done;
+    }
+
     hr = d3d9_device_prepare_vertex_buffer(device, size);
     if (FAILED(hr))
         goto done;
@@ -2977,8 +2987,6 @@ static HRESULT WINAPI d3d9_device_DrawPrimitiveUP(IDirect3DDevice9Ex *iface,
     if (FAILED(hr))
         goto done;
 
-    d3d9_generate_auto_mipmaps(device);
-    wined3d_device_set_primitive_type(device->wined3d_device, primitive_type, 0);
     hr = wined3d_device_draw_primitive(device->wined3d_device, vb_pos / stride, vtx_count);
     wined3d_device_set_stream_source(device->wined3d_device, 0, NULL, 0, 0);
     if (SUCCEEDED(hr))
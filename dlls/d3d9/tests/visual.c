@@ -30,6 +30,7 @@
 
 #include <limits.h>
 #include <math.h>
+#include <stdio.h>
 
 #define COBJMACROS
 #include <d3d9.h>
@@ -25848,6 +25849,161 @@ static void test_nrm_instruction(void)
     DestroyWindow(window);
 }
 
+static void draw_primitive_up_batching(void)
+{
+    IDirect3DDevice9 *device;
+    IDirect3D9 *d3d;
+    D3DCOLOR color;
+    ULONG refcount;
+    HWND window;
+    HRESULT hr;
+
+    static const struct
+    {
+        struct vec3 position;
+        float rhw;
+        DWORD diffuse;
+    }
+    left_red[] =
+    {
+        {{  0.0f,   0.0f, 0.0f}, 1.0f, 0xffff0000},
+        {{320.0f,   0.0f, 0.0f}, 1.0f, 0xffff0000},
+        {{  0.0f, 480.0f, 0.0f}, 1.0f, 0xffff0000},
+        {{  0.0f, 480.0f, 0.0f}, 1.0f, 0xffff0000},
+        {{320.0f,   0.0f, 0.0f}, 1.0f, 0xffff0000},
+        {{320.0f, 480.0f, 0.0f}, 1.0f, 0xffff0000},
+    },
+    right_green[] =
+    {
+        {{320.0f,   0.0f, 0.0f}, 1.0f, 0xff00ff00},
+        {{640.0f,   0.0f, 0.0f}, 1.0f, 0xff00ff00},
+        {{320.0f, 480.0f, 0.0f}, 1.0f, 0xff00ff00},
+        {{320.0f, 480.0f, 0.0f}, 1.0f, 0xff00ff00},
+        {{640.0f,   0.0f, 0.0f}, 1.0f, 0xff00ff00},
+        {{640.0f, 480.0f, 0.0f}, 1.0f, 0xff00ff00},
+    },
+    top_right_strip[] =
+    {
+        {{320.0f,   0.0f, 0.0f}, 1.0f, 0xff0000ff},
+        {{640.0f,   0.0f, 0.0f}, 1.0f, 0xff0000ff},
+        {{320.0f, 240.0f, 0.0f}, 1.0f, 0xff0000ff},
+        {{640.0f, 240.0f, 0.0f}, 1.0f, 0xff0000ff},
+    },
+    bottom_right_strip[] =
+    {
+        {{320.0f, 240.0f, 0.0f}, 1.0f, 0xffffff00},
+        {{640.0f, 240.0f, 0.0f}, 1.0f, 0xffffff00},
+        {{320.0f, 480.0f, 0.0f}, 1.0f, 0xffffff00},
+        {{640.0f, 480.0f, 0.0f}, 1.0f, 0xffffff00},
+    };
+
+    window = create_window();
+    d3d = Direct3DCreate9(D3D_SDK_VERSION);
+    ok(!!d3d, "Failed to create a D3D object.\n");
+    if (!(device = create_device(d3d, window, window, TRUE)))
+    {
+        skip("Failed to create a D3D device, skipping tests.\n");
+        IDirect3D9_Release(d3d);
+        DestroyWindow(window);
+        return;
+    }
+
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_LIGHTING, FALSE);
+    ok(SUCCEEDED(hr), "Failed to disable lighting, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_ZENABLE, D3DZB_FALSE);
+    ok(SUCCEEDED(hr), "Failed to disable depth test, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetFVF(device, D3DFVF_XYZRHW | D3DFVF_DIFFUSE);
+    ok(SUCCEEDED(hr), "Failed to set FVF, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_TEXTUREFACTOR, 0xff0000ff);
+    ok(SUCCEEDED(hr), "Failed to set texture factor, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+    ok(SUCCEEDED(hr), "Failed to set color op, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+    ok(SUCCEEDED(hr), "Failed to set color arg, hr %#x.\n", hr);
+
+    /* Two consecutive compatible draws. These are merged into a single batch. */
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+    ok(SUCCEEDED(hr), "Failed to clear, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(SUCCEEDED(hr), "Failed to begin scene, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLELIST, 2, left_red, sizeof(*left_red));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLELIST, 2, right_green, sizeof(*right_green));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(SUCCEEDED(hr), "Failed to end scene, hr %#x.\n", hr);
+    color = getPixelColor(device, 160, 240);
+    ok(color_match(color, 0x00ff0000, 1), "Got unexpected color 0x%08x.\n", color);
+    color = getPixelColor(device, 480, 240);
+    ok(color_match(color, 0x0000ff00, 1), "Got unexpected color 0x%08x.\n", color);
+
+    /* A state change in between ends the batch; the second draw uses the
+     * texture factor instead of the vertex color. */
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+    ok(SUCCEEDED(hr), "Failed to clear, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(SUCCEEDED(hr), "Failed to begin scene, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLELIST, 2, left_red, sizeof(*left_red));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLORARG1, D3DTA_TFACTOR);
+    ok(SUCCEEDED(hr), "Failed to set color arg, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLELIST, 2, right_green, sizeof(*right_green));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(SUCCEEDED(hr), "Failed to end scene, hr %#x.\n", hr);
+    color = getPixelColor(device, 160, 240);
+    ok(color_match(color, 0x00ff0000, 1), "Got unexpected color 0x%08x.\n", color);
+    color = getPixelColor(device, 480, 240);
+    ok(color_match(color, 0x000000ff, 1), "Got unexpected color 0x%08x.\n", color);
+
+    hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+    ok(SUCCEEDED(hr), "Failed to set color arg, hr %#x.\n", hr);
+
+    /* Mixed primitive types. Strips are never merged, not even with each
+     * other. */
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff000000, 1.0f, 0);
+    ok(SUCCEEDED(hr), "Failed to clear, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(SUCCEEDED(hr), "Failed to begin scene, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLELIST, 2, left_red, sizeof(*left_red));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2,
+            top_right_strip, sizeof(*top_right_strip));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2,
+            bottom_right_strip, sizeof(*bottom_right_strip));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLELIST, 2, left_red, sizeof(*left_red));
+    ok(SUCCEEDED(hr), "Failed to draw, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(SUCCEEDED(hr), "Failed to end scene, hr %#x.\n", hr);
+    color = getPixelColor(device, 160, 240);
+    ok(color_match(color, 0x00ff0000, 1), "Got unexpected color 0x%08x.\n", color);
+    color = getPixelColor(device, 480, 120);
+    ok(color_match(color, 0x000000ff, 1), "Got unexpected color 0x%08x.\n", color);
+    color = getPixelColor(device, 480, 360);
+    ok(color_match(color, 0x00ffff00, 1), "Got unexpected color 0x%08x.\n", color);
+
+    hr = IDirect3DDevice9_Present(device, NULL, NULL, NULL, NULL);
+    ok(SUCCEEDED(hr), "Failed to present, hr %#x.\n", hr);
+
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+    IDirect3D9_Release(d3d);
+    DestroyWindow(window);
+}
+
+static void test_draw_primitive_up_batching(void)
+{
+    draw_primitive_up_batching();
+
+    /* wined3d reads its settings when it is loaded, so the same draws are
+     * repeated with batching enabled in a child process. Merged draws have
+     * to render exactly like separate ones. */
+    if (!winetest_run_wine_child("--draw-up-batching", "WINE_D3D_CONFIG", "BatchDrawPrimitiveUP=enabled"))
+        skip("Draw batching is specific to Wine.\n");
+}
+
 static void test_desktop_window(void)
 {
     IDirect3DDevice9 *device;
@@ -25891,8 +26047,15 @@ START_TEST(visual)
 {
     D3DADAPTER_IDENTIFIER9 identifier;
     IDirect3D9 *d3d;
+    char **argv;
     HRESULT hr;
 
+    if (winetest_get_mainargs(&argv) >= 3 && !strcmp(argv[2], "--draw-up-batching"))
+    {
+        draw_primitive_up_batching();
+        return;
+    }
+
     if (!(d3d = Direct3DCreate9(D3D_SDK_VERSION)))
     {
         skip("could not create D3D9 object\n");
@@ -26030,4 +26193,5 @@ START_TEST(visual)
     test_sysmem_draw();
     test_nrm_instruction();
     test_desktop_window();
+    test_draw_primitive_up_batching();
 }
@@ -181,6 +181,23 @@ struct layout_run {
     UINT32 start_position; /* run text position in range [0, layout-text-length) */
 };
 
+/* Script and bidi analysis done for a single layout range. It only depends on text and reading direction,
+   so it's kept across relayouts and reused as long as range boundaries stay the same. */
+struct layout_analysis_run {
+    DWRITE_SCRIPT_ANALYSIS sa;
+    UINT32 position;
+    UINT32 length;
+    UINT8 bidi_level;
+};
+
+struct layout_analysis {
+    struct list entry;
+    DWRITE_TEXT_RANGE range;
+    BOOL used;
+    UINT32 count;
+    struct layout_analysis_run runs[1];
+};
+
 struct layout_effective_run {
     struct list entry;
     const struct layout_run *run; /* nominal run this one is based on */
@@ -262,6 +279,7 @@ struct dwrite_textlayout {
     struct list spacing;
     struct list ranges;
     struct list runs;
+    struct list analysis;
     /* lists ready to use by Draw() */
     struct list eruns;
     struct list inlineobjects;
@@ -508,10 +526,10 @@ static struct layout_run *alloc_layout_run(enum layout_run_kind kind, UINT32 sta
     return ret;
 }
 
-static void free_layout_runs(struct dwrite_textlayout *layout)
+static void free_layout_runs(struct list *runs)
 {
     struct layout_run *cur, *cur2;
-    LIST_FOR_EACH_ENTRY_SAFE(cur, cur2, &layout->runs, struct layout_run, entry) {
+    LIST_FOR_EACH_ENTRY_SAFE(cur, cur2, runs, struct layout_run, entry) {
         list_remove(&cur->entry);
         if (cur->kind == LAYOUT_RUN_REGULAR) {
             if (cur->u.regular.run.fontFace)
@@ -525,6 +543,27 @@ static void free_layout_runs(struct dwrite_textlayout *layout)
     }
 }
 
+static void free_layout_analysis(struct dwrite_textlayout *layout, BOOL unused_only)
+{
+    struct layout_analysis *cur, *cur2;
+
+    LIST_FOR_EACH_ENTRY_SAFE(cur, cur2, &layout->analysis, struct layout_analysis, entry) {
+        if (unused_only && cur->used)
+            continue;
+        list_remove(&cur->entry);
+        heap_free(cur);
+    }
+}
+
+static void free_layout_eruns(struct dwrite_textlayout *layout);
+
+/* Drops shaping results kept for reuse, should only be called when layout needs to be recomputed. */
+static void layout_discard_shaped_runs(struct dwrite_textlayout *layout)
+{
+    free_layout_eruns(layout);
+    free_layout_runs(&layout->runs);
+}
+
 static void free_layout_eruns(struct dwrite_textlayout *layout)
 {
     struct layout_effective_inline *in, *in2;
@@ -748,8 +787,76 @@ static void layout_get_font_height(FLOAT emsize, DWRITE_FONT_METRICS *fontmetric
     *height = SCALE_FONT_METRIC(fontmetrics->ascent + fontmetrics->descent + fontmetrics->lineGap, emsize, fontmetrics);
 }
 
+static struct layout_analysis *layout_get_cached_analysis(struct dwrite_textlayout *layout, UINT32 start,
+    UINT32 length)
+{
+    struct layout_analysis *analysis;
+
+    LIST_FOR_EACH_ENTRY(analysis, &layout->analysis, struct layout_analysis, entry) {
+        if (analysis->range.startPosition == start && analysis->range.length == length)
+            return analysis;
+    }
+
+    return NULL;
+}
+
+static HRESULT layout_add_analysis_runs(struct dwrite_textlayout *layout, const struct layout_analysis *analysis)
+{
+    struct layout_run *r;
+    UINT32 i;
+
+    for (i = 0; i < analysis->count; i++) {
+        const struct layout_analysis_run *cur = &analysis->runs[i];
+
+        r = alloc_layout_run(LAYOUT_RUN_REGULAR, cur->position);
+        if (!r)
+            return E_OUTOFMEMORY;
+
+        r->u.regular.descr.string = &layout->str[cur->position];
+        r->u.regular.descr.stringLength = cur->length;
+        r->u.regular.descr.textPosition = cur->position;
+        r->u.regular.sa = cur->sa;
+        r->u.regular.run.bidiLevel = cur->bidi_level;
+        list_add_tail(&layout->runs, &r->entry);
+    }
+
+    return S_OK;
+}
+
+/* Remembers runs added after 'last' as analysis results for given text range. */
+static void layout_cache_analysis(struct dwrite_textlayout *layout, struct list *last, UINT32 start, UINT32 length)
+{
+    struct layout_analysis *analysis;
+    struct layout_run *r;
+    struct list *cur;
+    UINT32 count = 0;
+
+    for (cur = list_next(&layout->runs, last); cur; cur = list_next(&layout->runs, cur))
+        count++;
+
+    if (!count || !(analysis = heap_alloc(FIELD_OFFSET(struct layout_analysis, runs[count]))))
+        return;
+
+    analysis->range.startPosition = start;
+    analysis->range.length = length;
+    analysis->used = TRUE;
+    analysis->count = 0;
+    for (cur = list_next(&layout->runs, last); cur; cur = list_next(&layout->runs, cur)) {
+        struct layout_analysis_run *run = &analysis->runs[analysis->count++];
+
+        r = LIST_ENTRY(cur, struct layout_run, entry);
+        run->sa = r->u.regular.sa;
+        run->position = r->u.regular.descr.textPosition;
+        run->length = r->u.regular.descr.stringLength;
+        run->bidi_level = r->u.regular.run.bidiLevel;
+    }
+
+    list_add_tail(&layout->analysis, &analysis->entry);
+}
+
 static HRESULT layout_itemize(struct dwrite_textlayout *layout)
 {
+    struct layout_analysis *analysis;
     IDWriteTextAnalyzer *analyzer;
     struct layout_range *range;
     struct layout_run *r;
@@ -757,7 +864,12 @@ static HRESULT layout_itemize(struct dwrite_textlayout *layout)
 
     analyzer = get_text_analyzer();
 
+    LIST_FOR_EACH_ENTRY(analysis, &layout->analysis, struct layout_analysis, entry)
+        analysis->used = FALSE;
+
     LIST_FOR_EACH_ENTRY(range, &layout->ranges, struct layout_range, h.entry) {
+        struct list *last;
+
         /* We don't care about ranges that don't contain any text. */
         if (range->h.range.startPosition >= layout->len)
             break;
@@ -778,6 +890,17 @@ static HRESULT layout_itemize(struct dwrite_textlayout *layout)
             continue;
         }
 
+        /* Ranges that were not split or merged since last layout reuse previous analysis. */
+        if ((analysis = layout_get_cached_analysis(layout, range->h.range.startPosition,
+                get_clipped_range_length(layout, range)))) {
+            analysis->used = TRUE;
+            if (FAILED(hr = layout_add_analysis_runs(layout, analysis)))
+                break;
+            continue;
+        }
+
+        last = layout->runs.prev;
+
         /* Initial splitting by script. */
         hr = IDWriteTextAnalyzer_AnalyzeScript(analyzer, (IDWriteTextAnalysisSource *)&layout->IDWriteTextAnalysisSource1_iface,
                 range->h.range.startPosition, get_clipped_range_length(layout, range),
@@ -791,8 +914,12 @@ static HRESULT layout_itemize(struct dwrite_textlayout *layout)
                 (IDWriteTextAnalysisSink *)&layout->IDWriteTextAnalysisSink1_iface);
         if (FAILED(hr))
             break;
+
+        layout_cache_analysis(layout, last, range->h.range.startPosition, get_clipped_range_length(layout, range));
     }
 
+    free_layout_analysis(layout, TRUE);
+
     return hr;
 }
 
@@ -1024,14 +1151,167 @@ static HRESULT layout_shape_run(struct dwrite_textlayout *layout, struct regular
     return S_OK;
 }
 
+static BOOL is_same_shaped_run(const struct regular_layout_run *run, const struct regular_layout_run *cached)
+{
+    return run->descr.textPosition == cached->descr.textPosition &&
+           run->descr.stringLength == cached->descr.stringLength &&
+           run->sa.script == cached->sa.script &&
+           run->sa.shapes == cached->sa.shapes &&
+           run->run.bidiLevel == cached->run.bidiLevel &&
+           run->run.isSideways == cached->run.isSideways &&
+           run->run.fontFace == cached->run.fontFace &&
+           run->run.fontEmSize == cached->run.fontEmSize &&
+           /* placement is only set when shaping succeeded */
+           cached->run.glyphAdvances;
+}
+
+/* Takes glyph data over from runs of previous layout that are still the same. Both lists are ordered by
+   text position. */
+static void layout_reuse_shaped_runs(struct dwrite_textlayout *layout, struct list *cached_runs)
+{
+    struct layout_run *r, *cached;
+    struct list *cur;
+    UINT32 count = 0;
+
+    cur = list_head(cached_runs);
+    LIST_FOR_EACH_ENTRY(r, &layout->runs, struct layout_run, entry) {
+        struct regular_layout_run *run = &r->u.regular, *prev;
+
+        if (r->kind == LAYOUT_RUN_INLINE)
+            continue;
+
+        while (cur && LIST_ENTRY(cur, struct layout_run, entry)->start_position < r->start_position)
+            cur = list_next(cached_runs, cur);
+        if (!cur)
+            break;
+
+        cached = LIST_ENTRY(cur, struct layout_run, entry);
+        if (cached->kind == LAYOUT_RUN_INLINE || !is_same_shaped_run(run, &cached->u.regular))
+            continue;
+
+        prev = &cached->u.regular;
+        run->descr.localeName = get_layout_range_by_pos(layout, run->descr.textPosition)->locale;
+        run->glyphs = prev->glyphs;
+        run->clustermap = prev->clustermap;
+        run->advances = prev->advances;
+        run->offsets = prev->offsets;
+        run->glyphcount = prev->glyphcount;
+        run->run.glyphIndices = run->glyphs;
+        run->run.glyphAdvances = run->advances;
+        run->run.glyphOffsets = run->offsets;
+        run->run.glyphCount = prev->run.glyphCount;
+        run->descr.clusterMap = run->clustermap;
+
+        prev->glyphs = NULL;
+        prev->clustermap = NULL;
+        prev->advances = NULL;
+        prev->offsets = NULL;
+        prev->run.glyphAdvances = NULL;
+        count++;
+    }
+
+    TRACE("reused %u shaped runs\n", count);
+}
+
+/* Runs are shaped independently of each other, so with enough text they are spread over a few thread pool
+   threads. Shaping caches of font faces are created upfront, anything else they use is either read-only
+   or serialized by the font backend. */
+#define LAYOUT_PARALLEL_MIN_LENGTH 16384
+#define LAYOUT_MAX_THREADS 8
+
+struct layout_shaping_job {
+    struct dwrite_textlayout *layout;
+    struct layout_run **runs;
+    HRESULT *results;
+    UINT32 count;
+    LONG next;
+    LONG workers;
+    HANDLE done;
+};
+
+static void layout_process_shaping_job(struct layout_shaping_job *job)
+{
+    LONG i;
+
+    while ((UINT32)(i = InterlockedIncrement(&job->next) - 1) < job->count) {
+        struct regular_layout_run *run = &job->runs[i]->u.regular;
+
+        /* runs reused from previous layout are already shaped */
+        if (!run->glyphs)
+            job->results[i] = layout_shape_run(job->layout, run);
+    }
+}
+
+static void CALLBACK layout_shaping_worker(TP_CALLBACK_INSTANCE *instance, void *arg)
+{
+    struct layout_shaping_job *job = arg;
+
+    layout_process_shaping_job(job);
+    if (!InterlockedDecrement(&job->workers))
+        SetEvent(job->done);
+}
+
+static void layout_shape_runs(struct dwrite_textlayout *layout, struct layout_run **runs, HRESULT *results,
+    UINT32 count)
+{
+    struct layout_shaping_job job;
+    UINT32 i, threads, length = 0;
+    SYSTEM_INFO info;
+
+    for (i = 0; i < count; i++) {
+        results[i] = S_OK;
+        if (!runs[i]->u.regular.glyphs)
+            length += runs[i]->u.regular.descr.stringLength;
+    }
+
+    job.layout = layout;
+    job.runs = runs;
+    job.results = results;
+    job.count = count;
+    job.next = 0;
+    job.workers = 1;
+
+    GetSystemInfo(&info);
+    threads = min(min(info.dwNumberOfProcessors, LAYOUT_MAX_THREADS), count);
+    if (threads <= 1 || length < LAYOUT_PARALLEL_MIN_LENGTH || !(job.done = CreateEventW(NULL, TRUE, FALSE, NULL))) {
+        layout_process_shaping_job(&job);
+        return;
+    }
+
+    TRACE("shaping %u runs, %u characters, using up to %u threads\n", count, length, threads);
+
+    for (i = 0; i < count; i++) {
+        if (!runs[i]->u.regular.glyphs)
+            fontface_get_shaping_cache(unsafe_impl_from_IDWriteFontFace(runs[i]->u.regular.run.fontFace));
+    }
+
+    for (i = 1; i < threads; i++) {
+        InterlockedIncrement(&job.workers);
+        if (!TrySubmitThreadpoolCallback(layout_shaping_worker, &job, NULL)) {
+            InterlockedDecrement(&job.workers);
+            break;
+        }
+    }
+
+    layout_process_shaping_job(&job);
+    if (InterlockedDecrement(&job.workers))
+        WaitForSingleObject(job.done, INFINITE);
+    CloseHandle(job.done);
+}
+
 static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
 {
-    struct layout_run *r;
-    UINT32 cluster = 0;
+    struct layout_run **shaping_runs = NULL, *r;
+    HRESULT *shaping_results = NULL;
+    UINT32 cluster = 0, count = 0;
+    struct list cached_runs;
     HRESULT hr;
 
     free_layout_eruns(layout);
-    free_layout_runs(layout);
+
+    /* Previous runs are kept until new ones are resolved, to take over their glyphs if nothing changed. */
+    list_init(&cached_runs);
+    list_move_tail(&cached_runs, &layout->runs);
 
     /* Cluster data arrays are allocated once, assuming one text position per cluster. */
     if (!layout->clustermetrics && layout->len) {
@@ -1040,6 +1320,7 @@ static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
         if (!layout->clustermetrics || !layout->clusters) {
             heap_free(layout->clustermetrics);
             heap_free(layout->clusters);
+            free_layout_runs(&cached_runs);
             return E_OUTOFMEMORY;
         }
     }
@@ -1047,14 +1328,43 @@ static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
 
     if (FAILED(hr = layout_itemize(layout))) {
         WARN("Itemization failed, hr %#x.\n", hr);
+        free_layout_runs(&cached_runs);
         return hr;
     }
 
     if (FAILED(hr = layout_resolve_fonts(layout))) {
         WARN("Failed to resolve layout fonts, hr %#x.\n", hr);
+        free_layout_runs(&cached_runs);
         return hr;
     }
 
+    layout_reuse_shaped_runs(layout, &cached_runs);
+    free_layout_runs(&cached_runs);
+
+    LIST_FOR_EACH_ENTRY(r, &layout->runs, struct layout_run, entry) {
+        if (r->kind == LAYOUT_RUN_REGULAR)
+            count++;
+    }
+
+    if (count) {
+        shaping_runs = heap_calloc(count, sizeof(*shaping_runs));
+        shaping_results = heap_calloc(count, sizeof(*shaping_results));
+        if (!shaping_runs || !shaping_results) {
+            heap_free(shaping_runs);
+            heap_free(shaping_results);
+            return E_OUTOFMEMORY;
+        }
+
+        count = 0;
+        LIST_FOR_EACH_ENTRY(r, &layout->runs, struct layout_run, entry) {
+            if (r->kind == LAYOUT_RUN_REGULAR)
+                shaping_runs[count++] = r;
+        }
+
+        layout_shape_runs(layout, shaping_runs, shaping_results, count);
+        count = 0;
+    }
+
     /* fill run info */
     LIST_FOR_EACH_ENTRY(r, &layout->runs, struct layout_run, entry) {
         struct regular_layout_run *run = &r->u.regular;
@@ -1093,7 +1403,7 @@ static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
             continue;
         }
 
-        if (FAILED(hr = layout_shape_run(layout, run)))
+        if (FAILED(hr = shaping_results[count++]))
             WARN("%s: shaping failed, hr %#x.\n", debugstr_rundescr(&run->descr), hr);
 
         /* baseline derived from font metrics */
@@ -1103,6 +1413,9 @@ static HRESULT layout_compute_runs(struct dwrite_textlayout *layout)
         layout_set_cluster_metrics(layout, r, &cluster);
     }
 
+    heap_free(shaping_runs);
+    heap_free(shaping_results);
+
     if (hr == S_OK) {
         layout->cluster_count = cluster;
         if (cluster)
@@ -2837,7 +3150,8 @@ static ULONG WINAPI dwritetextlayout_Release(IDWriteTextLayout3 *iface)
         IDWriteFactory5_Release(This->factory);
         free_layout_ranges_list(This);
         free_layout_eruns(This);
-        free_layout_runs(This);
+        free_layout_runs(&This->runs);
+        free_layout_analysis(This, FALSE);
         release_format_data(&This->format);
         heap_free(This->nominal_breakpoints);
         heap_free(This->actual_breakpoints);
@@ -3198,6 +3512,7 @@ static HRESULT WINAPI dwritetextlayout_SetLocaleName(IDWriteTextLayout3 *iface,
 {
     struct dwrite_textlayout *This = impl_from_IDWriteTextLayout3(iface);
     struct layout_range_attr_value value;
+    HRESULT hr;
 
     TRACE("(%p)->(%s %s)\n", This, debugstr_w(locale), debugstr_range(&range));
 
@@ -3206,7 +3521,13 @@ static HRESULT WINAPI dwritetextlayout_SetLocaleName(IDWriteTextLayout3 *iface,
 
     value.range = range;
     value.u.locale = locale;
-    return set_layout_range_attr(This, LAYOUT_RANGE_ATTR_LOCALE, &value);
+    hr = set_layout_range_attr(This, LAYOUT_RANGE_ATTR_LOCALE, &value);
+
+    /* shaping depends on locale, and ranges are updated in place */
+    if (SUCCEEDED(hr) && (This->recompute & RECOMPUTE_CLUSTERS))
+        layout_discard_shaped_runs(This);
+
+    return hr;
 }
 
 static FLOAT WINAPI dwritetextlayout_GetMaxWidth(IDWriteTextLayout3 *iface)
@@ -3999,6 +4320,8 @@ static HRESULT WINAPI dwritetextlayout3_InvalidateLayout(IDWriteTextLayout3 *ifa
     TRACE("(%p)\n", This);
 
     This->recompute = RECOMPUTE_EVERYTHING;
+    layout_discard_shaped_runs(This);
+    free_layout_analysis(This, FALSE);
     return S_OK;
 }
 
@@ -4247,8 +4570,11 @@ static HRESULT WINAPI dwritetextformat_layout_SetReadingDirection(IDWriteTextFor
     if (FAILED(hr))
         return hr;
 
-    if (changed)
+    if (changed) {
+        /* bidi levels have to be resolved again */
+        free_layout_analysis(This, FALSE);
         This->recompute = RECOMPUTE_EVERYTHING;
+    }
 
     return S_OK;
 }
@@ -4973,6 +5299,7 @@ static HRESULT init_textlayout(const struct textlayout_desc *desc, struct dwrite
     list_init(&layout->underlines);
     list_init(&layout->strikethrough);
     list_init(&layout->runs);
+    list_init(&layout->analysis);
     list_init(&layout->ranges);
     list_init(&layout->strike_ranges);
     list_init(&layout->underline_ranges);
@@ -5734,6 +5734,125 @@ todo_wine {
     IDWriteFactory_Release(factory);
 }
 
+static void test_relayout(void)
+{
+    static const WCHAR textW[] = {'a','b','c',' ','d','e','f',' ',0x5d0,0x5d1,' ','g','h','\n','i','j',0};
+    static const WCHAR corpusW[] = {'T','h','e',' ','q','u','i','c','k',' ','b','r','o','w','n',' ','f','o','x',' ',
+        0x645,0x631,0x62d,0x628,0x627,' ',0x5e9,0x5dc,0x5d5,0x5dd,' ','j','u','m','p','s',' ','o','v','e','r',' ',
+        't','h','e',' ','l','a','z','y',' ','d','o','g','.','\n'};
+    DWRITE_CLUSTER_METRICS clusters[16], clusters2[16], *corpus_clusters, *big_clusters;
+    DWRITE_TEXT_METRICS metrics, metrics2;
+    UINT32 count, count2, len, repeat, i, j;
+    IDWriteTextLayout *layout;
+    IDWriteTextFormat *format;
+    IDWriteFactory *factory;
+    DWRITE_TEXT_RANGE range;
+    WCHAR *text;
+    HRESULT hr;
+
+    factory = create_factory();
+
+    hr = IDWriteFactory_CreateTextFormat(factory, tahomaW, NULL, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
+        DWRITE_FONT_STRETCH_NORMAL, 10.0f, enusW, &format);
+    ok(hr == S_OK, "Failed to create text format, hr %#x.\n", hr);
+
+    /* Changing properties back and forth gives the same layout. */
+    hr = IDWriteFactory_CreateTextLayout(factory, textW, lstrlenW(textW), format, 1000.0f, 1000.0f, &layout);
+    ok(hr == S_OK, "Failed to create layout, hr %#x.\n", hr);
+
+    hr = IDWriteTextLayout_GetMetrics(layout, &metrics);
+    ok(hr == S_OK, "Failed to get metrics, hr %#x.\n", hr);
+    hr = IDWriteTextLayout_GetClusterMetrics(layout, clusters, ARRAY_SIZE(clusters), &count);
+    ok(hr == S_OK, "Failed to get cluster metrics, hr %#x.\n", hr);
+
+    range.startPosition = 4;
+    range.length = 3;
+    hr = IDWriteTextLayout_SetFontSize(layout, 20.0f, range);
+    ok(hr == S_OK, "Failed to set font size, hr %#x.\n", hr);
+    hr = IDWriteTextLayout_GetMetrics(layout, &metrics2);
+    ok(hr == S_OK, "Failed to get metrics, hr %#x.\n", hr);
+    ok(metrics2.width > metrics.width, "Unexpected width %f, was %f.\n", metrics2.width, metrics.width);
+
+    hr = IDWriteTextLayout_SetFontSize(layout, 10.0f, range);
+    ok(hr == S_OK, "Failed to set font size, hr %#x.\n", hr);
+    hr = IDWriteTextLayout_GetMetrics(layout, &metrics2);
+    ok(hr == S_OK, "Failed to get metrics, hr %#x.\n", hr);
+    ok(metrics2.width == metrics.width, "Unexpected width %f, expected %f.\n", metrics2.width, metrics.width);
+    ok(metrics2.height == metrics.height, "Unexpected height %f, expected %f.\n", metrics2.height, metrics.height);
+    ok(metrics2.lineCount == metrics.lineCount, "Unexpected line count %u, expected %u.\n", metrics2.lineCount,
+        metrics.lineCount);
+
+    hr = IDWriteTextLayout_GetClusterMetrics(layout, clusters2, ARRAY_SIZE(clusters2), &count2);
+    ok(hr == S_OK, "Failed to get cluster metrics, hr %#x.\n", hr);
+    ok(count2 == count, "Unexpected cluster count %u, expected %u.\n", count2, count);
+    for (i = 0; i < min(count, count2); i++)
+    {
+        ok(clusters2[i].width == clusters[i].width, "%u: unexpected width %f, expected %f.\n", i, clusters2[i].width,
+            clusters[i].width);
+        ok(clusters2[i].length == clusters[i].length, "%u: unexpected length %u, expected %u.\n", i,
+            clusters2[i].length, clusters[i].length);
+    }
+
+    IDWriteTextLayout_Release(layout);
+
+    /* Large texts are shaped in parallel, and must give the same clusters as a
+     * single paragraph, before and after a relayout. */
+    hr = IDWriteFactory_CreateTextLayout(factory, corpusW, ARRAY_SIZE(corpusW), format, 1000.0f, 1000.0f, &layout);
+    ok(hr == S_OK, "Failed to create layout, hr %#x.\n", hr);
+    hr = IDWriteTextLayout_GetClusterMetrics(layout, NULL, 0, &count);
+    ok(hr == E_NOT_SUFFICIENT_BUFFER, "Unexpected hr %#x.\n", hr);
+    corpus_clusters = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*corpus_clusters));
+    hr = IDWriteTextLayout_GetClusterMetrics(layout, corpus_clusters, count, &count);
+    ok(hr == S_OK, "Failed to get cluster metrics, hr %#x.\n", hr);
+    IDWriteTextLayout_Release(layout);
+
+    repeat = 1024;
+    len = repeat * ARRAY_SIZE(corpusW);
+    text = HeapAlloc(GetProcessHeap(), 0, len * sizeof(*text));
+    for (i = 0; i < len; i++)
+        text[i] = corpusW[i % ARRAY_SIZE(corpusW)];
+    big_clusters = HeapAlloc(GetProcessHeap(), 0, repeat * count * sizeof(*big_clusters));
+
+    hr = IDWriteFactory_CreateTextLayout(factory, text, len, format, 1000.0f, 1000.0f, &layout);
+    ok(hr == S_OK, "Failed to create layout, hr %#x.\n", hr);
+
+    for (j = 0; j < 3; j++)
+    {
+        if (j)
+        {
+            range.startPosition = len / 2;
+            range.length = 16;
+            hr = IDWriteTextLayout_SetFontWeight(layout, j == 1 ? DWRITE_FONT_WEIGHT_BOLD : DWRITE_FONT_WEIGHT_NORMAL,
+                range);
+            ok(hr == S_OK, "Failed to set font weight, hr %#x.\n", hr);
+        }
+
+        hr = IDWriteTextLayout_GetClusterMetrics(layout, big_clusters, repeat * count, &count2);
+        ok(hr == S_OK, "%u: failed to get cluster metrics, hr %#x.\n", j, hr);
+        ok(count2 == repeat * count, "%u: unexpected cluster count %u, expected %u.\n", j, count2, repeat * count);
+        if (j == 1 || hr != S_OK || count2 != repeat * count) continue;
+
+        for (i = 0; i < count2; i++)
+        {
+            if (big_clusters[i].width != corpus_clusters[i % count].width ||
+                big_clusters[i].length != corpus_clusters[i % count].length)
+            {
+                ok(0, "%u: cluster %u has width %f, length %u, expected %f, %u.\n", j, i, big_clusters[i].width,
+                    big_clusters[i].length, corpus_clusters[i % count].width, corpus_clusters[i % count].length);
+                break;
+            }
+        }
+    }
+
+    IDWriteTextLayout_Release(layout);
+    HeapFree(GetProcessHeap(), 0, big_clusters);
+    HeapFree(GetProcessHeap(), 0, corpus_clusters);
+    HeapFree(GetProcessHeap(), 0, text);
+
+    IDWriteTextFormat_Release(format);
+    IDWriteFactory_Release(factory);
+}
+
 START_TEST(layout)
 {
     IDWriteFactory *factory;
@@ -5785,6 +5904,7 @@ START_TEST(layout)
     test_line_spacing();
     test_GetOverhangMetrics();
     test_tab_stops();
+    test_relayout();
 
     IDWriteFactory_Release(factory);
 }
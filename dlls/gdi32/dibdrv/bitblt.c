@@ -19,8 +19,10 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 
 #include "gdi_private.h"
+#include "winreg.h"
 #include "dibdrv.h"
 
 #include "wine/debug.h"
@@ -581,19 +583,197 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/* Large operations can be split into horizontal bands that are rendered in
+ * parallel by the thread pool. This is disabled unless the WINEDIBTHREADS
+ * environment variable or the DibThreads value under HKCU\Software\Wine\GDI
+ * is set: 0 uses one thread per CPU, other values give the number of
+ * threads. */
+#define BAND_MIN_PIXELS  (256 * 1024)
+#define BAND_MIN_ROWS    16
+#define BAND_MAX_THREADS 16
+
+static unsigned int band_threads = 1;
+
+struct band_job
+{
+    void (*func)( void *ctx, int top, int bottom );
+    void *ctx;
+    int top, bottom, band_height;
+    LONG next_band;
+    LONG workers;
+    HANDLE done;
+};
+
+void init_dib_bands(void)
+{
+    static const WCHAR gdiW[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\','G','D','I',0};
+    static const WCHAR dib_threadsW[] = {'D','i','b','T','h','r','e','a','d','s',0};
+    DWORD type, count, size = sizeof(count);
+    const char *env;
+    SYSTEM_INFO info;
+    HKEY key;
+
+    if ((env = getenv( "WINEDIBTHREADS" )) && *env)
+        count = atoi( env );
+    else
+    {
+        if (RegOpenKeyW( HKEY_CURRENT_USER, gdiW, &key )) return;
+        if (RegQueryValueExW( key, dib_threadsW, NULL, &type, (BYTE *)&count, &size ) || type != REG_DWORD)
+            count = 1;
+        RegCloseKey( key );
+    }
+
+    if (!count)
+    {
+        GetSystemInfo( &info );
+        count = info.dwNumberOfProcessors;
+    }
+    band_threads = max( 1, min( count, BAND_MAX_THREADS ));
+    TRACE( "using up to %u threads\n", band_threads );
+}
+
+static void process_bands( struct band_job *job )
+{
+    int top;
+
+    for (;;)
+    {
+        top = job->top + (InterlockedIncrement( &job->next_band ) - 1) * job->band_height;
+        if (top >= job->bottom) break;
+        job->func( job->ctx, top, min( top + job->band_height, job->bottom ));
+    }
+}
+
+static void CALLBACK band_worker( TP_CALLBACK_INSTANCE *instance, void *arg )
+{
+    struct band_job *job = arg;
+
+    process_bands( job );
+    if (!InterlockedDecrement( &job->workers )) SetEvent( job->done );
+}
+
+/* Calls func for horizontal bands covering rows top to bottom. The bands
+ * must be independent of each other; they may run concurrently, in any
+ * order. */
+void run_in_bands( void (*func)( void *ctx, int top, int bottom ), void *ctx, int top, int bottom, int width )
+{
+    struct band_job job;
+    unsigned int threads = band_threads, i;
+    int height = bottom - top;
+
+    if (threads > 1 && (LONGLONG)width * height >= BAND_MIN_PIXELS)
+        threads = min( threads, height / BAND_MIN_ROWS );
+    else
+        threads = 1;
+
+    if (threads <= 1 || !(job.done = CreateEventW( NULL, TRUE, FALSE, NULL )))
+    {
+        func( ctx, top, bottom );
+        return;
+    }
+
+    /* Use a few bands per thread, so that threads that finish early can
+     * pick up some of the remaining work. */
+    job.func = func;
+    job.ctx = ctx;
+    job.top = top;
+    job.bottom = bottom;
+    job.band_height = max( BAND_MIN_ROWS, (height + threads * 4 - 1) / (threads * 4) );
+    job.next_band = 0;
+    job.workers = 1;
+
+    for (i = 1; i < threads; i++)
+    {
+        InterlockedIncrement( &job.workers );
+        if (!TrySubmitThreadpoolCallback( band_worker, &job, NULL ))
+        {
+            InterlockedDecrement( &job.workers );
+            break;
+        }
+    }
+
+    process_bands( &job );
+    if (InterlockedDecrement( &job.workers )) WaitForSingleObject( job.done, INFINITE );
+    CloseHandle( job.done );
+}
+
+struct blend_job
+{
+    const dib_info *dst;
+    const dib_info *src;
+    RECT rect;
+    POINT origin;
+    BLENDFUNCTION blend;
+};
+
+static void blend_band( void *ctx, int top, int bottom )
+{
+    const struct blend_job *job = ctx;
+    RECT rect = job->rect;
+    POINT origin = job->origin;
+
+    origin.y += top - rect.top;
+    rect.top = top;
+    rect.bottom = bottom;
+    job->dst->funcs->blend_rect( job->dst, &rect, job->src, &origin, job->blend );
+}
+
+static const BYTE *get_row_ptr( const dib_info *dib, int y )
+{
+    return (const BYTE *)dib->bits.ptr + (dib->rect.top + y) * dib->stride;
+}
+
+/* Returns TRUE if blending rect reads source rows that another band
+ * writes, which happens when source and destination share their bits. */
+static BOOL blend_rows_overlap( const dib_info *dst, const RECT *rect, const dib_info *src, const POINT *origin )
+{
+    int height = rect->bottom - rect->top;
+    const BYTE *dst_start, *dst_end, *src_start, *src_end;
+
+    dst_start = get_row_ptr( dst, rect->top );
+    dst_end = get_row_ptr( dst, rect->bottom - 1 );
+    src_start = get_row_ptr( src, origin->y );
+    src_end = get_row_ptr( src, origin->y + height - 1 );
+
+    /* each band reading back its own rows is fine */
+    if (src_start == dst_start && src->stride == dst->stride) return FALSE;
+
+    if (dst_start > dst_end)
+    {
+        const BYTE *tmp = dst_start;
+        dst_start = dst_end;
+        dst_end = tmp;
+    }
+    if (src_start > src_end)
+    {
+        const BYTE *tmp = src_start;
+        src_start = src_end;
+        src_end = tmp;
+    }
+    return src_start < dst_end + abs( dst->stride ) && dst_start < src_end + abs( src->stride );
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
-    POINT origin;
+    struct blend_job job;
     struct clipped_rects clipped_rects;
     int i;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
+
+    job.dst = dst;
+    job.src = src;
+    job.blend = blend;
     for (i = 0; i < clipped_rects.count; i++)
     {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        job.rect = clipped_rects.rects[i];
+        job.origin.x = src_rect->left + job.rect.left - dst_rect->left;
+        job.origin.y = src_rect->top  + job.rect.top  - dst_rect->top;
+        if (blend_rows_overlap( dst, &job.rect, src, &job.origin ))
+            blend_band( &job, job.rect.top, job.rect.bottom );
+        else
+            run_in_bands( blend_band, &job, job.rect.top, job.rect.bottom, job.rect.right - job.rect.left );
     }
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -1196,79 +1376,57 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
-DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                          INT mode )
+struct stretch_job
 {
-    dib_info src_dib, dst_dib;
-    POINT dst_start, src_start, dst_end, src_end;
-    RECT rect;
-    BOOL hstretch, vstretch;
+    dib_info *dst_dib;
+    const dib_info *src_dib;
+    POINT dst_start, src_start;
     struct stretch_params v_params, h_params;
-    int err;
-    DWORD ret;
+    BOOL vstretch;
+    int mode;
+    int width;
     void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
                     const dib_info *src_dib, const POINT *src_start,
                     const struct stretch_params *params, int mode, BOOL keep_dst);
+};
 
-    TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
-          dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
-          src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
-
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
-    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
-
-    /* v */
-    ret = calc_1d_stretch_params( dst->y, dst->height, dst->visrect.top, dst->visrect.bottom,
-                                  src->y, src->height, src->visrect.top, src->visrect.bottom,
-                                  &dst_start.y, &src_start.y, &dst_end.y, &src_end.y,
-                                  &v_params, &vstretch );
-    if (ret) return ret;
-
-    /* h */
-    ret = calc_1d_stretch_params( dst->x, dst->width, dst->visrect.left, dst->visrect.right,
-                                  src->x, src->width, src->visrect.left, src->visrect.right,
-                                  &dst_start.x, &src_start.x, &dst_end.x, &src_end.x,
-                                  &h_params, &hstretch );
-    if (ret) return ret;
-
-    TRACE("got dst start %d, %d inc %d, %d. src start %d, %d inc %d, %d len %d x %d\n",
-          dst_start.x, dst_start.y, h_params.dst_inc, v_params.dst_inc,
-          src_start.x, src_start.y, h_params.src_inc, v_params.src_inc,
-          h_params.length, v_params.length);
-
-    get_bounding_rect( &rect, dst_start.x, dst_start.y, dst_end.x - dst_start.x, dst_end.y - dst_start.y );
-    intersect_rect( &dst->visrect, &dst->visrect, &rect );
-
-    dst_start.x -= dst->visrect.left;
-    dst_start.y -= dst->visrect.top;
-
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+/* Renders the destination rows with an index between first and last. Every
+ * band steps through the whole vertical loop, since that is cheap compared
+ * to rendering rows, so bands don't depend on each other. */
+static void stretch_rows( void *ctx, int first, int last )
+{
+    const struct stretch_job *job = ctx;
+    struct stretch_params v_params = job->v_params;
+    POINT dst_start = job->dst_start, src_start = job->src_start;
+    int err = v_params.err_start, row = 0;
 
-    if (vstretch)
+    if (job->vstretch)
     {
         BOOL need_row = TRUE;
         RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
         last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
+        last_row.right = job->width;
 
-        while (v_params.length--)
+        for (; v_params.length-- && row < last; row++)
         {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
+            if (row >= first)
             {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
+                /* The first row of a band can't be copied from the previous
+                 * band, which may not have been rendered yet. */
+                if (need_row || row == first)
+                {
+                    job->row_fn( job->dst_dib, &dst_start, job->src_dib, &src_start, &job->h_params,
+                                 job->mode, FALSE );
+                    need_row = FALSE;
+                }
+                else
+                {
+                    last_row.top = dst_start.y - v_params.dst_inc;
+                    last_row.bottom = last_row.top + 1;
+                    this_row = last_row;
+                    offset_rect( &this_row, 0, v_params.dst_inc );
+                    copy_rect( job->dst_dib, &this_row, job->dst_dib, &last_row, NULL, R2_COPYPEN );
+                }
             }
 
             if (err > 0)
@@ -1285,22 +1443,81 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     {
         int merged_rows = 0;
 
-        while (v_params.length--)
+        while (v_params.length-- && row < last)
         {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
+            if (row >= first && (job->mode != STRETCH_DELETESCANS || !merged_rows))
+                job->row_fn( job->dst_dib, &dst_start, job->src_dib, &src_start, &job->h_params,
+                             job->mode, merged_rows != 0 );
             merged_rows++;
 
             if (err > 0)
             {
                 dst_start.y += v_params.dst_inc;
                 merged_rows = 0;
+                row++;
                 err += v_params.err_add_1;
             }
             else err += v_params.err_add_2;
             src_start.y += v_params.src_inc;
         }
     }
+}
+
+DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
+                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
+                          INT mode )
+{
+    dib_info src_dib, dst_dib;
+    POINT dst_start, src_start, dst_end, src_end;
+    RECT rect;
+    BOOL hstretch, vstretch;
+    struct stretch_params v_params, h_params;
+    struct stretch_job job;
+    DWORD ret;
+
+    TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
+          dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
+          src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
+
+    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
+    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+
+    /* v */
+    ret = calc_1d_stretch_params( dst->y, dst->height, dst->visrect.top, dst->visrect.bottom,
+                                  src->y, src->height, src->visrect.top, src->visrect.bottom,
+                                  &dst_start.y, &src_start.y, &dst_end.y, &src_end.y,
+                                  &v_params, &vstretch );
+    if (ret) return ret;
+
+    /* h */
+    ret = calc_1d_stretch_params( dst->x, dst->width, dst->visrect.left, dst->visrect.right,
+                                  src->x, src->width, src->visrect.left, src->visrect.right,
+                                  &dst_start.x, &src_start.x, &dst_end.x, &src_end.x,
+                                  &h_params, &hstretch );
+    if (ret) return ret;
+
+    TRACE("got dst start %d, %d inc %d, %d. src start %d, %d inc %d, %d len %d x %d\n",
+          dst_start.x, dst_start.y, h_params.dst_inc, v_params.dst_inc,
+          src_start.x, src_start.y, h_params.src_inc, v_params.src_inc,
+          h_params.length, v_params.length);
+
+    get_bounding_rect( &rect, dst_start.x, dst_start.y, dst_end.x - dst_start.x, dst_end.y - dst_start.y );
+    intersect_rect( &dst->visrect, &dst->visrect, &rect );
+
+    dst_start.x -= dst->visrect.left;
+    dst_start.y -= dst->visrect.top;
+
+    job.dst_dib = &dst_dib;
+    job.src_dib = &src_dib;
+    job.dst_start = dst_start;
+    job.src_start = src_start;
+    job.v_params = v_params;
+    job.h_params = h_params;
+    job.vstretch = vstretch;
+    job.mode = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    job.width = dst->visrect.right - dst->visrect.left;
+    job.row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+    run_in_bands( stretch_rows, &job, 0, dst->visrect.bottom - dst->visrect.top, job.width );
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
@@ -210,28 +210,58 @@ void copy_dib_color_info(dib_info *dst, const dib_info *src)
     dst->color_table      = src->color_table;
 }
 
-DWORD convert_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                          const BITMAPINFO *dst_info, void *dst_bits )
+struct convert_job
 {
-    dib_info src_dib, dst_dib;
-    DWORD ret;
+    const dib_info *dst;
+    const dib_info *src;
+    const RECT *src_rect;
+    LONG failed;
+};
 
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
-    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+static void convert_band( void *ctx, int top, int bottom )
+{
+    struct convert_job *job = ctx;
+    dib_info dst = *job->dst;
+    RECT src_rect = *job->src_rect;
+
+    /* The destination rectangle is always at 0,0. */
+    dst.bits.ptr = (BYTE *)dst.bits.ptr + (top - src_rect.top) * dst.stride;
+    dst.height = dst.rect.bottom = bottom - top;
+    src_rect.top = top;
+    src_rect.bottom = bottom;
 
     __TRY
     {
-        dst_dib.funcs->convert_to( &dst_dib, &src_dib, &src->visrect, FALSE );
-        ret = TRUE;
+        dst.funcs->convert_to( &dst, job->src, &src_rect, FALSE );
     }
     __EXCEPT_PAGE_FAULT
     {
-        WARN( "invalid bits pointer %p\n", src_bits );
-        ret = FALSE;
+        InterlockedExchange( &job->failed, TRUE );
     }
     __ENDTRY
+}
 
-    if(!ret) return ERROR_BAD_FORMAT;
+DWORD convert_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
+                          const BITMAPINFO *dst_info, void *dst_bits )
+{
+    dib_info src_dib, dst_dib;
+    struct convert_job job;
+
+    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
+    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+
+    job.dst = &dst_dib;
+    job.src = &src_dib;
+    job.src_rect = &src->visrect;
+    job.failed = FALSE;
+    run_in_bands( convert_band, &job, src->visrect.top, src->visrect.bottom,
+                  src->visrect.right - src->visrect.left );
+
+    if (job.failed)
+    {
+        WARN( "invalid bits pointer %p\n", src_bits );
+        return ERROR_BAD_FORMAT;
+    }
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     src->x -= src->visrect.left;
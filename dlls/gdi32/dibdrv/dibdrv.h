@@ -214,11 +214,11 @@ typedef struct primitive_funcs
                                     const struct stretch_params *params, int mode, BOOL keep_dst);
 } primitive_funcs;
 
-extern const primitive_funcs funcs_8888 DECLSPEC_HIDDEN;
-extern const primitive_funcs funcs_32   DECLSPEC_HIDDEN;
+extern primitive_funcs       funcs_8888 DECLSPEC_HIDDEN;
+extern primitive_funcs       funcs_32   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_24   DECLSPEC_HIDDEN;
-extern const primitive_funcs funcs_555  DECLSPEC_HIDDEN;
-extern const primitive_funcs funcs_16   DECLSPEC_HIDDEN;
+extern primitive_funcs       funcs_555  DECLSPEC_HIDDEN;
+extern primitive_funcs       funcs_16   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_8    DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_4    DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_1    DECLSPEC_HIDDEN;
@@ -265,6 +265,8 @@ extern int clip_line(const POINT *start, const POINT *end, const RECT *clip,
                      const bres_params *params, POINT *pt1, POINT *pt2) DECLSPEC_HIDDEN;
 extern void release_cached_font( struct cached_font *font ) DECLSPEC_HIDDEN;
 extern BOOL fill_with_pixel( DC *dc, dib_info *dib, DWORD pixel, int num, const RECT *rects, INT rop ) DECLSPEC_HIDDEN;
+extern void run_in_bands( void (*func)( void *ctx, int top, int bottom ), void *ctx,
+                          int top, int bottom, int width ) DECLSPEC_HIDDEN;
 
 static inline void init_clipped_rects( struct clipped_rects *clip_rects )
 {
@@ -19,7 +19,9 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include "gdi_private.h"
+#include "winreg.h"
 #include "dibdrv.h"
 
 #include "wine/unicode.h"
@@ -48,22 +50,51 @@ struct cached_font
     struct list           entry;
     LONG                  ref;
     DWORD                 hash;
+    LONG                  size;       /* bytes used by the glyph pages and bitmaps */
+    LONG                  last_used;
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
-static struct list font_cache = LIST_INIT( font_cache );
+/* Fonts are spread by hash over independently locked shards, each of which
+ * keeps its fonts in most-recently-used order. Once the glyphs of all cached
+ * fonts exceed the budget, unused fonts are evicted least-recently-used
+ * first; fonts that are still selected into a DC are never evicted. The
+ * budget can be changed with the WINEGLYPHCACHESIZE environment variable or
+ * the GlyphCacheSize value under HKCU\Software\Wine\GDI, both in KiB. */
+#define FONT_CACHE_SHARDS     16
+#define FONT_CACHE_MAX_UNUSED 4      /* per shard */
+#define GLYPH_CACHE_BUDGET    (8 * 1024 * 1024)
+
+struct DECLSPEC_ALIGN(64) font_cache_shard
+{
+    CRITICAL_SECTION cs;
+    struct list      fonts;
+    LONG             hits;
+    LONG             misses;
+};
 
-static CRITICAL_SECTION font_cache_cs;
+static struct font_cache_shard font_cache[FONT_CACHE_SHARDS];
+static LONG font_cache_clock;
+static LONG font_cache_evictions;
+static LONG glyph_cache_size;
+static LONG glyph_cache_budget = GLYPH_CACHE_BUDGET;
+/* When the fonts in use alone exceed the budget, scanning the shards again
+ * for every new glyph would be pointless, so eviction is retried only once
+ * the cache has grown by another eighth of the budget, or a font has been
+ * released. */
+static LONG glyph_cache_evict_size = GLYPH_CACHE_BUDGET;
+
+static CRITICAL_SECTION font_evict_cs;
 static CRITICAL_SECTION_DEBUG critsect_debug =
 {
-    0, 0, &font_cache_cs,
+    0, 0, &font_evict_cs,
     { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
-      0, 0, { (DWORD_PTR)(__FILE__ ": font_cache_cs") }
+      0, 0, { (DWORD_PTR)(__FILE__ ": font_evict_cs") }
 };
-static CRITICAL_SECTION font_cache_cs = { &critsect_debug, -1, 0, 0, 0, 0 };
+static CRITICAL_SECTION font_evict_cs = { &critsect_debug, -1, 0, 0, 0, 0 };
 
 
 static BOOL brush_rect( dibdrv_physdev *pdev, dib_brush *brush, const RECT *rect, HRGN clip )
@@ -554,10 +585,136 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static inline struct font_cache_shard *get_font_shard( const struct cached_font *font )
+{
+    return &font_cache[(font->hash ^ (font->hash >> 16)) % FONT_CACHE_SHARDS];
+}
+
+static void free_cached_glyphs( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                HeapFree( GetProcessHeap(), 0, font->glyphs[i][j][k] );
+            HeapFree( GetProcessHeap(), 0, font->glyphs[i][j] );
+        }
+    }
+    InterlockedExchangeAdd( &glyph_cache_size, -font->size );
+}
+
+/* must be called with the shard lock held */
+static struct cached_font *get_oldest_unused_font( struct font_cache_shard *shard )
+{
+    struct cached_font *font;
+
+    LIST_FOR_EACH_ENTRY_REV( font, &shard->fonts, struct cached_font, entry )
+        if (!font->ref && font->size) return font;
+    return NULL;
+}
+
+static void evict_cached_fonts(void)
+{
+    struct cached_font *font, *victim;
+    struct font_cache_shard *shard = NULL;
+    LONG hits = 0, misses = 0, last_used = 0;
+    UINT i;
+
+    /* one thread evicting is enough, the others just keep rendering */
+    if (!TryEnterCriticalSection( &font_evict_cs )) return;
+
+    while (glyph_cache_size > glyph_cache_budget)
+    {
+        victim = NULL;
+        for (i = 0; i < FONT_CACHE_SHARDS; i++)
+        {
+            EnterCriticalSection( &font_cache[i].cs );
+            if ((font = get_oldest_unused_font( &font_cache[i] )) &&
+                (!victim || font->last_used - last_used < 0))
+            {
+                victim = font;
+                last_used = font->last_used;
+                shard = &font_cache[i];
+            }
+            LeaveCriticalSection( &font_cache[i].cs );
+        }
+        if (!victim)
+        {
+            TRACE( "%d bytes used by fonts in use\n", glyph_cache_size );
+            InterlockedExchange( &glyph_cache_evict_size, glyph_cache_size + glyph_cache_budget / 8 );
+            break;
+        }
+
+        EnterCriticalSection( &shard->cs );
+        /* the font may have been reused or recycled while the shard was unlocked */
+        if (!victim->ref && victim->last_used == last_used)
+        {
+            TRACE( "evicting %p, %d bytes\n", victim, victim->size );
+            list_remove( &victim->entry );
+            free_cached_glyphs( victim );
+            HeapFree( GetProcessHeap(), 0, victim );
+            InterlockedIncrement( &font_cache_evictions );
+        }
+        LeaveCriticalSection( &shard->cs );
+    }
+    if (glyph_cache_size <= glyph_cache_budget)
+        InterlockedExchange( &glyph_cache_evict_size, glyph_cache_budget );
+
+    if (TRACE_ON(dib))
+    {
+        for (i = 0; i < FONT_CACHE_SHARDS; i++)
+        {
+            hits += font_cache[i].hits;
+            misses += font_cache[i].misses;
+        }
+        TRACE( "%d hits, %d misses, %d evictions, %d bytes cached\n",
+               hits, misses, font_cache_evictions, glyph_cache_size );
+    }
+    LeaveCriticalSection( &font_evict_cs );
+}
+
+void init_glyph_cache(void)
+{
+    static const WCHAR gdiW[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\','G','D','I',0};
+    static const WCHAR glyph_cache_sizeW[] = {'G','l','y','p','h','C','a','c','h','e','S','i','z','e',0};
+    DWORD type, size_kb = 0, size = sizeof(size_kb);
+    const char *env;
+    HKEY key;
+    UINT i;
+
+    for (i = 0; i < FONT_CACHE_SHARDS; i++)
+    {
+        InitializeCriticalSection( &font_cache[i].cs );
+        font_cache[i].cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": font_cache_shard.cs");
+        list_init( &font_cache[i].fonts );
+    }
+
+    if ((env = getenv( "WINEGLYPHCACHESIZE" )) && *env)
+        size_kb = atoi( env );
+    else if (!RegOpenKeyW( HKEY_CURRENT_USER, gdiW, &key ))
+    {
+        if (RegQueryValueExW( key, glyph_cache_sizeW, NULL, &type, (BYTE *)&size_kb, &size ) ||
+            type != REG_DWORD)
+            size_kb = 0;
+        RegCloseKey( key );
+    }
+
+    if (size_kb)
+    {
+        glyph_cache_budget = glyph_cache_evict_size = min( size_kb, MAXLONG / 1024 ) * 1024;
+        TRACE( "glyph cache budget %d bytes\n", glyph_cache_budget );
+    }
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
     struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct font_cache_shard *shard;
+    UINT i = 0;
 
     GetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -571,9 +728,10 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     font.lf.lfWidth = abs( font.lf.lfWidth );
     font.aa_flags = aa_flags;
     font.hash = font_cache_hash( &font );
+    shard = get_font_shard( &font );
 
-    EnterCriticalSection( &font_cache_cs );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    EnterCriticalSection( &shard->cs );
+    LIST_FOR_EACH_ENTRY( ptr, &shard->fonts, struct cached_font, entry )
     {
         if (!font_cache_cmp( &font, ptr ))
         {
@@ -588,44 +746,46 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
         }
     }
 
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
+    if (i > FONT_CACHE_MAX_UNUSED)  /* keep a few of the most-recently used fonts around */
     {
         ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j][k] );
-                HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j] );
-            }
-        }
+        free_cached_glyphs( ptr );
         list_remove( &ptr->entry );
     }
     else if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
     {
-        LeaveCriticalSection( &font_cache_cs );
+        LeaveCriticalSection( &shard->cs );
         return NULL;
     }
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->size = 0;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
-    list_add_head( &font_cache, &ptr->entry );
-    LeaveCriticalSection( &font_cache_cs );
+    ptr->last_used = InterlockedIncrement( &font_cache_clock );
+    list_add_head( &shard->fonts, &ptr->entry );
+    LeaveCriticalSection( &shard->cs );
     TRACE( "%d %s -> %p\n", ptr->lf.lfHeight, debugstr_w(ptr->lf.lfFaceName), ptr );
     return ptr;
 }
 
 void release_cached_font( struct cached_font *font )
 {
-    if (font) InterlockedDecrement( &font->ref );
+    /* the font can be evicted now, so let the next glyph try again */
+    if (font && !InterlockedDecrement( &font->ref ))
+        InterlockedExchange( &glyph_cache_evict_size, glyph_cache_budget );
+}
+
+static void account_cached_glyphs( struct cached_font *font, LONG size )
+{
+    InterlockedExchangeAdd( &font->size, size );
+    if (InterlockedExchangeAdd( &glyph_cache_size, size ) + size > glyph_cache_evict_size)
+        evict_cached_fonts();
 }
 
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, DWORD size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
@@ -644,9 +804,15 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
         }
         if (InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page], ptr, NULL ))
             HeapFree( GetProcessHeap(), 0, ptr );
+        else
+            size += GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr);
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        account_cached_glyphs( font, size );
+        ret = glyph;
+    }
     else HeapFree( GetProcessHeap(), 0, glyph );
     return ret;
 }
@@ -805,14 +971,15 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    return add_cached_glyph( font, index, flags, glyph, FIELD_OFFSET( struct cached_glyph, bits[size] ));
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
                            UINT flags, const WCHAR *str, UINT count, const INT *dx,
                            const struct clipped_rects *clipped_rects, RECT *bounds )
 {
-    UINT i;
+    struct font_cache_shard *shard = get_font_shard( font );
+    UINT i, misses = 0;
     struct cached_glyph *glyph;
     dib_info glyph_dib;
     DWORD text_color;
@@ -833,8 +1000,11 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
 
     for (i = 0; i < count; i++)
     {
-        if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
-            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        if (!(glyph = get_cached_glyph( font, str[i], flags )))
+        {
+            misses++;
+            if (!(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        }
 
         glyph_dib.width       = glyph->metrics.gmBlackBoxX;
         glyph_dib.height      = glyph->metrics.gmBlackBoxY;
@@ -861,6 +1031,10 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
             y += glyph->metrics.gmCellIncY;
         }
     }
+
+    /* counted per string rather than per glyph to keep the shard lines quiet */
+    if (misses) InterlockedExchangeAdd( &shard->misses, misses );
+    if (count > misses) InterlockedExchangeAdd( &shard->hits, count - misses );
 }
 
 BOOL render_aa_text_bitmapinfo( DC *dc, BITMAPINFO *info, struct gdi_image_bits *bits,
@@ -20,6 +20,12 @@
 
 #include <assert.h>
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) \
+    && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define USE_X86_SIMD
+#include <immintrin.h>
+#endif
+
 #include "gdi_private.h"
 #include "dibdrv.h"
 
@@ -7367,7 +7373,246 @@ static void shrink_row_null(const dib_info *dst_dib, const POINT *dst_start,
     return;
 }
 
-const primitive_funcs funcs_8888 =
+/* SIMD versions of the most frequently used 16 and 32 bpp primitives. They
+ * produce exactly the same results as the C versions above, and are plugged
+ * into the function tables by init_dib_primitives() when the CPU supports
+ * them. */
+
+#ifdef USE_X86_SIMD
+
+#define SSE2_FUNC __attribute__((target("sse2")))
+#define AVX2_FUNC __attribute__((target("avx2")))
+
+static void SSE2_FUNC solid_rects_32_sse2(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
+{
+    const __m128i and_vec = _mm_set1_epi32( and ), xor_vec = _mm_set1_epi32( xor );
+    DWORD *ptr, *start;
+    int x, y, i, len;
+
+    if (!and)
+    {
+        solid_rects_32( dib, num, rc, and, xor );
+        return;
+    }
+
+    for(i = 0; i < num; i++, rc++)
+    {
+        assert( !is_rect_empty( rc ));
+
+        len = rc->right - rc->left;
+        start = get_pixel_ptr_32(dib, rc->left, rc->top);
+        for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
+        {
+            for(x = 0, ptr = start; x + 4 <= len; x += 4, ptr += 4)
+            {
+                __m128i val = _mm_loadu_si128( (const __m128i *)ptr );
+                _mm_storeu_si128( (__m128i *)ptr, _mm_xor_si128( _mm_and_si128( val, and_vec ), xor_vec ));
+            }
+            for(; x < len; x++)
+                do_rop_32(ptr++, and, xor);
+        }
+    }
+}
+
+static void SSE2_FUNC solid_rects_16_sse2(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
+{
+    const __m128i and_vec = _mm_set1_epi16( and ), xor_vec = _mm_set1_epi16( xor );
+    WORD *ptr, *start;
+    int x, y, i, len;
+
+    if (!and)
+    {
+        solid_rects_16( dib, num, rc, and, xor );
+        return;
+    }
+
+    for(i = 0; i < num; i++, rc++)
+    {
+        assert( !is_rect_empty( rc ));
+
+        len = rc->right - rc->left;
+        start = get_pixel_ptr_16(dib, rc->left, rc->top);
+        for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 2)
+        {
+            for(x = 0, ptr = start; x + 8 <= len; x += 8, ptr += 8)
+            {
+                __m128i val = _mm_loadu_si128( (const __m128i *)ptr );
+                _mm_storeu_si128( (__m128i *)ptr, _mm_xor_si128( _mm_and_si128( val, and_vec ), xor_vec ));
+            }
+            for(; x < len; x++)
+                do_rop_16(ptr++, and, xor);
+        }
+    }
+}
+
+enum blend_mode
+{
+    BLEND_SRC_ALPHA,            /* blend_argb() */
+    BLEND_SRC_ALPHA_CONSTANT,   /* blend_argb_alpha() */
+    BLEND_CONSTANT,             /* blend_argb_constant_alpha() */
+    BLEND_CONSTANT_NO_SRC_ALPHA /* blend_argb_no_src_alpha() */
+};
+
+static inline enum blend_mode get_blend_mode( const dib_info *src, BLENDFUNCTION blend )
+{
+    if (blend.AlphaFormat & AC_SRC_ALPHA)
+        return blend.SourceConstantAlpha == 255 ? BLEND_SRC_ALPHA : BLEND_SRC_ALPHA_CONSTANT;
+    return src->compression == BI_RGB ? BLEND_CONSTANT : BLEND_CONSTANT_NO_SRC_ALPHA;
+}
+
+static inline DWORD blend_pixel( DWORD dst, DWORD src, enum blend_mode mode, DWORD alpha )
+{
+    switch (mode)
+    {
+    case BLEND_SRC_ALPHA:          return blend_argb( dst, src );
+    case BLEND_SRC_ALPHA_CONSTANT: return blend_argb_alpha( dst, src, alpha );
+    case BLEND_CONSTANT:           return blend_argb_constant_alpha( dst, src, alpha );
+    default:                       return blend_argb_no_src_alpha( dst, src, alpha );
+    }
+}
+
+/* (x + 127) / 255 is computed as (y + 1 + (y >> 8)) >> 8, with y = x + 127.
+ * This is exact for every x <= 255 * 255, which keeps everything in 16-bit
+ * lanes. Each lane holds one channel of one pixel. */
+static inline __m128i SSE2_FUNC div255_sse2( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 127 ));
+    x = _mm_add_epi16( x, _mm_add_epi16( _mm_srli_epi16( x, 8 ), _mm_set1_epi16( 1 )));
+    return _mm_srli_epi16( x, 8 );
+}
+
+static inline __m128i SSE2_FUNC blend_channels_sse2( __m128i dst, __m128i src, enum blend_mode mode, __m128i alpha )
+{
+    const __m128i c255 = _mm_set1_epi16( 255 );
+    __m128i src_alpha;
+
+    switch (mode)
+    {
+    case BLEND_SRC_ALPHA_CONSTANT:
+        src = div255_sse2( _mm_mullo_epi16( src, alpha ));
+        /* fall through */
+    case BLEND_SRC_ALPHA:
+        src_alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+        return _mm_add_epi16( src, div255_sse2( _mm_mullo_epi16( dst, _mm_sub_epi16( c255, src_alpha ))));
+    default:
+        return div255_sse2( _mm_add_epi16( _mm_mullo_epi16( src, alpha ),
+                                           _mm_mullo_epi16( dst, _mm_sub_epi16( c255, alpha ))));
+    }
+}
+
+/* Channels of a premultiplied blend can exceed 255 if the source isn't
+ * properly premultiplied; like the C code we let the ninth bit spill into
+ * the next channel. */
+static inline __m128i SSE2_FUNC pack_channels_sse2( __m128i lo, __m128i hi )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    __m128i val = _mm_packus_epi16( _mm_and_si128( lo, mask ), _mm_and_si128( hi, mask ));
+    __m128i carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ));
+
+    return _mm_or_si128( val, _mm_slli_epi32( carry, 8 ));
+}
+
+static void SSE2_FUNC blend_row_8888_sse2( DWORD *dst, const DWORD *src, int len, enum blend_mode mode, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128(), alpha_vec = _mm_set1_epi16( alpha );
+    const __m128i src_or = _mm_set1_epi32( mode == BLEND_CONSTANT_NO_SRC_ALPHA ? 0xff000000 : 0 );
+    __m128i d, s, lo, hi;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), src_or );
+        lo = blend_channels_sse2( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ), mode, alpha_vec );
+        hi = blend_channels_sse2( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ), mode, alpha_vec );
+        _mm_storeu_si128( (__m128i *)(dst + x), pack_channels_sse2( lo, hi ));
+    }
+    for (; x < len; x++)
+        dst[x] = blend_pixel( dst[x], src[x], mode, alpha );
+}
+
+static void SSE2_FUNC blend_rect_8888_sse2(const dib_info *dst, const RECT *rc,
+                                           const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
+{
+    DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
+    DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
+    enum blend_mode mode = get_blend_mode( src, blend );
+    int y;
+
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+        blend_row_8888_sse2( dst_ptr, src_ptr, rc->right - rc->left, mode, blend.SourceConstantAlpha );
+}
+
+/* The AVX2 versions work the same way as the SSE2 ones, on twice as many
+ * pixels. Unpacking and packing both operate within 128-bit lanes, so the
+ * pixel order is preserved. */
+static inline __m256i AVX2_FUNC div255_avx2( __m256i x )
+{
+    x = _mm256_add_epi16( x, _mm256_set1_epi16( 127 ));
+    x = _mm256_add_epi16( x, _mm256_add_epi16( _mm256_srli_epi16( x, 8 ), _mm256_set1_epi16( 1 )));
+    return _mm256_srli_epi16( x, 8 );
+}
+
+static inline __m256i AVX2_FUNC blend_channels_avx2( __m256i dst, __m256i src, enum blend_mode mode, __m256i alpha )
+{
+    const __m256i c255 = _mm256_set1_epi16( 255 );
+    __m256i src_alpha;
+
+    switch (mode)
+    {
+    case BLEND_SRC_ALPHA_CONSTANT:
+        src = div255_avx2( _mm256_mullo_epi16( src, alpha ));
+        /* fall through */
+    case BLEND_SRC_ALPHA:
+        src_alpha = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( src, 0xff ), 0xff );
+        return _mm256_add_epi16( src, div255_avx2( _mm256_mullo_epi16( dst, _mm256_sub_epi16( c255, src_alpha ))));
+    default:
+        return div255_avx2( _mm256_add_epi16( _mm256_mullo_epi16( src, alpha ),
+                                              _mm256_mullo_epi16( dst, _mm256_sub_epi16( c255, alpha ))));
+    }
+}
+
+static inline __m256i AVX2_FUNC pack_channels_avx2( __m256i lo, __m256i hi )
+{
+    const __m256i mask = _mm256_set1_epi16( 0xff );
+    __m256i val = _mm256_packus_epi16( _mm256_and_si256( lo, mask ), _mm256_and_si256( hi, mask ));
+    __m256i carry = _mm256_packus_epi16( _mm256_srli_epi16( lo, 8 ), _mm256_srli_epi16( hi, 8 ));
+
+    return _mm256_or_si256( val, _mm256_slli_epi32( carry, 8 ));
+}
+
+static void AVX2_FUNC blend_rect_8888_avx2(const dib_info *dst, const RECT *rc,
+                                           const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
+{
+    DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
+    DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
+    enum blend_mode mode = get_blend_mode( src, blend );
+    const __m256i zero = _mm256_setzero_si256(), alpha_vec = _mm256_set1_epi16( blend.SourceConstantAlpha );
+    const __m256i src_or = _mm256_set1_epi32( mode == BLEND_CONSTANT_NO_SRC_ALPHA ? 0xff000000 : 0 );
+    int len = rc->right - rc->left;
+    __m256i d, s, lo, hi;
+    int x, y;
+
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+    {
+        for (x = 0; x + 8 <= len; x += 8)
+        {
+            d = _mm256_loadu_si256( (const __m256i *)(dst_ptr + x) );
+            s = _mm256_or_si256( _mm256_loadu_si256( (const __m256i *)(src_ptr + x) ), src_or );
+            lo = blend_channels_avx2( _mm256_unpacklo_epi8( d, zero ), _mm256_unpacklo_epi8( s, zero ),
+                                      mode, alpha_vec );
+            hi = blend_channels_avx2( _mm256_unpackhi_epi8( d, zero ), _mm256_unpackhi_epi8( s, zero ),
+                                      mode, alpha_vec );
+            _mm256_storeu_si256( (__m256i *)(dst_ptr + x), pack_channels_avx2( lo, hi ));
+        }
+        if (x < len)
+            blend_row_8888_sse2( dst_ptr + x, src_ptr + x, len - x, mode, blend.SourceConstantAlpha );
+    }
+}
+
+#endif  /* USE_X86_SIMD */
+
+primitive_funcs funcs_8888 =
 {
     solid_rects_32,
     solid_line_32,
@@ -7388,7 +7633,7 @@ const primitive_funcs funcs_8888 =
     shrink_row_32
 };
 
-const primitive_funcs funcs_32 =
+primitive_funcs funcs_32 =
 {
     solid_rects_32,
     solid_line_32,
@@ -7430,7 +7675,7 @@ const primitive_funcs funcs_24 =
     shrink_row_24
 };
 
-const primitive_funcs funcs_555 =
+primitive_funcs funcs_555 =
 {
     solid_rects_16,
     solid_line_16,
@@ -7451,7 +7696,7 @@ const primitive_funcs funcs_555 =
     shrink_row_16
 };
 
-const primitive_funcs funcs_16 =
+primitive_funcs funcs_16 =
 {
     solid_rects_16,
     solid_line_16,
@@ -7555,3 +7800,22 @@ const primitive_funcs funcs_null =
     stretch_row_null,
     shrink_row_null
 };
+
+void init_dib_primitives(void)
+{
+#ifdef USE_X86_SIMD
+    if (!IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE )) return;
+
+    funcs_8888.solid_rects = funcs_32.solid_rects = solid_rects_32_sse2;
+    funcs_555.solid_rects = funcs_16.solid_rects = solid_rects_16_sse2;
+    funcs_8888.blend_rect = blend_rect_8888_sse2;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports( "avx2" ))
+    {
+        TRACE( "using AVX2 primitives\n" );
+        funcs_8888.blend_rect = blend_rect_8888_avx2;
+    }
+    else TRACE( "using SSE2 primitives\n" );
+#endif
+}
@@ -173,6 +173,7 @@ static FT_Error (*pFT_Property_Set)(FT_Library, const FT_String *, const FT_Stri
 
 #ifdef SONAME_LIBFONTCONFIG
 #include <fontconfig/fontconfig.h>
+MAKE_FUNCPTR(FcConfigGetFontDirs);
 MAKE_FUNCPTR(FcConfigSubstitute);
 MAKE_FUNCPTR(FcDefaultSubstitute);
 MAKE_FUNCPTR(FcFontList);
@@ -185,6 +186,8 @@ MAKE_FUNCPTR(FcPatternDestroy);
 MAKE_FUNCPTR(FcPatternGetBool);
 MAKE_FUNCPTR(FcPatternGetInteger);
 MAKE_FUNCPTR(FcPatternGetString);
+MAKE_FUNCPTR(FcStrListDone);
+MAKE_FUNCPTR(FcStrListNext);
 #ifndef FC_NAMELANG
 #define FC_NAMELANG "namelang"
 #endif
@@ -269,6 +272,7 @@ struct enum_data
 
 typedef struct tagFace {
     struct list entry;
+    struct list file_entry;  /* entry in face_file_hash */
     unsigned int refcount;
     WCHAR *StyleName;
     WCHAR *FullName;
@@ -296,15 +300,36 @@ typedef struct tagFace {
 #define ADDFONT_VERTICAL_FONT 0x10
 #define ADDFONT_AA_FLAGS(flags) ((flags) << 16)
 
+struct family_name_entry
+{
+    struct list entry;  /* entry in family_name_hash */
+    const WCHAR *name;
+    struct tagFamily *family;
+};
+
 typedef struct tagFamily {
     struct list entry;
     unsigned int refcount;
     WCHAR *FamilyName;
     WCHAR *EnglishName;
+    struct family_name_entry name_entry;
+    struct family_name_entry english_entry;
     struct list faces;
     struct list *replacement;
 } Family;
 
+/* faces found by scanning the font directories are saved to the font index,
+ * those added through AddFontResource to the registry cache */
+static inline BOOL face_in_font_index( const Face *face )
+{
+    return face->file && (face->flags & ADDFONT_ADD_TO_CACHE) && !(face->flags & ADDFONT_ADD_RESOURCE);
+}
+
+static inline BOOL face_in_registry_cache( const Face *face )
+{
+    return (face->flags & ADDFONT_ADD_TO_CACHE) && (face->flags & ADDFONT_ADD_RESOURCE);
+}
+
 typedef struct {
     GLYPHMETRICS gm;
     ABC          abc;  /* metrics of the unrotated char */
@@ -402,9 +427,11 @@ struct font_fileinfo {
 struct tagGdiFont {
     struct list entry;
     struct list unused_entry;
+    struct list hash_entry;
     unsigned int refcount;
     GM **gm;
     DWORD gmsize;
+    struct list *glyph_bitmaps;
     OUTLINETEXTMETRICW *potm;
     DWORD total_kern_pairs;
     KERNINGPAIR *kern_pairs;
@@ -441,6 +468,7 @@ struct tagGdiFont {
 
 typedef struct {
     struct list entry;
+    struct list hash_entry;
     const WCHAR *font_name;
     FONTSIGNATURE fs;
     struct list links;
@@ -460,6 +488,27 @@ struct enum_charset_list {
 #define GM_BLOCK_SIZE 128
 #define FONT_GM(font,idx) (&(font)->gm[(idx) / GM_BLOCK_SIZE][(idx) % GM_BLOCK_SIZE])
 
+/* Rendered anti-aliased and subpixel glyphs, cached for untransformed requests.
+ * Each font hashes its own entries by glyph index, and all entries are kept on
+ * a single LRU list bounded by glyph_bitmap_cache_max bytes. */
+struct glyph_bitmap
+{
+    struct list  entry;
+    struct list  lru_entry;
+    UINT         index;
+    UINT         format;
+    BOOL         tategaki;
+    GLYPHMETRICS gm;
+    ABC          abc;
+    DWORD        size;
+    BYTE         bits[1];
+};
+
+#define GLYPH_BITMAP_HASH_SIZE 64
+static struct list glyph_bitmap_lru = LIST_INIT(glyph_bitmap_lru);
+static SIZE_T glyph_bitmap_cache_size;
+static SIZE_T glyph_bitmap_cache_max = 4 * 1024 * 1024;
+
 static struct list gdi_font_list = LIST_INIT(gdi_font_list);
 static struct list unused_gdi_font_list = LIST_INIT(unused_gdi_font_list);
 static unsigned int unused_font_count;
@@ -468,6 +517,21 @@ static struct list system_links = LIST_INIT(system_links);
 
 static struct list font_subst_list = LIST_INIT(font_subst_list);
 
+/* Case-insensitive hash indexes over the lists above. The chains are kept in
+ * insertion order, so that a lookup finds the same entry as a walk of the
+ * corresponding list would. */
+#define FAMILY_HASH_SIZE   1024
+#define FACE_HASH_SIZE     1024
+#define SUBST_HASH_SIZE    256
+#define LINK_HASH_SIZE     64
+#define GDI_FONT_HASH_SIZE 64
+
+static struct list family_name_hash[FAMILY_HASH_SIZE];
+static struct list face_file_hash[FACE_HASH_SIZE];
+static struct list font_subst_hash[SUBST_HASH_SIZE];
+static struct list system_link_hash[LINK_HASH_SIZE];
+static struct list gdi_font_hash[GDI_FONT_HASH_SIZE];
+
 static struct list font_list = LIST_INIT(font_list);
 
 struct freetype_physdev
@@ -576,6 +640,7 @@ typedef struct {
 
 typedef struct tagFontSubst {
     struct list entry;
+    struct list hash_entry;
     NameCs from;
     NameCs to;
 } FontSubst;
@@ -1030,6 +1095,41 @@ static BOOL is_subpixel_rendering_enabled( void )
 }
 
 
+static unsigned int hash_name( const WCHAR *name, unsigned int len )
+{
+    unsigned int hash = 0;
+
+    while (len-- && *name) hash = hash * 31 + tolowerW( *name++ );
+    return hash;
+}
+
+static void init_font_hashes(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < FAMILY_HASH_SIZE; i++) list_init( &family_name_hash[i] );
+    for (i = 0; i < FACE_HASH_SIZE; i++) list_init( &face_file_hash[i] );
+    for (i = 0; i < SUBST_HASH_SIZE; i++) list_init( &font_subst_hash[i] );
+    for (i = 0; i < LINK_HASH_SIZE; i++) list_init( &system_link_hash[i] );
+    for (i = 0; i < GDI_FONT_HASH_SIZE; i++) list_init( &gdi_font_hash[i] );
+}
+
+static inline struct list *get_family_name_bucket( const WCHAR *name )
+{
+    return &family_name_hash[hash_name( name, LF_FACESIZE - 1 ) % FAMILY_HASH_SIZE];
+}
+
+static inline struct list *get_face_file_bucket( const WCHAR *file_name )
+{
+    return &face_file_hash[hash_name( file_name, ~0u ) % FACE_HASH_SIZE];
+}
+
+static const WCHAR *get_face_file_name( const Face *face )
+{
+    const WCHAR *file = strrchrW( face->file, '/' );
+    return file ? file + 1 : face->file;
+}
+
 static const struct list *get_face_list_from_family(const Family *family)
 {
     if (!list_empty(&family->faces))
@@ -1040,43 +1140,48 @@ static const struct list *get_face_list_from_family(const Family *family)
 
 static Face *find_face_from_filename(const WCHAR *file_name, const WCHAR *face_name)
 {
-    Family *family;
+    struct family_name_entry *entry;
     Face *face;
-    const WCHAR *file;
 
     TRACE("looking for file %s name %s\n", debugstr_w(file_name), debugstr_w(face_name));
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    if (!face_name)
+    {
+        LIST_FOR_EACH_ENTRY(face, get_face_file_bucket(file_name), Face, file_entry)
+        {
+            if(strcmpiW(get_face_file_name(face), file_name)) continue;
+            face->refcount++;
+            return face;
+        }
+        return NULL;
+    }
+
+    LIST_FOR_EACH_ENTRY(entry, get_family_name_bucket(face_name), struct family_name_entry, entry)
     {
         const struct list *face_list;
-        if(face_name && strncmpiW(face_name, family->FamilyName, LF_FACESIZE - 1))
+        if(entry != &entry->family->name_entry || strncmpiW(face_name, entry->name, LF_FACESIZE - 1))
             continue;
-        face_list = get_face_list_from_family(family);
+        face_list = get_face_list_from_family(entry->family);
         LIST_FOR_EACH_ENTRY(face, face_list, Face, entry)
         {
             if (!face->file)
                 continue;
-            file = strrchrW(face->file, '/');
-            if(!file)
-                file = face->file;
-            else
-                file++;
-            if(strcmpiW(file, file_name)) continue;
+            if(strcmpiW(get_face_file_name(face), file_name)) continue;
             face->refcount++;
             return face;
-	}
+        }
     }
     return NULL;
 }
 
 static Family *find_family_from_name(const WCHAR *name)
 {
-    Family *family;
+    struct family_name_entry *entry;
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    LIST_FOR_EACH_ENTRY(entry, get_family_name_bucket(name), struct family_name_entry, entry)
     {
-        if(!strncmpiW(family->FamilyName, name, LF_FACESIZE -1))
-            return family;
+        if(entry == &entry->family->name_entry && !strncmpiW(entry->name, name, LF_FACESIZE - 1))
+            return entry->family;
     }
 
     return NULL;
@@ -1084,14 +1189,12 @@ static Family *find_family_from_name(const WCHAR *name)
 
 static Family *find_family_from_any_name(const WCHAR *name)
 {
-    Family *family;
+    struct family_name_entry *entry;
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    LIST_FOR_EACH_ENTRY(entry, get_family_name_bucket(name), struct family_name_entry, entry)
     {
-        if(!strncmpiW(family->FamilyName, name, LF_FACESIZE - 1))
-            return family;
-        if(family->EnglishName && !strncmpiW(family->EnglishName, name, LF_FACESIZE - 1))
-            return family;
+        if(!strncmpiW(entry->name, name, LF_FACESIZE - 1))
+            return entry->family;
     }
 
     return NULL;
@@ -1121,12 +1224,16 @@ static LPWSTR strdupW(LPCWSTR p)
     return ret;
 }
 
-static FontSubst *get_font_subst(const struct list *subst_list, const WCHAR *from_name,
-                                 INT from_charset)
+static inline struct list *get_font_subst_bucket( const WCHAR *name )
+{
+    return &font_subst_hash[hash_name( name, ~0u ) % SUBST_HASH_SIZE];
+}
+
+static FontSubst *get_font_subst(const WCHAR *from_name, INT from_charset)
 {
     FontSubst *element;
 
-    LIST_FOR_EACH_ENTRY(element, subst_list, FontSubst, entry)
+    LIST_FOR_EACH_ENTRY(element, get_font_subst_bucket(from_name), FontSubst, hash_entry)
     {
         if(!strcmpiW(element->from.name, from_name) &&
            (element->from.charset == from_charset ||
@@ -1139,15 +1246,16 @@ static FontSubst *get_font_subst(const struct list *subst_list, const WCHAR *fro
 
 #define ADD_FONT_SUBST_FORCE  1
 
-static BOOL add_font_subst(struct list *subst_list, FontSubst *subst, INT flags)
+static BOOL add_font_subst(FontSubst *subst, INT flags)
 {
     FontSubst *from_exist, *to_exist;
 
-    from_exist = get_font_subst(subst_list, subst->from.name, subst->from.charset);
+    from_exist = get_font_subst(subst->from.name, subst->from.charset);
 
     if(from_exist && (flags & ADD_FONT_SUBST_FORCE))
     {
         list_remove(&from_exist->entry);
+        list_remove(&from_exist->hash_entry);
         HeapFree(GetProcessHeap(), 0, from_exist->from.name);
         HeapFree(GetProcessHeap(), 0, from_exist->to.name);
         HeapFree(GetProcessHeap(), 0, from_exist);
@@ -1156,7 +1264,7 @@ static BOOL add_font_subst(struct list *subst_list, FontSubst *subst, INT flags)
 
     if(!from_exist)
     {
-        to_exist = get_font_subst(subst_list, subst->to.name, subst->to.charset);
+        to_exist = get_font_subst(subst->to.name, subst->to.charset);
 
         if(to_exist)
         {
@@ -1164,7 +1272,8 @@ static BOOL add_font_subst(struct list *subst_list, FontSubst *subst, INT flags)
             subst->to.name = strdupW(to_exist->to.name);
         }
             
-        list_add_tail(subst_list, &subst->entry);
+        list_add_tail(&font_subst_list, &subst->entry);
+        list_add_tail(get_font_subst_bucket(subst->from.name), &subst->hash_entry);
 
         return TRUE;
     }
@@ -1243,7 +1352,7 @@ static void LoadSubstList(void)
 		HeapFree(GetProcessHeap(), 0, psub->from.name);
 		HeapFree(GetProcessHeap(), 0, psub);
 	    } else {
-	        add_font_subst(&font_subst_list, psub, 0);
+	        add_font_subst(psub, 0);
 	    }
 	    /* reset dlen and vlen */
 	    dlen = datalen;
@@ -1504,6 +1613,8 @@ static void release_family( Family *family )
     if (--family->refcount) return;
     assert( list_empty( &family->faces ));
     list_remove( &family->entry );
+    list_remove( &family->name_entry.entry );
+    if (family->EnglishName) list_remove( &family->english_entry.entry );
     HeapFree( GetProcessHeap(), 0, family->FamilyName );
     HeapFree( GetProcessHeap(), 0, family->EnglishName );
     HeapFree( GetProcessHeap(), 0, family );
@@ -1514,8 +1625,9 @@ static void release_face( Face *face )
     if (--face->refcount) return;
     if (face->family)
     {
-        if (face->flags & ADDFONT_ADD_TO_CACHE) remove_face_from_cache( face );
+        if (face_in_registry_cache( face )) remove_face_from_cache( face );
         list_remove( &face->entry );
+        if (face->file) list_remove( &face->file_entry );
         release_family( face->family );
     }
     HeapFree( GetProcessHeap(), 0, face->file );
@@ -1576,6 +1688,7 @@ static BOOL insert_face_in_family_list( Face *face, Family *family )
                 TRACE("Replacing original %s with %s\n",
                       debugstr_w(cursor->file), debugstr_w(face->file));
                 list_add_before( &cursor->entry, &face->entry );
+                if (face->file) list_add_tail( get_face_file_bucket( get_face_file_name( face )), &face->file_entry );
                 face->family = family;
                 family->refcount++;
                 face->refcount++;
@@ -1590,6 +1703,7 @@ static BOOL insert_face_in_family_list( Face *face, Family *family )
     }
 
     list_add_before( &cursor->entry, &face->entry );
+    if (face->file) list_add_tail( get_face_file_bucket( get_face_file_name( face )), &face->file_entry );
     face->family = family;
     family->refcount++;
     face->refcount++;
@@ -1610,6 +1724,15 @@ static Family *create_family( WCHAR *name, WCHAR *english_name )
     family->replacement = &family->faces;
     list_add_tail( &font_list, &family->entry );
 
+    family->name_entry.name = family->FamilyName;
+    family->name_entry.family = family;
+    list_add_tail( get_family_name_bucket( family->FamilyName ), &family->name_entry.entry );
+    if (family->EnglishName)
+    {
+        family->english_entry.name = family->EnglishName;
+        family->english_entry.family = family;
+        list_add_tail( get_family_name_bucket( family->EnglishName ), &family->english_entry.entry );
+    }
     return family;
 }
 
@@ -1725,11 +1848,9 @@ static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *bu
 }
 
 /* move vertical fonts after their horizontal counterpart */
-/* assumes that font_list is already sorted by family name */
 static void reorder_vertical_fonts(void)
 {
-    Family *family, *next, *vert_family;
-    struct list *ptr, *vptr;
+    Family *family, *next, *horz_family;
     struct list vertical_families = LIST_INIT( vertical_families );
 
     LIST_FOR_EACH_ENTRY_SAFE( family, next, &font_list, Family, entry )
@@ -1739,21 +1860,14 @@ static void reorder_vertical_fonts(void)
         list_add_tail( &vertical_families, &family->entry );
     }
 
-    ptr = list_head( &font_list );
-    vptr = list_head( &vertical_families );
-    while (ptr && vptr)
+    LIST_FOR_EACH_ENTRY_SAFE( family, next, &vertical_families, Family, entry )
     {
-        family = LIST_ENTRY( ptr, Family, entry );
-        vert_family = LIST_ENTRY( vptr, Family, entry );
-        if (strcmpiW( family->FamilyName, vert_family->FamilyName + 1 ) > 0)
-        {
-            list_remove( vptr );
-            list_add_before( ptr, vptr );
-            vptr = list_head( &vertical_families );
-        }
-        else ptr = list_next( &font_list, ptr );
+        list_remove( &family->entry );
+        if ((horz_family = find_family_from_name( family->FamilyName + 1 )))
+            list_add_after( &horz_family->entry, &family->entry );
+        else
+            list_add_tail( &font_list, &family->entry );
     }
-    list_move_tail( &font_list, &vertical_families );
 }
 
 static void load_font_list_from_cache(HKEY hkey_font_cache)
@@ -1785,7 +1899,7 @@ static void load_font_list_from_cache(HKEY hkey_font_cache)
             subst->from.charset = -1;
             subst->to.name = strdupW(family_name);
             subst->to.charset = -1;
-            add_font_subst(&font_subst_list, subst, 0);
+            add_font_subst(subst, 0);
         }
 
         size = sizeof(buffer);
@@ -1884,7 +1998,8 @@ static void remove_face_from_cache( Face *face )
 {
     HKEY hkey_family;
 
-    RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family );
+    if (RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family ))
+        return;
 
     if (face->scalable)
     {
@@ -1901,6 +2016,510 @@ static void remove_face_from_cache( Face *face )
     RegCloseKey(hkey_family);
 }
 
+/* The font list built by scanning the font directories is saved to a binary
+ * index in the prefix, which later processes map and load without going
+ * through FreeType or the registry. The index records the modification time
+ * of every scanned directory, whether it exists or not, as well as hashes of
+ * the font directories configured in fontconfig and of the font paths in the
+ * registry. It is rebuilt as soon as any of them changes. Fonts added at run time through AddFontResource are still shared
+ * through the volatile registry cache. */
+
+#define FONT_INDEX_MAGIC   0x58444946  /* "FIDX" */
+#define FONT_INDEX_VERSION 3
+
+#define FONT_INDEX_DIR_MISSING 0x0001
+
+struct font_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD size;          /* size of the whole file */
+    DWORD lcid;          /* family and style names depend on the locale */
+    DWORD config_hash;   /* hash of the fontconfig font directories */
+    DWORD reg_hash;      /* hash of the font paths in the registry */
+    DWORD dir_count;
+    DWORD dirs;          /* offsets are from the start of the file */
+    DWORD family_count;
+    DWORD families;
+    DWORD face_count;
+    DWORD faces;
+    DWORD strings;       /* string pool, ends with a null WCHAR */
+};
+
+struct font_index_dir
+{
+    ULONGLONG mtime;
+    DWORD     name;      /* unix path */
+    DWORD     flags;
+};
+
+struct font_index_family
+{
+    DWORD name;
+    DWORD english_name;
+    DWORD first_face;
+    DWORD face_count;
+};
+
+struct font_index_face
+{
+    ULONGLONG     dev;
+    ULONGLONG     ino;
+    DWORD         file;
+    DWORD         style_name;
+    DWORD         full_name;
+    DWORD         ntm_flags;
+    DWORD         flags;
+    DWORD         scalable;
+    LONGLONG      face_index;
+    LONGLONG      font_version;
+    FONTSIGNATURE fs;
+    LONGLONG      size;
+    LONGLONG      x_ppem;
+    LONGLONG      y_ppem;
+    SHORT         height;
+    SHORT         width;
+    SHORT         internal_leading;
+    SHORT         pad;
+};
+
+struct font_index_buffer
+{
+    BYTE *data;
+    DWORD size;
+    DWORD max_size;
+    BOOL  failed;
+};
+
+/* directories scanned while building the font list */
+static char **font_index_dirs;
+static unsigned int font_index_dir_count, font_index_dir_size;
+static DWORD font_config_hash;
+static DWORD font_reg_hash;
+
+static char *get_font_index_path(void)
+{
+    static const char name[] = "/fonts.idx";
+    const char *dir = wine_get_config_dir();
+    char *path;
+
+    if (!dir) return NULL;
+    if ((path = HeapAlloc( GetProcessHeap(), 0, strlen(dir) + sizeof(name) )))
+    {
+        strcpy( path, dir );
+        strcat( path, name );
+    }
+    return path;
+}
+
+static ULONGLONG get_mtime( const struct stat *st )
+{
+    ULONGLONG ret = (ULONGLONG)st->st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    ret += st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    ret += st->st_mtimespec.tv_nsec;
+#endif
+    return ret;
+}
+
+static void add_font_index_dir( const char *dir, size_t len )
+{
+    char *name;
+
+    if (font_index_dir_count && !strncmp( font_index_dirs[font_index_dir_count - 1], dir, len ) &&
+        !font_index_dirs[font_index_dir_count - 1][len])
+        return;  /* fonts usually come in runs from the same directory */
+
+    if (font_index_dir_count == font_index_dir_size)
+    {
+        unsigned int new_size = max( 64, font_index_dir_size * 2 );
+        char **new_dirs;
+
+        if (font_index_dirs)
+            new_dirs = HeapReAlloc( GetProcessHeap(), 0, font_index_dirs, new_size * sizeof(*new_dirs) );
+        else
+            new_dirs = HeapAlloc( GetProcessHeap(), 0, new_size * sizeof(*new_dirs) );
+        if (!new_dirs) return;
+        font_index_dirs = new_dirs;
+        font_index_dir_size = new_size;
+    }
+    if (!(name = HeapAlloc( GetProcessHeap(), 0, len + 1 ))) return;
+    memcpy( name, dir, len );
+    name[len] = 0;
+    font_index_dirs[font_index_dir_count++] = name;
+}
+
+static void free_font_index_dirs(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < font_index_dir_count; i++) HeapFree( GetProcessHeap(), 0, font_index_dirs[i] );
+    HeapFree( GetProcessHeap(), 0, font_index_dirs );
+    font_index_dirs = NULL;
+    font_index_dir_count = font_index_dir_size = 0;
+}
+
+static int compare_font_index_dirs( const void *a, const void *b )
+{
+    return strcmp( *(char * const *)a, *(char * const *)b );
+}
+
+static DWORD font_index_alloc( struct font_index_buffer *buffer, DWORD size, DWORD align )
+{
+    DWORD offset = (buffer->size + align - 1) & ~(align - 1);
+
+    if (buffer->failed) return 0;
+    if (offset + size > buffer->max_size)
+    {
+        DWORD new_size = max( buffer->max_size * 2, offset + size );
+        BYTE *new_data;
+
+        if (!(new_data = HeapReAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, buffer->data, new_size )))
+        {
+            buffer->failed = TRUE;
+            return 0;
+        }
+        buffer->data = new_data;
+        buffer->max_size = new_size;
+    }
+    buffer->size = offset + size;
+    return offset;
+}
+
+static DWORD font_index_add_stringW( struct font_index_buffer *buffer, const WCHAR *str )
+{
+    DWORD size, offset;
+
+    if (!str) return 0;
+    size = (strlenW( str ) + 1) * sizeof(WCHAR);
+    if ((offset = font_index_alloc( buffer, size, sizeof(WCHAR) ))) memcpy( buffer->data + offset, str, size );
+    return offset;
+}
+
+static DWORD font_index_add_stringA( struct font_index_buffer *buffer, const char *str )
+{
+    DWORD size = strlen( str ) + 1, offset;
+
+    if ((offset = font_index_alloc( buffer, size, sizeof(WCHAR) ))) memcpy( buffer->data + offset, str, size );
+    return offset;
+}
+
+static void save_font_list_to_index(void)
+{
+    struct font_index_buffer buffer = { NULL, 0, 0x10000, FALSE };
+    struct font_index_header header;
+    struct font_index_family index_family;
+    struct font_index_face index_face;
+    struct font_index_dir index_dir;
+    DWORD dir_pos, family_pos, face_pos, count, written = 0;
+    unsigned int i, j;
+    char *path = NULL, *tmp_path = NULL, *file, *p;
+    struct stat st;
+    Family *family;
+    Face *face;
+    int fd, ret;
+
+    memset( &header, 0, sizeof(header) );
+    header.magic   = FONT_INDEX_MAGIC;
+    header.version = FONT_INDEX_VERSION;
+    header.lcid    = GetSystemDefaultLCID();
+    header.config_hash = font_config_hash;
+    header.reg_hash    = font_reg_hash;
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+    {
+        count = 0;
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+        {
+            if (!face_in_font_index( face )) continue;
+            if ((file = strWtoA( CP_UNIXCP, face->file )))
+            {
+                if ((p = strrchr( file, '/' ))) add_font_index_dir( file, p - file );
+                HeapFree( GetProcessHeap(), 0, file );
+            }
+            count++;
+        }
+        if (!count) continue;
+        header.family_count++;
+        header.face_count += count;
+    }
+
+    qsort( font_index_dirs, font_index_dir_count, sizeof(*font_index_dirs), compare_font_index_dirs );
+    for (i = j = 0; i < font_index_dir_count; i++)
+    {
+        if (j && !strcmp( font_index_dirs[j - 1], font_index_dirs[i] ))
+            HeapFree( GetProcessHeap(), 0, font_index_dirs[i] );
+        else
+            font_index_dirs[j++] = font_index_dirs[i];
+    }
+    font_index_dir_count = j;
+
+    if (!(buffer.data = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, buffer.max_size ))) goto done;
+    buffer.size = sizeof(header);
+    header.dirs     = dir_pos    = font_index_alloc( &buffer, font_index_dir_count * sizeof(index_dir), 8 );
+    header.families = family_pos = font_index_alloc( &buffer, header.family_count * sizeof(index_family), 8 );
+    header.faces    = face_pos   = font_index_alloc( &buffer, header.face_count * sizeof(index_face), 8 );
+    header.strings  = buffer.size;
+
+    for (i = 0; i < font_index_dir_count; i++)
+    {
+        /* a missing directory must still invalidate the index once it is created */
+        if (stat( font_index_dirs[i], &st ) == -1)
+        {
+            index_dir.mtime = 0;
+            index_dir.flags = FONT_INDEX_DIR_MISSING;
+        }
+        else
+        {
+            index_dir.mtime = get_mtime( &st );
+            index_dir.flags = 0;
+        }
+        index_dir.name  = font_index_add_stringA( &buffer, font_index_dirs[i] );
+        if (!buffer.failed) memcpy( buffer.data + dir_pos, &index_dir, sizeof(index_dir) );
+        dir_pos += sizeof(index_dir);
+        header.dir_count++;
+    }
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+    {
+        index_family.first_face = (face_pos - header.faces) / sizeof(index_face);
+        index_family.face_count = 0;
+
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+        {
+            if (!face_in_font_index( face )) continue;
+
+            memset( &index_face, 0, sizeof(index_face) );
+            index_face.dev          = face->dev;
+            index_face.ino          = face->ino;
+            index_face.file         = font_index_add_stringW( &buffer, face->file );
+            index_face.style_name   = font_index_add_stringW( &buffer, face->StyleName );
+            index_face.full_name    = font_index_add_stringW( &buffer, face->FullName );
+            index_face.ntm_flags    = face->ntmFlags;
+            index_face.flags        = face->flags;
+            index_face.scalable     = face->scalable;
+            index_face.face_index   = face->face_index;
+            index_face.font_version = face->font_version;
+            index_face.fs           = face->fs;
+            index_face.size         = face->size.size;
+            index_face.x_ppem       = face->size.x_ppem;
+            index_face.y_ppem       = face->size.y_ppem;
+            index_face.height       = face->size.height;
+            index_face.width        = face->size.width;
+            index_face.internal_leading = face->size.internal_leading;
+            if (!buffer.failed) memcpy( buffer.data + face_pos, &index_face, sizeof(index_face) );
+            face_pos += sizeof(index_face);
+            index_family.face_count++;
+        }
+        if (!index_family.face_count) continue;
+
+        index_family.name         = font_index_add_stringW( &buffer, family->FamilyName );
+        index_family.english_name = font_index_add_stringW( &buffer, family->EnglishName );
+        if (!buffer.failed) memcpy( buffer.data + family_pos, &index_family, sizeof(index_family) );
+        family_pos += sizeof(index_family);
+    }
+
+    /* terminate the string pool, so that all strings are known to end inside the file */
+    font_index_alloc( &buffer, sizeof(WCHAR), sizeof(WCHAR) );
+    if (buffer.failed) goto done;
+    header.size = buffer.size;
+    memcpy( buffer.data, &header, sizeof(header) );
+
+    if (!(path = get_font_index_path())) goto done;
+    if (!(tmp_path = HeapAlloc( GetProcessHeap(), 0, strlen(path) + 16 ))) goto done;
+    sprintf( tmp_path, "%s.%x", path, GetCurrentProcessId() );
+
+    if ((fd = open( tmp_path, O_CREAT | O_TRUNC | O_WRONLY, 0644 )) == -1)
+    {
+        WARN( "can't create %s\n", debugstr_a(tmp_path) );
+        goto done;
+    }
+    while (written < buffer.size)
+    {
+        if ((ret = write( fd, buffer.data + written, buffer.size - written )) <= 0) break;
+        written += ret;
+    }
+    close( fd );
+    if (written < buffer.size || rename( tmp_path, path ) == -1)
+    {
+        WARN( "can't write %s\n", debugstr_a(path) );
+        unlink( tmp_path );
+    }
+    else TRACE( "saved %u families, %u faces, %u dirs to %s\n",
+                header.family_count, header.face_count, header.dir_count, debugstr_a(path) );
+
+done:
+    HeapFree( GetProcessHeap(), 0, tmp_path );
+    HeapFree( GetProcessHeap(), 0, path );
+    HeapFree( GetProcessHeap(), 0, buffer.data );
+    free_font_index_dirs();
+}
+
+static inline BOOL font_index_array_valid( const struct font_index_header *header, DWORD offset,
+                                           DWORD count, DWORD size )
+{
+    return offset >= sizeof(*header) && offset <= header->size && !(offset % 8) &&
+           count <= (header->size - offset) / size;
+}
+
+static inline BOOL font_index_string_valid( const struct font_index_header *header, DWORD offset )
+{
+    return offset >= header->strings && offset < header->size && !(offset % sizeof(WCHAR));
+}
+
+static BOOL font_index_valid( const BYTE *data, SIZE_T size )
+{
+    const struct font_index_header *header = (const struct font_index_header *)data;
+    const struct font_index_family *families;
+    const struct font_index_face *faces;
+    const struct font_index_dir *dirs;
+    struct stat st;
+    DWORD i;
+
+    if (size < sizeof(*header) || header->magic != FONT_INDEX_MAGIC ||
+        header->version != FONT_INDEX_VERSION || header->size != size ||
+        header->lcid != GetSystemDefaultLCID() || header->config_hash != font_config_hash ||
+        header->reg_hash != font_reg_hash)
+        return FALSE;
+    if (header->strings < sizeof(*header) || header->strings > size - sizeof(WCHAR) || size % sizeof(WCHAR) ||
+        *(const WCHAR *)(data + size - sizeof(WCHAR)))
+        return FALSE;
+    if (!font_index_array_valid( header, header->dirs, header->dir_count, sizeof(*dirs) ) ||
+        !font_index_array_valid( header, header->families, header->family_count, sizeof(*families) ) ||
+        !font_index_array_valid( header, header->faces, header->face_count, sizeof(*faces) ))
+        return FALSE;
+
+    dirs = (const struct font_index_dir *)(data + header->dirs);
+    for (i = 0; i < header->dir_count; i++)
+    {
+        if (!font_index_string_valid( header, dirs[i].name )) return FALSE;
+        if (stat( (const char *)data + dirs[i].name, &st ) == -1 ?
+            !(dirs[i].flags & FONT_INDEX_DIR_MISSING) :
+            (dirs[i].flags & FONT_INDEX_DIR_MISSING) || get_mtime( &st ) != dirs[i].mtime)
+        {
+            TRACE( "%s has changed\n", debugstr_a((const char *)data + dirs[i].name) );
+            return FALSE;
+        }
+    }
+
+    families = (const struct font_index_family *)(data + header->families);
+    for (i = 0; i < header->family_count; i++)
+    {
+        if (!font_index_string_valid( header, families[i].name ) ||
+            (families[i].english_name && !font_index_string_valid( header, families[i].english_name )) ||
+            families[i].first_face > header->face_count ||
+            families[i].face_count > header->face_count - families[i].first_face)
+            return FALSE;
+    }
+
+    faces = (const struct font_index_face *)(data + header->faces);
+    for (i = 0; i < header->face_count; i++)
+    {
+        if (!font_index_string_valid( header, faces[i].file ) ||
+            !font_index_string_valid( header, faces[i].style_name ) ||
+            (faces[i].full_name && !font_index_string_valid( header, faces[i].full_name )))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void load_face_from_index( const BYTE *data, const struct font_index_face *entry, Family *family )
+{
+    Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+
+    face->refcount = 1;
+    face->file = strdupW( (const WCHAR *)(data + entry->file) );
+    face->StyleName = strdupW( (const WCHAR *)(data + entry->style_name) );
+    face->FullName = entry->full_name ? strdupW( (const WCHAR *)(data + entry->full_name) ) : NULL;
+    face->dev = entry->dev;
+    face->ino = entry->ino;
+    face->font_data_ptr = NULL;
+    face->font_data_size = 0;
+    face->face_index = entry->face_index;
+    face->fs = entry->fs;
+    face->ntmFlags = entry->ntm_flags;
+    face->font_version = entry->font_version;
+    face->scalable = entry->scalable;
+    face->size.height = entry->height;
+    face->size.width = entry->width;
+    face->size.size = entry->size;
+    face->size.x_ppem = entry->x_ppem;
+    face->size.y_ppem = entry->y_ppem;
+    face->size.internal_leading = entry->internal_leading;
+    face->flags = entry->flags;
+    face->family = NULL;
+    face->cached_enum_data = NULL;
+
+    if (insert_face_in_family_list( face, family ))
+        TRACE( "Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName) );
+
+    release_face( face );
+}
+
+static BOOL load_font_list_from_index(void)
+{
+    const struct font_index_header *header;
+    const struct font_index_family *families;
+    const struct font_index_face *faces;
+    struct stat st;
+    BYTE *data;
+    char *path;
+    DWORD i, j;
+    BOOL ret;
+    int fd;
+
+    if (!(path = get_font_index_path())) return FALSE;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return FALSE;
+
+    if (fstat( fd, &st ) == -1 || st.st_size < (off_t)sizeof(*header) || st.st_size > 0x7fffffff ||
+        (data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return FALSE;
+    }
+    close( fd );
+
+    if ((ret = font_index_valid( data, st.st_size )))
+    {
+        header = (const struct font_index_header *)data;
+        families = (const struct font_index_family *)(data + header->families);
+        faces = (const struct font_index_face *)(data + header->faces);
+
+        for (i = 0; i < header->family_count; i++)
+        {
+            WCHAR *english_family = NULL;
+            Family *family;
+
+            if (families[i].english_name)
+                english_family = strdupW( (const WCHAR *)(data + families[i].english_name) );
+            family = create_family( strdupW( (const WCHAR *)(data + families[i].name) ), english_family );
+
+            if (english_family)
+            {
+                FontSubst *subst = HeapAlloc( GetProcessHeap(), 0, sizeof(*subst) );
+                subst->from.name = strdupW( english_family );
+                subst->from.charset = -1;
+                subst->to.name = strdupW( family->FamilyName );
+                subst->to.charset = -1;
+                add_font_subst( subst, 0 );
+            }
+
+            for (j = 0; j < families[i].face_count; j++)
+                load_face_from_index( data, faces + families[i].first_face + j, family );
+            release_family( family );
+        }
+        TRACE( "loaded %u families, %u faces\n", header->family_count, header->face_count );
+    }
+    else TRACE( "font index is missing or out of date\n" );
+
+    munmap( data, st.st_size );
+    return ret;
+}
+
 static WCHAR *prepend_at(WCHAR *family)
 {
     WCHAR *str;
@@ -1958,7 +2577,7 @@ static Family *get_family( FT_Face ft_face, BOOL vertical )
             subst->from.charset = -1;
             subst->to.name = strdupW( name );
             subst->to.charset = -1;
-            add_font_subst( &font_subst_list, subst, 0 );
+            add_font_subst( subst, 0 );
         }
     }
     else
@@ -2165,7 +2784,7 @@ static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr
 
     if (insert_face_in_family_list( face, family ))
     {
-        if (flags & ADDFONT_ADD_TO_CACHE)
+        if (face_in_registry_cache( face ))
             add_face_to_cache( face );
 
         TRACE("Added font %s %s\n", debugstr_w(family->FamilyName),
@@ -2360,15 +2979,11 @@ static BOOL map_font_family(const WCHAR *orig, const WCHAR *repl)
     Family *family = find_family_from_any_name(repl);
     if (family != NULL)
     {
-        Family *new_family = HeapAlloc(GetProcessHeap(), 0, sizeof(*new_family));
+        Family *new_family = create_family(strdupW(orig), NULL);
         if (new_family != NULL)
         {
             TRACE("mapping %s to %s\n", debugstr_w(repl), debugstr_w(orig));
-            new_family->FamilyName = strdupW(orig);
-            new_family->EnglishName = NULL;
-            list_init(&new_family->faces);
             new_family->replacement = &family->faces;
-            list_add_tail(&font_list, &new_family->entry);
             return TRUE;
         }
     }
@@ -2638,11 +3253,22 @@ static const struct font_links_defaults_list
 };
 
 
+static inline struct list *get_font_link_bucket( const WCHAR *name )
+{
+    return &system_link_hash[hash_name( name, LF_FACESIZE - 1 ) % LINK_HASH_SIZE];
+}
+
+static void add_font_link( SYSTEM_LINKS *font_link )
+{
+    list_add_tail( &system_links, &font_link->entry );
+    list_add_tail( get_font_link_bucket( font_link->font_name ), &font_link->hash_entry );
+}
+
 static SYSTEM_LINKS *find_font_link(const WCHAR *name)
 {
     SYSTEM_LINKS *font_link;
 
-    LIST_FOR_EACH_ENTRY(font_link, &system_links, SYSTEM_LINKS, entry)
+    LIST_FOR_EACH_ENTRY(font_link, get_font_link_bucket(name), SYSTEM_LINKS, hash_entry)
     {
         if(!strncmpiW(font_link->font_name, name, LF_FACESIZE - 1))
             return font_link;
@@ -2664,7 +3290,7 @@ static void populate_system_links(const WCHAR *name, const WCHAR *const *values)
     {
         SYSTEM_LINKS *font_link;
 
-        psub = get_font_subst(&font_subst_list, name, -1);
+        psub = get_font_subst(name, -1);
         /* Don't store fonts that are only substitutes for other fonts */
         if(psub)
         {
@@ -2678,7 +3304,7 @@ static void populate_system_links(const WCHAR *name, const WCHAR *const *values)
             font_link = HeapAlloc(GetProcessHeap(), 0, sizeof(*font_link));
             font_link->font_name = strdupW(name);
             list_init(&font_link->links);
-            list_add_tail(&system_links, &font_link->entry);
+            add_font_link(font_link);
         }
 
         memset(&font_link->fs, 0, sizeof font_link->fs);
@@ -2690,7 +3316,7 @@ static void populate_system_links(const WCHAR *name, const WCHAR *const *values)
             value = values[i];
             if (!strcmpiW(name,value))
                 continue;
-            psub = get_font_subst(&font_subst_list, value, -1);
+            psub = get_font_subst(value, -1);
             if(psub)
                 value = psub->to.name;
             family = find_family_from_name(value);
@@ -2762,7 +3388,7 @@ static void init_system_links(void)
         index = 0;
         while(RegEnumValueW(hkey, index++, value, &val_len, NULL, &type, (LPBYTE)data, &data_len) == ERROR_SUCCESS)
         {
-            psub = get_font_subst(&font_subst_list, value, -1);
+            psub = get_font_subst(value, -1);
             /* Don't store fonts that are only substitutes for other fonts */
             if(psub)
             {
@@ -2789,7 +3415,7 @@ static void init_system_links(void)
                     while(isspaceW(*face_name))
                         face_name++;
 
-                    psub = get_font_subst(&font_subst_list, face_name, -1);
+                    psub = get_font_subst(face_name, -1);
                     if(psub)
                         face_name = psub->to.name;
                 }
@@ -2809,7 +3435,7 @@ static void init_system_links(void)
                       debugstr_w(child_font->face->file), child_font->face->face_index);
                 list_add_tail(&font_link->links, &child_font->entry);
             }
-            list_add_tail(&system_links, &font_link->entry);
+            add_font_link(font_link);
         next:
             val_len = max_val + 1;
             data_len = max_data;
@@ -2821,7 +3447,7 @@ static void init_system_links(void)
     }
 
 
-    psub = get_font_subst(&font_subst_list, MS_Shell_Dlg, -1);
+    psub = get_font_subst(MS_Shell_Dlg, -1);
     if (!psub) {
         WARN("could not find FontSubstitute for MS Shell Dlg\n");
         goto skip_internal;
@@ -2830,7 +3456,7 @@ static void init_system_links(void)
     for (i = 0; i < ARRAY_SIZE(font_links_defaults_list); i++)
     {
         const FontSubst *psub2;
-        psub2 = get_font_subst(&font_subst_list, font_links_defaults_list[i].shelldlg, -1);
+        psub2 = get_font_subst(font_links_defaults_list[i].shelldlg, -1);
 
         if ((!strcmpiW(font_links_defaults_list[i].shelldlg, psub->to.name) || (psub2 && !strcmpiW(psub2->to.name,psub->to.name))))
         {
@@ -2884,7 +3510,7 @@ skip_internal:
             list_add_tail(&system_font_link->links, &new_child->entry);
         }
     }
-    list_add_tail(&system_links, &system_font_link->entry);
+    add_font_link(system_font_link);
 }
 
 static BOOL ReadFontDir(const char *dirname, BOOL external_fonts)
@@ -2895,6 +3521,8 @@ static BOOL ReadFontDir(const char *dirname, BOOL external_fonts)
 
     TRACE("Loading fonts from %s\n", debugstr_a(dirname));
 
+    /* fonts may appear in it later, even if it doesn't exist yet */
+    add_font_index_dir(dirname, strlen(dirname));
     dir = opendir(dirname);
     if(!dir) {
         WARN("Can't open directory %s\n", debugstr_a(dirname));
@@ -2966,6 +3594,7 @@ static void init_fontconfig(void)
     }
 
 #define LOAD_FUNCPTR(f) if((p##f = wine_dlsym(fc_handle, #f, NULL, 0)) == NULL){WARN("Can't find symbol %s\n", #f); return;}
+    LOAD_FUNCPTR(FcConfigGetFontDirs);
     LOAD_FUNCPTR(FcConfigSubstitute);
     LOAD_FUNCPTR(FcDefaultSubstitute);
     LOAD_FUNCPTR(FcFontList);
@@ -2978,6 +3607,8 @@ static void init_fontconfig(void)
     LOAD_FUNCPTR(FcPatternGetBool);
     LOAD_FUNCPTR(FcPatternGetInteger);
     LOAD_FUNCPTR(FcPatternGetString);
+    LOAD_FUNCPTR(FcStrListDone);
+    LOAD_FUNCPTR(FcStrListNext);
 #undef LOAD_FUNCPTR
 
     if (pFcInit())
@@ -3000,6 +3631,29 @@ static void init_fontconfig(void)
     }
 }
 
+/* Returns a hash of the font directories configured in fontconfig, and
+ * optionally records them for the font index, whether they exist or not. */
+static DWORD walk_fontconfig_dirs( BOOL record )
+{
+    DWORD hash = 2166136261u;
+    FcStrList *list;
+    const char *p;
+    FcChar8 *dir;
+
+    if (!fontconfig_enabled || !(list = pFcConfigGetFontDirs( NULL ))) return 0;
+    while ((dir = pFcStrListNext( list )))
+    {
+        if (record) add_font_index_dir( (const char *)dir, strlen( (const char *)dir ));
+        for (p = (const char *)dir; ; p++)
+        {
+            hash = (hash ^ (BYTE)*p) * 16777619;
+            if (!*p) break;
+        }
+    }
+    pFcStrListDone( list );
+    return hash;
+}
+
 static void load_fontconfig_fonts(void)
 {
     FcPattern *pat;
@@ -3010,6 +3664,8 @@ static void load_fontconfig_fonts(void)
 
     if (!fontconfig_enabled) return;
 
+    walk_fontconfig_dirs( TRUE );
+
     pat = pFcPatternCreate();
     if (!pat) return;
 
@@ -4505,17 +5161,12 @@ static void init_font_list(void)
 
 static BOOL move_to_front(const WCHAR *name)
 {
-    Family *family, *cursor2;
-    LIST_FOR_EACH_ENTRY_SAFE(family, cursor2, &font_list, Family, entry)
-    {
-        if(!strncmpiW(family->FamilyName, name, LF_FACESIZE - 1))
-        {
-            list_remove(&family->entry);
-            list_add_head(&font_list, &family->entry);
-            return TRUE;
-        }
-    }
-    return FALSE;
+    Family *family = find_family_from_name(name);
+
+    if (!family) return FALSE;
+    list_remove(&family->entry);
+    list_add_head(&font_list, &family->entry);
+    return TRUE;
 }
 
 static const WCHAR *set_default(const WCHAR **name_list)
@@ -4538,6 +5189,76 @@ static void reorder_font_list(void)
     default_sans = set_default( default_sans_list );
 }
 
+static DWORD hash_font_reg_data( DWORD hash, const void *data, DWORD size )
+{
+    const BYTE *p = data;
+
+    while (size--) hash = (hash ^ *p++) * 16777619;
+    return hash;
+}
+
+/* Returns a hash of the registry values that init_font_list() reads font
+ * paths from. The external fonts that it deletes before reading them are
+ * left out, since they are written back after every scan. */
+static DWORD get_font_reg_hash(void)
+{
+    static const WCHAR pathW[] = {'P','a','t','h',0};
+    DWORD hash = 2166136261u, i = 0, type, path_type, vlen, dlen, plen, valuelen, datalen;
+    HKEY hkey, external_key;
+    const char *home;
+    WCHAR *valueW;
+    BYTE *data, *path;
+
+    if (!RegOpenKeyW( HKEY_LOCAL_MACHINE, is_win9x() ? win9x_font_reg_key : winnt_font_reg_key, &hkey ))
+    {
+        if (RegOpenKeyW( HKEY_CURRENT_USER, external_fonts_reg_key, &external_key )) external_key = 0;
+        RegQueryInfoKeyW( hkey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &valuelen, &datalen, NULL, NULL );
+        valuelen++; /* returned value doesn't include room for '\0' */
+        valueW = HeapAlloc( GetProcessHeap(), 0, valuelen * sizeof(WCHAR) );
+        data = HeapAlloc( GetProcessHeap(), 0, datalen );
+        path = HeapAlloc( GetProcessHeap(), 0, datalen );
+        if (valueW && data && path)
+        {
+            vlen = valuelen;
+            dlen = datalen;
+            while (!RegEnumValueW( hkey, i++, valueW, &vlen, NULL, &type, data, &dlen ))
+            {
+                plen = dlen;
+                if (!external_key || RegQueryValueExW( external_key, valueW, NULL, &path_type, path, &plen ) ||
+                    type != path_type || dlen != plen || memcmp( data, path, plen ))
+                {
+                    hash = hash_font_reg_data( hash, valueW, (vlen + 1) * sizeof(WCHAR) );
+                    hash = hash_font_reg_data( hash, data, dlen );
+                }
+                vlen = valuelen;
+                dlen = datalen;
+            }
+        }
+        HeapFree( GetProcessHeap(), 0, path );
+        HeapFree( GetProcessHeap(), 0, data );
+        HeapFree( GetProcessHeap(), 0, valueW );
+        if (external_key) RegCloseKey( external_key );
+        RegCloseKey( hkey );
+    }
+
+    if (!RegOpenKeyW( HKEY_CURRENT_USER, wine_fonts_key, &hkey ))
+    {
+        if (!RegQueryValueExW( hkey, pathW, NULL, NULL, NULL, &dlen ) &&
+            (data = HeapAlloc( GetProcessHeap(), 0, dlen )))
+        {
+            if (!RegQueryValueExW( hkey, pathW, NULL, NULL, data, &dlen ))
+            {
+                hash = hash_font_reg_data( hash, data, dlen );
+                /* the path can be relative to the home directory */
+                if ((home = getenv( "HOME" ))) hash = hash_font_reg_data( hash, home, strlen(home) );
+            }
+            HeapFree( GetProcessHeap(), 0, data );
+        }
+        RegCloseKey( hkey );
+    }
+    return hash;
+}
+
 /*************************************************************
  *    WineEngInit
  *
@@ -4546,8 +5267,10 @@ static void reorder_font_list(void)
 BOOL WineEngInit(void)
 {
     HKEY hkey;
-    DWORD disposition;
     HANDLE font_mutex;
+    BOOL loaded;
+
+    init_font_hashes();
 
     /* update locale dependent font info in registry */
     update_font_info();
@@ -4562,8 +5285,10 @@ BOOL WineEngInit(void)
     {
         static const WCHAR antialias_fake_bold_or_italic[] = { 'A','n','t','i','a','l','i','a','s','F','a','k','e',
                                                                'B','o','l','d','O','r','I','t','a','l','i','c',0 };
+        static const WCHAR glyph_bitmap_cache_size_value[] = { 'G','l','y','p','h','B','i','t','m','a','p',
+                                                               'C','a','c','h','e','S','i','z','e',0 };
         static const WCHAR true_options[] = { 'y','Y','t','T','1',0 };
-        DWORD type, size;
+        DWORD type, size, value;
         WCHAR buffer[20];
 
         size = sizeof(buffer);
@@ -4572,6 +5297,13 @@ BOOL WineEngInit(void)
         {
             antialias_fakes = (strchrW(true_options, buffer[0]) != NULL);
         }
+        size = sizeof(value);
+        if (!RegQueryValueExW(hkey, glyph_bitmap_cache_size_value, NULL, &type, (BYTE*)&value, &size) &&
+            type == REG_DWORD)
+        {
+            glyph_bitmap_cache_max = (SIZE_T)value * 1024;
+            TRACE("glyph bitmap cache limited to %u KB\n", value);
+        }
         RegCloseKey(hkey);
     }
 
@@ -4582,12 +5314,19 @@ BOOL WineEngInit(void)
     }
     WaitForSingleObject(font_mutex, INFINITE);
 
-    create_font_cache_key(&hkey_font_cache, &disposition);
+    create_font_cache_key(&hkey_font_cache, NULL);
 
-    if(disposition == REG_CREATED_NEW_KEY)
+#ifdef SONAME_LIBFONTCONFIG
+    font_config_hash = walk_fontconfig_dirs( FALSE );
+#endif
+    font_reg_hash = get_font_reg_hash();
+    if (!(loaded = load_font_list_from_index()))
+    {
         init_font_list();
-    else
-        load_font_list_from_cache(hkey_font_cache);
+        save_font_list_to_index();
+    }
+    /* fonts added through AddFontResource by other processes */
+    load_font_list_from_cache(hkey_font_cache);
 
     reorder_font_list();
 
@@ -4596,7 +5335,7 @@ BOOL WineEngInit(void)
     DumpSubstList();
     LoadReplaceList();
 
-    if(disposition == REG_CREATED_NEW_KEY)
+    if (!loaded)
         update_reg_entries();
 
     init_system_links();
@@ -4846,6 +5585,26 @@ static GdiFont *alloc_font(void)
     return ret;
 }
 
+static void free_glyph_bitmap( struct glyph_bitmap *bitmap )
+{
+    list_remove( &bitmap->entry );
+    list_remove( &bitmap->lru_entry );
+    glyph_bitmap_cache_size -= offsetof( struct glyph_bitmap, bits[bitmap->size] );
+    HeapFree( GetProcessHeap(), 0, bitmap );
+}
+
+static void free_glyph_bitmaps( GdiFont *font )
+{
+    struct glyph_bitmap *bitmap, *next;
+    UINT i;
+
+    if (!font->glyph_bitmaps) return;
+    for (i = 0; i < GLYPH_BITMAP_HASH_SIZE; i++)
+        LIST_FOR_EACH_ENTRY_SAFE( bitmap, next, &font->glyph_bitmaps[i], struct glyph_bitmap, entry )
+            free_glyph_bitmap( bitmap );
+    HeapFree( GetProcessHeap(), 0, font->glyph_bitmaps );
+}
+
 static void free_font(GdiFont *font)
 {
     CHILD_FONT *child, *child_next;
@@ -4870,6 +5629,7 @@ static void free_font(GdiFont *font)
     for (i = 0; i < font->gmsize; i++)
         HeapFree(GetProcessHeap(),0,font->gm[i]);
     HeapFree(GetProcessHeap(), 0, font->gm);
+    free_glyph_bitmaps(font);
     HeapFree(GetProcessHeap(), 0, font->GSUB_Table);
     HeapFree(GetProcessHeap(), 0, font);
 }
@@ -4921,6 +5681,84 @@ static void set_cached_metrics( GdiFont *font, UINT index, const GLYPHMETRICS *g
     font->gm[block][entry].init = TRUE;
 }
 
+static BOOL is_cached_bitmap_format( UINT format )
+{
+    switch (format)
+    {
+    case GGO_GRAY2_BITMAP:
+    case GGO_GRAY4_BITMAP:
+    case GGO_GRAY8_BITMAP:
+    case WINE_GGO_GRAY16_BITMAP:
+    case WINE_GGO_HRGB_BITMAP:
+    case WINE_GGO_HBGR_BITMAP:
+    case WINE_GGO_VRGB_BITMAP:
+    case WINE_GGO_VBGR_BITMAP:
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static struct glyph_bitmap *find_glyph_bitmap( GdiFont *font, UINT index, UINT format, BOOL tategaki )
+{
+    struct glyph_bitmap *bitmap;
+
+    if (!font->glyph_bitmaps) return NULL;
+
+    LIST_FOR_EACH_ENTRY( bitmap, &font->glyph_bitmaps[index % GLYPH_BITMAP_HASH_SIZE], struct glyph_bitmap, entry )
+    {
+        if (bitmap->index != index || bitmap->format != format || bitmap->tategaki != tategaki) continue;
+        list_remove( &bitmap->lru_entry );
+        list_add_head( &glyph_bitmap_lru, &bitmap->lru_entry );
+        return bitmap;
+    }
+    return NULL;
+}
+
+static struct glyph_bitmap *add_glyph_bitmap( GdiFont *font, UINT index, UINT format, BOOL tategaki, DWORD size )
+{
+    struct glyph_bitmap *bitmap;
+    SIZE_T total = offsetof( struct glyph_bitmap, bits[size] );
+    struct list *ptr;
+    UINT i;
+
+    /* a single glyph shouldn't be allowed to flush most of the cache */
+    if (total > glyph_bitmap_cache_max / 16) return NULL;
+
+    if (!font->glyph_bitmaps)
+    {
+        if (!(font->glyph_bitmaps = HeapAlloc( GetProcessHeap(), 0,
+                                               GLYPH_BITMAP_HASH_SIZE * sizeof(*font->glyph_bitmaps) )))
+            return NULL;
+        for (i = 0; i < GLYPH_BITMAP_HASH_SIZE; i++) list_init( &font->glyph_bitmaps[i] );
+    }
+
+    while (glyph_bitmap_cache_size + total > glyph_bitmap_cache_max &&
+           (ptr = list_tail( &glyph_bitmap_lru )))
+        free_glyph_bitmap( LIST_ENTRY( ptr, struct glyph_bitmap, lru_entry ));
+
+    if (!(bitmap = HeapAlloc( GetProcessHeap(), 0, total ))) return NULL;
+    bitmap->index    = index;
+    bitmap->format   = format;
+    bitmap->tategaki = tategaki;
+    bitmap->size     = size;
+    list_add_head( &font->glyph_bitmaps[index % GLYPH_BITMAP_HASH_SIZE], &bitmap->entry );
+    list_add_head( &glyph_bitmap_lru, &bitmap->lru_entry );
+    glyph_bitmap_cache_size += total;
+    return bitmap;
+}
+
+/* same buffer semantics as get_antialias_glyph_bitmap() and get_subpixel_glyph_bitmap() */
+static DWORD copy_glyph_bitmap( const struct glyph_bitmap *bitmap, DWORD buflen, BYTE *buf )
+{
+    if (!buf || !buflen) return bitmap->size;
+    if (!bitmap->size) return GDI_ERROR;  /* empty glyph */
+    if (bitmap->size > buflen) return GDI_ERROR;
+
+    memcpy( buf, bitmap->bits, bitmap->size );
+    memset( buf + bitmap->size, 0, buflen - bitmap->size );
+    return bitmap->size;
+}
+
 static DWORD get_font_data( GdiFont *font, DWORD table, DWORD offset, LPVOID buf, DWORD cbData)
 {
     FT_Face ft_face = font->ft_face;
@@ -5161,6 +5999,7 @@ static void release_font( GdiFont *font )
             TRACE( "freeing %p\n", font );
             list_remove( &font->entry );
             list_remove( &font->unused_entry );
+            list_remove( &font->hash_entry );
             free_font( font );
         }
         else unused_font_count++;
@@ -5206,6 +6045,7 @@ static GdiFont *find_in_cache(HFONT hfont, const LOGFONTW *plf, const FMAT2 *pma
 {
     GdiFont *ret;
     FONT_DESC fd;
+    struct list *bucket;
 
     fd.lf = *plf;
     fd.matrix = *pmat;
@@ -5213,12 +6053,15 @@ static GdiFont *find_in_cache(HFONT hfont, const LOGFONTW *plf, const FMAT2 *pma
     calc_hash(&fd);
 
     /* try the in-use list */
-    LIST_FOR_EACH_ENTRY( ret, &gdi_font_list, struct tagGdiFont, entry )
+    bucket = &gdi_font_hash[fd.hash % GDI_FONT_HASH_SIZE];
+    LIST_FOR_EACH_ENTRY( ret, bucket, struct tagGdiFont, hash_entry )
     {
         if(fontcmp(ret, &fd)) continue;
         if(!can_use_bitmap && !FT_IS_SCALABLE(ret->ft_face)) continue;
         list_remove( &ret->entry );
         list_add_head( &gdi_font_list, &ret->entry );
+        list_remove( &ret->hash_entry );
+        list_add_head( bucket, &ret->hash_entry );
         grab_font( ret );
         return ret;
     }
@@ -5231,6 +6074,7 @@ static void add_to_cache(GdiFont *font)
 
     font->cache_num = cache_num++;
     list_add_head(&gdi_font_list, &font->entry);
+    list_add_head(&gdi_font_hash[font->font_desc.hash % GDI_FONT_HASH_SIZE], &font->hash_entry);
     TRACE( "font %p\n", font );
 }
 
@@ -5245,7 +6089,7 @@ static BOOL create_child_font_list(GdiFont *font)
     FontSubst *psub;
     WCHAR* font_name;
 
-    psub = get_font_subst(&font_subst_list, font->name, -1);
+    psub = get_font_subst(font->name, -1);
     font_name = psub ? psub->to.name : font->name;
     font_link = find_font_link(font_name);
     if (font_link != NULL)
@@ -5773,7 +6617,7 @@ static HFONT CDECL freetype_SelectFont( PHYSDEV dev, HFONT hfont, UINT *aa_flags
         CHILD_FONT *font_link_entry;
         LPWSTR FaceName = lf.lfFaceName;
 
-        psub = get_font_subst(&font_subst_list, FaceName, lf.lfCharSet);
+        psub = get_font_subst(FaceName, lf.lfCharSet);
 
 	if(psub) {
 	    TRACE("substituting %s,%d -> %s,%d\n", debugstr_w(FaceName), lf.lfCharSet,
@@ -6450,7 +7294,7 @@ static BOOL CDECL freetype_EnumFonts( PHYSDEV dev, LPLOGFONTW plf, FONTENUMPROCW
     EnterCriticalSection( &freetype_cs );
     if(plf->lfFaceName[0]) {
         WCHAR *face_name = plf->lfFaceName;
-        FontSubst *psub = get_font_subst(&font_subst_list, plf->lfFaceName, plf->lfCharSet);
+        FontSubst *psub = get_font_subst(plf->lfFaceName, plf->lfCharSet);
 
         if(psub) {
             TRACE("substituting %s -> %s\n", debugstr_w(plf->lfFaceName),
@@ -7689,6 +8533,24 @@ static FT_Int get_load_flags( UINT format )
     return load_flags;
 }
 
+static DWORD render_glyph_bitmap( FT_GlyphSlot glyph, FT_BBox bbox, UINT format,
+                                  BOOL fake_bold, BOOL needs_transform, FT_Matrix matrices[3],
+                                  GLYPHMETRICS *gm, DWORD buflen, BYTE *buf )
+{
+    switch (format)
+    {
+    case WINE_GGO_HRGB_BITMAP:
+    case WINE_GGO_HBGR_BITMAP:
+    case WINE_GGO_VRGB_BITMAP:
+    case WINE_GGO_VBGR_BITMAP:
+        return get_subpixel_glyph_bitmap( glyph, bbox, format, fake_bold, needs_transform,
+                                          matrices, gm, buflen, buf );
+    default:
+        return get_antialias_glyph_bitmap( glyph, bbox, format, fake_bold, needs_transform,
+                                           matrices, buflen, buf );
+    }
+}
+
 static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
                                LPGLYPHMETRICS lpgm, ABC *abc, DWORD buflen, LPVOID buf,
                                const MAT2* lpmat)
@@ -7706,6 +8568,8 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
     BOOL needsTransform = FALSE;
     BOOL tategaki = (font->name[0] == '@');
     BOOL vertical_metrics;
+    BOOL cache_bitmap;
+    struct glyph_bitmap *bitmap;
 
     TRACE("%p, %04x, %08x, %p, %08x, %p, %p\n", font, glyph, format, lpgm,
 	  buflen, buf, lpmat);
@@ -7740,6 +8604,17 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
         get_cached_metrics( font, glyph_index, lpgm, abc ))
         return 1; /* FIXME */
 
+    cache_bitmap = is_cached_bitmap_format( format ) && is_identity_MAT2( lpmat ) && glyph_bitmap_cache_max;
+    if (cache_bitmap && (bitmap = find_glyph_bitmap( font, glyph_index, format, tategaki )))
+    {
+        TRACE("cached bitmap for glyph %04x format %x, %u bytes\n", glyph_index, format, bitmap->size);
+        *abc = bitmap->abc;
+        needed = copy_glyph_bitmap( bitmap, buflen, buf );
+        if (needed != GDI_ERROR)
+            *lpgm = bitmap->gm;
+        return needed;
+    }
+
     needsTransform = get_transform_matrices( font, tategaki, lpmat, matrices );
 
     vertical_metrics = (tategaki && FT_HAS_VERTICAL(ft_face));
@@ -7812,16 +8687,37 @@ static DWORD get_glyph_outline(GdiFont *incoming_font, UINT glyph, UINT format,
     case GGO_GRAY4_BITMAP:
     case GGO_GRAY8_BITMAP:
     case WINE_GGO_GRAY16_BITMAP:
-        needed = get_antialias_glyph_bitmap( ft_face->glyph, bbox, format, font->fake_bold,
-                                             needsTransform, matrices, buflen, buf );
-	break;
-
     case WINE_GGO_HRGB_BITMAP:
     case WINE_GGO_HBGR_BITMAP:
     case WINE_GGO_VRGB_BITMAP:
     case WINE_GGO_VBGR_BITMAP:
-        needed = get_subpixel_glyph_bitmap( ft_face->glyph, bbox, format, font->fake_bold,
-                                            needsTransform, matrices, &gm, buflen, buf );
+        if (cache_bitmap)
+        {
+            /* render the whole glyph once, so that the size query usually
+             * preceding the actual request is enough to populate the cache */
+            GLYPHMETRICS bitmap_gm = gm;
+
+            needed = render_glyph_bitmap( ft_face->glyph, bbox, format, font->fake_bold,
+                                          needsTransform, matrices, &bitmap_gm, 0, NULL );
+            if (needed != GDI_ERROR &&
+                (bitmap = add_glyph_bitmap( font, glyph_index, format, tategaki, needed )))
+            {
+                bitmap->gm  = gm;
+                bitmap->abc = *abc;
+                if (needed && render_glyph_bitmap( ft_face->glyph, bbox, format, font->fake_bold,
+                                                   needsTransform, matrices, &bitmap->gm,
+                                                   needed, bitmap->bits ) == GDI_ERROR)
+                {
+                    free_glyph_bitmap( bitmap );
+                    return GDI_ERROR;
+                }
+                gm = bitmap->gm;
+                needed = copy_glyph_bitmap( bitmap, buflen, buf );
+                break;
+            }
+        }
+        needed = render_glyph_bitmap( ft_face->glyph, bbox, format, font->fake_bold,
+                                      needsTransform, matrices, &gm, buflen, buf );
         break;
 
     case GGO_NATIVE:
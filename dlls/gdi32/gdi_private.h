@@ -261,6 +261,15 @@ extern DWORD put_image_into_bitmap( BITMAPOBJ *bmp, HRGN clip, BITMAPINFO *info,
                                     struct bitblt_coords *dst ) DECLSPEC_HIDDEN;
 extern void dibdrv_set_window_surface( DC *dc, struct window_surface *surface ) DECLSPEC_HIDDEN;
 
+/* dibdrv/bitblt.c */
+extern void init_dib_bands(void) DECLSPEC_HIDDEN;
+
+/* dibdrv/graphics.c */
+extern void init_glyph_cache(void) DECLSPEC_HIDDEN;
+
+/* dibdrv/primitives.c */
+extern void init_dib_primitives(void) DECLSPEC_HIDDEN;
+
 /* driver.c */
 extern const struct gdi_dc_funcs null_driver DECLSPEC_HIDDEN;
 extern const struct gdi_dc_funcs dib_driver DECLSPEC_HIDDEN;
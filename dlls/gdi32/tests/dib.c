@@ -3516,11 +3516,421 @@ static void test_simple_graphics(void)
     DeleteDC(mem_dc);
 }
 
+static inline DWORD premultiplied_blend( DWORD dst, DWORD src )
+{
+    DWORD alpha = src >> 24, ret = 0;
+    int i;
+
+    for (i = 0; i < 32; i += 8)
+        ret |= (((src >> i) & 0xff) + (((dst >> i) & 0xff) * (255 - alpha) + 127) / 255) << i;
+    return ret;
+}
+
+static inline BOOL compare_pixel( DWORD a, DWORD b )
+{
+    int i;
+
+    for (i = 0; i < 32; i += 8)
+        if (abs( (int)((a >> i) & 0xff) - (int)((b >> i) & 0xff) ) > 1) return FALSE;
+    return TRUE;
+}
+
+/* The blending primitives may process several pixels at a time; make sure
+ * every row length gives the same result. */
+static void test_blend_widths(void)
+{
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    BITMAPINFO bmi;
+    DWORD *src_bits, *dst_bits, expect;
+    HBITMAP src_dib, dst_dib, orig_src, orig_dst;
+    HDC src_dc, dst_dc;
+    int width, x;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 32;
+    bmi.bmiHeader.biHeight = -1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    src_dc = CreateCompatibleDC( NULL );
+    dst_dc = CreateCompatibleDC( NULL );
+    src_dib = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    dst_dib = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    orig_src = SelectObject( src_dc, src_dib );
+    orig_dst = SelectObject( dst_dc, dst_dib );
+
+    for (width = 1; width <= 20; width++)
+    {
+        for (x = 0; x < 32; x++)
+        {
+            BYTE alpha = x * 37 + width;
+            src_bits[x] = alpha << 24 | (alpha * x / 31) << 16 | (alpha / 3) << 8 | alpha / 2;
+            dst_bits[x] = 0x01020304 * (x + width);
+        }
+        GdiFlush();
+
+        GdiAlphaBlend( dst_dc, 1, 0, width, 1, src_dc, 1, 0, width, 1, blend );
+
+        for (x = 0; x < 32; x++)
+        {
+            expect = 0x01020304 * (x + width);
+            if (x >= 1 && x < width + 1) expect = premultiplied_blend( expect, src_bits[x] );
+            ok( compare_pixel( dst_bits[x], expect ), "width %d, pixel %d: got %08x, expected %08x\n",
+                width, x, dst_bits[x], expect );
+        }
+    }
+
+    SelectObject( src_dc, orig_src );
+    SelectObject( dst_dc, orig_dst );
+    DeleteObject( src_dib );
+    DeleteObject( dst_dib );
+    DeleteDC( src_dc );
+    DeleteDC( dst_dc );
+}
+
+/* Checks the solid ROP fills at every row length, so that both the vector
+ * loops and the leftover pixels are covered. */
+static void test_rop_widths(void)
+{
+    static const DWORD rops[] = { PATINVERT, 0x00a000c9 /* PATAND */ };
+    static const int bpps[] = { 32, 16 };
+    HBITMAP dib, orig_dib;
+    HBRUSH brush, orig_brush;
+    DWORD color, expect, got;
+    BITMAPINFO bmi;
+    void *bits;
+    HDC dc;
+    int i, j, width, x;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 48;
+    bmi.bmiHeader.biHeight = -1;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    brush = CreateSolidBrush( RGB(0x12, 0x34, 0x56) );
+
+    for (i = 0; i < ARRAY_SIZE(bpps); i++)
+    {
+        bmi.bmiHeader.biBitCount = bpps[i];
+        dc = CreateCompatibleDC( NULL );
+        dib = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, &bits, NULL, 0 );
+        orig_dib = SelectObject( dc, dib );
+        orig_brush = SelectObject( dc, brush );
+
+        PatBlt( dc, 0, 0, 1, 1, PATCOPY );
+        color = bpps[i] == 32 ? ((DWORD *)bits)[0] : ((WORD *)bits)[0];
+
+        for (j = 0; j < ARRAY_SIZE(rops); j++)
+        {
+            for (width = 1; width <= 40; width++)
+            {
+                for (x = 0; x < 48; x++)
+                {
+                    if (bpps[i] == 32) ((DWORD *)bits)[x] = x * 0x01030507;
+                    else ((WORD *)bits)[x] = x * 0x1357;
+                }
+                PatBlt( dc, 1, 0, width, 1, rops[j] );
+                for (x = 0; x < 48; x++)
+                {
+                    if (bpps[i] == 32)
+                    {
+                        got = ((DWORD *)bits)[x];
+                        expect = x * 0x01030507;
+                    }
+                    else
+                    {
+                        got = ((WORD *)bits)[x];
+                        expect = (WORD)(x * 0x1357);
+                    }
+                    if (x >= 1 && x < width + 1)
+                        expect = rops[j] == PATINVERT ? expect ^ color : expect & color;
+                    ok( got == expect, "%d bpp, rop %06x, width %d, pixel %d: got %08x, expected %08x\n",
+                        bpps[i], rops[j], width, x, got, expect );
+                }
+            }
+        }
+
+        SelectObject( dc, orig_brush );
+        SelectObject( dc, orig_dib );
+        DeleteObject( dib );
+        DeleteDC( dc );
+    }
+
+    DeleteObject( brush );
+}
+
+#define BAND_STRIP_ROWS 8
+
+static void band_blit( HDC dst_dc, HDC src_dc, int op, int width, int height )
+{
+    static const BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    static const BLENDFUNCTION blend_constant = { AC_SRC_OVER, 0, 128, 0 };
+
+    switch (op)
+    {
+    case 0:
+        StretchBlt( dst_dc, 0, 0, width, height, src_dc, 0, 0, width / 2, height / 2, SRCCOPY );
+        break;
+    case 1:
+        GdiAlphaBlend( dst_dc, 0, 0, width, height, src_dc, 0, 0, width, height, blend );
+        break;
+    case 2:
+        /* The rectangles don't intersect, but the source rows are below the
+         * destination rows they are blended into. */
+        GdiAlphaBlend( dst_dc, 0, 0, width / 2, height - 256, dst_dc, width / 2, 256, width / 2, height - 256,
+                       blend_constant );
+        break;
+    }
+}
+
+/* Does large blits in one call, where they may be split into bands, and
+ * compares them with the same blits clipped to strips that are too short
+ * to be split. */
+static void band_rendering(void)
+{
+    static const char *names[] = { "stretch", "blend", "overlapping blend" };
+    const int width = 3840, height = 2160;
+    HBITMAP src_dib, dst_dib, ref_dib, orig_src, orig_dst, orig_ref;
+    DWORD *src_bits, *dst_bits, *ref_bits, pixel;
+    WORD *conv_bits, expect;
+    HDC src_dc, dst_dc, ref_dc;
+    BITMAPINFO bmi;
+    HRGN rgn;
+    int i, y;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    src_dc = CreateCompatibleDC( NULL );
+    dst_dc = CreateCompatibleDC( NULL );
+    ref_dc = CreateCompatibleDC( NULL );
+    src_dib = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    dst_dib = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    ref_dib = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&ref_bits, NULL, 0 );
+    if (!src_dib || !dst_dib || !ref_dib)
+    {
+        skip( "failed to allocate the bitmaps\n" );
+        goto done;
+    }
+    orig_src = SelectObject( src_dc, src_dib );
+    orig_dst = SelectObject( dst_dc, dst_dib );
+    orig_ref = SelectObject( ref_dc, ref_dib );
+    SetStretchBltMode( dst_dc, COLORONCOLOR );
+    SetStretchBltMode( ref_dc, COLORONCOLOR );
+    for (i = 0; i < width * height; i++)
+        src_bits[i] = (i % 251) << 24 | ((i * 7) % ((i % 251) + 1)) * 0x010101;
+
+    for (i = 0; i < ARRAY_SIZE(names); i++)
+    {
+        memcpy( ref_bits, dst_bits, width * height * 4 );
+        band_blit( dst_dc, src_dc, i, width, height );
+        for (y = 0; y < height; y += BAND_STRIP_ROWS)
+        {
+            rgn = CreateRectRgn( 0, y, width, y + BAND_STRIP_ROWS );
+            SelectClipRgn( ref_dc, rgn );
+            DeleteObject( rgn );
+            band_blit( ref_dc, src_dc, i, width, height );
+        }
+        SelectClipRgn( ref_dc, NULL );
+        GdiFlush();
+        ok( !memcmp( dst_bits, ref_bits, width * height * 4 ), "%s: output differs\n", names[i] );
+    }
+
+    bmi.bmiHeader.biBitCount = 16;
+    conv_bits = HeapAlloc( GetProcessHeap(), 0, width * height * 2 );
+    GetDIBits( dst_dc, dst_dib, 0, height, conv_bits, &bmi, DIB_RGB_COLORS );
+    for (i = 0; i < width * height; i++)
+    {
+        pixel = dst_bits[i];
+        expect = ((pixel >> 9) & 0x7c00) | ((pixel >> 6) & 0x03e0) | ((pixel >> 3) & 0x001f);
+        if (conv_bits[i] == expect) continue;
+        ok( 0, "convert: pixel %d: got %04x, expected %04x\n", i, conv_bits[i], expect );
+        break;
+    }
+    HeapFree( GetProcessHeap(), 0, conv_bits );
+
+    SelectObject( src_dc, orig_src );
+    SelectObject( dst_dc, orig_dst );
+    SelectObject( ref_dc, orig_ref );
+done:
+    DeleteObject( src_dib );
+    DeleteObject( dst_dib );
+    DeleteObject( ref_dib );
+    DeleteDC( src_dc );
+    DeleteDC( dst_dc );
+    DeleteDC( ref_dc );
+}
+
+static void test_band_rendering(void)
+{
+    band_rendering();
+
+    /* the thread count is only read when gdi32 is loaded */
+    if (!winetest_run_wine_child( "band_rendering", "WINEDIBTHREADS", "4" ))
+        skip( "rendering in bands is only implemented in Wine\n" );
+}
+
+static const WCHAR glyph_cache_lines[][40] =
+{
+    {'T','h','e',' ','q','u','i','c','k',' ','b','r','o','w','n',' ','f','o','x',' ',
+     'j','u','m','p','s',' ','o','v','e','r',' ','t','h','e',' ','l','a','z','y',0},
+    {0x00c0,'l','a',' ','c','l','a','i','r','e',' ','f','o','n','t','a','i','n','e',' ',
+     0x00e9,'t','a','i','t',' ','p','l','u','t',0x00f4,'t',' ','f','r','a',0x00ee,'c','h',0},
+    {0x0393,0x03b1,0x03b6,0x03ad,0x03b5,0x03c2,' ',0x03ba,0x03b1,0x1f76,' ',0x03bc,0x03c5,
+     0x03c1,0x03c4,0x03b9,0x1f72,0x03c2,' ',0x03b4,0x1f72,0x03bd,' ',0x03b8,0x1f70,' ',
+     0x03b2,0x03c1,0x1ff6,' ',0x03c0,0x03b9,0x1f70,0},
+    {0x0421,0x044a,0x0435,0x0448,0x044c,' ',0x0436,0x0435,' ',0x0435,0x0449,0x0451,' ',
+     0x044d,0x0442,0x0438,0x0445,' ',0x043c,0x044f,0x0433,0x043a,0x0438,0x0445,' ',
+     0x0444,0x0440,0x0430,0x043d,0x0446,0x0443,0x0437,0x0441,0x043a,0x0438,0x0445,0},
+    {0x3044,0x308d,0x306f,0x306b,0x307b,0x3078,0x3068,0x3061,0x308a,0x306c,0x308b,0x3092,
+     0x308f,0x304b,0x3088,0x305f,0x308c,0x305d,0x3064,0x306d,0x306a,0x3089,0x3080,0},
+    {0x5929,0x5730,0x7384,0x9ec4,0xff0c,0x5b87,0x5b99,0x6d2a,0x8352,0x3002,0x65e5,0x6708,
+     0x76c8,0x6603,0xff0c,0x8fb0,0x5bbf,0x5217,0x5f20,0x3002,0},
+};
+
+#define GLYPH_CACHE_THREADS 4
+#define GLYPH_CACHE_SIZES   5
+
+static HFONT create_glyph_cache_font( int height )
+{
+    return CreateFontA( height, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+                        OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY,
+                        DEFAULT_PITCH, "Arial" );
+}
+
+static void render_glyph_cache_text( HDC dc, int size, int height )
+{
+    int i;
+
+    PatBlt( dc, 0, 0, size, size, WHITENESS );
+    for (i = 0; i < ARRAY_SIZE(glyph_cache_lines); i++)
+        TextOutW( dc, 0, i * height, glyph_cache_lines[i], lstrlenW( glyph_cache_lines[i] ));
+    GdiFlush();
+}
+
+/* Every thread keeps a large font selected into one DC while it renders a
+ * short multilingual document at several sizes into another, so that the
+ * glyphs in use exceed the cache budget. Rendering the same text again,
+ * from the cache or after its glyphs were evicted, must give the same
+ * result. */
+static DWORD WINAPI glyph_cache_thread( void *arg )
+{
+    const int index = (INT_PTR)arg, size = 512, big_height = 72 + 8 * index;
+    HBITMAP dibs[2], orig_dibs[2];
+    HFONT big_font, font, orig_fonts[2];
+    void *bits[2], *first;
+    BITMAPINFO bmi;
+    HDC dcs[2];
+    int i, height;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = size;
+    bmi.bmiHeader.biHeight = -size;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    for (i = 0; i < 2; i++)
+    {
+        dcs[i] = CreateCompatibleDC( NULL );
+        dibs[i] = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, &bits[i], NULL, 0 );
+        orig_dibs[i] = SelectObject( dcs[i], dibs[i] );
+        SetBkMode( dcs[i], TRANSPARENT );
+    }
+    first = HeapAlloc( GetProcessHeap(), 0, size * size * 4 );
+
+    big_font = create_glyph_cache_font( big_height );
+    orig_fonts[0] = SelectObject( dcs[0], big_font );
+    render_glyph_cache_text( dcs[0], size, big_height );
+    memcpy( first, bits[0], size * size * 4 );
+
+    for (i = 0; i < GLYPH_CACHE_SIZES; i++)
+    {
+        height = 10 + 6 * (index * GLYPH_CACHE_SIZES + i);
+        font = create_glyph_cache_font( height );
+        orig_fonts[1] = SelectObject( dcs[1], font );
+        render_glyph_cache_text( dcs[1], size, height );
+        memcpy( bits[0], bits[1], size * size * 4 );
+        render_glyph_cache_text( dcs[1], size, height );
+        ok( !memcmp( bits[0], bits[1], size * size * 4 ), "thread %d, height %d: output differs\n",
+            index, height );
+        SelectObject( dcs[1], orig_fonts[1] );
+        DeleteObject( font );
+    }
+
+    render_glyph_cache_text( dcs[0], size, big_height );
+    ok( !memcmp( first, bits[0], size * size * 4 ), "thread %d, height %d: output differs\n",
+        index, big_height );
+    SelectObject( dcs[0], orig_fonts[0] );
+    DeleteObject( big_font );
+
+    HeapFree( GetProcessHeap(), 0, first );
+    for (i = 0; i < 2; i++)
+    {
+        SelectObject( dcs[i], orig_dibs[i] );
+        DeleteObject( dibs[i] );
+        DeleteDC( dcs[i] );
+    }
+    return 0;
+}
+
+static void glyph_cache(void)
+{
+    HANDLE threads[GLYPH_CACHE_THREADS];
+    int i;
+
+    for (i = 0; i < GLYPH_CACHE_THREADS; i++)
+        threads[i] = CreateThread( NULL, 0, glyph_cache_thread, (void *)(INT_PTR)i, 0, NULL );
+    WaitForMultipleObjects( GLYPH_CACHE_THREADS, threads, TRUE, INFINITE );
+    for (i = 0; i < GLYPH_CACHE_THREADS; i++) CloseHandle( threads[i] );
+}
+
+static void test_glyph_cache_budget(void)
+{
+    glyph_cache();
+
+    /* the budget is only read when gdi32 is loaded; a budget that is much
+     * smaller than the fonts in use evicts glyphs all the time */
+    if (!winetest_run_wine_child( "glyph_cache", "WINEGLYPHCACHESIZE", "64" ))
+        skip( "the glyph cache budget can only be changed in Wine\n" );
+}
+
 START_TEST(dib)
 {
+    char **argv;
+    int argc;
+
     CryptAcquireContextW(&crypt_prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 3 && !strcmp( argv[2], "band_rendering" ))
+    {
+        band_rendering();
+        CryptReleaseContext(crypt_prov, 0);
+        return;
+    }
+    if (argc >= 3 && !strcmp( argv[2], "glyph_cache" ))
+    {
+        glyph_cache();
+        CryptReleaseContext(crypt_prov, 0);
+        return;
+    }
+
     test_simple_graphics();
+    test_blend_widths();
+    test_rop_widths();
+    test_band_rendering();
+    test_glyph_cache_budget();
 
     CryptReleaseContext(crypt_prov, 0);
 }
@@ -5860,6 +5860,70 @@ todo_wine
     ReleaseDC(NULL, hdc);
 }
 
+static void test_GetGlyphOutline_repeated(void)
+{
+    static const UINT formats[] = { GGO_GRAY2_BITMAP, GGO_GRAY4_BITMAP, GGO_GRAY8_BITMAP };
+    static const MAT2 rotate = { {0,0}, {0,1}, {0,-1}, {0,0} };
+    HDC hdc;
+    LOGFONTA lf;
+    HFONT hfont, hfont_prev;
+    GLYPHMETRICS gm, gm2;
+    BYTE *buf, *buf2;
+    DWORD size, ret;
+    UINT i, j;
+
+    if (!is_truetype_font_installed("Tahoma"))
+    {
+        skip("Tahoma is not installed\n");
+        return;
+    }
+
+    memset(&lf, 0, sizeof(lf));
+    lf.lfHeight = 48;
+    lstrcpyA(lf.lfFaceName, "Tahoma");
+
+    hfont = CreateFontIndirectA(&lf);
+    ok(hfont != 0, "CreateFontIndirectA error %u\n", GetLastError());
+
+    hdc = GetDC(NULL);
+    hfont_prev = SelectObject(hdc, hfont);
+    ok(hfont_prev != NULL, "SelectObject failed\n");
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        size = GetGlyphOutlineA(hdc, 'W', formats[i], &gm, 0, NULL, &mat);
+        ok(size != GDI_ERROR && size, "%u: GetGlyphOutline failed\n", i);
+        if (size == GDI_ERROR || !size) continue;
+
+        buf = HeapAlloc(GetProcessHeap(), 0, size + 16);
+        buf2 = HeapAlloc(GetProcessHeap(), 0, size + 16);
+        memset(buf, 0xcc, size + 16);
+        ret = GetGlyphOutlineA(hdc, 'W', formats[i], &gm, size + 16, buf, &mat);
+        ok(ret == size, "%u: expected %u, got %u\n", i, size, ret);
+
+        /* a transformed request in between must not disturb the plain one */
+        ret = GetGlyphOutlineA(hdc, 'W', formats[i], &gm2, 0, NULL, &rotate);
+        ok(ret != GDI_ERROR, "%u: GetGlyphOutline failed\n", i);
+
+        for (j = 0; j < 2; j++)
+        {
+            memset(buf2, 0xcc, size + 16);
+            memset(&gm2, 0, sizeof(gm2));
+            ret = GetGlyphOutlineA(hdc, 'W', formats[i], &gm2, size + 16, buf2, &mat);
+            ok(ret == size, "%u/%u: expected %u, got %u\n", i, j, size, ret);
+            ok(!memcmp(&gm, &gm2, sizeof(gm)), "%u/%u: glyph metrics differ\n", i, j);
+            ok(!memcmp(buf, buf2, size), "%u/%u: glyph bits differ\n", i, j);
+        }
+
+        HeapFree(GetProcessHeap(), 0, buf);
+        HeapFree(GetProcessHeap(), 0, buf2);
+    }
+
+    SelectObject(hdc, hfont_prev);
+    DeleteObject(hfont);
+    ReleaseDC(NULL, hdc);
+}
+
 static void test_fstype_fixup(void)
 {
     HDC hdc;
@@ -7189,6 +7253,57 @@ static void test_GetCharWidthInfo(void)
     ReleaseDC(NULL, hdc);
 }
 
+struct font_list_check
+{
+    HDC hdc;
+    int count;
+};
+
+static INT CALLBACK font_list_proc( const LOGFONTA *lf, const TEXTMETRICA *tm, DWORD type, LPARAM lparam )
+{
+    struct font_list_check *check = (struct font_list_check *)lparam;
+    char face_name[LF_FACESIZE];
+    TEXTMETRICA sel_tm;
+    HFONT hfont, old_hfont;
+
+    if (!(type & TRUETYPE_FONTTYPE)) return 1;
+
+    hfont = CreateFontIndirectA( lf );
+    old_hfont = SelectObject( check->hdc, hfont );
+    GetTextFaceA( check->hdc, sizeof(face_name), face_name );
+    GetTextMetricsA( check->hdc, &sel_tm );
+    ok( !strcmp( face_name, lf->lfFaceName ), "%s: got face %s\n", lf->lfFaceName, face_name );
+    ok( sel_tm.tmHeight == tm->tmHeight, "%s: got height %d, expected %d\n",
+        lf->lfFaceName, sel_tm.tmHeight, tm->tmHeight );
+    ok( sel_tm.tmWeight == tm->tmWeight, "%s: got weight %d, expected %d\n",
+        lf->lfFaceName, sel_tm.tmWeight, tm->tmWeight );
+    ok( sel_tm.tmItalic == tm->tmItalic, "%s: got italic %d, expected %d\n",
+        lf->lfFaceName, sel_tm.tmItalic, tm->tmItalic );
+    ok( sel_tm.tmCharSet == lf->lfCharSet, "%s: got charset %d, expected %d\n",
+        lf->lfFaceName, sel_tm.tmCharSet, lf->lfCharSet );
+    SelectObject( check->hdc, old_hfont );
+    DeleteObject( hfont );
+    check->count++;
+    return 1;
+}
+
+/* The font list may have been loaded from what an earlier process saved,
+ * without scanning the font files. The enumerated fonts must still match
+ * the fonts that get selected. */
+static void test_font_list_reload(void)
+{
+    struct font_list_check check;
+    LOGFONTA lf;
+
+    memset( &lf, 0, sizeof(lf) );
+    lf.lfCharSet = DEFAULT_CHARSET;
+    check.hdc = CreateCompatibleDC( 0 );
+    check.count = 0;
+    EnumFontFamiliesExA( check.hdc, &lf, font_list_proc, (LPARAM)&check, 0 );
+    DeleteDC( check.hdc );
+    ok( check.count > 0, "no TrueType fonts enumerated\n" );
+}
+
 START_TEST(font)
 {
     static const char *test_names[] =
@@ -7250,6 +7365,7 @@ START_TEST(font)
     test_RealizationInfo();
     test_GetTextFace();
     test_GetGlyphOutline();
+    test_GetGlyphOutline_repeated();
     test_GetTextMetrics2("Tahoma", -11);
     test_GetTextMetrics2("Tahoma", -55);
     test_GetTextMetrics2("Tahoma", -110);
@@ -7271,6 +7387,7 @@ START_TEST(font)
     test_bitmap_font_glyph_index();
     test_GetCharWidthI();
     test_long_names();
+    test_font_list_reload();
 
     /* These tests should be last test until RemoveFontResource
      * is properly implemented.
@@ -103,6 +103,7 @@
 #include "wine/debug.h"
 #include "wine/server.h"
 #include "ntdll_misc.h"
+#include "uring.h"
 
 #include "winternl.h"
 #include "winioctl.h"
@@ -859,6 +860,11 @@ NTSTATUS WINAPI NtReadFile(HANDLE hFile, HANDLE hEvent,
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
+            if (async_read && length && do_uring() &&
+                (status = uring_submit_file_io( hFile, unix_handle, TRUE, buffer, length, offset->QuadPart,
+                                                hEvent, apc, apc_user, io_status )) == STATUS_PENDING)
+                goto err;
+
             /* async I/O doesn't make sense on regular files */
             while ((result = virtual_locked_pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
@@ -1264,6 +1270,11 @@ NTSTATUS WINAPI NtWriteFile(HANDLE hFile, HANDLE hEvent,
                 goto done;
             }
 
+            if (async_write && length && do_uring() &&
+                (status = uring_submit_file_io( hFile, unix_handle, FALSE, (void *)buffer, length, off,
+                                                hEvent, apc, apc_user, io_status )) == STATUS_PENDING)
+                goto err;
+
             /* async I/O doesn't make sense on regular files */
             while ((result = pwrite( unix_handle, buffer, length, off )) == -1)
             {
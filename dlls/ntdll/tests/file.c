@@ -3611,6 +3611,128 @@ static void test_file_completion_information(void)
     CloseHandle(h);
 }
 
+static void test_file_io_pending(void)
+{
+    static const DWORD size = 1024 * 1024;
+    IO_STATUS_BLOCK io;
+    OVERLAPPED ov;
+    NTSTATUS status;
+    DWORD num_bytes, i;
+    char *data, *buf;
+    HANDLE event, h;
+    BOOL ret;
+
+    if (!(h = create_temp_file(FILE_FLAG_OVERLAPPED))) return;
+    event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    data = HeapAlloc(GetProcessHeap(), 0, size);
+    buf = HeapAlloc(GetProcessHeap(), 0, size);
+    for (i = 0; i < size; i++) data[i] = i * 7;
+
+    /* without an event, the file handle must not be signaled before the I/O is done */
+    memset(&ov, 0, sizeof(ov));
+    ret = WriteFile(h, data, size, NULL, &ov);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "WriteFile failed, error %u\n", GetLastError());
+    ret = GetOverlappedResult(h, &ov, &num_bytes, TRUE);
+    ok(ret, "GetOverlappedResult failed, error %u\n", GetLastError());
+    ok(num_bytes == size, "got %u\n", num_bytes);
+
+    memset(&ov, 0, sizeof(ov));
+    memset(buf, 0xcc, size);
+    ret = ReadFile(h, buf, size, NULL, &ov);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed, error %u\n", GetLastError());
+    ret = GetOverlappedResult(h, &ov, &num_bytes, TRUE);
+    ok(ret, "GetOverlappedResult failed, error %u\n", GetLastError());
+    ok(num_bytes == size, "got %u\n", num_bytes);
+    ok(ov.Internal == STATUS_SUCCESS, "got status %#lx\n", ov.Internal);
+    ok(!memcmp(buf, data, size), "wrong data\n");
+
+    /* the read either completes or gets cancelled, but it is always reported */
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = event;
+    ret = ReadFile(h, buf, size, NULL, &ov);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed, error %u\n", GetLastError());
+    status = pNtCancelIoFileEx(h, (IO_STATUS_BLOCK *)&ov, &io);
+    ok(status == STATUS_SUCCESS || status == STATUS_NOT_FOUND, "got %#x\n", status);
+    ret = GetOverlappedResult(h, &ov, &num_bytes, TRUE);
+    if (ret)
+    {
+        ok(num_bytes == size, "got %u\n", num_bytes);
+        ok(!memcmp(buf, data, size), "wrong data\n");
+    }
+    else ok(GetLastError() == ERROR_OPERATION_ABORTED, "got error %u\n", GetLastError());
+    ok(!WaitForSingleObject(event, 0), "event not signaled\n");
+
+    /* closing the handle doesn't lose the pending read */
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = event;
+    ret = ReadFile(h, buf, size, NULL, &ov);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed, error %u\n", GetLastError());
+    CloseHandle(h);
+    ok(!WaitForSingleObject(event, 5000), "event not signaled\n");
+    ok(ov.Internal == STATUS_SUCCESS || ov.Internal == STATUS_CANCELLED, "got status %#lx\n", ov.Internal);
+    if (ov.Internal == STATUS_SUCCESS) ok(ov.InternalHigh == size, "got %lu\n", ov.InternalHigh);
+
+    HeapFree(GetProcessHeap(), 0, buf);
+    HeapFree(GetProcessHeap(), 0, data);
+    CloseHandle(event);
+}
+
+static void test_file_io_queue_depth(void)
+{
+    enum { block_size = 4096, block_count = 64, queue_depth = 32 };
+    static unsigned char data[block_size * block_count], bufs[queue_depth][block_size];
+    OVERLAPPED ov[queue_depth], *pov;
+    DWORD num_bytes;
+    ULONG_PTR key;
+    HANDLE port, h;
+    BOOL ret;
+    int i;
+
+    if (!(h = create_temp_file(FILE_FLAG_OVERLAPPED))) return;
+
+    for (i = 0; i < sizeof(data); i++) data[i] = i / block_size;
+    memset(&ov[0], 0, sizeof(ov[0]));
+    ret = WriteFile(h, data, sizeof(data), &num_bytes, &ov[0]);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "WriteFile failed, error %u\n", GetLastError());
+    ret = GetOverlappedResult(h, &ov[0], &num_bytes, TRUE);
+    ok(ret, "GetOverlappedResult failed, error %u\n", GetLastError());
+    ok(num_bytes == sizeof(data), "got %u\n", num_bytes);
+
+    port = CreateIoCompletionPort(h, NULL, 0xdeadbeef, 0);
+    ok(port != NULL, "CreateIoCompletionPort failed, error %u\n", GetLastError());
+
+    for (i = 0; i < queue_depth; i++)
+    {
+        memset(&ov[i], 0, sizeof(ov[i]));
+        ov[i].Offset = ((i * 37) % block_count) * block_size;
+        memset(bufs[i], 0xcc, block_size);
+        SetLastError(0xdeadbeef);
+        ret = ReadFile(h, bufs[i], block_size, NULL, &ov[i]);
+        ok((!ret && GetLastError() == ERROR_IO_PENDING) || broken(ret) /* Before Vista */,
+           "%d: unexpected result %#x, error %u\n", i, ret, GetLastError());
+    }
+
+    for (i = 0; i < queue_depth; i++)
+    {
+        int index;
+
+        key = 0;
+        pov = NULL;
+        ret = GetQueuedCompletionStatus(port, &num_bytes, &key, &pov, 1000);
+        ok(ret, "GetQueuedCompletionStatus failed, error %u\n", GetLastError());
+        if (!ret) break;
+        ok(key == 0xdeadbeef, "expected 0xdeadbeef, got %lx\n", key);
+        ok(num_bytes == block_size, "got %u\n", num_bytes);
+        index = pov - ov;
+        ok(index >= 0 && index < queue_depth, "unexpected overlapped %p\n", pov);
+        if (index < 0 || index >= queue_depth) continue;
+        ok(!memcmp(bufs[index], data + ov[index].Offset, block_size), "%d: wrong data\n", index);
+    }
+
+    CloseHandle(port);
+    CloseHandle(h);
+}
+
 static void test_file_id_information(void)
 {
     BY_HANDLE_FILE_INFORMATION info;
@@ -4854,10 +4976,36 @@ static void test_file_readonly_access(void)
     DeleteFileW(path);
 }
 
+static void test_uring(void)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char cmdline[MAX_PATH];
+    char **argv;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" file uring", argv[0]);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+
+    /* only used by Wine, harmless elsewhere */
+    SetEnvironmentVariableA("WINEURING", "1");
+    if (CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info))
+    {
+        winetest_wait_child_process(info.hProcess);
+        CloseHandle(info.hProcess);
+        CloseHandle(info.hThread);
+    }
+    else ok(0, "CreateProcess failed, error %u\n", GetLastError());
+    SetEnvironmentVariableA("WINEURING", NULL);
+}
+
 START_TEST(file)
 {
     HMODULE hkernel32 = GetModuleHandleA("kernel32.dll");
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
+    char **argv;
+
     if (!hntdll)
     {
         skip("not running on NT, skipping test\n");
@@ -4895,6 +5043,17 @@ START_TEST(file)
     pNtQueryFullAttributesFile = (void *)GetProcAddress(hntdll, "NtQueryFullAttributesFile");
     pNtFlushBuffersFile = (void *)GetProcAddress(hntdll, "NtFlushBuffersFile");
 
+    if (winetest_get_mainargs(&argv) >= 3 && !strcmp(argv[2], "uring"))
+    {
+        /* overlapped file I/O tests, run with the io_uring backend enabled */
+        test_read_write();
+        test_file_io_completion();
+        test_file_completion_information();
+        test_file_io_pending();
+        test_file_io_queue_depth();
+        return;
+    }
+
     test_read_write();
     test_NtCreateFile();
     create_file_test();
@@ -4915,6 +5074,9 @@ START_TEST(file)
     test_file_link_information();
     test_file_disposition_information();
     test_file_completion_information();
+    test_file_io_pending();
+    test_file_io_queue_depth();
+    test_uring();
     test_file_id_information();
     test_file_access_information();
     test_file_mode();
@@ -0,0 +1,495 @@
+/*
+ * io_uring-based asynchronous file I/O
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Overlapped reads and writes on regular files are normally performed
+ * synchronously in NtReadFile/NtWriteFile, since the server always reports
+ * them as ready.  When WINEURING is set, they are instead queued to a
+ * per-process io_uring instance.  Each request is also registered as an
+ * async with the server, which keeps the file unsignaled and handles
+ * cancellation; a dedicated thread stores the result in the I/O status
+ * block and has the server complete the async, which takes care of the
+ * event, APC and completion port. */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
+#include <unistd.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#define NONAMELESSUNION
+#include "windef.h"
+#include "winternl.h"
+#include "wine/debug.h"
+#include "wine/server.h"
+
+#include "ntdll_misc.h"
+#include "uring.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(uring);
+
+#ifdef __linux__
+
+/* The io_uring ABI; defined here so that we don't depend on the headers
+ * of the build machine.  The syscall numbers are shared by all architectures. */
+
+#define URING_SYSCALL_SETUP     425
+#define URING_SYSCALL_ENTER     426
+
+#define IORING_OFF_SQ_RING      0ULL
+#define IORING_OFF_CQ_RING      0x8000000ULL
+#define IORING_OFF_SQES         0x10000000ULL
+
+#define IORING_OP_READV         1
+#define IORING_OP_WRITEV        2
+#define IORING_OP_ASYNC_CANCEL  14
+
+#define IORING_ENTER_GETEVENTS  (1U << 0)
+
+#define URING_ENTRIES           256
+
+struct io_uring_sqe
+{
+    unsigned char      opcode;
+    unsigned char      flags;
+    unsigned short     ioprio;
+    int                fd;
+    unsigned long long off;
+    unsigned long long addr;
+    unsigned int       len;
+    unsigned int       rw_flags;
+    unsigned long long user_data;
+    unsigned long long pad[3];
+};
+C_ASSERT( sizeof(struct io_uring_sqe) == 64 );
+
+struct io_uring_cqe
+{
+    unsigned long long user_data;
+    int                res;
+    unsigned int       flags;
+};
+C_ASSERT( sizeof(struct io_uring_cqe) == 16 );
+
+struct io_sqring_offsets
+{
+    unsigned int head;
+    unsigned int tail;
+    unsigned int ring_mask;
+    unsigned int ring_entries;
+    unsigned int flags;
+    unsigned int dropped;
+    unsigned int array;
+    unsigned int resv1;
+    unsigned long long resv2;
+};
+
+struct io_cqring_offsets
+{
+    unsigned int head;
+    unsigned int tail;
+    unsigned int ring_mask;
+    unsigned int ring_entries;
+    unsigned int overflow;
+    unsigned int cqes;
+    unsigned long long resv[2];
+};
+
+struct io_uring_params
+{
+    unsigned int sq_entries;
+    unsigned int cq_entries;
+    unsigned int flags;
+    unsigned int sq_thread_cpu;
+    unsigned int sq_thread_idle;
+    unsigned int resv[5];
+    struct io_sqring_offsets sq_off;
+    struct io_cqring_offsets cq_off;
+};
+C_ASSERT( sizeof(struct io_uring_params) == 120 );
+
+/* a pending request; the iovec must stay valid until the kernel picked it up */
+struct uring_io
+{
+    NTSTATUS         (*callback)( void *, IO_STATUS_BLOCK *, NTSTATUS ); /* must be the first field */
+    struct iovec       iov;
+    BOOL               is_read;
+    ULONGLONG          offset;
+    IO_STATUS_BLOCK   *iosb;
+    LONG               done;     /* set once the result is stored and the server refused it */
+};
+
+static struct
+{
+    int                  fd;
+    unsigned int         entries;
+    unsigned int        *sq_head;
+    unsigned int        *sq_tail;
+    unsigned int        *sq_mask;
+    unsigned int        *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned int        *cq_head;
+    unsigned int        *cq_tail;
+    unsigned int        *cq_mask;
+    struct io_uring_cqe *cqes;
+    int                  inflight;
+} ring = { -1 };
+
+static RTL_CRITICAL_SECTION uring_section;
+static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
+{
+    0, 0, &uring_section,
+    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": uring_section") }
+};
+static RTL_CRITICAL_SECTION uring_section = { &critsect_debug, -1, 0, 0, 0, 0 };
+
+static inline int io_uring_setup( unsigned int entries, struct io_uring_params *params )
+{
+    return syscall( URING_SYSCALL_SETUP, entries, params );
+}
+
+static inline int io_uring_enter( int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags )
+{
+    return syscall( URING_SYSCALL_ENTER, fd, to_submit, min_complete, flags, NULL, 0 );
+}
+
+static inline unsigned int load_acquire( unsigned int *ptr )
+{
+    return __atomic_load_n( ptr, __ATOMIC_ACQUIRE );
+}
+
+static inline void store_release( unsigned int *ptr, unsigned int val )
+{
+    __atomic_store_n( ptr, val, __ATOMIC_RELEASE );
+}
+
+int do_uring(void)
+{
+    static int do_uring_cached = -1;
+
+    if (do_uring_cached == -1)
+    {
+        do_uring_cached = getenv("WINEURING") && atoi(getenv("WINEURING"));
+        if (do_uring_cached)
+        {
+            struct io_uring_params params;
+            int fd;
+
+            memset( &params, 0, sizeof(params) );
+            if ((fd = io_uring_setup( URING_ENTRIES, &params )) == -1)
+            {
+                FIXME( "io_uring not available (%s), using synchronous file I/O.\n", strerror(errno) );
+                do_uring_cached = 0;
+            }
+            else close( fd );
+        }
+    }
+
+    return do_uring_cached;
+}
+
+/* convert a completion result into the status delivered to the application */
+static NTSTATUS uring_io_status( struct uring_io *io, int res )
+{
+    if (res >= 0)
+    {
+        if (io->is_read && !res && io->iov.iov_len) return STATUS_END_OF_FILE;
+        return STATUS_SUCCESS;
+    }
+    if (res == -ECANCELED) return STATUS_CANCELLED;
+    if (res == -EFAULT && !io->is_read) return STATUS_INVALID_USER_BUFFER;
+    errno = -res;
+    return FILE_GetNtStatus();
+}
+
+/* store the result and have the server complete the async */
+static void uring_complete( struct uring_io *io, int res )
+{
+    NTSTATUS status = uring_io_status( io, res ), ret;
+    ULONG total = status ? 0 : res;
+
+    TRACE( "%p %s %u bytes at %s -> %08x\n", io, io->is_read ? "read" : "write",
+           (UINT)io->iov.iov_len, wine_dbgstr_longlong(io->offset), status );
+
+    io->iosb->Information = total;
+    io->iosb->u.Status = status;
+
+    SERVER_START_REQ( complete_client_async )
+    {
+        req->user_arg = wine_server_client_ptr( io );
+        req->status   = status;
+        req->total    = total;
+        ret = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+
+    if (!ret)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, io );
+        return;
+    }
+
+    /* the async was cancelled or its handle closed; uring_async_callback reports
+     * the result from the owning thread and frees the request */
+    interlocked_xchg( &io->done, 1 );
+    RtlWakeAddressAll( (void *)&io->done );
+}
+
+/* queue an sqe; called with uring_section held */
+static BOOL uring_queue_sqe( unsigned char opcode, int fd, ULONGLONG offset, ULONG_PTR addr,
+                             unsigned int len, ULONG_PTR user_data )
+{
+    struct io_uring_sqe *sqe;
+    unsigned int tail, index;
+    int ret;
+
+    if (ring.fd == -1) return FALSE;
+    if (interlocked_xchg_add( &ring.inflight, 1 ) >= (int)ring.entries)
+    {
+        interlocked_xchg_add( &ring.inflight, -1 );
+        return FALSE;
+    }
+
+    tail = *ring.sq_tail;
+    index = tail & *ring.sq_mask;
+    sqe = &ring.sqes[index];
+    memset( sqe, 0, sizeof(*sqe) );
+    sqe->opcode    = opcode;
+    sqe->fd        = fd;
+    sqe->off       = offset;
+    sqe->addr      = addr;
+    sqe->len       = len;
+    sqe->user_data = user_data;
+    ring.sq_array[index] = index;
+    store_release( ring.sq_tail, tail + 1 );
+
+    /* the kernel takes its own reference to the fd during submission */
+    while ((ret = io_uring_enter( ring.fd, 1, 0, 0 )) == -1 && errno == EINTR);
+    if (ret == 1) return TRUE;
+
+    /* submission failed, take the entry back */
+    ERR( "failed to submit request: %s\n", strerror(errno) );
+    store_release( ring.sq_tail, tail );
+    interlocked_xchg_add( &ring.inflight, -1 );
+    return FALSE;
+}
+
+/* called through APC_ASYNC_IO in the thread that started the I/O, once the
+ * server terminated the async because it got cancelled or its handle closed */
+static NTSTATUS uring_async_callback( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS status )
+{
+    struct uring_io *io = user;
+    LONG zero = 0;
+
+    TRACE( "%p status %08x\n", io, status );
+
+    if (!io->done)
+    {
+        RtlEnterCriticalSection( &uring_section );
+        uring_queue_sqe( IORING_OP_ASYNC_CANCEL, -1, 0, (ULONG_PTR)io, 0, 0 );
+        RtlLeaveCriticalSection( &uring_section );
+
+        /* the kernel may still write to the buffer until the request is done */
+        while (!io->done) RtlWaitOnAddress( (void *)&io->done, &zero, sizeof(zero), NULL );
+    }
+
+    status = iosb->u.Status;
+    RtlFreeHeap( GetProcessHeap(), 0, io );
+    return status;
+}
+
+static void CALLBACK uring_completion_proc( void *arg )
+{
+    for (;;)
+    {
+        unsigned int head = *ring.cq_head, tail = load_acquire( ring.cq_tail );
+
+        if (head == tail)
+        {
+            if (io_uring_enter( ring.fd, 0, 1, IORING_ENTER_GETEVENTS ) == -1 && errno != EINTR)
+                ERR( "io_uring_enter failed: %s\n", strerror(errno) );
+            continue;
+        }
+
+        while (head != tail)
+        {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            struct uring_io *io = (struct uring_io *)(ULONG_PTR)cqe->user_data;
+            int res = cqe->res;
+
+            store_release( ring.cq_head, ++head );
+            interlocked_xchg_add( &ring.inflight, -1 );
+            /* cancellation requests have no user data */
+            if (io) uring_complete( io, res );
+        }
+    }
+}
+
+/* map the rings and start the completion thread; called with uring_section held */
+static BOOL uring_init(void)
+{
+    struct io_uring_params params;
+    size_t sq_size, cq_size;
+    char *sq_ptr, *cq_ptr;
+    HANDLE thread;
+    void *sqes;
+    int fd;
+
+    memset( &params, 0, sizeof(params) );
+    if ((fd = io_uring_setup( URING_ENTRIES, &params )) == -1) return FALSE;
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    sq_ptr = mmap( NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING );
+    if (sq_ptr == MAP_FAILED) goto failed;
+    cq_ptr = mmap( NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING );
+    if (cq_ptr == MAP_FAILED) goto failed;
+    sqes = mmap( NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+    if (sqes == MAP_FAILED) goto failed;
+
+    ring.sq_head  = (unsigned int *)(sq_ptr + params.sq_off.head);
+    ring.sq_tail  = (unsigned int *)(sq_ptr + params.sq_off.tail);
+    ring.sq_mask  = (unsigned int *)(sq_ptr + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned int *)(sq_ptr + params.sq_off.array);
+    ring.sqes     = sqes;
+    ring.cq_head  = (unsigned int *)(cq_ptr + params.cq_off.head);
+    ring.cq_tail  = (unsigned int *)(cq_ptr + params.cq_off.tail);
+    ring.cq_mask  = (unsigned int *)(cq_ptr + params.cq_off.ring_mask);
+    ring.cqes     = (struct io_uring_cqe *)(cq_ptr + params.cq_off.cqes);
+    /* never queue more requests than the completion ring can hold */
+    ring.entries  = min( params.sq_entries, params.cq_entries );
+    ring.fd       = fd;
+
+    if (RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                             uring_completion_proc, NULL, &thread, NULL ))
+    {
+        ring.fd = -1;
+        goto failed;
+    }
+    NtClose( thread );
+    TRACE( "ring fd %d, %u entries\n", fd, ring.entries );
+    return TRUE;
+
+failed:
+    WARN( "failed to set up io_uring: %s\n", strerror(errno) );
+    close( fd );
+    return FALSE;
+}
+
+/***********************************************************************
+ *           uring_submit_file_io
+ *
+ * Queue an overlapped read or write on a regular file. Returns STATUS_PENDING
+ * on success; any other status means the caller should perform the I/O itself.
+ */
+NTSTATUS uring_submit_file_io( HANDLE handle, int fd, BOOL is_read, void *buffer, ULONG length,
+                               ULONGLONG offset, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                               IO_STATUS_BLOCK *iosb )
+{
+    static BOOL init_done;
+    struct uring_io *io;
+    NTSTATUS status;
+    BOOL queued;
+    int res;
+
+    RtlEnterCriticalSection( &uring_section );
+    if (!init_done)
+    {
+        init_done = TRUE;
+        uring_init();
+    }
+    RtlLeaveCriticalSection( &uring_section );
+    if (ring.fd == -1) return STATUS_NOT_SUPPORTED;
+
+    if (!(io = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*io) ))) return STATUS_NO_MEMORY;
+    io->callback     = uring_async_callback;
+    io->iov.iov_base = buffer;
+    io->iov.iov_len  = length;
+    io->is_read      = is_read;
+    io->offset       = offset;
+    io->iosb         = iosb;
+    io->done         = 0;
+
+    iosb->u.Status = STATUS_PENDING;
+    iosb->Information = 0;
+
+    SERVER_START_REQ( register_client_async )
+    {
+        req->type              = is_read ? ASYNC_TYPE_READ : ASYNC_TYPE_WRITE;
+        req->async.handle      = wine_server_obj_handle( handle );
+        req->async.user        = wine_server_client_ptr( io );
+        req->async.iosb        = wine_server_client_ptr( iosb );
+        req->async.event       = wine_server_obj_handle( event );
+        req->async.apc         = wine_server_client_ptr( apc );
+        req->async.apc_context = wine_server_client_ptr( apc_user );
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+
+    if (status)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, io );
+        return status;
+    }
+
+    RtlEnterCriticalSection( &uring_section );
+    queued = uring_queue_sqe( is_read ? IORING_OP_READV : IORING_OP_WRITEV, fd, offset,
+                              (ULONG_PTR)&io->iov, 1, (ULONG_PTR)io );
+    RtlLeaveCriticalSection( &uring_section );
+
+    if (!queued)
+    {
+        /* the async is already registered, so complete it synchronously */
+        if (is_read) res = virtual_locked_pread( fd, buffer, length, offset );
+        else res = pwrite( fd, buffer, length, offset );
+        uring_complete( io, res == -1 ? -errno : res );
+    }
+    return STATUS_PENDING;
+}
+
+#else  /* __linux__ */
+
+int do_uring(void)
+{
+    return 0;
+}
+
+NTSTATUS uring_submit_file_io( HANDLE handle, int fd, BOOL is_read, void *buffer, ULONG length,
+                               ULONGLONG offset, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                               IO_STATUS_BLOCK *iosb )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+#endif  /* __linux__ */
@@ -0,0 +1,22 @@
+/*
+ * io_uring-based asynchronous file I/O
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+extern int do_uring(void) DECLSPEC_HIDDEN;
+extern NTSTATUS uring_submit_file_io( HANDLE handle, int fd, BOOL is_read, void *buffer, ULONG length,
+                                      ULONGLONG offset, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                                      IO_STATUS_BLOCK *io ) DECLSPEC_HIDDEN;
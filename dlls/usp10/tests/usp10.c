@@ -4172,6 +4172,110 @@ static void test_script_cache_reuse(void)
     DestroyWindow(hwnd2);
 }
 
+struct shape_result
+{
+    HRESULT hr;
+    int glyph_count;
+    WORD glyphs[64];
+    WORD log_clust[64];
+    SCRIPT_VISATTR attrs[64];
+    int advances[64];
+    GOFFSET offsets[64];
+    ABC abc;
+};
+
+static void shape_and_place(HDC hdc, SCRIPT_CACHE *sc, const WCHAR *str, int len,
+                            const SCRIPT_ANALYSIS *analysis, struct shape_result *r)
+{
+    SCRIPT_ANALYSIS sa = *analysis;
+
+    memset(r, 0, sizeof(*r));
+    r->hr = ScriptShape(hdc, sc, str, len, ARRAY_SIZE(r->glyphs), &sa, r->glyphs, r->log_clust,
+                        r->attrs, &r->glyph_count);
+    if (r->hr == USP_E_SCRIPT_NOT_IN_FONT)
+    {
+        sa.eScript = SCRIPT_UNDEFINED;
+        r->hr = ScriptShape(hdc, sc, str, len, ARRAY_SIZE(r->glyphs), &sa, r->glyphs, r->log_clust,
+                            r->attrs, &r->glyph_count);
+    }
+    if (r->hr != S_OK) return;
+    r->hr = ScriptPlace(hdc, sc, r->glyphs, r->glyph_count, r->attrs, &sa, r->advances, r->offsets, &r->abc);
+}
+
+/* Shapes and places every item of a few texts, including right-to-left runs
+ * and combining marks: first when they are not in the cache yet, then from
+ * the cache, and again after they have been evicted. */
+static void shape_cache(void)
+{
+    static const WCHAR latin[] = {'T','h','e',' ','q','u','i','c','k',' ','f','o','x',0};
+    static const WCHAR arabic[] = {0x645,0x631,0x62d,0x628,0x627,' ',0x628,0x627,0x644,0x639,0x627,0x644,0x645,0};
+    static const WCHAR hebrew[] = {0x5e9,0x5dc,0x5d5,0x5dd,' ',0x5e2,0x5d5,0x5dc,0x5dd,0};
+    static const WCHAR marks[] = {'a',0x301,'e',0x308,' ','o',0x302,0x323,' ','n',0x303,0};
+    static const WCHAR devanagari[] = {0x928,0x92e,0x938,0x94d,0x924,0x947,0};
+    static const WCHAR mixed[] = {'a','b','c',' ',0x5e9,0x5dc,0x5d5,0x5dd,' ',0x645,0x631,0x62d,0x628,0x627,0};
+    static const WCHAR *const texts[] = {latin, arabic, hebrew, marks, devanagari, mixed};
+    struct shape_result first, cached, evicted, filler;
+    SCRIPT_ITEM items[16];
+    SCRIPT_CACHE sc = NULL;
+    WCHAR other[8];
+    HFONT font, old_font;
+    int i, j, k, len, nitems;
+    LOGFONTA lf;
+    HRESULT hr;
+    HDC hdc;
+
+    hdc = CreateCompatibleDC(NULL);
+    memset(&lf, 0, sizeof(lf));
+    lstrcpyA(lf.lfFaceName, "Tahoma");
+    lf.lfHeight = -16;
+    font = CreateFontIndirectA(&lf);
+    old_font = SelectObject(hdc, font);
+
+    for (i = 0; i < ARRAY_SIZE(texts); i++)
+    {
+        len = lstrlenW(texts[i]);
+        hr = ScriptItemize(texts[i], len, ARRAY_SIZE(items) - 1, NULL, NULL, items, &nitems);
+        ok(hr == S_OK, "text %d: ScriptItemize failed, hr %#x.\n", i, hr);
+        if (hr != S_OK) continue;
+
+        for (j = 0; j < nitems; j++)
+        {
+            const WCHAR *str = texts[i] + items[j].iCharPos;
+            int count = items[j + 1].iCharPos - items[j].iCharPos;
+
+            shape_and_place(hdc, &sc, str, count, &items[j].a, &first);
+            shape_and_place(hdc, &sc, str, count, &items[j].a, &cached);
+            ok(!memcmp(&first, &cached, sizeof(first)), "text %d, item %d: cached results differ.\n", i, j);
+
+            /* push the run out of the cache */
+            for (k = 0; k < 64; k++)
+            {
+                other[0] = 'A' + k % 26;
+                other[1] = 'a' + k / 26;
+                other[2] = 'x';
+                shape_and_place(hdc, &sc, other, 3, &items[0].a, &filler);
+            }
+            shape_and_place(hdc, &sc, str, count, &items[j].a, &evicted);
+            ok(!memcmp(&first, &evicted, sizeof(first)), "text %d, item %d: results differ after eviction.\n",
+               i, j);
+        }
+    }
+
+    ScriptFreeCache(&sc);
+    SelectObject(hdc, old_font);
+    DeleteObject(font);
+    DeleteDC(hdc);
+}
+
+static void test_shape_cache(void)
+{
+    shape_cache();
+
+    /* the cache is disabled by default, and its size is only read once */
+    if (!winetest_run_wine_child("shape_cache", "WINESHAPECACHESIZE", "16"))
+        skip("The shape cache is only implemented in Wine.\n");
+}
+
 static void init_tests(void)
 {
     HMODULE module = GetModuleHandleA("usp10.dll");
@@ -4193,6 +4297,13 @@ START_TEST(usp10)
     HFONT           hfont;
 
     unsigned short  pwOutGlyphs[256];
+    char          **argv;
+
+    if (winetest_get_mainargs(&argv) >= 3 && !strcmp(argv[2], "shape_cache"))
+    {
+        shape_cache();
+        return;
+    }
 
     /* We need a valid HDC to drive a lot of Script functions which requires the following    *
      * to set up for the tests.                                                               */
@@ -4246,6 +4357,7 @@ START_TEST(usp10)
 
     test_ScriptIsComplex();
     test_script_cache_reuse();
+    test_shape_cache();
 
     ReleaseDC(hwnd, hdc);
     DestroyWindow(hwnd);
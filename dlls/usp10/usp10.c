@@ -913,6 +913,7 @@ static HRESULT init_script_cache(const HDC hdc, SCRIPT_CACHE *psc)
     }
     sc->lf = lf;
     sc->refcount = 1;
+    list_init(&sc->shape_cache);
     *psc = sc;
 
     EnterCriticalSection(&cs_script_cache);
@@ -935,6 +936,185 @@ static HRESULT init_script_cache(const HDC hdc, SCRIPT_CACHE *psc)
     return S_OK;
 }
 
+/* Results of ScriptShape and ScriptPlace, kept per font in most recently used
+ * order. The cache is opt-in: the WINESHAPECACHESIZE environment variable or
+ * HKCU\Software\Wine\Uniscribe\ShapeCacheSize gives the number of runs to
+ * keep for each font. It is protected by cs_script_cache. */
+typedef struct {
+    struct list entry;
+    DWORD hash;
+    BOOL place;
+    OPENTYPE_TAG script;
+    OPENTYPE_TAG lang;
+    SCRIPT_ANALYSIS sa;
+    int count;          /* characters when shaping, glyphs when placing */
+    int glyph_count;
+    ABC abc;
+    int *advances;
+    GOFFSET *offsets;
+    SCRIPT_GLYPHPROP *glyph_props;
+    SCRIPT_CHARPROP *char_props;
+    WORD *glyphs;
+    WORD *log_clust;
+    WCHAR *chars;
+} ShapeCacheEntry;
+
+static unsigned int get_shape_cache_size(void)
+{
+    static LONG cache_size = -1;
+    DWORD size = 0, type, count = sizeof(size);
+    const char *env;
+    HKEY hkey;
+
+    if (cache_size != -1) return cache_size;
+
+    if ((env = getenv("WINESHAPECACHESIZE")) && *env)
+        size = atoi(env);
+    else if (!RegOpenKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Uniscribe", &hkey))
+    {
+        if (RegQueryValueExA(hkey, "ShapeCacheSize", 0, &type, (BYTE *)&size, &count) || type != REG_DWORD)
+            size = 0;
+        RegCloseKey(hkey);
+    }
+    TRACE("keeping %u shaped runs per font\n", size);
+    InterlockedExchange(&cache_size, size);
+    return size;
+}
+
+static DWORD hash_shape_data(DWORD hash, const void *data, unsigned int size)
+{
+    const BYTE *ptr = data;
+
+    while (size--) hash = (hash ^ *ptr++) * 0x01000193;
+    return hash;
+}
+
+static DWORD hash_shape_key(OPENTYPE_TAG script, OPENTYPE_TAG lang, const SCRIPT_ANALYSIS *sa,
+                            const void *key, unsigned int size)
+{
+    DWORD hash = 0x811c9dc5;
+
+    hash = hash_shape_data(hash, &script, sizeof(script));
+    hash = hash_shape_data(hash, &lang, sizeof(lang));
+    hash = hash_shape_data(hash, sa, sizeof(*sa));
+    return hash_shape_data(hash, key, size);
+}
+
+static ShapeCacheEntry *alloc_shape_entry(BOOL place, int count, int glyph_count)
+{
+    ShapeCacheEntry *entry;
+    SIZE_T size = sizeof(*entry);
+    char *ptr;
+
+    if (place)
+        size += count * (sizeof(int) + sizeof(GOFFSET) + sizeof(SCRIPT_GLYPHPROP) + sizeof(WORD));
+    else
+        size += glyph_count * (sizeof(SCRIPT_GLYPHPROP) + sizeof(WORD)) +
+                count * (sizeof(SCRIPT_CHARPROP) + 2 * sizeof(WORD));
+    if (!(entry = heap_alloc_zero(size))) return NULL;
+
+    entry->place = place;
+    entry->count = count;
+    entry->glyph_count = glyph_count;
+    ptr = (char *)(entry + 1);
+    if (place)
+    {
+        entry->advances = (int *)ptr;
+        ptr += count * sizeof(int);
+        entry->offsets = (GOFFSET *)ptr;
+        ptr += count * sizeof(GOFFSET);
+    }
+    entry->glyph_props = (SCRIPT_GLYPHPROP *)ptr;
+    ptr += glyph_count * sizeof(SCRIPT_GLYPHPROP);
+    if (!place)
+    {
+        entry->char_props = (SCRIPT_CHARPROP *)ptr;
+        ptr += count * sizeof(SCRIPT_CHARPROP);
+    }
+    entry->glyphs = (WORD *)ptr;
+    ptr += glyph_count * sizeof(WORD);
+    if (!place)
+    {
+        entry->log_clust = (WORD *)ptr;
+        ptr += count * sizeof(WORD);
+        entry->chars = (WCHAR *)ptr;
+    }
+    return entry;
+}
+
+static void add_shape_entry(ScriptCache *sc, ShapeCacheEntry *entry)
+{
+    unsigned int size = get_shape_cache_size();
+    struct list *ptr;
+
+    EnterCriticalSection(&cs_script_cache);
+    list_add_head(&sc->shape_cache, &entry->entry);
+    for (sc->shape_cache_count++; sc->shape_cache_count > size; sc->shape_cache_count--)
+    {
+        ptr = list_tail(&sc->shape_cache);
+        list_remove(ptr);
+        heap_free(LIST_ENTRY(ptr, ShapeCacheEntry, entry));
+    }
+    LeaveCriticalSection(&cs_script_cache);
+}
+
+static BOOL get_cached_shape(ScriptCache *sc, DWORD hash, OPENTYPE_TAG script, OPENTYPE_TAG lang,
+                             const SCRIPT_ANALYSIS *sa, const WCHAR *chars, int count, int max_glyphs,
+                             WORD *log_clust, SCRIPT_CHARPROP *char_props, WORD *glyphs,
+                             SCRIPT_GLYPHPROP *glyph_props, int *glyph_count)
+{
+    ShapeCacheEntry *entry;
+
+    EnterCriticalSection(&cs_script_cache);
+    LIST_FOR_EACH_ENTRY(entry, &sc->shape_cache, ShapeCacheEntry, entry)
+    {
+        if (entry->hash != hash || entry->place || entry->count != count ||
+            entry->script != script || entry->lang != lang ||
+            memcmp(&entry->sa, sa, sizeof(*sa)) || memcmp(entry->chars, chars, count * sizeof(*chars)))
+            continue;
+        if (entry->glyph_count > max_glyphs) break;
+
+        memcpy(log_clust, entry->log_clust, count * sizeof(*log_clust));
+        memcpy(char_props, entry->char_props, count * sizeof(*char_props));
+        memcpy(glyphs, entry->glyphs, entry->glyph_count * sizeof(*glyphs));
+        memcpy(glyph_props, entry->glyph_props, entry->glyph_count * sizeof(*glyph_props));
+        *glyph_count = entry->glyph_count;
+        list_remove(&entry->entry);
+        list_add_head(&sc->shape_cache, &entry->entry);
+        LeaveCriticalSection(&cs_script_cache);
+        return TRUE;
+    }
+    LeaveCriticalSection(&cs_script_cache);
+    return FALSE;
+}
+
+static BOOL get_cached_place(ScriptCache *sc, DWORD hash, OPENTYPE_TAG script, OPENTYPE_TAG lang,
+                             const SCRIPT_ANALYSIS *sa, const WORD *glyphs, const SCRIPT_GLYPHPROP *glyph_props,
+                             int count, int *advances, GOFFSET *offsets, ABC *abc)
+{
+    ShapeCacheEntry *entry;
+
+    EnterCriticalSection(&cs_script_cache);
+    LIST_FOR_EACH_ENTRY(entry, &sc->shape_cache, ShapeCacheEntry, entry)
+    {
+        if (entry->hash != hash || !entry->place || entry->count != count ||
+            entry->script != script || entry->lang != lang ||
+            memcmp(&entry->sa, sa, sizeof(*sa)) || memcmp(entry->glyphs, glyphs, count * sizeof(*glyphs)) ||
+            memcmp(entry->glyph_props, glyph_props, count * sizeof(*glyph_props)))
+            continue;
+
+        memcpy(advances, entry->advances, count * sizeof(*advances));
+        memcpy(offsets, entry->offsets, count * sizeof(*offsets));
+        if (abc) *abc = entry->abc;
+        list_remove(&entry->entry);
+        list_add_head(&sc->shape_cache, &entry->entry);
+        LeaveCriticalSection(&cs_script_cache);
+        return TRUE;
+    }
+    LeaveCriticalSection(&cs_script_cache);
+    return FALSE;
+}
+
 static WCHAR mirror_char( WCHAR ch )
 {
     extern const WCHAR wine_mirror_map[] DECLSPEC_HIDDEN;
@@ -1081,6 +1261,7 @@ HRESULT WINAPI ScriptFreeCache(SCRIPT_CACHE *psc)
 
     if (psc && *psc)
     {
+        ShapeCacheEntry *shape, *next_shape;
         unsigned int i;
         INT n;
 
@@ -1094,6 +1275,9 @@ HRESULT WINAPI ScriptFreeCache(SCRIPT_CACHE *psc)
         list_remove(&((ScriptCache *)*psc)->entry);
         LeaveCriticalSection(&cs_script_cache);
 
+        LIST_FOR_EACH_ENTRY_SAFE(shape, next_shape, &((ScriptCache *)*psc)->shape_cache, ShapeCacheEntry, entry)
+            heap_free(shape);
+
         for (i = 0; i < GLYPH_MAX / GLYPH_BLOCK_SIZE; i++)
         {
             heap_free(((ScriptCache *)*psc)->widths[i]);
@@ -3092,41 +3276,14 @@ HRESULT WINAPI ScriptIsComplex(const WCHAR *chars, int len, DWORD flag)
     return S_FALSE;
 }
 
-/***********************************************************************
- *      ScriptShapeOpenType (USP10.@)
- *
- * Produce glyphs and visual attributes for a run.
- *
- * PARAMS
- *  hdc         [I]   Device context.
- *  psc         [I/O] Opaque pointer to a script cache.
- *  psa         [I/O] Script analysis.
- *  tagScript   [I]   The OpenType tag for the Script
- *  tagLangSys  [I]   The OpenType tag for the Language
- *  rcRangeChars[I]   Array of Character counts in each range
- *  rpRangeProperties [I] Array of TEXTRANGE_PROPERTIES structures
- *  cRanges     [I]   Count of ranges
- *  pwcChars    [I]   Array of characters specifying the run.
- *  cChars      [I]   Number of characters in pwcChars.
- *  cMaxGlyphs  [I]   Length of pwOutGlyphs.
- *  pwLogClust  [O]   Array of logical cluster info.
- *  pCharProps  [O]   Array of character property values
- *  pwOutGlyphs [O]   Array of glyphs.
- *  pOutGlyphProps [O]  Array of attributes for the retrieved glyphs
- *  pcGlyphs    [O]   Number of glyphs returned.
- *
- * RETURNS
- *  Success: S_OK
- *  Failure: Non-zero HRESULT value.
- */
-HRESULT WINAPI ScriptShapeOpenType( HDC hdc, SCRIPT_CACHE *psc,
-                                    SCRIPT_ANALYSIS *psa, OPENTYPE_TAG tagScript,
-                                    OPENTYPE_TAG tagLangSys, int *rcRangeChars,
-                                    TEXTRANGE_PROPERTIES **rpRangeProperties,
-                                    int cRanges, const WCHAR *pwcChars, int cChars,
-                                    int cMaxGlyphs, WORD *pwLogClust,
-                                    SCRIPT_CHARPROP *pCharProps, WORD *pwOutGlyphs,
-                                    SCRIPT_GLYPHPROP *pOutGlyphProps, int *pcGlyphs)
+static HRESULT shape_run( HDC hdc, SCRIPT_CACHE *psc,
+                          SCRIPT_ANALYSIS *psa, OPENTYPE_TAG tagScript,
+                          OPENTYPE_TAG tagLangSys, int *rcRangeChars,
+                          TEXTRANGE_PROPERTIES **rpRangeProperties,
+                          int cRanges, const WCHAR *pwcChars, int cChars,
+                          int cMaxGlyphs, WORD *pwLogClust,
+                          SCRIPT_CHARPROP *pCharProps, WORD *pwOutGlyphs,
+                          SCRIPT_GLYPHPROP *pOutGlyphProps, int *pcGlyphs)
 {
     HRESULT hr;
     int i;
@@ -3294,6 +3451,84 @@ HRESULT WINAPI ScriptShapeOpenType( HDC hdc, SCRIPT_CACHE *psc,
     return S_OK;
 }
 
+/***********************************************************************
+ *      ScriptShapeOpenType (USP10.@)
+ *
+ * Produce glyphs and visual attributes for a run.
+ *
+ * PARAMS
+ *  hdc         [I]   Device context.
+ *  psc         [I/O] Opaque pointer to a script cache.
+ *  psa         [I/O] Script analysis.
+ *  tagScript   [I]   The OpenType tag for the Script
+ *  tagLangSys  [I]   The OpenType tag for the Language
+ *  rcRangeChars[I]   Array of Character counts in each range
+ *  rpRangeProperties [I] Array of TEXTRANGE_PROPERTIES structures
+ *  cRanges     [I]   Count of ranges
+ *  pwcChars    [I]   Array of characters specifying the run.
+ *  cChars      [I]   Number of characters in pwcChars.
+ *  cMaxGlyphs  [I]   Length of pwOutGlyphs.
+ *  pwLogClust  [O]   Array of logical cluster info.
+ *  pCharProps  [O]   Array of character property values
+ *  pwOutGlyphs [O]   Array of glyphs.
+ *  pOutGlyphProps [O]  Array of attributes for the retrieved glyphs
+ *  pcGlyphs    [O]   Number of glyphs returned.
+ *
+ * RETURNS
+ *  Success: S_OK
+ *  Failure: Non-zero HRESULT value.
+ */
+HRESULT WINAPI ScriptShapeOpenType( HDC hdc, SCRIPT_CACHE *psc,
+                                    SCRIPT_ANALYSIS *psa, OPENTYPE_TAG tagScript,
+                                    OPENTYPE_TAG tagLangSys, int *rcRangeChars,
+                                    TEXTRANGE_PROPERTIES **rpRangeProperties,
+                                    int cRanges, const WCHAR *pwcChars, int cChars,
+                                    int cMaxGlyphs, WORD *pwLogClust,
+                                    SCRIPT_CHARPROP *pCharProps, WORD *pwOutGlyphs,
+                                    SCRIPT_GLYPHPROP *pOutGlyphProps, int *pcGlyphs)
+{
+    ShapeCacheEntry *entry;
+    ScriptCache *sc;
+    DWORD hash;
+    HRESULT hr;
+
+    /* only runs going through the OpenType shaping engine are worth caching */
+    if (!get_shape_cache_size() || !psa || psa->fNoGlyphIndex || cRanges || cChars <= 0 ||
+        cChars > cMaxGlyphs || !pwLogClust || !pCharProps || !pOutGlyphProps || !pcGlyphs ||
+        init_script_cache(hdc, psc) != S_OK || !((ScriptCache *)*psc)->sfnt)
+        return shape_run(hdc, psc, psa, tagScript, tagLangSys, rcRangeChars, rpRangeProperties, cRanges,
+                         pwcChars, cChars, cMaxGlyphs, pwLogClust, pCharProps, pwOutGlyphs,
+                         pOutGlyphProps, pcGlyphs);
+
+    sc = *psc;
+    hash = hash_shape_key(tagScript, tagLangSys, psa, pwcChars, cChars * sizeof(*pwcChars));
+    if (get_cached_shape(sc, hash, tagScript, tagLangSys, psa, pwcChars, cChars, cMaxGlyphs,
+                         pwLogClust, pCharProps, pwOutGlyphs, pOutGlyphProps, pcGlyphs))
+    {
+        TRACE("cached run %s, %d glyphs\n", debugstr_wn(pwcChars, cChars), *pcGlyphs);
+        sc->userScript = tagScript;
+        sc->userLang = tagLangSys;
+        return S_OK;
+    }
+
+    hr = shape_run(hdc, psc, psa, tagScript, tagLangSys, rcRangeChars, rpRangeProperties, cRanges,
+                   pwcChars, cChars, cMaxGlyphs, pwLogClust, pCharProps, pwOutGlyphs,
+                   pOutGlyphProps, pcGlyphs);
+    if (hr != S_OK || !(entry = alloc_shape_entry(FALSE, cChars, *pcGlyphs))) return hr;
+
+    entry->hash = hash;
+    entry->script = tagScript;
+    entry->lang = tagLangSys;
+    entry->sa = *psa;
+    memcpy(entry->chars, pwcChars, cChars * sizeof(*pwcChars));
+    memcpy(entry->log_clust, pwLogClust, cChars * sizeof(*pwLogClust));
+    memcpy(entry->char_props, pCharProps, cChars * sizeof(*pCharProps));
+    memcpy(entry->glyphs, pwOutGlyphs, *pcGlyphs * sizeof(*pwOutGlyphs));
+    memcpy(entry->glyph_props, pOutGlyphProps, *pcGlyphs * sizeof(*pOutGlyphProps));
+    add_shape_entry(sc, entry);
+    return hr;
+}
+
 
 /***********************************************************************
  *      ScriptShape (USP10.@)
@@ -3352,45 +3587,14 @@ HRESULT WINAPI ScriptShape(HDC hdc, SCRIPT_CACHE *psc, const WCHAR *pwcChars,
     return hr;
 }
 
-/***********************************************************************
- *      ScriptPlaceOpenType (USP10.@)
- *
- * Produce advance widths for a run.
- *
- * PARAMS
- *  hdc       [I]   Device context.
- *  psc       [I/O] Opaque pointer to a script cache.
- *  psa       [I/O] Script analysis.
- *  tagScript   [I]   The OpenType tag for the Script
- *  tagLangSys  [I]   The OpenType tag for the Language
- *  rcRangeChars[I]   Array of Character counts in each range
- *  rpRangeProperties [I] Array of TEXTRANGE_PROPERTIES structures
- *  cRanges     [I]   Count of ranges
- *  pwcChars    [I]   Array of characters specifying the run.
- *  pwLogClust  [I]   Array of logical cluster info
- *  pCharProps  [I]   Array of character property values
- *  cChars      [I]   Number of characters in pwcChars.
- *  pwGlyphs  [I]   Array of glyphs.
- *  pGlyphProps [I]  Array of attributes for the retrieved glyphs
- *  cGlyphs [I] Count of Glyphs
- *  piAdvance [O]   Array of advance widths.
- *  pGoffset  [O]   Glyph offsets.
- *  pABC      [O]   Combined ABC width.
- *
- * RETURNS
- *  Success: S_OK
- *  Failure: Non-zero HRESULT value.
- */
-
-HRESULT WINAPI ScriptPlaceOpenType( HDC hdc, SCRIPT_CACHE *psc, SCRIPT_ANALYSIS *psa,
-                                    OPENTYPE_TAG tagScript, OPENTYPE_TAG tagLangSys,
-                                    int *rcRangeChars, TEXTRANGE_PROPERTIES **rpRangeProperties,
-                                    int cRanges, const WCHAR *pwcChars, WORD *pwLogClust,
-                                    SCRIPT_CHARPROP *pCharProps, int cChars,
-                                    const WORD *pwGlyphs, const SCRIPT_GLYPHPROP *pGlyphProps,
-                                    int cGlyphs, int *piAdvance,
-                                    GOFFSET *pGoffset, ABC *pABC
-)
+static HRESULT place_run( HDC hdc, SCRIPT_CACHE *psc, SCRIPT_ANALYSIS *psa,
+                          OPENTYPE_TAG tagScript, OPENTYPE_TAG tagLangSys,
+                          int *rcRangeChars, TEXTRANGE_PROPERTIES **rpRangeProperties,
+                          int cRanges, const WCHAR *pwcChars, WORD *pwLogClust,
+                          SCRIPT_CHARPROP *pCharProps, int cChars,
+                          const WORD *pwGlyphs, const SCRIPT_GLYPHPROP *pGlyphProps,
+                          int cGlyphs, int *piAdvance,
+                          GOFFSET *pGoffset, ABC *pABC )
 {
     HRESULT hr;
     int i;
@@ -3485,6 +3689,88 @@ HRESULT WINAPI ScriptPlaceOpenType( HDC hdc, SCRIPT_CACHE *psc, SCRIPT_ANALYSIS
     return S_OK;
 }
 
+/***********************************************************************
+ *      ScriptPlaceOpenType (USP10.@)
+ *
+ * Produce advance widths for a run.
+ *
+ * PARAMS
+ *  hdc       [I]   Device context.
+ *  psc       [I/O] Opaque pointer to a script cache.
+ *  psa       [I/O] Script analysis.
+ *  tagScript   [I]   The OpenType tag for the Script
+ *  tagLangSys  [I]   The OpenType tag for the Language
+ *  rcRangeChars[I]   Array of Character counts in each range
+ *  rpRangeProperties [I] Array of TEXTRANGE_PROPERTIES structures
+ *  cRanges     [I]   Count of ranges
+ *  pwcChars    [I]   Array of characters specifying the run.
+ *  pwLogClust  [I]   Array of logical cluster info
+ *  pCharProps  [I]   Array of character property values
+ *  cChars      [I]   Number of characters in pwcChars.
+ *  pwGlyphs  [I]   Array of glyphs.
+ *  pGlyphProps [I]  Array of attributes for the retrieved glyphs
+ *  cGlyphs [I] Count of Glyphs
+ *  piAdvance [O]   Array of advance widths.
+ *  pGoffset  [O]   Glyph offsets.
+ *  pABC      [O]   Combined ABC width.
+ *
+ * RETURNS
+ *  Success: S_OK
+ *  Failure: Non-zero HRESULT value.
+ */
+
+HRESULT WINAPI ScriptPlaceOpenType( HDC hdc, SCRIPT_CACHE *psc, SCRIPT_ANALYSIS *psa,
+                                    OPENTYPE_TAG tagScript, OPENTYPE_TAG tagLangSys,
+                                    int *rcRangeChars, TEXTRANGE_PROPERTIES **rpRangeProperties,
+                                    int cRanges, const WCHAR *pwcChars, WORD *pwLogClust,
+                                    SCRIPT_CHARPROP *pCharProps, int cChars,
+                                    const WORD *pwGlyphs, const SCRIPT_GLYPHPROP *pGlyphProps,
+                                    int cGlyphs, int *piAdvance,
+                                    GOFFSET *pGoffset, ABC *pABC )
+{
+    ShapeCacheEntry *entry;
+    ScriptCache *sc;
+    DWORD hash;
+    HRESULT hr;
+    ABC abc;
+
+    if (!get_shape_cache_size() || !psa || psa->fNoGlyphIndex || cRanges || cGlyphs <= 0 ||
+        !pGlyphProps || !piAdvance || !pGoffset ||
+        init_script_cache(hdc, psc) != S_OK || !((ScriptCache *)*psc)->sfnt)
+        return place_run(hdc, psc, psa, tagScript, tagLangSys, rcRangeChars, rpRangeProperties, cRanges,
+                         pwcChars, pwLogClust, pCharProps, cChars, pwGlyphs, pGlyphProps, cGlyphs,
+                         piAdvance, pGoffset, pABC);
+
+    sc = *psc;
+    hash = hash_shape_key(tagScript, tagLangSys, psa, pwGlyphs, cGlyphs * sizeof(*pwGlyphs));
+    if (get_cached_place(sc, hash, tagScript, tagLangSys, psa, pwGlyphs, pGlyphProps, cGlyphs,
+                         piAdvance, pGoffset, pABC))
+    {
+        TRACE("cached placement of %d glyphs\n", cGlyphs);
+        sc->userScript = tagScript;
+        sc->userLang = tagLangSys;
+        return S_OK;
+    }
+
+    hr = place_run(hdc, psc, psa, tagScript, tagLangSys, rcRangeChars, rpRangeProperties, cRanges,
+                   pwcChars, pwLogClust, pCharProps, cChars, pwGlyphs, pGlyphProps, cGlyphs,
+                   piAdvance, pGoffset, &abc);
+    if (pABC) *pABC = abc;
+    if (hr != S_OK || !(entry = alloc_shape_entry(TRUE, cGlyphs, cGlyphs))) return hr;
+
+    entry->hash = hash;
+    entry->script = tagScript;
+    entry->lang = tagLangSys;
+    entry->sa = *psa;
+    entry->abc = abc;
+    memcpy(entry->glyphs, pwGlyphs, cGlyphs * sizeof(*pwGlyphs));
+    memcpy(entry->glyph_props, pGlyphProps, cGlyphs * sizeof(*pGlyphProps));
+    memcpy(entry->advances, piAdvance, cGlyphs * sizeof(*piAdvance));
+    memcpy(entry->offsets, pGoffset, cGlyphs * sizeof(*pGoffset));
+    add_shape_entry(sc, entry);
+    return hr;
+}
+
 /***********************************************************************
  *      ScriptPlace (USP10.@)
  *
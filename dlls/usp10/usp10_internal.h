@@ -207,6 +207,9 @@ typedef struct {
 
     OPENTYPE_TAG userScript;
     OPENTYPE_TAG userLang;
+
+    struct list shape_cache;
+    unsigned int shape_cache_count;
 } ScriptCache;
 
 typedef struct _scriptData
@@ -28,12 +28,14 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 #define WINED3D_BUFFER_HASDESC      0x01    /* A vertex description has been found. */
 #define WINED3D_BUFFER_USE_BO       0x02    /* Use a buffer object for this buffer. */
 #define WINED3D_BUFFER_PIN_SYSMEM   0x04    /* Keep a system memory copy for this buffer. */
 #define WINED3D_BUFFER_DISCARD      0x08    /* A DISCARD lock has occurred since the last preload. */
 #define WINED3D_BUFFER_APPLESYNC    0x10    /* Using sync as in GL_APPLE_flush_buffer_range. */
+#define WINED3D_BUFFER_STREAMING    0x20    /* Persistently mapped, renamed on DISCARD maps. */
 
 #define VB_MAXDECLCHANGES     100     /* After that number of decl changes we stop converting */
 #define VB_RESETDECLCHANGE    1000    /* Reset the decl changecount after that number of draws */
@@ -140,6 +142,28 @@ static void wined3d_buffer_gl_bind(struct wined3d_buffer_gl *buffer_gl, struct w
     wined3d_context_gl_bind_bo(context_gl, buffer_gl->buffer_type_hint, buffer_gl->buffer_object);
 }
 
+static void wined3d_buffer_invalidate_bindings(struct wined3d_buffer *buffer)
+{
+    struct wined3d_resource *resource = &buffer->resource;
+
+    if (!resource->bind_count)
+        return;
+
+    if (resource->bind_flags & WINED3D_BIND_VERTEX_BUFFER)
+        device_invalidate_state(resource->device, STATE_STREAMSRC);
+    if (resource->bind_flags & WINED3D_BIND_INDEX_BUFFER)
+        device_invalidate_state(resource->device, STATE_INDEXBUFFER);
+    if (resource->bind_flags & WINED3D_BIND_CONSTANT_BUFFER)
+    {
+        device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_VERTEX));
+        device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_HULL));
+        device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_DOMAIN));
+        device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_GEOMETRY));
+        device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_PIXEL));
+        device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_COMPUTE));
+    }
+}
+
 /* Context activation is done by the caller. */
 static void wined3d_buffer_gl_destroy_buffer_object(struct wined3d_buffer_gl *buffer_gl,
         struct wined3d_context *context)
@@ -147,6 +171,7 @@ static void wined3d_buffer_gl_destroy_buffer_object(struct wined3d_buffer_gl *bu
     struct wined3d_context_gl *context_gl = wined3d_context_gl(context);
     struct wined3d_resource *resource = &buffer_gl->b.resource;
     const struct wined3d_gl_info *gl_info = context->gl_info;
+    unsigned int i;
 
     if (!buffer_gl->buffer_object)
         return;
@@ -156,37 +181,40 @@ static void wined3d_buffer_gl_destroy_buffer_object(struct wined3d_buffer_gl *bu
      * valid any longer. Dirtify the stream source to force a reload. This
      * happens only once per changed vertexbuffer and should occur rather
      * rarely. */
-    if (resource->bind_count)
+    wined3d_buffer_invalidate_bindings(&buffer_gl->b);
+    if (resource->bind_count && (resource->bind_flags & WINED3D_BIND_STREAM_OUTPUT))
     {
-        if (resource->bind_flags & WINED3D_BIND_VERTEX_BUFFER)
-            device_invalidate_state(resource->device, STATE_STREAMSRC);
-        if (resource->bind_flags & WINED3D_BIND_INDEX_BUFFER)
-            device_invalidate_state(resource->device, STATE_INDEXBUFFER);
-        if (resource->bind_flags & WINED3D_BIND_CONSTANT_BUFFER)
+        device_invalidate_state(resource->device, STATE_STREAM_OUTPUT);
+        if (context->transform_feedback_active)
         {
-            device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_VERTEX));
-            device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_HULL));
-            device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_DOMAIN));
-            device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_GEOMETRY));
-            device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_PIXEL));
-            device_invalidate_state(resource->device, STATE_CONSTANT_BUFFER(WINED3D_SHADER_TYPE_COMPUTE));
+            /* We have to make sure that transform feedback is not active
+             * when deleting a potentially bound transform feedback buffer.
+             * This may happen when the device is being destroyed. */
+            WARN("Deleting buffer object for buffer %p, disabling transform feedback.\n", buffer_gl);
+            wined3d_context_gl_end_transform_feedback(context_gl);
         }
-        if (resource->bind_flags & WINED3D_BIND_STREAM_OUTPUT)
+    }
+
+    if (buffer_gl->b.flags & WINED3D_BUFFER_STREAMING)
+    {
+        for (i = 0; i < buffer_gl->stream_bo_count; ++i)
         {
-            device_invalidate_state(resource->device, STATE_STREAM_OUTPUT);
-            if (context->transform_feedback_active)
-            {
-                /* We have to make sure that transform feedback is not active
-                 * when deleting a potentially bound transform feedback buffer.
-                 * This may happen when the device is being destroyed. */
-                WARN("Deleting buffer object for buffer %p, disabling transform feedback.\n", buffer_gl);
-                wined3d_context_gl_end_transform_feedback(context_gl);
-            }
+            struct wined3d_buffer_gl_stream_bo *bo = &buffer_gl->stream_bos[i];
+
+            GL_EXTCALL(glDeleteBuffers(1, &bo->id));
+            if (bo->fence)
+                wined3d_fence_destroy(bo->fence);
+            memset(bo, 0, sizeof(*bo));
         }
+        checkGLcall("glDeleteBuffers");
+        buffer_gl->stream_bo_count = 0;
+        buffer_gl->stream_bo_idx = 0;
+    }
+    else
+    {
+        GL_EXTCALL(glDeleteBuffers(1, &buffer_gl->buffer_object));
+        checkGLcall("glDeleteBuffers");
     }
-
-    GL_EXTCALL(glDeleteBuffers(1, &buffer_gl->buffer_object));
-    checkGLcall("glDeleteBuffers");
     buffer_gl->buffer_object = 0;
 
     if (buffer_gl->b.fence)
@@ -194,7 +222,104 @@ static void wined3d_buffer_gl_destroy_buffer_object(struct wined3d_buffer_gl *bu
         wined3d_fence_destroy(buffer_gl->b.fence);
         buffer_gl->b.fence = NULL;
     }
-    buffer_gl->b.flags &= ~WINED3D_BUFFER_APPLESYNC;
+    buffer_gl->b.flags &= ~(WINED3D_BUFFER_APPLESYNC | WINED3D_BUFFER_STREAMING);
+}
+
+static BOOL wined3d_buffer_gl_use_streaming(const struct wined3d_buffer_gl *buffer_gl,
+        const struct wined3d_gl_info *gl_info)
+{
+    const struct wined3d_resource *resource = &buffer_gl->b.resource;
+
+    if (!(resource->usage & WINED3DUSAGE_DYNAMIC))
+        return FALSE;
+
+    /* Views and stream output bindings reference the buffer object
+     * directly, so those can't be renamed behind their back. */
+    if (resource->bind_flags & ~(WINED3D_BIND_VERTEX_BUFFER | WINED3D_BIND_INDEX_BUFFER
+            | WINED3D_BIND_CONSTANT_BUFFER))
+        return FALSE;
+
+    return gl_info->supported[ARB_BUFFER_STORAGE] && gl_info->supported[ARB_MAP_BUFFER_RANGE]
+            && gl_info->supported[ARB_SYNC] && gl_info->supported[ARB_COPY_BUFFER];
+}
+
+/* Context activation is done by the caller. */
+static BOOL wined3d_buffer_gl_create_stream_bo(struct wined3d_buffer_gl *buffer_gl,
+        struct wined3d_context *context, struct wined3d_buffer_gl_stream_bo *bo)
+{
+    static const GLbitfield map_flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT
+            | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    struct wined3d_context_gl *context_gl = wined3d_context_gl(context);
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    GLenum binding = buffer_gl->buffer_type_hint;
+    GLsizeiptr size = buffer_gl->b.resource.size;
+
+    GL_EXTCALL(glGenBuffers(1, &bo->id));
+    wined3d_context_gl_bind_bo(context_gl, binding, bo->id);
+    GL_EXTCALL(glBufferStorage(binding, size, NULL, map_flags | GL_DYNAMIC_STORAGE_BIT));
+    bo->ptr = GL_EXTCALL(glMapBufferRange(binding, 0, size, map_flags));
+    checkGLcall("create stream buffer object");
+
+    if (!bo->ptr || ((DWORD_PTR)bo->ptr & (RESOURCE_ALIGNMENT - 1)))
+    {
+        WARN("Failed to map stream buffer object, pointer %p.\n", bo->ptr);
+        GL_EXTCALL(glDeleteBuffers(1, &bo->id));
+        memset(bo, 0, sizeof(*bo));
+        return FALSE;
+    }
+    bo->fence = NULL;
+
+    TRACE("Created stream buffer object %u for buffer %p, pointer %p.\n", bo->id, buffer_gl, bo->ptr);
+
+    return TRUE;
+}
+
+/* Switch to a copy of the buffer storage the GPU is no longer using. Only
+ * when all copies are busy and we can't create another one do we have to
+ * wait for the oldest. Context activation is done by the caller. */
+static void wined3d_buffer_gl_rename(struct wined3d_buffer_gl *buffer_gl, struct wined3d_context *context)
+{
+    struct wined3d_buffer_gl_stream_bo *bo = &buffer_gl->stream_bos[buffer_gl->stream_bo_idx];
+    struct wined3d_device *device = buffer_gl->b.resource.device;
+    unsigned int i, idx;
+    HRESULT hr;
+
+    if (!bo->fence && FAILED(hr = wined3d_fence_create(device, &bo->fence)))
+    {
+        ERR("Failed to create fence, hr %#x.\n", hr);
+        context->gl_info->gl_ops.gl.p_glFinish();
+        return;
+    }
+    wined3d_fence_issue(bo->fence, device);
+
+    for (i = 1; i < buffer_gl->stream_bo_count; ++i)
+    {
+        idx = (buffer_gl->stream_bo_idx + i) % buffer_gl->stream_bo_count;
+        bo = &buffer_gl->stream_bos[idx];
+        if (!bo->fence || wined3d_fence_test(bo->fence, device, 0) != WINED3D_FENCE_WAITING)
+            goto done;
+    }
+
+    idx = buffer_gl->stream_bo_count;
+    if (idx < ARRAY_SIZE(buffer_gl->stream_bos)
+            && wined3d_buffer_gl_create_stream_bo(buffer_gl, context, &buffer_gl->stream_bos[idx]))
+    {
+        ++buffer_gl->stream_bo_count;
+        goto done;
+    }
+
+    idx = (buffer_gl->stream_bo_idx + 1) % buffer_gl->stream_bo_count;
+    TRACE_(d3d_perf)("Waiting for stream buffer object %u of buffer %p.\n", idx, buffer_gl);
+    if (wined3d_fence_wait(buffer_gl->stream_bos[idx].fence, device) == WINED3D_FENCE_ERROR)
+        context->gl_info->gl_ops.gl.p_glFinish();
+
+done:
+    TRACE("Renaming buffer %p to stream buffer object %u.\n", buffer_gl, idx);
+    if (idx == buffer_gl->stream_bo_idx)
+        return;
+    buffer_gl->stream_bo_idx = idx;
+    buffer_gl->buffer_object = buffer_gl->stream_bos[idx].id;
+    wined3d_buffer_invalidate_bindings(&buffer_gl->b);
 }
 
 /* Context activation is done by the caller. */
@@ -214,6 +339,19 @@ static BOOL wined3d_buffer_gl_create_buffer_object(struct wined3d_buffer_gl *buf
      */
     while (gl_info->gl_ops.gl.p_glGetError() != GL_NO_ERROR);
 
+    if (wined3d_buffer_gl_use_streaming(buffer_gl, gl_info)
+            && wined3d_buffer_gl_create_stream_bo(buffer_gl, context, &buffer_gl->stream_bos[0]))
+    {
+        TRACE("Using persistently mapped stream buffer objects.\n");
+        buffer_gl->buffer_object = buffer_gl->stream_bos[0].id;
+        buffer_gl->buffer_object_usage = GL_STREAM_DRAW_ARB;
+        buffer_gl->stream_bo_count = 1;
+        buffer_gl->stream_bo_idx = 0;
+        buffer_gl->b.flags |= WINED3D_BUFFER_STREAMING;
+        buffer_invalidate_bo_range(&buffer_gl->b, 0, 0);
+        return TRUE;
+    }
+
     /* Basically the FVF parameter passed to CreateVertexBuffer is no good.
      * The vertex declaration from the device determines how the data in the
      * buffer is interpreted. This means that on each draw call the buffer has
@@ -1082,7 +1220,13 @@ static HRESULT wined3d_buffer_gl_map(struct wined3d_buffer_gl *buffer_gl,
                 if (buffer_gl->b.flags & WINED3D_BUFFER_DISCARD)
                     flags &= ~WINED3D_MAP_DISCARD;
 
-                if (gl_info->supported[ARB_MAP_BUFFER_RANGE])
+                if (buffer_gl->b.flags & WINED3D_BUFFER_STREAMING)
+                {
+                    if (flags & WINED3D_MAP_DISCARD)
+                        wined3d_buffer_gl_rename(buffer_gl, context);
+                    buffer_gl->b.map_ptr = buffer_gl->stream_bos[buffer_gl->stream_bo_idx].ptr;
+                }
+                else if (gl_info->supported[ARB_MAP_BUFFER_RANGE])
                 {
                     GLbitfield mapflags = wined3d_resource_gl_map_flags(flags);
                     buffer_gl->b.map_ptr = GL_EXTCALL(glMapBufferRange(buffer_gl->buffer_type_hint,
@@ -1164,7 +1308,13 @@ static void wined3d_buffer_gl_unmap(struct wined3d_buffer_gl *buffer_gl)
         return;
     }
 
-    if (buffer_gl->b.map_ptr)
+    /* Stream buffer objects are coherent and stay mapped. */
+    if (buffer_gl->b.map_ptr && (buffer_gl->b.flags & WINED3D_BUFFER_STREAMING))
+    {
+        buffer_clear_dirty_areas(&buffer_gl->b);
+        buffer_gl->b.map_ptr = NULL;
+    }
+    else if (buffer_gl->b.map_ptr)
     {
         struct wined3d_device *device = buffer_gl->b.resource.device;
         const struct wined3d_gl_info *gl_info;
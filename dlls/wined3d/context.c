@@ -1659,10 +1659,11 @@ void context_invalidate_state(struct wined3d_context *context, DWORD state)
 
     if (isStateDirty(context, rep)) return;
 
-    context->dirtyArray[context->numDirtyEntries++] = rep;
     idx = rep / (sizeof(*context->isStateDirty) * CHAR_BIT);
     shift = rep & ((sizeof(*context->isStateDirty) * CHAR_BIT) - 1);
     context->isStateDirty[idx] |= (1u << shift);
+    context->dirty_state_words[idx / (sizeof(*context->dirty_state_words) * CHAR_BIT)]
+            |= 1u << (idx & ((sizeof(*context->dirty_state_words) * CHAR_BIT) - 1));
 }
 
 /* This function takes care of wined3d pixel format selection. */
@@ -3920,11 +3921,13 @@ static void context_load_stream_output_buffers(struct wined3d_context *context,
 static BOOL context_apply_draw_state(struct wined3d_context *context,
         const struct wined3d_device *device, const struct wined3d_state *state)
 {
+    struct wined3d_state_stats *stats = &wined3d_device_gl(context->device)->state_stats;
     const struct wined3d_state_entry *state_table = context->state_table;
     struct wined3d_context_gl *context_gl = wined3d_context_gl(context);
     const struct wined3d_gl_info *gl_info = context->gl_info;
+    DWORD word_mask, dirty_mask, idx, rep;
     const struct wined3d_fb_state *fb = state->fb;
-    unsigned int i;
+    unsigned int i, state_count = 0;
     WORD map;
 
     if (!have_framebuffer_attachment(gl_info->limits.buffers, fb->render_targets, fb->depth_stencil))
@@ -3976,13 +3979,37 @@ static BOOL context_apply_draw_state(struct wined3d_context *context,
             wined3d_buffer_load_sysmem(state->index_buffer, context);
     }
 
-    for (i = 0; i < context->numDirtyEntries; ++i)
+    /* State handlers may invalidate further states, including ones in words
+     * that were already visited, so rescan until everything is clean. */
+    for (;;)
+    {
+        for (i = 0; i < ARRAY_SIZE(context->dirty_state_words); ++i)
+        {
+            if (context->dirty_state_words[i])
+                break;
+        }
+        if (i == ARRAY_SIZE(context->dirty_state_words))
+            break;
+
+        word_mask = context->dirty_state_words[i];
+        idx = i * sizeof(*context->dirty_state_words) * CHAR_BIT + wined3d_bit_scan(&word_mask);
+        context->dirty_state_words[i] &= ~(1u << (idx & ((sizeof(*context->dirty_state_words) * CHAR_BIT) - 1)));
+
+        while (context->isStateDirty[idx])
+        {
+            dirty_mask = context->isStateDirty[idx];
+            rep = idx * sizeof(*context->isStateDirty) * CHAR_BIT + wined3d_bit_scan(&dirty_mask);
+            context->isStateDirty[idx] &= ~(1u << (rep & ((sizeof(*context->isStateDirty) * CHAR_BIT) - 1)));
+            state_table[rep].apply(context, state, rep);
+            ++state_count;
+        }
+    }
+
+    if (stats->collect)
     {
-        DWORD rep = context->dirtyArray[i];
-        DWORD idx = rep / (sizeof(*context->isStateDirty) * CHAR_BIT);
-        BYTE shift = rep & ((sizeof(*context->isStateDirty) * CHAR_BIT) - 1);
-        context->isStateDirty[idx] &= ~(1u << shift);
-        state_table[rep].apply(context, state, rep);
+        ++stats->draw_count;
+        stats->state_count += state_count;
+        stats->max_draw_state_count = max(stats->max_draw_state_count, state_count);
     }
 
     if (context->shader_update_mask & ~(1u << WINED3D_SHADER_TYPE_COMPUTE))
@@ -4018,13 +4045,25 @@ static BOOL context_apply_draw_state(struct wined3d_context *context,
     if (wined3d_settings.offscreen_rendering_mode == ORM_FBO)
         wined3d_context_gl_check_fbo_status(context_gl, GL_FRAMEBUFFER);
 
-    context->numDirtyEntries = 0; /* This makes the whole list clean */
     context->last_was_blit = FALSE;
     context->last_was_ffp_blit = FALSE;
 
     return TRUE;
 }
 
+void wined3d_state_stats_end_frame(struct wined3d_state_stats *stats)
+{
+    if (stats->draw_count)
+        TRACE_(d3d_perf)("Applied %u states for %u draws (%.2f per draw, at most %u).\n",
+                stats->state_count, stats->draw_count, (float)stats->state_count / stats->draw_count,
+                stats->max_draw_state_count);
+
+    stats->draw_count = 0;
+    stats->state_count = 0;
+    stats->max_draw_state_count = 0;
+    stats->collect = TRACE_ON(d3d_perf);
+}
+
 static void wined3d_context_gl_apply_compute_state(struct wined3d_context_gl *context_gl,
         const struct wined3d_device *device, const struct wined3d_state *state)
 {
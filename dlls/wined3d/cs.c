@@ -21,6 +21,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 #define WINED3D_INITIAL_CS_SIZE 4096
 
@@ -31,6 +32,7 @@ enum wined3d_cs_op
     WINED3D_CS_OP_CLEAR,
     WINED3D_CS_OP_DISPATCH,
     WINED3D_CS_OP_DRAW,
+    WINED3D_CS_OP_DRAW_UP,
     WINED3D_CS_OP_FLUSH,
     WINED3D_CS_OP_SET_PREDICATION,
     WINED3D_CS_OP_SET_VIEWPORTS,
@@ -129,6 +131,17 @@ struct wined3d_cs_draw
     struct wined3d_draw_parameters parameters;
 };
 
+struct wined3d_cs_draw_up
+{
+    enum wined3d_cs_op opcode;
+    GLenum primitive_type;
+    struct wined3d_buffer *buffer;
+    unsigned int offset;
+    unsigned int stride;
+    unsigned int vertex_count;
+    BYTE data[1];
+};
+
 struct wined3d_cs_flush
 {
     enum wined3d_cs_op opcode;
@@ -480,6 +493,7 @@ struct wined3d_cs_stop
 static inline void *wined3d_cs_require_space(struct wined3d_cs *cs,
         size_t size, enum wined3d_cs_queue_id queue_id)
 {
+    wined3d_cs_flush_draw_up(cs);
     return cs->ops->require_space(cs, size, queue_id);
 }
 
@@ -498,6 +512,7 @@ static const char *debug_cs_op(enum wined3d_cs_op op)
         WINED3D_TO_STR(WINED3D_CS_OP_CLEAR);
         WINED3D_TO_STR(WINED3D_CS_OP_DISPATCH);
         WINED3D_TO_STR(WINED3D_CS_OP_DRAW);
+        WINED3D_TO_STR(WINED3D_CS_OP_DRAW_UP);
         WINED3D_TO_STR(WINED3D_CS_OP_FLUSH);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_PREDICATION);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_VIEWPORTS);
@@ -1042,6 +1057,169 @@ void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, GLenum primitive_type,
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
+static void wined3d_cs_exec_draw_up(struct wined3d_cs *cs, const void *data)
+{
+    struct wined3d_stream_state *stream = &cs->state.streams[0];
+    const struct wined3d_cs_draw_up *op = data;
+    struct wined3d_buffer *buffer = op->buffer;
+    unsigned int prev_offset, prev_stride;
+    struct wined3d_context *context;
+    struct wined3d_cs_draw draw;
+    struct wined3d_box box;
+
+    context = context_acquire(cs->device, NULL, 0);
+    if (wined3d_buffer_load_location(buffer, context, WINED3D_LOCATION_BUFFER))
+    {
+        wined3d_box_set(&box, op->offset, 0, op->offset + op->vertex_count * op->stride, 1, 0, 1);
+        wined3d_buffer_upload_data(buffer, context, &box, op->data);
+        wined3d_buffer_invalidate_location(buffer, ~WINED3D_LOCATION_BUFFER);
+    }
+    else
+    {
+        ERR("Failed to load buffer location.\n");
+    }
+    context_release(context);
+
+    /* The application side only batches draws while stream 0 is unbound, so
+     * we can borrow it for the duration of the draw. */
+    prev_offset = stream->offset;
+    prev_stride = stream->stride;
+    stream->buffer = buffer;
+    stream->offset = 0;
+    stream->stride = op->stride;
+    device_invalidate_state(cs->device, STATE_STREAMSRC);
+
+    draw.opcode = WINED3D_CS_OP_DRAW;
+    draw.primitive_type = op->primitive_type;
+    draw.patch_vertex_count = 0;
+    draw.parameters.indirect = FALSE;
+    draw.parameters.u.direct.base_vertex_idx = 0;
+    draw.parameters.u.direct.start_idx = op->offset / op->stride;
+    draw.parameters.u.direct.index_count = op->vertex_count;
+    draw.parameters.u.direct.start_instance = 0;
+    draw.parameters.u.direct.instance_count = 0;
+    draw.parameters.indexed = FALSE;
+    wined3d_cs_exec_draw(cs, &draw);
+
+    stream->buffer = NULL;
+    stream->offset = prev_offset;
+    stream->stride = prev_stride;
+    device_invalidate_state(cs->device, STATE_STREAMSRC);
+}
+
+static BOOL wined3d_cs_is_list_primitive_type(GLenum primitive_type)
+{
+    return primitive_type == GL_POINTS || primitive_type == GL_LINES || primitive_type == GL_TRIANGLES;
+}
+
+/* Draws from application memory are not submitted right away. Any further
+ * command flushes the pending batch first, so as long as nothing else is
+ * emitted in between, consecutive list draws with the same vertex stride
+ * see identical state and can be merged into a single draw. The resources
+ * used by the batch are acquired when it is started, since that is the state
+ * it will be executed with. */
+HRESULT wined3d_cs_emit_draw_up(struct wined3d_cs *cs, GLenum primitive_type,
+        const void *data, unsigned int vertex_count, unsigned int stride)
+{
+    const struct wined3d_d3d_info *d3d_info = &cs->device->adapter->d3d_info;
+    struct wined3d_cs_draw_up_batch *batch = &cs->draw_up_batch;
+    const struct wined3d_state *state = &cs->device->state;
+    struct wined3d_buffer_desc desc;
+    unsigned int size;
+    HRESULT hr;
+
+    if (!stride || vertex_count > WINED3D_CS_INLINE_DATA_SIZE / stride || state->streams[0].buffer)
+        return WINED3DERR_NOTAVAILABLE;
+    size = vertex_count * stride;
+
+    if (!batch->buffer)
+    {
+        desc.byte_width = WINED3D_CS_DRAW_UP_BUFFER_SIZE;
+        desc.usage = 0;
+        desc.bind_flags = WINED3D_BIND_VERTEX_BUFFER;
+        desc.access = WINED3D_RESOURCE_ACCESS_GPU;
+        desc.misc_flags = 0;
+        desc.structure_byte_stride = 0;
+
+        if (!(batch->data = heap_alloc(WINED3D_CS_INLINE_DATA_SIZE)))
+            return E_OUTOFMEMORY;
+        if (FAILED(hr = wined3d_buffer_create(cs->device, &desc, NULL, NULL,
+                &wined3d_null_parent_ops, &batch->buffer)))
+        {
+            ERR("Failed to create vertex buffer, hr %#x.\n", hr);
+            heap_free(batch->data);
+            batch->data = NULL;
+            return hr;
+        }
+    }
+
+    if (batch->vertex_count && (primitive_type != batch->primitive_type
+            || !wined3d_cs_is_list_primitive_type(primitive_type) || stride != batch->stride
+            || size > WINED3D_CS_INLINE_DATA_SIZE - batch->vertex_count * stride))
+        wined3d_cs_flush_draw_up(cs);
+
+    if (!batch->vertex_count)
+    {
+        batch->primitive_type = primitive_type;
+        batch->stride = stride;
+        acquire_graphics_pipeline_resources(state, FALSE, d3d_info);
+        wined3d_resource_acquire(&batch->buffer->resource);
+    }
+
+    memcpy(batch->data + batch->vertex_count * stride, data, size);
+    batch->vertex_count += vertex_count;
+    if (cs->collect_stats)
+        ++cs->stats.draw_up_count;
+
+    return WINED3D_OK;
+}
+
+void wined3d_cs_emit_draw_up_batch(struct wined3d_cs *cs)
+{
+    struct wined3d_cs_draw_up_batch *batch = &cs->draw_up_batch;
+    unsigned int size = batch->vertex_count * batch->stride;
+    struct wined3d_cs_draw_up *op;
+    unsigned int offset;
+
+    /* Wrapping around is fine; uploads are ordered after the draws that
+     * still use the previous contents. */
+    offset = (batch->offset + batch->stride - 1) / batch->stride * batch->stride;
+    if (offset + size > WINED3D_CS_DRAW_UP_BUFFER_SIZE)
+        offset = 0;
+    batch->offset = offset + size;
+
+    /* Bypass wined3d_cs_require_space(), which would try to flush the batch again. */
+    op = cs->ops->require_space(cs, FIELD_OFFSET(struct wined3d_cs_draw_up, data[size]), WINED3D_CS_QUEUE_DEFAULT);
+    op->opcode = WINED3D_CS_OP_DRAW_UP;
+    op->primitive_type = batch->primitive_type;
+    op->buffer = batch->buffer;
+    op->offset = offset;
+    op->stride = batch->stride;
+    op->vertex_count = batch->vertex_count;
+    memcpy(op->data, batch->data, size);
+    batch->vertex_count = 0;
+
+    if (cs->collect_stats)
+        ++cs->stats.draw_up_batch_count;
+
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+}
+
+void wined3d_cs_cleanup_draw_up(struct wined3d_cs *cs)
+{
+    struct wined3d_cs_draw_up_batch *batch = &cs->draw_up_batch;
+
+    wined3d_cs_flush_draw_up(cs);
+    if (batch->buffer)
+    {
+        wined3d_buffer_decref(batch->buffer);
+        batch->buffer = NULL;
+    }
+    heap_free(batch->data);
+    batch->data = NULL;
+    batch->offset = 0;
+}
+
 static void wined3d_cs_exec_flush(struct wined3d_cs *cs, const void *data)
 {
     struct wined3d_context_gl *context_gl;
@@ -2044,6 +2222,14 @@ void wined3d_cs_init_object(struct wined3d_cs *cs, void (*callback)(void *object
     wined3d_cs_emit_callback(cs, callback, object);
 }
 
+static LONGLONG wined3d_cs_get_time(void)
+{
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
 static void wined3d_cs_exec_query_issue(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_query_issue *op = data;
@@ -2057,10 +2243,18 @@ static void wined3d_cs_exec_query_issue(struct wined3d_cs *cs, const void *data)
 
     if (poll && list_empty(&query->poll_list_entry))
     {
-        if (query->buffer_object)
+        if (query->buffer.buffer_object)
+        {
+            if (cs->collect_stats)
+                ++cs->stats.buffer_query_count;
             InterlockedIncrement(&query->counter_retrieved);
+        }
         else
+        {
+            if (cs->collect_stats)
+                query->issue_time = wined3d_cs_get_time();
             list_add_tail(&cs->query_poll_list, &query->poll_list_entry);
+        }
         return;
     }
 
@@ -2082,6 +2276,8 @@ static void wined3d_cs_exec_query_issue(struct wined3d_cs *cs, const void *data)
      * fence was reached. In this case the query is already in the list and
      * the poll function will check the new fence. We have to counter-balance
      * the discarded increment. */
+    if (poll && cs->collect_stats)
+        query->issue_time = wined3d_cs_get_time();
     if (op->flags & WINED3DISSUE_END)
         InterlockedIncrement(&query->counter_retrieved);
 }
@@ -2395,13 +2591,46 @@ done:
     wined3d_resource_release(resource);
 }
 
+static size_t wined3d_cs_get_update_data_size(const struct wined3d_resource *resource,
+        const struct wined3d_box *box, unsigned int row_pitch, unsigned int slice_pitch)
+{
+    const struct wined3d_format *format = resource->format;
+    unsigned int row_size, rows_size;
+    size_t size;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+    {
+        size = box->right - box->left;
+        return size <= WINED3D_CS_INLINE_DATA_SIZE ? size : 0;
+    }
+
+    if (resource->format_flags & WINED3DFMT_FLAG_HEIGHT_SCALE
+            || box->right <= box->left || box->bottom <= box->top || box->back <= box->front)
+        return 0;
+
+    /* "rows_size" is the tightly packed size of a single slice, which for
+     * block based formats is a multiple of the block row size. */
+    wined3d_format_calculate_pitch(format, 1, box->right - box->left,
+            box->bottom - box->top, &row_size, &rows_size);
+    if (!row_size)
+        return 0;
+
+    size = (size_t)(box->back - box->front - 1) * slice_pitch
+            + (size_t)(rows_size / row_size - 1) * row_pitch + row_size;
+    return size <= WINED3D_CS_INLINE_DATA_SIZE ? size : 0;
+}
+
 void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
         unsigned int slice_pitch)
 {
     struct wined3d_cs_update_sub_resource *op;
+    size_t data_size = 0;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
+    if (cs->thread)
+        data_size = wined3d_cs_get_update_data_size(resource, box, row_pitch, slice_pitch);
+
+    op = wined3d_cs_require_space(cs, sizeof(*op) + data_size, WINED3D_CS_QUEUE_MAP);
     op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
     op->resource = resource;
     op->sub_resource_idx = sub_resource_idx;
@@ -2410,12 +2639,22 @@ void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_r
     op->data.slice_pitch = slice_pitch;
     op->data.data = data;
 
+    /* Small updates are copied into the command stream, so that we don't
+     * have to wait for the CS thread to consume the application's data. */
+    if (data_size)
+    {
+        memcpy(op + 1, data, data_size);
+        op->data.data = op + 1;
+        if (cs->collect_stats)
+            ++cs->stats.inline_count;
+    }
+
     wined3d_resource_acquire(resource);
 
     wined3d_cs_submit(cs, WINED3D_CS_QUEUE_MAP);
-    /* The data pointer may go away, so we need to wait until it is read.
-     * Copying the data may be faster if it's small. */
-    wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
+    /* The data pointer may go away, so we need to wait until it is read. */
+    if (!data_size)
+        wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
 }
 
 static void wined3d_cs_exec_add_dirty_texture_region(struct wined3d_cs *cs, const void *data)
@@ -2570,7 +2809,7 @@ void wined3d_cs_emit_gl_texture_callback(struct wined3d_cs *cs, struct wined3d_t
 {
     struct wined3d_cs_gl_texture_callback *op;
 
-    op = cs->ops->require_space(cs, sizeof(*op) + size, WINED3D_CS_QUEUE_DEFAULT);
+    op = wined3d_cs_require_space(cs, sizeof(*op) + size, WINED3D_CS_QUEUE_DEFAULT);
     op->opcode = WINED3D_CS_OP_GL_TEXTURE_CALLBACK;
     op->texture = texture;
     op->depth_texture = depth_texture;
@@ -2580,7 +2819,7 @@ void wined3d_cs_emit_gl_texture_callback(struct wined3d_cs *cs, struct wined3d_t
 
     wined3d_resource_acquire(&texture->resource);
 
-    cs->ops->submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_user_callback(struct wined3d_cs *cs, const void *data)
@@ -2604,13 +2843,13 @@ void wined3d_cs_emit_user_callback(struct wined3d_cs *cs,
 {
     struct wined3d_cs_user_callback *op;
 
-    op = cs->ops->require_space(cs, sizeof(*op) + size, WINED3D_CS_QUEUE_DEFAULT);
+    op = wined3d_cs_require_space(cs, sizeof(*op) + size, WINED3D_CS_QUEUE_DEFAULT);
     op->opcode = WINED3D_CS_OP_USER_CALLBACK;
     op->callback = callback;
     op->data_size = size;
     memcpy(op->data, data, size);
 
-    cs->ops->submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_fence(struct wined3d_cs *cs, const void *data)
@@ -2640,13 +2879,13 @@ static GLsync wined3d_cs_emit_fence(struct wined3d_cs *cs, struct wined3d_textur
     struct wined3d_cs_fence *op;
     GLsync fence;
 
-    op = cs->ops->require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
     op->opcode = WINED3D_CS_OP_FENCE;
     op->texture = texture;
     op->fence = &fence;
 
-    cs->ops->submit(cs, WINED3D_CS_QUEUE_DEFAULT);
-    cs->ops->finish(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
 
     return fence;
 }
@@ -2674,6 +2913,7 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_CLEAR                       */ wined3d_cs_exec_clear,
     /* WINED3D_CS_OP_DISPATCH                    */ wined3d_cs_exec_dispatch,
     /* WINED3D_CS_OP_DRAW                        */ wined3d_cs_exec_draw,
+    /* WINED3D_CS_OP_DRAW_UP                     */ wined3d_cs_exec_draw_up,
     /* WINED3D_CS_OP_FLUSH                       */ wined3d_cs_exec_flush,
     /* WINED3D_CS_OP_SET_PREDICATION             */ wined3d_cs_exec_set_predication,
     /* WINED3D_CS_OP_SET_VIEWPORTS               */ wined3d_cs_exec_set_viewports,
@@ -2793,7 +3033,7 @@ static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
-    InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
+    InterlockedExchange(&queue->head, (queue->head + packet_size) & (queue->size - 1));
 
     if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         SetEvent(cs->event);
@@ -2807,22 +3047,56 @@ static void wined3d_cs_mt_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id
     wined3d_cs_queue_submit(&cs->queue[queue_id], cs);
 }
 
+/* Only the application thread writes to the queue, so once the CS thread has
+ * caught up with it we can safely swap in a larger buffer. "head" and "tail"
+ * remain valid positions in the new buffer. */
+static BOOL wined3d_cs_queue_grow(struct wined3d_cs_queue *queue, size_t packet_size, struct wined3d_cs *cs)
+{
+    size_t new_size = queue->size;
+    BYTE *new_data, *old_data;
+
+    while (new_size <= packet_size)
+        new_size *= 2;
+    if (new_size > WINED3D_CS_QUEUE_MAX_SIZE)
+        return FALSE;
+
+    if (!(new_data = heap_alloc(new_size)))
+        return FALSE;
+
+    TRACE_(d3d_perf)("Growing queue %p from %lu to %lu bytes for a %lu byte packet.\n", queue,
+            (unsigned long)queue->size, (unsigned long)new_size, (unsigned long)packet_size);
+
+    while (queue->head != *(volatile LONG *)&queue->tail)
+        wined3d_pause();
+
+    old_data = queue->data;
+    queue->data = new_data;
+    queue->size = new_size;
+    heap_free(old_data);
+
+    if (cs->collect_stats)
+        ++cs->stats.grow_count;
+
+    return TRUE;
+}
+
 static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size_t size, struct wined3d_cs *cs)
 {
-    size_t queue_size = ARRAY_SIZE(queue->data);
-    size_t header_size, packet_size, remaining;
+    size_t header_size, packet_size, remaining, queue_size;
     struct wined3d_cs_packet *packet;
+    LONGLONG stall_start = 0;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     size = (size + header_size - 1) & ~(header_size - 1);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
-    if (packet_size >= WINED3D_CS_QUEUE_SIZE)
+    if (packet_size >= queue->size && !wined3d_cs_queue_grow(queue, packet_size, cs))
     {
-        ERR("Packet size %lu >= queue size %u.\n",
-                (unsigned long)packet_size, WINED3D_CS_QUEUE_SIZE);
+        ERR("Packet size %lu >= queue size %lu.\n",
+                (unsigned long)packet_size, (unsigned long)queue->size);
         return NULL;
     }
 
+    queue_size = queue->size;
     remaining = queue_size - queue->head;
     if (remaining < packet_size)
     {
@@ -2849,7 +3123,7 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
         /* Empty. */
         if (head == tail)
             break;
-        new_pos = (head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1);
+        new_pos = (head + packet_size) & (queue_size - 1);
         /* Head ahead of tail. We checked the remaining size above, so we only
          * need to make sure we don't make head equal to tail. */
         if (head > tail && (new_pos != tail))
@@ -2859,10 +3133,19 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
         if (new_pos < tail && new_pos)
             break;
 
+        if (cs->collect_stats && !stall_start)
+            stall_start = wined3d_cs_get_time();
+
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
     }
 
+    if (stall_start)
+    {
+        ++cs->stats.stall_count;
+        cs->stats.stall_time += wined3d_cs_get_time() - stall_start;
+    }
+
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
     packet->size = size;
     return packet->data;
@@ -2878,11 +3161,24 @@ static void *wined3d_cs_mt_require_space(struct wined3d_cs *cs, size_t size, enu
 
 static void wined3d_cs_mt_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
+    struct wined3d_cs_queue *queue = &cs->queue[queue_id];
+    LONGLONG stall_start;
+
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(cs, queue_id);
 
-    while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
+    if (queue->head == *(volatile LONG *)&queue->tail)
+        return;
+
+    stall_start = cs->collect_stats ? wined3d_cs_get_time() : 0;
+    while (queue->head != *(volatile LONG *)&queue->tail)
         wined3d_pause();
+
+    if (stall_start)
+    {
+        ++cs->stats.stall_count;
+        cs->stats.stall_time += wined3d_cs_get_time() - stall_start;
+    }
 }
 
 static const struct wined3d_cs_ops wined3d_cs_mt_ops =
@@ -2893,9 +3189,12 @@ static const struct wined3d_cs_ops wined3d_cs_mt_ops =
     wined3d_cs_mt_push_constants,
 };
 
+/* Queries of different types don't necessarily complete in issue order, so
+ * a query that isn't done yet doesn't say anything about the ones after it. */
 static void poll_queries(struct wined3d_cs *cs)
 {
     struct wined3d_query *query, *cursor;
+    LONGLONG latency, now = 0;
 
     LIST_FOR_EACH_ENTRY_SAFE(query, cursor, &cs->query_poll_list, struct wined3d_query, poll_list_entry)
     {
@@ -2905,10 +3204,23 @@ static void poll_queries(struct wined3d_cs *cs)
         list_remove(&query->poll_list_entry);
         list_init(&query->poll_list_entry);
         InterlockedIncrement(&query->counter_retrieved);
+
+        if (cs->collect_stats && query->issue_time)
+        {
+            if (!now)
+                now = wined3d_cs_get_time();
+            latency = now - query->issue_time;
+            ++cs->stats.query_count;
+            cs->stats.query_latency += latency;
+            cs->stats.max_query_latency = max(cs->stats.max_query_latency, latency);
+            query->issue_time = 0;
+        }
     }
 }
 
-static void wined3d_cs_wait_event(struct wined3d_cs *cs)
+/* Returns FALSE if "timeout" expired before the application thread woke us
+ * up. */
+static BOOL wined3d_cs_wait_event(struct wined3d_cs *cs, DWORD timeout)
 {
     InterlockedExchange(&cs->waiting_for_event, TRUE);
 
@@ -2922,9 +3234,68 @@ static void wined3d_cs_wait_event(struct wined3d_cs *cs)
     if (!(wined3d_cs_queue_is_empty(cs, &cs->queue[WINED3D_CS_QUEUE_DEFAULT])
             && wined3d_cs_queue_is_empty(cs, &cs->queue[WINED3D_CS_QUEUE_MAP]))
             && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
+        return TRUE;
+
+    if (WaitForSingleObject(cs->event, timeout) != WAIT_TIMEOUT)
+        return TRUE;
+
+    /* If the application thread reset "waiting_for_event" in the meantime,
+     * the event is still signalled, and the next wait returns immediately. */
+    InterlockedExchange(&cs->waiting_for_event, FALSE);
+    return FALSE;
+}
+
+static void wined3d_cs_report_stats(struct wined3d_cs *cs)
+{
+    struct wined3d_cs_stats *stats = &cs->stats;
+    LONGLONG now, elapsed, stall_time, idle_time;
+    LARGE_INTEGER frequency;
+    ULONG stall_count;
+
+    now = wined3d_cs_get_time();
+    if (!stats->report_time)
+    {
+        stats->report_time = now;
+        return;
+    }
+
+    QueryPerformanceFrequency(&frequency);
+    if ((elapsed = now - stats->report_time) < frequency.QuadPart)
         return;
 
-    WaitForSingleObject(cs->event, INFINITE);
+    /* The application thread updates these concurrently; we only need an
+     * approximate snapshot. */
+    stall_count = *(volatile ULONG *)&stats->stall_count;
+    stall_time = *(volatile LONGLONG *)&stats->stall_time;
+    /* Idle periods are accounted when they end, so they may straddle the
+     * reporting interval. */
+    idle_time = min(stats->idle_time - stats->report_idle_time, elapsed);
+
+    TRACE_(d3d_perf)("%u packets, CS thread busy %u%%, %u application stalls (%u ms), "
+            "queue sizes %lu/%lu bytes, %u grows, %u inline updates, %u UP draws in %u batches.\n",
+            stats->packet_count - stats->report_packet_count,
+            (unsigned int)(100 - idle_time * 100 / elapsed),
+            stall_count - stats->report_stall_count,
+            (unsigned int)((stall_time - stats->report_stall_time) * 1000 / frequency.QuadPart),
+            (unsigned long)cs->queue[WINED3D_CS_QUEUE_DEFAULT].size,
+            (unsigned long)cs->queue[WINED3D_CS_QUEUE_MAP].size,
+            stats->grow_count, stats->inline_count, *(volatile ULONG *)&stats->draw_up_count,
+            *(volatile ULONG *)&stats->draw_up_batch_count);
+    if (stats->query_count || stats->buffer_query_count)
+        TRACE_(d3d_perf)("%u polled queries, latency %u us average, %u us max; %u buffered queries.\n",
+                stats->query_count,
+                stats->query_count ? (unsigned int)(stats->query_latency * 1000000
+                / (stats->query_count * frequency.QuadPart)) : 0,
+                (unsigned int)(stats->max_query_latency * 1000000 / frequency.QuadPart),
+                stats->buffer_query_count);
+
+    stats->report_time = now;
+    stats->report_packet_count = stats->packet_count;
+    stats->report_stall_count = stall_count;
+    stats->report_stall_time = stall_time;
+    stats->report_idle_time = stats->idle_time;
+    stats->query_count = stats->buffer_query_count = 0;
+    stats->query_latency = stats->max_query_latency = 0;
 }
 
 static DWORD WINAPI wined3d_cs_run(void *ctx)
@@ -2951,6 +3322,8 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
         if (++poll == WINED3D_CS_QUERY_POLL_INTERVAL)
         {
             poll_queries(cs);
+            if (cs->collect_stats)
+                wined3d_cs_report_stats(cs);
             poll = 0;
         }
 
@@ -2960,13 +3333,32 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
-                if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
-                    wined3d_cs_wait_event(cs);
+                if (cs->collect_stats && !cs->stats.idle_start)
+                    cs->stats.idle_start = wined3d_cs_get_time();
+                if (++spin_count >= WINED3D_CS_SPIN_COUNT)
+                {
+                    /* Outstanding queries still need to be polled, but
+                     * there's no need to busy-loop for them. */
+                    if (list_empty(&cs->query_poll_list))
+                        wined3d_cs_wait_event(cs, INFINITE);
+                    else if (!wined3d_cs_wait_event(cs, WINED3D_CS_QUERY_POLL_WAIT))
+                        poll = WINED3D_CS_QUERY_POLL_INTERVAL - 1;
+                }
                 continue;
             }
         }
         spin_count = 0;
 
+        if (cs->collect_stats)
+        {
+            if (cs->stats.idle_start)
+            {
+                cs->stats.idle_time += wined3d_cs_get_time() - cs->stats.idle_start;
+                cs->stats.idle_start = 0;
+            }
+            ++cs->stats.packet_count;
+        }
+
         tail = queue->tail;
         packet = (struct wined3d_cs_packet *)&queue->data[tail];
         if (packet->size)
@@ -2986,7 +3378,7 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
         }
 
         tail += FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
-        tail &= (WINED3D_CS_QUEUE_SIZE - 1);
+        tail &= (queue->size - 1);
         InterlockedExchange(&queue->tail, tail);
     }
 
@@ -3000,6 +3392,7 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
 {
     const struct wined3d_d3d_info *d3d_info = &device->adapter->d3d_info;
     struct wined3d_cs *cs;
+    unsigned int i;
 
     if (!(cs = heap_alloc_zero(sizeof(*cs))))
         return NULL;
@@ -3017,11 +3410,21 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
             && !RtlIsCriticalSectionLockedByThread(NtCurrentTeb()->Peb->LoaderLock))
     {
         cs->ops = &wined3d_cs_mt_ops;
+        cs->collect_stats = TRACE_ON(d3d_perf);
+
+        for (i = 0; i < WINED3D_CS_QUEUE_COUNT; ++i)
+        {
+            cs->queue[i].size = WINED3D_CS_QUEUE_SIZE;
+            if (!(cs->queue[i].data = heap_alloc(cs->queue[i].size)))
+            {
+                ERR("Failed to allocate command stream queue.\n");
+                goto fail;
+            }
+        }
 
         if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
         {
             ERR("Failed to create command stream event.\n");
-            heap_free(cs->data);
             goto fail;
         }
 
@@ -3030,7 +3433,6 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
         {
             ERR("Failed to get wined3d module handle.\n");
             CloseHandle(cs->event);
-            heap_free(cs->data);
             goto fail;
         }
 
@@ -3039,7 +3441,6 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
             ERR("Failed to create wined3d command stream thread.\n");
             FreeLibrary(cs->wined3d_module);
             CloseHandle(cs->event);
-            heap_free(cs->data);
             goto fail;
         }
     }
@@ -3047,6 +3448,9 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
     return cs;
 
 fail:
+    for (i = 0; i < WINED3D_CS_QUEUE_COUNT; ++i)
+        heap_free(cs->queue[i].data);
+    heap_free(cs->data);
     state_cleanup(&cs->state);
     heap_free(cs);
     return NULL;
@@ -3054,6 +3458,8 @@ fail:
 
 void wined3d_cs_destroy(struct wined3d_cs *cs)
 {
+    unsigned int i;
+
     if (cs->thread)
     {
         wined3d_cs_emit_stop(cs);
@@ -3062,6 +3468,13 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
             ERR("Closing event failed.\n");
     }
 
+    if (cs->collect_stats)
+        TRACE_(d3d_perf)("%u UP draws in %u batches in total.\n",
+                cs->stats.draw_up_count, cs->stats.draw_up_batch_count);
+
+    for (i = 0; i < WINED3D_CS_QUEUE_COUNT; ++i)
+        heap_free(cs->queue[i].data);
+    heap_free(cs->draw_up_batch.data);
     state_cleanup(&cs->state);
     heap_free(cs->data);
     heap_free(cs);
@@ -988,6 +988,8 @@ void wined3d_device_delete_opengl_contexts_cs(void *object)
     device->blitter->ops->blitter_destroy(device->blitter, context);
     device->shader_backend->shader_free_private(device, context);
     wined3d_device_gl_destroy_dummy_textures(device_gl, context_gl);
+    wined3d_upload_ring_destroy(&device_gl->upload_ring, context);
+    wined3d_query_buffer_pool_destroy(&device_gl->query_buffer_pool, context);
     destroy_default_samplers(device, context);
     context_release(context);
 
@@ -1141,6 +1143,7 @@ void wined3d_device_uninit_3d(struct wined3d_device *device)
         return;
     }
 
+    wined3d_cs_cleanup_draw_up(device->cs);
     wined3d_cs_finish(device->cs, WINED3D_CS_QUEUE_DEFAULT);
 
     device->swapchain_count = 0;
@@ -1767,6 +1770,12 @@ void CDECL wined3d_device_set_material(struct wined3d_device *device, const stru
         return;
     }
 
+    if (!memcmp(&device->state.material, material, sizeof(*material)))
+    {
+        TRACE("Application is setting the old values over, nothing to do.\n");
+        return;
+    }
+
     device->state.material = *material;
     wined3d_cs_emit_set_material(device->cs, material);
 }
@@ -2362,6 +2371,12 @@ HRESULT CDECL wined3d_device_set_vs_consts_b(struct wined3d_device *device,
         return WINED3D_OK;
     }
 
+    if (!memcmp(&device->state.vs_consts_b[start_idx], constants, count * sizeof(*constants)))
+    {
+        TRACE("Application is setting the old values over, nothing to do.\n");
+        return WINED3D_OK;
+    }
+
     memcpy(&device->state.vs_consts_b[start_idx], constants, count * sizeof(*constants));
     if (TRACE_ON(d3d))
     {
@@ -2412,6 +2427,12 @@ HRESULT CDECL wined3d_device_set_vs_consts_i(struct wined3d_device *device,
         return WINED3D_OK;
     }
 
+    if (!memcmp(&device->state.vs_consts_i[start_idx], constants, count * sizeof(*constants)))
+    {
+        TRACE("Application is setting the old values over, nothing to do.\n");
+        return WINED3D_OK;
+    }
+
     memcpy(&device->state.vs_consts_i[start_idx], constants, count * sizeof(*constants));
     if (TRACE_ON(d3d))
     {
@@ -2460,6 +2481,12 @@ HRESULT CDECL wined3d_device_set_vs_consts_f(struct wined3d_device *device,
         return WINED3D_OK;
     }
 
+    if (!memcmp(&device->state.vs_consts_f[start_idx], constants, count * sizeof(*constants)))
+    {
+        TRACE("Application is setting the old values over, nothing to do.\n");
+        return WINED3D_OK;
+    }
+
     memcpy(&device->state.vs_consts_f[start_idx], constants, count * sizeof(*constants));
     if (TRACE_ON(d3d))
     {
@@ -2576,6 +2603,12 @@ HRESULT CDECL wined3d_device_set_ps_consts_b(struct wined3d_device *device,
         return WINED3D_OK;
     }
 
+    if (!memcmp(&device->state.ps_consts_b[start_idx], constants, count * sizeof(*constants)))
+    {
+        TRACE("Application is setting the old values over, nothing to do.\n");
+        return WINED3D_OK;
+    }
+
     memcpy(&device->state.ps_consts_b[start_idx], constants, count * sizeof(*constants));
     if (TRACE_ON(d3d))
     {
@@ -2626,6 +2659,12 @@ HRESULT CDECL wined3d_device_set_ps_consts_i(struct wined3d_device *device,
         return WINED3D_OK;
     }
 
+    if (!memcmp(&device->state.ps_consts_i[start_idx], constants, count * sizeof(*constants)))
+    {
+        TRACE("Application is setting the old values over, nothing to do.\n");
+        return WINED3D_OK;
+    }
+
     memcpy(&device->state.ps_consts_i[start_idx], constants, count * sizeof(*constants));
     if (TRACE_ON(d3d))
     {
@@ -2675,6 +2714,12 @@ HRESULT CDECL wined3d_device_set_ps_consts_f(struct wined3d_device *device,
         return WINED3D_OK;
     }
 
+    if (!memcmp(&device->state.ps_consts_f[start_idx], constants, count * sizeof(*constants)))
+    {
+        TRACE("Application is setting the old values over, nothing to do.\n");
+        return WINED3D_OK;
+    }
+
     memcpy(&device->state.ps_consts_f[start_idx], constants, count * sizeof(*constants));
     if (TRACE_ON(d3d))
     {
@@ -4297,6 +4342,17 @@ void CDECL wined3d_device_draw_primitive_instanced_indirect(struct wined3d_devic
             buffer, offset, FALSE);
 }
 
+HRESULT CDECL wined3d_device_draw_primitive_up(struct wined3d_device *device,
+        const void *data, UINT vertex_count, UINT stride)
+{
+    TRACE("device %p, data %p, vertex_count %u, stride %u.\n", device, data, vertex_count, stride);
+
+    if (!wined3d_settings.batch_draws_up)
+        return WINED3DERR_NOTAVAILABLE;
+
+    return wined3d_cs_emit_draw_up(device->cs, device->state.gl_primitive_type, data, vertex_count, stride);
+}
+
 HRESULT CDECL wined3d_device_draw_indexed_primitive(struct wined3d_device *device, UINT start_idx, UINT index_count)
 {
     TRACE("device %p, start_idx %u, index_count %u.\n", device, start_idx, index_count);
@@ -5337,6 +5393,7 @@ HRESULT CDECL wined3d_device_reset(struct wined3d_device *device,
     TRACE("device %p, swapchain_desc %p, mode %p, callback %p, reset_state %#x.\n",
             device, swapchain_desc, mode, callback, reset_state);
 
+    wined3d_cs_cleanup_draw_up(device->cs);
     wined3d_cs_finish(device->cs, WINED3D_CS_QUEUE_DEFAULT);
 
     if (!(swapchain = wined3d_device_get_swapchain(device, 0)))
@@ -5870,9 +5927,7 @@ err:
 
 void device_invalidate_state(const struct wined3d_device *device, DWORD state)
 {
-    DWORD rep = device->state_table[state].representative;
-    struct wined3d_context *context;
-    unsigned int i, idx, shift;
+    unsigned int i;
 
     wined3d_from_cs(device->cs);
 
@@ -5884,15 +5939,7 @@ void device_invalidate_state(const struct wined3d_device *device, DWORD state)
     }
 
     for (i = 0; i < device->context_count; ++i)
-    {
-        context = device->contexts[i];
-        if (isStateDirty(context, rep)) continue;
-
-        context->dirtyArray[context->numDirtyEntries++] = rep;
-        idx = rep / (sizeof(*context->isStateDirty) * CHAR_BIT);
-        shift = rep & ((sizeof(*context->isStateDirty) * CHAR_BIT) - 1);
-        context->isStateDirty[idx] |= (1u << shift);
-    }
+        context_invalidate_state(device->contexts[i], state);
 }
 
 LRESULT device_process_message(struct wined3d_device *device, HWND window, BOOL unicode,
@@ -5950,5 +5997,5 @@ void CDECL wined3d_device_wait_idle(struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    device->cs->ops->finish(device->cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_finish(device->cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -132,7 +132,9 @@ struct shader_glsl_priv
 {
     struct wined3d_string_buffer shader_buffer;
     struct wined3d_string_buffer_list string_buffers;
-    struct wine_rb_tree program_lookup;
+    struct list *program_lookup;
+    unsigned int program_lookup_size;
+    unsigned int program_count;
     struct constant_heap vconst_heap;
     struct constant_heap pconst_heap;
     unsigned char *stack;
@@ -144,6 +146,10 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct wined3d_shader_cache *program_cache;
+    struct wined3d_shader_cache_key driver_key;
+    BOOL driver_key_initialised;
 };
 
 struct glsl_vs_program
@@ -246,7 +252,7 @@ struct glsl_cs_program
 /* Struct to maintain data about a linked GLSL program */
 struct glsl_shader_prog_link
 {
-    struct wine_rb_entry program_lookup_entry;
+    struct list program_lookup_entry;
     struct glsl_vs_program vs;
     struct glsl_hs_program hs;
     struct glsl_ds_program ds;
@@ -321,6 +327,12 @@ struct glsl_cs_compiled_shader
     GLuint id;
 };
 
+struct glsl_variant_index_entry
+{
+    unsigned int hash;
+    unsigned int idx; /* Index in gl_shaders + 1, 0 for empty slots. */
+};
+
 struct glsl_shader_private
 {
     union
@@ -333,6 +345,10 @@ struct glsl_shader_private
         struct glsl_cs_compiled_shader *cs;
     } gl_shaders;
     unsigned int num_gl_shaders, shader_array_size;
+
+    /* Open addressing hash table over the vertex and pixel shader variants. */
+    struct glsl_variant_index_entry *variant_index;
+    unsigned int variant_index_size;
 };
 
 struct glsl_ffp_vertex_shader
@@ -632,6 +648,162 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+/* FNV-1a */
+static unsigned int shader_glsl_hash(const void *data, SIZE_T size, unsigned int hash)
+{
+    const BYTE *ptr = data;
+    SIZE_T i;
+
+    for (i = 0; i < size; ++i)
+        hash = (hash ^ ptr[i]) * 16777619u;
+
+    return hash;
+}
+
+static int shader_glsl_cache_key_compare(const void *a, const void *b)
+{
+    const struct wined3d_shader_cache_key *k0 = a, *k1 = b;
+
+    if (k0->hash[0] != k1->hash[0])
+        return k0->hash[0] < k1->hash[0] ? -1 : 1;
+    if (k0->hash[1] != k1->hash[1])
+        return k0->hash[1] < k1->hash[1] ? -1 : 1;
+    return 0;
+}
+
+/* Program binaries are only valid for the driver that created them. The key
+ * covers the source and type of all shader objects attached to the program,
+ * and the transform feedback varyings and buffer mode set before linking.
+ * Attribute and fragment data locations are bound to fixed names and don't
+ * need to be part of it.
+ *
+ * Context activation is done by the caller. */
+static BOOL shader_glsl_get_program_cache_key(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program, const struct wined3d_shader_cache_key *so_key,
+        struct wined3d_shader_cache_key *key)
+{
+    static const GLenum driver_strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION_ARB};
+    struct wined3d_shader_cache_key *shader_keys;
+    GLint i, shader_count, source_size = 0;
+    char *source = NULL;
+    GLuint *shaders;
+
+    if (!priv->driver_key_initialised)
+    {
+        wined3d_shader_cache_key_init(&priv->driver_key);
+        for (i = 0; i < ARRAY_SIZE(driver_strings); ++i)
+        {
+            const char *str = (const char *)gl_info->gl_ops.gl.p_glGetString(driver_strings[i]);
+
+            if (str)
+                wined3d_shader_cache_key_update(&priv->driver_key, str, strlen(str) + 1);
+        }
+        priv->driver_key_initialised = TRUE;
+    }
+
+    GL_EXTCALL(glGetProgramiv(program, GL_ATTACHED_SHADERS, &shader_count));
+    if (shader_count <= 0)
+        return FALSE;
+    if (!(shaders = heap_calloc(shader_count, sizeof(*shaders))))
+        return FALSE;
+    if (!(shader_keys = heap_calloc(shader_count, sizeof(*shader_keys))))
+    {
+        heap_free(shaders);
+        return FALSE;
+    }
+
+    GL_EXTCALL(glGetAttachedShaders(program, shader_count, &shader_count, shaders));
+    for (i = 0; i < shader_count; ++i)
+    {
+        GLint length, type;
+
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type));
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (length > source_size)
+        {
+            heap_free(source);
+            if (!(source = heap_alloc(length)))
+            {
+                heap_free(shader_keys);
+                heap_free(shaders);
+                return FALSE;
+            }
+            source_size = length;
+        }
+        GL_EXTCALL(glGetShaderSource(shaders[i], source_size, &length, source));
+
+        wined3d_shader_cache_key_init(&shader_keys[i]);
+        wined3d_shader_cache_key_update(&shader_keys[i], &type, sizeof(type));
+        wined3d_shader_cache_key_update(&shader_keys[i], source, length);
+    }
+    checkGLcall("get program cache key");
+
+    /* The order in which attached shaders are returned is not defined. */
+    qsort(shader_keys, shader_count, sizeof(*shader_keys), shader_glsl_cache_key_compare);
+
+    *key = priv->driver_key;
+    wined3d_shader_cache_key_update(key, shader_keys, shader_count * sizeof(*shader_keys));
+    if (so_key)
+        wined3d_shader_cache_key_update(key, so_key, sizeof(*so_key));
+
+    heap_free(source);
+    heap_free(shader_keys);
+    heap_free(shaders);
+    return TRUE;
+}
+
+/* Link the program, or load it from the program binary cache when possible.
+ *
+ * Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program, const struct wined3d_shader_cache_key *so_key)
+{
+    struct wined3d_shader_cache_key key;
+    GLint status, length;
+    GLenum format;
+    DWORD cached_format;
+    SIZE_T size;
+    void *data;
+
+    if (!priv->program_cache || !shader_glsl_get_program_cache_key(gl_info, priv, program, so_key, &key))
+    {
+        TRACE("Linking GLSL shader program %u.\n", program);
+        GL_EXTCALL(glLinkProgram(program));
+        shader_glsl_validate_link(gl_info, program);
+        return;
+    }
+
+    if (wined3d_shader_cache_get(priv->program_cache, &key, &cached_format, &data, &size))
+    {
+        TRACE("Loading GLSL shader program %u from the program cache.\n", program);
+        GL_EXTCALL(glProgramBinary(program, cached_format, data, size));
+        heap_free(data);
+
+        /* The driver may reject binaries, e.g. after an update. Errors are
+         * expected here, so don't use checkGLcall(). */
+        while (gl_info->gl_ops.gl.p_glGetError());
+        GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        if (status)
+            return;
+        WARN("Cached binary for program %u rejected by the driver, linking.\n", program);
+    }
+
+    GL_EXTCALL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    TRACE("Linking GLSL shader program %u.\n", program);
+    GL_EXTCALL(glLinkProgram(program));
+    shader_glsl_validate_link(gl_info, program);
+
+    GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+    GL_EXTCALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (!status || length <= 0 || !(data = heap_alloc(length)))
+        return;
+    GL_EXTCALL(glGetProgramBinary(program, length, &length, &format, data));
+    checkGLcall("glGetProgramBinary");
+    if (length > 0)
+        wined3d_shader_cache_put(priv->program_cache, &key, format, data, length);
+    heap_free(data);
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -938,8 +1110,11 @@ static BOOL shader_glsl_generate_transform_feedback_varyings(struct wined3d_stri
     return have_varyings_to_record;
 }
 
+/* The transform feedback varyings and buffer mode are hashed into "so_key",
+ * since they affect linking but are not part of the shader source. */
 static void shader_glsl_init_transform_feedback(const struct wined3d_context *context,
-        struct shader_glsl_priv *priv, GLuint program_id, struct wined3d_shader *shader)
+        struct shader_glsl_priv *priv, GLuint program_id, struct wined3d_shader *shader,
+        struct wined3d_shader_cache_key *so_key)
 {
     const struct wined3d_stream_output_desc *so_desc = &shader->u.gs.so_desc;
     const struct wined3d_gl_info *gl_info = context->gl_info;
@@ -1021,6 +1196,12 @@ static void shader_glsl_init_transform_feedback(const struct wined3d_context *co
     GL_EXTCALL(glTransformFeedbackVaryings(program_id, count, varyings, mode));
     checkGLcall("glTransformFeedbackVaryings");
 
+    /* The strings are the varying names, including gl_SkipComponents and
+     * gl_NextBuffer, each one followed by a null terminator. */
+    wined3d_shader_cache_key_update(so_key, &mode, sizeof(mode));
+    wined3d_shader_cache_key_update(so_key, &count, sizeof(count));
+    wined3d_shader_cache_key_update(so_key, strings, length);
+
     heap_free(varyings);
     heap_free(strings);
     string_buffer_release(&priv->string_buffers, buffer);
@@ -1261,9 +1442,18 @@ static void shader_glsl_load_constantsB(const struct wined3d_shader *shader, con
     checkGLcall("glUniform1iv()");
 }
 
-static void reset_program_constant_version(struct wine_rb_entry *entry, void *context)
+static void reset_program_constant_versions(struct shader_glsl_priv *priv)
 {
-    WINE_RB_ENTRY_VALUE(entry, struct glsl_shader_prog_link, program_lookup_entry)->constant_version = 0;
+    struct glsl_shader_prog_link *entry;
+    unsigned int i;
+
+    for (i = 0; i < priv->program_lookup_size; ++i)
+    {
+        LIST_FOR_EACH_ENTRY(entry, &priv->program_lookup[i], struct glsl_shader_prog_link, program_lookup_entry)
+        {
+            entry->constant_version = 0;
+        }
+    }
 }
 
 /* Context activation is done by the caller (state handler). */
@@ -1778,7 +1968,7 @@ static void shader_glsl_load_constants(void *shader_priv, struct wined3d_context
     if (priv->next_constant_version == UINT_MAX)
     {
         TRACE("Max constant version reached, resetting to 0.\n");
-        wine_rb_for_each_entry(&priv->program_lookup, reset_program_constant_version, NULL);
+        reset_program_constant_versions(priv);
         priv->next_constant_version = 1;
     }
     else
@@ -6747,37 +6937,88 @@ static void shader_glsl_input_pack(const struct wined3d_shader *shader, struct w
     }
 }
 
-static void add_glsl_program_entry(struct shader_glsl_priv *priv, struct glsl_shader_prog_link *entry)
+static unsigned int glsl_program_key_hash(const struct glsl_program_key *key)
+{
+    return shader_glsl_hash(key, sizeof(*key), 2166136261u);
+}
+
+static void glsl_program_entry_get_key(const struct glsl_shader_prog_link *entry, struct glsl_program_key *key)
 {
+    key->vs_id = entry->vs.id;
+    key->hs_id = entry->hs.id;
+    key->ds_id = entry->ds.id;
+    key->gs_id = entry->gs.id;
+    key->ps_id = entry->ps.id;
+    key->cs_id = entry->cs.id;
+}
+
+static BOOL glsl_program_lookup_resize(struct shader_glsl_priv *priv, unsigned int size)
+{
+    struct glsl_shader_prog_link *entry, *entry2;
     struct glsl_program_key key;
+    struct list *buckets;
+    unsigned int i;
 
-    key.vs_id = entry->vs.id;
-    key.hs_id = entry->hs.id;
-    key.ds_id = entry->ds.id;
-    key.gs_id = entry->gs.id;
-    key.ps_id = entry->ps.id;
-    key.cs_id = entry->cs.id;
+    if (!(buckets = heap_calloc(size, sizeof(*buckets))))
+        return FALSE;
+    for (i = 0; i < size; ++i)
+        list_init(&buckets[i]);
 
-    if (wine_rb_put(&priv->program_lookup, &key, &entry->program_lookup_entry) == -1)
+    for (i = 0; i < priv->program_lookup_size; ++i)
     {
-        ERR("Failed to insert program entry.\n");
+        LIST_FOR_EACH_ENTRY_SAFE(entry, entry2, &priv->program_lookup[i],
+                struct glsl_shader_prog_link, program_lookup_entry)
+        {
+            glsl_program_entry_get_key(entry, &key);
+            list_remove(&entry->program_lookup_entry);
+            list_add_head(&buckets[glsl_program_key_hash(&key) & (size - 1)], &entry->program_lookup_entry);
+        }
     }
+
+    heap_free(priv->program_lookup);
+    priv->program_lookup = buckets;
+    priv->program_lookup_size = size;
+    return TRUE;
+}
+
+static void add_glsl_program_entry(struct shader_glsl_priv *priv, struct glsl_shader_prog_link *entry)
+{
+    struct glsl_program_key key;
+
+    /* Try to keep the load factor at or below 1. If growing the table
+     * fails, the existing buckets just get longer. */
+    if (priv->program_count >= priv->program_lookup_size)
+        glsl_program_lookup_resize(priv, priv->program_lookup_size * 2);
+
+    glsl_program_entry_get_key(entry, &key);
+    list_add_head(&priv->program_lookup[glsl_program_key_hash(&key) & (priv->program_lookup_size - 1)],
+            &entry->program_lookup_entry);
+    ++priv->program_count;
 }
 
 static struct glsl_shader_prog_link *get_glsl_program_entry(const struct shader_glsl_priv *priv,
         const struct glsl_program_key *key)
 {
-    struct wine_rb_entry *entry;
+    struct glsl_shader_prog_link *entry;
+    struct list *bucket;
+
+    bucket = &priv->program_lookup[glsl_program_key_hash(key) & (priv->program_lookup_size - 1)];
+    LIST_FOR_EACH_ENTRY(entry, bucket, struct glsl_shader_prog_link, program_lookup_entry)
+    {
+        if (entry->vs.id == key->vs_id && entry->ps.id == key->ps_id && entry->gs.id == key->gs_id
+                && entry->hs.id == key->hs_id && entry->ds.id == key->ds_id && entry->cs.id == key->cs_id)
+            return entry;
+    }
 
-    entry = wine_rb_get(&priv->program_lookup, key);
-    return entry ? WINE_RB_ENTRY_VALUE(entry, struct glsl_shader_prog_link, program_lookup_entry) : NULL;
+    return NULL;
 }
 
 /* Context activation is done by the caller. */
 static void delete_glsl_program_entry(struct shader_glsl_priv *priv, const struct wined3d_gl_info *gl_info,
         struct glsl_shader_prog_link *entry)
 {
-    wine_rb_remove(&priv->program_lookup, &entry->program_lookup_entry);
+    list_remove(&entry->program_lookup_entry);
+    --priv->program_count;
 
     GL_EXTCALL(glDeleteProgram(entry->id));
     if (entry->vs.id)
@@ -8386,6 +8627,63 @@ static GLuint shader_glsl_generate_compute_shader(const struct wined3d_context *
     return shader_id;
 }
 
+/* Shaders with only a few variants are searched linearly; the hash table is
+ * used for shaders that end up with many compile-args permutations. */
+#define GLSL_VARIANT_LINEAR_SEARCH_MAX 4
+
+static void shader_glsl_variant_index_insert(struct glsl_variant_index_entry *index,
+        unsigned int size, unsigned int hash, unsigned int idx)
+{
+    unsigned int slot;
+
+    for (slot = hash & (size - 1); index[slot].idx; slot = (slot + 1) & (size - 1));
+    index[slot].hash = hash;
+    index[slot].idx = idx;
+}
+
+/* Add the variant at "idx" in the gl_shaders array. */
+static void shader_glsl_variant_index_add(struct glsl_shader_private *shader_data,
+        unsigned int hash, unsigned int idx)
+{
+    struct glsl_variant_index_entry *new_index;
+    unsigned int i, new_size;
+
+    /* The index is built along with the variant array; if that failed once,
+     * stick to linear searches for this shader. */
+    if (!shader_data->variant_index && idx)
+        return;
+
+    if (shader_data->variant_index_size < 2 * (idx + 1))
+    {
+        new_size = max(8, 2 * shader_data->variant_index_size);
+        if (!(new_index = heap_calloc(new_size, sizeof(*new_index))))
+        {
+            /* Fall back to a linear search. */
+            heap_free(shader_data->variant_index);
+            shader_data->variant_index = NULL;
+            shader_data->variant_index_size = 0;
+            return;
+        }
+
+        for (i = 0; i < shader_data->variant_index_size; ++i)
+        {
+            if (shader_data->variant_index[i].idx)
+                shader_glsl_variant_index_insert(new_index, new_size,
+                        shader_data->variant_index[i].hash, shader_data->variant_index[i].idx);
+        }
+        heap_free(shader_data->variant_index);
+        shader_data->variant_index = new_index;
+        shader_data->variant_index_size = new_size;
+    }
+
+    shader_glsl_variant_index_insert(shader_data->variant_index, shader_data->variant_index_size, hash, idx + 1);
+}
+
+static unsigned int ps_args_hash(const struct ps_compile_args *args)
+{
+    return shader_glsl_hash(args, sizeof(*args), 2166136261u);
+}
+
 static GLuint find_glsl_pshader(const struct wined3d_context *context,
         struct wined3d_string_buffer *buffer, struct wined3d_string_buffer_list *string_buffers,
         struct wined3d_shader *shader,
@@ -8394,6 +8692,7 @@ static GLuint find_glsl_pshader(const struct wined3d_context *context,
     struct glsl_ps_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
     struct ps_np2fixup_info *np2fixup;
+    unsigned int hash, slot;
     UINT i;
     DWORD new_size;
     GLuint ret;
@@ -8413,13 +8712,33 @@ static GLuint find_glsl_pshader(const struct wined3d_context *context,
      * so a linear search is more performant than a hashmap or a binary search
      * (cache coherency etc)
      */
-    for (i = 0; i < shader_data->num_gl_shaders; ++i)
+    if (shader_data->num_gl_shaders <= GLSL_VARIANT_LINEAR_SEARCH_MAX || !shader_data->variant_index)
     {
-        if (!memcmp(&gl_shaders[i].args, args, sizeof(*args)))
+        for (i = 0; i < shader_data->num_gl_shaders; ++i)
         {
-            if (args->np2_fixup)
-                *np2fixup_info = &gl_shaders[i].np2fixup;
-            return gl_shaders[i].id;
+            if (!memcmp(&gl_shaders[i].args, args, sizeof(*args)))
+            {
+                if (args->np2_fixup)
+                    *np2fixup_info = &gl_shaders[i].np2fixup;
+                return gl_shaders[i].id;
+            }
+        }
+        hash = ps_args_hash(args);
+    }
+    else
+    {
+        unsigned int mask = shader_data->variant_index_size - 1;
+
+        hash = ps_args_hash(args);
+        for (slot = hash & mask; (i = shader_data->variant_index[slot].idx); slot = (slot + 1) & mask)
+        {
+            if (shader_data->variant_index[slot].hash == hash
+                    && !memcmp(&gl_shaders[i - 1].args, args, sizeof(*args)))
+            {
+                if (args->np2_fixup)
+                    *np2fixup_info = &gl_shaders[i - 1].np2fixup;
+                return gl_shaders[i - 1].id;
+            }
         }
     }
 
@@ -8456,6 +8775,7 @@ static GLuint find_glsl_pshader(const struct wined3d_context *context,
 
     string_buffer_clear(buffer);
     ret = shader_glsl_generate_pshader(context, buffer, string_buffers, shader, args, np2fixup);
+    shader_glsl_variant_index_add(shader_data, hash, shader_data->num_gl_shaders);
     gl_shaders[shader_data->num_gl_shaders++].id = ret;
 
     return ret;
@@ -8483,6 +8803,24 @@ static inline BOOL vs_args_equal(const struct vs_compile_args *stored, const str
     return !memcmp(stored->interpolation_mode, new->interpolation_mode, sizeof(new->interpolation_mode));
 }
 
+/* The swizzle map is not part of the hash, since vs_args_equal() only
+ * compares it for the attributes in use. */
+static unsigned int vs_args_hash(const struct vs_compile_args *args)
+{
+    BYTE flags[6];
+    unsigned int hash;
+
+    flags[0] = args->fog_src;
+    flags[1] = args->clip_enabled;
+    flags[2] = args->point_size;
+    flags[3] = args->per_vertex_point_size;
+    flags[4] = args->flatshading;
+    flags[5] = args->next_shader_type;
+    hash = shader_glsl_hash(flags, sizeof(flags), 2166136261u);
+    hash = shader_glsl_hash(&args->next_shader_input_count, sizeof(args->next_shader_input_count), hash);
+    return shader_glsl_hash(args->interpolation_mode, sizeof(args->interpolation_mode), hash);
+}
+
 static GLuint find_glsl_vshader(const struct wined3d_context *context, struct shader_glsl_priv *priv,
         struct wined3d_shader *shader, const struct vs_compile_args *args)
 {
@@ -8491,6 +8829,7 @@ static GLuint find_glsl_vshader(const struct wined3d_context *context, struct sh
     DWORD use_map = context->stream_info.use_map;
     struct glsl_vs_compiled_shader *gl_shaders, *new_array;
     struct glsl_shader_private *shader_data;
+    unsigned int hash, slot;
     GLuint ret;
 
     if (!shader->backend_data)
@@ -8508,10 +8847,26 @@ static GLuint find_glsl_vshader(const struct wined3d_context *context, struct sh
      * so a linear search is more performant than a hashmap or a binary search
      * (cache coherency etc)
      */
-    for (i = 0; i < shader_data->num_gl_shaders; ++i)
+    if (shader_data->num_gl_shaders <= GLSL_VARIANT_LINEAR_SEARCH_MAX || !shader_data->variant_index)
     {
-        if (vs_args_equal(&gl_shaders[i].args, args, use_map))
-            return gl_shaders[i].id;
+        for (i = 0; i < shader_data->num_gl_shaders; ++i)
+        {
+            if (vs_args_equal(&gl_shaders[i].args, args, use_map))
+                return gl_shaders[i].id;
+        }
+        hash = vs_args_hash(args);
+    }
+    else
+    {
+        unsigned int mask = shader_data->variant_index_size - 1;
+
+        hash = vs_args_hash(args);
+        for (slot = hash & mask; (i = shader_data->variant_index[slot].idx); slot = (slot + 1) & mask)
+        {
+            if (shader_data->variant_index[slot].hash == hash
+                    && vs_args_equal(&gl_shaders[i - 1].args, args, use_map))
+                return gl_shaders[i - 1].id;
+        }
     }
 
     TRACE("No matching GL shader found for shader %p, compiling a new shader.\n", shader);
@@ -8542,6 +8897,7 @@ static GLuint find_glsl_vshader(const struct wined3d_context *context, struct sh
 
     string_buffer_clear(&priv->shader_buffer);
     ret = shader_glsl_generate_vshader(context, priv, shader, args);
+    shader_glsl_variant_index_add(shader_data, hash, shader_data->num_gl_shaders);
     gl_shaders[shader_data->num_gl_shaders++].id = ret;
 
     return ret;
@@ -10041,9 +10397,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, priv, program_id, NULL);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10114,6 +10468,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     struct glsl_shader_prog_link *entry = NULL;
     struct wined3d_shader *vshader = NULL;
     struct wined3d_shader *pshader = NULL;
+    struct wined3d_shader_cache_key so_key;
     GLuint reorder_shader_id = 0;
     struct glsl_program_key key;
     GLuint program_id;
@@ -10236,6 +10591,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     }
 
     /* If we get to this point, then no matching program exists, so we create one */
+    wined3d_shader_cache_key_init(&so_key);
     program_id = GL_EXTCALL(glCreateProgram());
     TRACE("Created new GLSL shader program %u.\n", program_id);
 
@@ -10354,7 +10710,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         GL_EXTCALL(glAttachShader(program_id, gs_id));
         checkGLcall("glAttachShader");
 
-        shader_glsl_init_transform_feedback(context, priv, program_id, gshader);
+        shader_glsl_init_transform_feedback(context, priv, program_id, gshader, &so_key);
 
         list_add_head(&gshader->linked_programs, &entry->gs.shader_entry);
     }
@@ -10370,9 +10726,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     }
 
     /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, priv, program_id, &so_key);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -10691,6 +11045,8 @@ static void shader_glsl_destroy(struct wined3d_shader *shader)
 
     if (!shader_data || !shader_data->num_gl_shaders)
     {
+        if (shader_data)
+            heap_free(shader_data->variant_index);
         heap_free(shader_data);
         shader->backend_data = NULL;
         return;
@@ -10846,39 +11202,13 @@ static void shader_glsl_destroy(struct wined3d_shader *shader)
         }
     }
 
+    heap_free(shader_data->variant_index);
     heap_free(shader->backend_data);
     shader->backend_data = NULL;
 
     context_release(context);
 }
 
-static int glsl_program_key_compare(const void *key, const struct wine_rb_entry *entry)
-{
-    const struct glsl_program_key *k = key;
-    const struct glsl_shader_prog_link *prog = WINE_RB_ENTRY_VALUE(entry,
-            const struct glsl_shader_prog_link, program_lookup_entry);
-
-    if (k->vs_id > prog->vs.id) return 1;
-    else if (k->vs_id < prog->vs.id) return -1;
-
-    if (k->gs_id > prog->gs.id) return 1;
-    else if (k->gs_id < prog->gs.id) return -1;
-
-    if (k->ps_id > prog->ps.id) return 1;
-    else if (k->ps_id < prog->ps.id) return -1;
-
-    if (k->hs_id > prog->hs.id) return 1;
-    else if (k->hs_id < prog->hs.id) return -1;
-
-    if (k->ds_id > prog->ds.id) return 1;
-    else if (k->ds_id < prog->ds.id) return -1;
-
-    if (k->cs_id > prog->cs.id) return 1;
-    else if (k->cs_id < prog->cs.id) return -1;
-
-    return 0;
-}
-
 static BOOL constant_heap_init(struct constant_heap *heap, unsigned int constant_count)
 {
     SIZE_T size = (constant_count + 1) * sizeof(*heap->entries)
@@ -10959,7 +11289,11 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
         goto fail;
     }
 
-    wine_rb_init(&priv->program_lookup, glsl_program_key_compare);
+    if (!glsl_program_lookup_resize(priv, 64))
+    {
+        ERR("Failed to initialize program lookup table.\n");
+        goto fail;
+    }
 
     priv->next_constant_version = 1;
     priv->vertex_pipe = vertex_pipe;
@@ -10967,6 +11301,8 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     fragment_pipe->get_caps(device->adapter, &fragment_caps);
     priv->ffp_proj_control = fragment_caps.wined3d_caps & WINED3D_FRAGMENT_CAP_PROJ_CONTROL;
     priv->legacy_lighting = device->wined3d->flags & WINED3D_LEGACY_FFP_LIGHTING;
+    if (device->adapter->gl_info.supported[ARB_GET_PROGRAM_BINARY])
+        priv->program_cache = wined3d_shader_cache_acquire();
 
     device->vertex_priv = vertex_priv;
     device->fragment_priv = fragment_priv;
@@ -10975,6 +11311,7 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     return WINED3D_OK;
 
 fail:
+    heap_free(priv->program_lookup);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
     heap_free(priv->stack);
@@ -10990,7 +11327,9 @@ static void shader_glsl_free(struct wined3d_device *device, struct wined3d_conte
 {
     struct shader_glsl_priv *priv = device->shader_priv;
 
-    wine_rb_destroy(&priv->program_lookup, NULL, NULL);
+    if (priv->program_cache)
+        wined3d_shader_cache_release(priv->program_cache);
+    heap_free(priv->program_lookup);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
     heap_free(priv->stack);
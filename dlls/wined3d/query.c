@@ -28,41 +28,186 @@ WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 static void wined3d_query_buffer_invalidate(struct wined3d_query *query)
 {
     /* map[0] != map[1]: exact values do not have any significance. */
-    query->map_ptr[0] = 0;
-    query->map_ptr[1] = ~(UINT64)0;
+    query->buffer.map_ptr[0] = 0;
+    query->buffer.map_ptr[1] = ~(UINT64)0;
 }
 
 static BOOL wined3d_query_buffer_is_valid(struct wined3d_query *query)
 {
-    return query->map_ptr[0] == query->map_ptr[1];
+    return query->buffer.map_ptr[0] == query->buffer.map_ptr[1];
 }
 
-static void wined3d_query_create_buffer_object(struct wined3d_context *context, struct wined3d_query *query)
+/* Context activation is done by the caller. */
+static BOOL wined3d_query_buffer_pool_grow(struct wined3d_query_buffer_pool *pool, struct wined3d_context *context)
 {
+    static const GLbitfield map_flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    static const unsigned int slot_size = 2 * sizeof(UINT64);
     const struct wined3d_gl_info *gl_info = context->gl_info;
-    const GLuint map_flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    struct wined3d_query_buffer_slot *slot;
     GLuint buffer_object;
+    UINT64 *map_ptr;
+    unsigned int i;
+
+    /* Every slot is either free, retired or owned by a query, so reserving
+     * room for all of them means returning slots to the free list can't
+     * fail. */
+    if (!wined3d_array_reserve((void **)&pool->buffer_objects, &pool->buffer_objects_size,
+            pool->buffer_object_count + 1, sizeof(*pool->buffer_objects))
+            || !wined3d_array_reserve((void **)&pool->free_slots, &pool->free_slots_size,
+            (pool->buffer_object_count + 1) * WINED3D_QUERY_BUFFER_CHUNK_SLOTS, sizeof(*pool->free_slots)))
+        return FALSE;
 
     GL_EXTCALL(glGenBuffers(1, &buffer_object));
     GL_EXTCALL(glBindBuffer(GL_QUERY_BUFFER, buffer_object));
-    GL_EXTCALL(glBufferStorage(GL_QUERY_BUFFER, sizeof(query->map_ptr[0]) * 2, NULL, map_flags));
-    query->map_ptr = GL_EXTCALL(glMapBufferRange(GL_QUERY_BUFFER, 0, sizeof(query->map_ptr[0]) * 2, map_flags));
+    GL_EXTCALL(glBufferStorage(GL_QUERY_BUFFER, WINED3D_QUERY_BUFFER_CHUNK_SLOTS * slot_size, NULL, map_flags));
+    map_ptr = GL_EXTCALL(glMapBufferRange(GL_QUERY_BUFFER, 0, WINED3D_QUERY_BUFFER_CHUNK_SLOTS * slot_size, map_flags));
     GL_EXTCALL(glBindBuffer(GL_QUERY_BUFFER, 0));
     checkGLcall("query buffer object creation");
 
-    wined3d_query_buffer_invalidate(query);
-    query->buffer_object = buffer_object;
+    if (!map_ptr)
+    {
+        WARN("Failed to map query buffer object.\n");
+        GL_EXTCALL(glDeleteBuffers(1, &buffer_object));
+        return FALSE;
+    }
+
+    TRACE("Created query buffer object %u with %u slots.\n", buffer_object, WINED3D_QUERY_BUFFER_CHUNK_SLOTS);
+
+    pool->buffer_objects[pool->buffer_object_count++] = buffer_object;
+    for (i = WINED3D_QUERY_BUFFER_CHUNK_SLOTS; i--;)
+    {
+        slot = &pool->free_slots[pool->free_slot_count++];
+        slot->buffer_object = buffer_object;
+        slot->offset = i * slot_size;
+        slot->map_ptr = &map_ptr[i * 2];
+    }
+
+    return TRUE;
+}
+
+/* Return retired slots whose fence has been reached to the free list.
+ * Groups are fenced in order, so we can stop at the first pending one. */
+static void wined3d_query_buffer_pool_recycle(struct wined3d_query_buffer_pool *pool, struct wined3d_device *device)
+{
+    unsigned int group_count = 0, slot_count = 0;
+
+    while (group_count < pool->group_count
+            && wined3d_fence_test(pool->groups[group_count].fence, device, 0) == WINED3D_FENCE_OK)
+    {
+        wined3d_fence_destroy(pool->groups[group_count].fence);
+        slot_count += pool->groups[group_count++].slot_count;
+    }
+
+    if (!group_count)
+        return;
+
+    memcpy(&pool->free_slots[pool->free_slot_count], pool->retired_slots, slot_count * sizeof(*pool->retired_slots));
+    pool->free_slot_count += slot_count;
+
+    pool->retired_slot_count -= slot_count;
+    memmove(pool->retired_slots, &pool->retired_slots[slot_count],
+            pool->retired_slot_count * sizeof(*pool->retired_slots));
+    pool->group_count -= group_count;
+    memmove(pool->groups, &pool->groups[group_count], pool->group_count * sizeof(*pool->groups));
+}
+
+/* Context activation is done by the caller. */
+static BOOL wined3d_query_buffer_pool_alloc(struct wined3d_query_buffer_pool *pool,
+        struct wined3d_context *context, struct wined3d_query_buffer_slot *slot)
+{
+    if (!pool->free_slot_count)
+        wined3d_query_buffer_pool_recycle(pool, context->device);
+    if (!pool->free_slot_count && !wined3d_query_buffer_pool_grow(pool, context))
+        return FALSE;
+
+    *slot = pool->free_slots[--pool->free_slot_count];
+    return TRUE;
+}
+
+static void wined3d_query_buffer_pool_free(struct wined3d_query_buffer_pool *pool,
+        const struct wined3d_query_buffer_slot *slot)
+{
+    pool->free_slots[pool->free_slot_count++] = *slot;
+}
+
+/* The slot may still have a result write in flight. It can be reused once
+ * the next fence issued by wined3d_query_buffer_pool_fence() is reached. */
+static void wined3d_query_buffer_pool_retire(struct wined3d_query_buffer_pool *pool,
+        const struct wined3d_query_buffer_slot *slot)
+{
+    if (!wined3d_array_reserve((void **)&pool->retired_slots, &pool->retired_slots_size,
+            pool->retired_slot_count + 1, sizeof(*pool->retired_slots)))
+    {
+        ERR("Failed to grow retired slot array, leaking slot %u:%u.\n", slot->buffer_object, slot->offset);
+        return;
+    }
+
+    pool->retired_slots[pool->retired_slot_count++] = *slot;
+    ++pool->unfenced_slot_count;
+}
+
+static void wined3d_query_buffer_pool_fence(struct wined3d_query_buffer_pool *pool, struct wined3d_device *device)
+{
+    struct wined3d_fence *fence;
+    HRESULT hr;
+
+    if (!pool->unfenced_slot_count)
+        return;
+
+    if (!wined3d_array_reserve((void **)&pool->groups, &pool->groups_size,
+            pool->group_count + 1, sizeof(*pool->groups)))
+        return;
+
+    if (FAILED(hr = wined3d_fence_create(device, &fence)))
+    {
+        ERR("Failed to create fence, hr %#x.\n", hr);
+        return;
+    }
+    wined3d_fence_issue(fence, device);
+
+    pool->groups[pool->group_count].fence = fence;
+    pool->groups[pool->group_count++].slot_count = pool->unfenced_slot_count;
+    pool->unfenced_slot_count = 0;
 }
 
-static void wined3d_query_destroy_buffer_object(struct wined3d_context *context, struct wined3d_query *query)
+/* Context activation is done by the caller. */
+void wined3d_query_buffer_pool_destroy(struct wined3d_query_buffer_pool *pool, struct wined3d_context *context)
 {
     const struct wined3d_gl_info *gl_info = context->gl_info;
+    unsigned int i;
 
-    GL_EXTCALL(glDeleteBuffers(1, &query->buffer_object));
-    checkGLcall("query buffer object destruction");
+    for (i = 0; i < pool->group_count; ++i)
+        wined3d_fence_destroy(pool->groups[i].fence);
 
-    query->buffer_object = 0;
-    query->map_ptr = NULL;
+    if (pool->buffer_object_count)
+    {
+        GL_EXTCALL(glDeleteBuffers(pool->buffer_object_count, pool->buffer_objects));
+        checkGLcall("glDeleteBuffers");
+    }
+
+    heap_free(pool->buffer_objects);
+    heap_free(pool->free_slots);
+    heap_free(pool->retired_slots);
+    heap_free(pool->groups);
+    memset(pool, 0, sizeof(*pool));
+}
+
+/* Context activation is done by the caller. */
+static void wined3d_query_release_buffer(struct wined3d_context *context, struct wined3d_query *query)
+{
+    struct wined3d_query_buffer_pool *pool = &wined3d_device_gl(context->device)->query_buffer_pool;
+
+    if (wined3d_query_buffer_is_valid(query))
+    {
+        wined3d_query_buffer_pool_free(pool, &query->buffer);
+    }
+    else
+    {
+        wined3d_query_buffer_pool_retire(pool, &query->buffer);
+        wined3d_query_buffer_pool_fence(pool, context->device);
+    }
+
+    memset(&query->buffer, 0, sizeof(query->buffer));
 }
 
 /* From ARB_occlusion_query: "Querying the state for a given occlusion query
@@ -75,43 +220,58 @@ static void wined3d_query_destroy_buffer_object(struct wined3d_context *context,
  * instead of from the csmt-thread. */
 static BOOL wined3d_query_buffer_queue_result(struct wined3d_context *context, struct wined3d_query *query, GLuint id)
 {
+    struct wined3d_query_buffer_pool *pool = &wined3d_device_gl(context->device)->query_buffer_pool;
     const struct wined3d_gl_info *gl_info = context->gl_info;
     GLsync tmp_sync;
 
-    if (!gl_info->supported[ARB_QUERY_BUFFER_OBJECT] || !gl_info->supported[ARB_BUFFER_STORAGE])
+    if (!gl_info->supported[ARB_QUERY_BUFFER_OBJECT] || !gl_info->supported[ARB_BUFFER_STORAGE]
+            || !gl_info->supported[ARB_SYNC])
         return FALSE;
     /* Don't use query buffers without CSMT, mainly for simplicity. */
     if (!context->device->cs->thread)
         return FALSE;
 
-    if (query->buffer_object)
+    if (query->buffer.buffer_object && wined3d_query_buffer_is_valid(query))
     {
-        /* If there's still a query result in-flight for the existing buffer
-         * object (i.e., the query was restarted before we received its
-         * result), we can't reuse the existing buffer object. */
-        if (wined3d_query_buffer_is_valid(query))
-            wined3d_query_buffer_invalidate(query);
-        else
-            wined3d_query_destroy_buffer_object(context, query);
+        wined3d_query_buffer_invalidate(query);
+    }
+    else
+    {
+        /* If there's still a query result in-flight for the existing slot
+         * (i.e., the query was restarted before we received its result), we
+         * can't reuse it until the GPU is done writing to it. */
+        if (query->buffer.buffer_object)
+            wined3d_query_buffer_pool_retire(pool, &query->buffer);
+        if (!wined3d_query_buffer_pool_alloc(pool, context, &query->buffer))
+        {
+            memset(&query->buffer, 0, sizeof(query->buffer));
+            return FALSE;
+        }
+        wined3d_query_buffer_invalidate(query);
     }
 
-    if (!query->buffer_object)
-        wined3d_query_create_buffer_object(context, query);
-
-    GL_EXTCALL(glBindBuffer(GL_QUERY_BUFFER, query->buffer_object));
+    GL_EXTCALL(glBindBuffer(GL_QUERY_BUFFER, query->buffer.buffer_object));
     /* Read the same value twice. We know we have the result if map_ptr[0] == map_ptr[1]. */
-    GL_EXTCALL(glGetQueryObjectui64v(id, GL_QUERY_RESULT, (void *)0));
-    GL_EXTCALL(glGetQueryObjectui64v(id, GL_QUERY_RESULT, (void *)sizeof(query->map_ptr[0])));
+    GL_EXTCALL(glGetQueryObjectui64v(id, GL_QUERY_RESULT, (void *)(ULONG_PTR)query->buffer.offset));
+    GL_EXTCALL(glGetQueryObjectui64v(id, GL_QUERY_RESULT,
+            (void *)(ULONG_PTR)(query->buffer.offset + sizeof(*query->buffer.map_ptr))));
     GL_EXTCALL(glBindBuffer(GL_QUERY_BUFFER, 0));
     checkGLcall("queue query result");
 
     /* ARB_buffer_storage requires the client to call FenceSync with
      * SYNC_GPU_COMMANDS_COMPLETE after the server does a write. This behavior
-     * is not enforced by Mesa.
-     */
-    tmp_sync = GL_EXTCALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
-    GL_EXTCALL(glDeleteSync(tmp_sync));
-    checkGLcall("query buffer sync");
+     * is not enforced by Mesa. Slots retired since the last fence share
+     * a fence of their own, so we only need one when there are any. */
+    if (pool->unfenced_slot_count)
+    {
+        wined3d_query_buffer_pool_fence(pool, context->device);
+    }
+    else
+    {
+        tmp_sync = GL_EXTCALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        GL_EXTCALL(glDeleteSync(tmp_sync));
+        checkGLcall("query buffer sync");
+    }
 
     return TRUE;
 }
@@ -179,7 +339,7 @@ static BOOL wined3d_fence_supported(const struct wined3d_gl_info *gl_info)
     return gl_info->supported[ARB_SYNC] || gl_info->supported[NV_FENCE] || gl_info->supported[APPLE_FENCE];
 }
 
-static enum wined3d_fence_result wined3d_fence_test(const struct wined3d_fence *fence,
+enum wined3d_fence_result wined3d_fence_test(const struct wined3d_fence *fence,
         struct wined3d_device *device, DWORD flags)
 {
     const struct wined3d_gl_info *gl_info;
@@ -430,11 +590,11 @@ static void wined3d_query_destroy_object(void *object)
     if (!list_empty(&query->poll_list_entry))
         list_remove(&query->poll_list_entry);
 
-    if (query->buffer_object)
+    if (query->buffer.buffer_object)
     {
         struct wined3d_context *context;
         context = context_acquire(query->device, NULL, 0);
-        wined3d_query_destroy_buffer_object(context, query);
+        wined3d_query_release_buffer(context, query);
         context_release(context);
     }
 
@@ -463,6 +623,8 @@ ULONG CDECL wined3d_query_decref(struct wined3d_query *query)
 HRESULT CDECL wined3d_query_get_data(struct wined3d_query *query,
         void *data, UINT data_size, DWORD flags)
 {
+    const void *result = query->data;
+
     TRACE("query %p, data %p, data_size %u, flags %#x.\n",
             query, data, data_size, flags);
 
@@ -484,14 +646,16 @@ HRESULT CDECL wined3d_query_get_data(struct wined3d_query *query,
     if (query->device->cs->thread)
     {
         if (query->counter_main != query->counter_retrieved
-                || (query->buffer_object && !wined3d_query_buffer_is_valid(query)))
+                || (query->buffer.buffer_object && !wined3d_query_buffer_is_valid(query)))
         {
             if (flags & WINED3DGETDATA_FLUSH && !query->device->cs->queries_flushed)
                 wined3d_cs_emit_flush(query->device->cs);
             return S_FALSE;
         }
-        if (query->buffer_object)
-            query->data = query->map_ptr;
+        /* The result is read straight from the query buffer, without
+         * waiting for the CS thread. */
+        if (query->buffer.buffer_object)
+            result = query->buffer.map_ptr;
     }
     else if (!query->query_ops->query_poll(query, flags))
     {
@@ -499,7 +663,7 @@ HRESULT CDECL wined3d_query_get_data(struct wined3d_query *query,
     }
 
     if (data)
-        memcpy(data, query->data, min(data_size, query->data_size));
+        memcpy(data, result, min(data_size, query->data_size));
 
     return S_OK;
 }
@@ -754,6 +918,7 @@ static BOOL wined3d_timestamp_query_ops_issue(struct wined3d_query *query, DWORD
         wined3d_context_gl_alloc_timestamp_query(wined3d_context_gl(context), tq);
         GL_EXTCALL(glQueryCounter(tq->id, GL_TIMESTAMP));
         checkGLcall("glQueryCounter()");
+        wined3d_query_buffer_queue_result(context, query, tq->id);
         context_release(context);
 
         return TRUE;
@@ -0,0 +1,411 @@
+/*
+ * Persistent shader program cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* The cache stores opaque, driver specific blobs (e.g. GL program binaries)
+ * indexed by a 128-bit key. It is shared by all devices in the process, read
+ * from disk in a background thread when the first device is created, and
+ * written back when the last device goes away. The total size of the stored
+ * blobs is bounded; the least recently used entries are evicted first. */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include "wined3d_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
+
+#define WINED3D_SHADER_CACHE_MAGIC      0x43533357u /* "W3SC" */
+#define WINED3D_SHADER_CACHE_VERSION    1u
+
+struct wined3d_shader_cache_entry
+{
+    struct wine_rb_entry entry;
+    struct list lru_entry;
+    struct wined3d_shader_cache_key key;
+    DWORD format;
+    DWORD size;
+    BYTE data[1];
+};
+
+struct wined3d_shader_cache_file_header
+{
+    DWORD magic;
+    DWORD version;
+};
+
+struct wined3d_shader_cache_file_entry
+{
+    struct wined3d_shader_cache_key key;
+    DWORD format;
+    DWORD size;
+};
+
+struct wined3d_shader_cache
+{
+    LONG refcount;
+    CRITICAL_SECTION cs;
+    struct wine_rb_tree entries;
+    struct list lru; /* Most recently used entries first. */
+    SIZE_T size;
+    SIZE_T max_size;
+    BOOL dirty;
+
+    HANDLE load_thread;
+
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+};
+
+static struct wined3d_shader_cache *shader_cache;
+
+static CRITICAL_SECTION shader_cache_cs;
+static CRITICAL_SECTION_DEBUG shader_cache_cs_debug =
+{
+    0, 0, &shader_cache_cs,
+    {&shader_cache_cs_debug.ProcessLocksList,
+    &shader_cache_cs_debug.ProcessLocksList},
+    0, 0, {(DWORD_PTR)(__FILE__ ": shader_cache_cs")}
+};
+static CRITICAL_SECTION shader_cache_cs = {&shader_cache_cs_debug, -1, 0, 0, 0, 0};
+
+void wined3d_shader_cache_key_init(struct wined3d_shader_cache_key *key)
+{
+    key->hash[0] = 0xcbf29ce484222325ull;
+    key->hash[1] = 0x6a09e667f3bcc908ull;
+}
+
+/* Two independent 64-bit hashes; FNV-1a and a multiply/rotate mix. */
+void wined3d_shader_cache_key_update(struct wined3d_shader_cache_key *key, const void *data, SIZE_T size)
+{
+    const BYTE *ptr = data;
+    UINT64 h0 = key->hash[0];
+    UINT64 h1 = key->hash[1];
+    SIZE_T i;
+
+    for (i = 0; i < size; ++i)
+    {
+        h0 = (h0 ^ ptr[i]) * 0x100000001b3ull;
+        h1 = (h1 + ptr[i]) * 0x9e3779b97f4a7c15ull;
+        h1 ^= h1 >> 29;
+    }
+
+    key->hash[0] = h0;
+    key->hash[1] = h1;
+}
+
+static int wined3d_shader_cache_entry_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct wined3d_shader_cache_entry *e = WINE_RB_ENTRY_VALUE(entry, struct wined3d_shader_cache_entry, entry);
+    const struct wined3d_shader_cache_key *k = key;
+
+    if (k->hash[0] != e->key.hash[0])
+        return k->hash[0] < e->key.hash[0] ? -1 : 1;
+    if (k->hash[1] != e->key.hash[1])
+        return k->hash[1] < e->key.hash[1] ? -1 : 1;
+    return 0;
+}
+
+static void wined3d_shader_cache_remove_entry(struct wined3d_shader_cache *cache,
+        struct wined3d_shader_cache_entry *entry)
+{
+    wine_rb_remove(&cache->entries, &entry->entry);
+    list_remove(&entry->lru_entry);
+    cache->size -= entry->size;
+    heap_free(entry);
+}
+
+/* The caller should hold the cache lock. */
+static void wined3d_shader_cache_insert(struct wined3d_shader_cache *cache, const struct wined3d_shader_cache_key *key,
+        DWORD format, const void *data, DWORD size)
+{
+    struct wined3d_shader_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+    struct list *tail;
+
+    if (size > cache->max_size)
+        return;
+
+    if ((rb_entry = wine_rb_get(&cache->entries, key)))
+        wined3d_shader_cache_remove_entry(cache,
+                WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry));
+
+    while (cache->size + size > cache->max_size && (tail = list_tail(&cache->lru)))
+    {
+        wined3d_shader_cache_remove_entry(cache, LIST_ENTRY(tail, struct wined3d_shader_cache_entry, lru_entry));
+        ++cache->evictions;
+    }
+
+    if (!(entry = heap_alloc(FIELD_OFFSET(struct wined3d_shader_cache_entry, data[size]))))
+    {
+        ERR("Failed to allocate shader cache entry.\n");
+        return;
+    }
+    entry->key = *key;
+    entry->format = format;
+    entry->size = size;
+    memcpy(entry->data, data, size);
+
+    wine_rb_put(&cache->entries, &entry->key, &entry->entry);
+    list_add_head(&cache->lru, &entry->lru_entry);
+    cache->size += size;
+}
+
+static BOOL wined3d_shader_cache_read(HANDLE file, void *data, DWORD size)
+{
+    DWORD read;
+
+    return ReadFile(file, data, size, &read, NULL) && read == size;
+}
+
+static BOOL wined3d_shader_cache_write(HANDLE file, const void *data, DWORD size)
+{
+    DWORD written;
+
+    return WriteFile(file, data, size, &written, NULL) && written == size;
+}
+
+static DWORD WINAPI wined3d_shader_cache_load(void *ctx)
+{
+    struct wined3d_shader_cache *cache = ctx;
+    struct wined3d_shader_cache_file_header header;
+    struct wined3d_shader_cache_file_entry file_entry;
+    unsigned int count = 0;
+    void *data = NULL;
+    DWORD data_size = 0;
+    HANDLE file;
+
+    file = CreateFileA(wined3d_settings.shader_cache, GENERIC_READ, FILE_SHARE_READ,
+            NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        TRACE("No shader cache file %s.\n", debugstr_a(wined3d_settings.shader_cache));
+        return 0;
+    }
+
+    if (!wined3d_shader_cache_read(file, &header, sizeof(header))
+            || header.magic != WINED3D_SHADER_CACHE_MAGIC || header.version != WINED3D_SHADER_CACHE_VERSION)
+    {
+        WARN("Ignoring invalid shader cache file %s.\n", debugstr_a(wined3d_settings.shader_cache));
+        CloseHandle(file);
+        return 0;
+    }
+
+    while (wined3d_shader_cache_read(file, &file_entry, sizeof(file_entry)))
+    {
+        if (file_entry.size > cache->max_size)
+            break;
+
+        if (file_entry.size > data_size)
+        {
+            void *new_data;
+
+            if (!(new_data = heap_realloc(data, file_entry.size)))
+                break;
+            data = new_data;
+            data_size = file_entry.size;
+        }
+
+        if (!wined3d_shader_cache_read(file, data, file_entry.size))
+            break;
+
+        EnterCriticalSection(&cache->cs);
+        /* Entries created in the meantime are more recent than the ones on disk. */
+        if (!wine_rb_get(&cache->entries, &file_entry.key))
+            wined3d_shader_cache_insert(cache, &file_entry.key, file_entry.format, data, file_entry.size);
+        LeaveCriticalSection(&cache->cs);
+        ++count;
+    }
+
+    heap_free(data);
+    CloseHandle(file);
+
+    TRACE("Loaded %u entries from shader cache %s.\n", count, debugstr_a(wined3d_settings.shader_cache));
+
+    return 0;
+}
+
+static void wined3d_shader_cache_save(struct wined3d_shader_cache *cache)
+{
+    struct wined3d_shader_cache_file_header header;
+    struct wined3d_shader_cache_file_entry file_entry;
+    struct wined3d_shader_cache_entry *entry;
+    char *tmp_path;
+    SIZE_T len;
+    HANDLE file;
+    BOOL ret;
+
+    len = strlen(wined3d_settings.shader_cache);
+    if (!(tmp_path = heap_alloc(len + 5)))
+        return;
+    memcpy(tmp_path, wined3d_settings.shader_cache, len);
+    memcpy(tmp_path + len, ".tmp", 5);
+
+    file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create shader cache file %s, error %u.\n", debugstr_a(tmp_path), GetLastError());
+        heap_free(tmp_path);
+        return;
+    }
+
+    header.magic = WINED3D_SHADER_CACHE_MAGIC;
+    header.version = WINED3D_SHADER_CACHE_VERSION;
+    ret = wined3d_shader_cache_write(file, &header, sizeof(header));
+
+    /* Write the least recently used entries first, so that the LRU order is
+     * preserved when the file is read back. */
+    LIST_FOR_EACH_ENTRY_REV(entry, &cache->lru, struct wined3d_shader_cache_entry, lru_entry)
+    {
+        if (!ret)
+            break;
+        file_entry.key = entry->key;
+        file_entry.format = entry->format;
+        file_entry.size = entry->size;
+        ret = wined3d_shader_cache_write(file, &file_entry, sizeof(file_entry))
+                && wined3d_shader_cache_write(file, entry->data, entry->size);
+    }
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExA(tmp_path, wined3d_settings.shader_cache, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write shader cache file %s, error %u.\n",
+                debugstr_a(wined3d_settings.shader_cache), GetLastError());
+        DeleteFileA(tmp_path);
+    }
+    heap_free(tmp_path);
+}
+
+struct wined3d_shader_cache *wined3d_shader_cache_acquire(void)
+{
+    struct wined3d_shader_cache *cache;
+
+    if (!wined3d_settings.shader_cache || !wined3d_settings.shader_cache_size)
+        return NULL;
+
+    EnterCriticalSection(&shader_cache_cs);
+
+    if ((cache = shader_cache))
+    {
+        ++cache->refcount;
+        LeaveCriticalSection(&shader_cache_cs);
+        return cache;
+    }
+
+    if (!(cache = heap_alloc_zero(sizeof(*cache))))
+    {
+        LeaveCriticalSection(&shader_cache_cs);
+        return NULL;
+    }
+    cache->refcount = 1;
+    InitializeCriticalSection(&cache->cs);
+    cache->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": wined3d_shader_cache.cs");
+    wine_rb_init(&cache->entries, wined3d_shader_cache_entry_compare);
+    list_init(&cache->lru);
+    cache->max_size = (SIZE_T)wined3d_settings.shader_cache_size * 1024 * 1024;
+
+    /* Warm the cache up while the application is busy creating its resources. */
+    if (!(cache->load_thread = CreateThread(NULL, 0, wined3d_shader_cache_load, cache, 0, NULL)))
+        ERR("Failed to create shader cache load thread, error %u.\n", GetLastError());
+
+    shader_cache = cache;
+    LeaveCriticalSection(&shader_cache_cs);
+
+    TRACE("Created shader cache %p, file %s, maximum size %lu bytes.\n",
+            cache, debugstr_a(wined3d_settings.shader_cache), cache->max_size);
+
+    return cache;
+}
+
+void wined3d_shader_cache_release(struct wined3d_shader_cache *cache)
+{
+    struct wined3d_shader_cache_entry *entry, *next;
+
+    EnterCriticalSection(&shader_cache_cs);
+    if (--cache->refcount)
+    {
+        LeaveCriticalSection(&shader_cache_cs);
+        return;
+    }
+    shader_cache = NULL;
+    LeaveCriticalSection(&shader_cache_cs);
+
+    if (cache->load_thread)
+    {
+        WaitForSingleObject(cache->load_thread, INFINITE);
+        CloseHandle(cache->load_thread);
+    }
+
+    TRACE_(d3d_perf)("Shader cache %p: %u hits, %u misses, %u evictions, %u entries, %lu bytes.\n",
+            cache, cache->hits, cache->misses, cache->evictions, list_count(&cache->lru), cache->size);
+
+    if (cache->dirty)
+        wined3d_shader_cache_save(cache);
+
+    LIST_FOR_EACH_ENTRY_SAFE(entry, next, &cache->lru, struct wined3d_shader_cache_entry, lru_entry)
+    {
+        heap_free(entry);
+    }
+    cache->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&cache->cs);
+    heap_free(cache);
+}
+
+/* On success, the returned data should be freed with heap_free(). */
+BOOL wined3d_shader_cache_get(struct wined3d_shader_cache *cache, const struct wined3d_shader_cache_key *key,
+        DWORD *format, void **data, SIZE_T *size)
+{
+    struct wined3d_shader_cache_entry *entry;
+    struct wine_rb_entry *rb_entry;
+    BOOL ret = FALSE;
+
+    EnterCriticalSection(&cache->cs);
+    if ((rb_entry = wine_rb_get(&cache->entries, key)))
+    {
+        entry = WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_cache_entry, entry);
+        if ((*data = heap_alloc(entry->size)))
+        {
+            memcpy(*data, entry->data, entry->size);
+            *format = entry->format;
+            *size = entry->size;
+            list_remove(&entry->lru_entry);
+            list_add_head(&cache->lru, &entry->lru_entry);
+            ret = TRUE;
+        }
+    }
+    if (ret)
+        ++cache->hits;
+    else
+        ++cache->misses;
+    LeaveCriticalSection(&cache->cs);
+
+    return ret;
+}
+
+void wined3d_shader_cache_put(struct wined3d_shader_cache *cache, const struct wined3d_shader_cache_key *key,
+        DWORD format, const void *data, SIZE_T size)
+{
+    if (size > ~0u)
+        return;
+
+    EnterCriticalSection(&cache->cs);
+    wined3d_shader_cache_insert(cache, key, format, data, size);
+    cache->dirty = TRUE;
+    LeaveCriticalSection(&cache->cs);
+}
@@ -331,67 +331,41 @@ BOOL fbo_blitter_supported(enum wined3d_blit_op blit_op, const struct wined3d_gl
     return TRUE;
 }
 
-/* See also float_16_to_32() in wined3d_private.h */
+/* See also float_16_to_32() in wined3d_private.h. This works on the bit
+ * pattern directly; the mantissa is rounded to nearest, away from zero. */
 static inline unsigned short float_32_to_16(const float *in)
 {
-    int exp = 0;
-    float tmp = fabsf(*in);
-    unsigned int mantissa;
-    unsigned short ret;
+    unsigned int bits, exponent, mantissa;
+    unsigned short sign;
+    int exp;
+
+    memcpy(&bits, in, sizeof(bits));
+    sign = (bits >> 16) & 0x8000;
+    exponent = (bits >> 23) & 0xff;
 
     /* Deal with special numbers */
-    if (*in == 0.0f)
+    if (exponent == 0xff)
+        return (bits & 0x7fffff) ? 0x7c01 : sign | 0x7c00;
+    if (!(bits & 0x7fffffff))
         return 0x0000;
-    if (isnan(*in))
-        return 0x7c01;
-    if (isinf(*in))
-        return (*in < 0.0f ? 0xfc00 : 0x7c00);
-
-    if (tmp < (float)(1u << 10))
-    {
-        do
-        {
-            tmp = tmp * 2.0f;
-            exp--;
-        } while (tmp < (float)(1u << 10));
-    }
-    else if (tmp >= (float)(1u << 11))
-    {
-        do
-        {
-            tmp /= 2.0f;
-            exp++;
-        } while (tmp >= (float)(1u << 11));
-    }
+    if (!exponent)
+        return sign;
 
-    mantissa = (unsigned int)tmp;
-    if (tmp - mantissa >= 0.5f)
-        ++mantissa; /* Round to nearest, away from zero. */
-
-    exp += 10;  /* Normalize the mantissa. */
-    exp += 15;  /* Exponent is encoded with excess 15. */
+    /* 11 bits of mantissa, including the implicit leading one. */
+    mantissa = (((bits & 0x7fffff) | 0x800000) + 0x1000) >> 13;
+    /* Rebias the exponent from excess 127 to excess 15. */
+    exp = exponent - 112;
 
     if (exp > 30) /* too big */
+        return sign | 0x7c00; /* INF */
+    if (exp <= 0)
     {
-        ret = 0x7c00; /* INF */
-    }
-    else if (exp <= 0)
-    {
-        /* exp == 0: Non-normalized mantissa. Returns 0x0000 (=0.0) for too small numbers. */
-        while (exp <= 0)
-        {
-            mantissa = mantissa >> 1;
-            ++exp;
-        }
-        ret = mantissa & 0x3ff;
-    }
-    else
-    {
-        ret = (exp << 10) | (mantissa & 0x3ff);
+        /* Non-normalized mantissa. Returns 0x0000 (=0.0) for too small numbers. */
+        if (1 - exp >= 32)
+            return sign;
+        return sign | ((mantissa >> (1 - exp)) & 0x3ff);
     }
-
-    ret |= ((*in < 0.0f ? 1 : 0) << 15); /* Add the sign */
-    return ret;
+    return sign | (exp << 10) | (mantissa & 0x3ff);
 }
 
 static void convert_r32_float_r16_float(const BYTE *src, BYTE *dst,
@@ -480,10 +454,51 @@ static inline BYTE cliptobyte(int x)
     return (BYTE)((x < 0) ? 0 : ((x > 255) ? 255 : x));
 }
 
+/* YUV to RGB conversion formulas from http://en.wikipedia.org/wiki/YUV:
+ *     C = Y - 16; D = U - 128; E = V - 128;
+ *     R = cliptobyte((298 * C + 409 * E + 128) >> 8);
+ *     G = cliptobyte((298 * C - 100 * D - 208 * E + 128) >> 8);
+ *     B = cliptobyte((298 * C + 516 * D + 128) >> 8);
+ * Two adjacent YUY2 pixels are stored as four bytes: Y0 U Y1 V .
+ * U and V are shared between the pixels, so we convert pixel pairs. */
+struct yuy2_chroma
+{
+    int r, g, b;
+};
+
+static inline void yuy2_get_chroma(const BYTE *src, struct yuy2_chroma *chroma)
+{
+    int d = (int)src[1] - 128;
+    int e = (int)src[3] - 128;
+
+    chroma->r = 409 * e + 128;
+    chroma->g = -100 * d - 208 * e + 128;
+    chroma->b = 516 * d + 128;
+}
+
+static inline DWORD yuy2_to_x8r8g8b8(BYTE y, const struct yuy2_chroma *chroma)
+{
+    int c = 298 * ((int)y - 16);
+
+    return 0xff000000
+            | cliptobyte((c + chroma->r) >> 8) << 16    /* red   */
+            | cliptobyte((c + chroma->g) >> 8) << 8     /* green */
+            | cliptobyte((c + chroma->b) >> 8);         /* blue  */
+}
+
+static inline WORD yuy2_to_r5g6b5(BYTE y, const struct yuy2_chroma *chroma)
+{
+    int c = 298 * ((int)y - 16);
+
+    return (cliptobyte((c + chroma->r) >> 8) >> 3) << 11   /* red   */
+            | (cliptobyte((c + chroma->g) >> 8) >> 2) << 5 /* green */
+            | (cliptobyte((c + chroma->b) >> 8) >> 3);     /* blue  */
+}
+
 static void convert_yuy2_x8r8g8b8(const BYTE *src, BYTE *dst,
         DWORD pitch_in, DWORD pitch_out, unsigned int w, unsigned int h)
 {
-    int c2, d, e, r2 = 0, g2 = 0, b2 = 0;
+    struct yuy2_chroma chroma;
     unsigned int x, y;
 
     TRACE("Converting %ux%u pixels, pitches %u %u.\n", w, h, pitch_in, pitch_out);
@@ -492,32 +507,17 @@ static void convert_yuy2_x8r8g8b8(const BYTE *src, BYTE *dst,
     {
         const BYTE *src_line = src + y * pitch_in;
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+
+        for (x = 0; x + 1 < w; x += 2, src_line += 4)
         {
-            /* YUV to RGB conversion formulas from http://en.wikipedia.org/wiki/YUV:
-             *     C = Y - 16; D = U - 128; E = V - 128;
-             *     R = cliptobyte((298 * C + 409 * E + 128) >> 8);
-             *     G = cliptobyte((298 * C - 100 * D - 208 * E + 128) >> 8);
-             *     B = cliptobyte((298 * C + 516 * D + 128) >> 8);
-             * Two adjacent YUY2 pixels are stored as four bytes: Y0 U Y1 V .
-             * U and V are shared between the pixels. */
-            if (!(x & 1)) /* For every even pixel, read new U and V. */
-            {
-                d = (int) src_line[1] - 128;
-                e = (int) src_line[3] - 128;
-                r2 = 409 * e + 128;
-                g2 = - 100 * d - 208 * e + 128;
-                b2 = 516 * d + 128;
-            }
-            c2 = 298 * ((int) src_line[0] - 16);
-            dst_line[x] = 0xff000000
-                | cliptobyte((c2 + r2) >> 8) << 16    /* red   */
-                | cliptobyte((c2 + g2) >> 8) << 8     /* green */
-                | cliptobyte((c2 + b2) >> 8);         /* blue  */
-                /* Scale RGB values to 0..255 range,
-                 * then clip them if still not in range (may be negative),
-                 * then shift them within DWORD if necessary. */
-            src_line += 2;
+            yuy2_get_chroma(src_line, &chroma);
+            dst_line[x] = yuy2_to_x8r8g8b8(src_line[0], &chroma);
+            dst_line[x + 1] = yuy2_to_x8r8g8b8(src_line[2], &chroma);
+        }
+        if (x < w)
+        {
+            yuy2_get_chroma(src_line, &chroma);
+            dst_line[x] = yuy2_to_x8r8g8b8(src_line[0], &chroma);
         }
     }
 }
@@ -525,8 +525,8 @@ static void convert_yuy2_x8r8g8b8(const BYTE *src, BYTE *dst,
 static void convert_yuy2_r5g6b5(const BYTE *src, BYTE *dst,
         DWORD pitch_in, DWORD pitch_out, unsigned int w, unsigned int h)
 {
+    struct yuy2_chroma chroma;
     unsigned int x, y;
-    int c2, d, e, r2 = 0, g2 = 0, b2 = 0;
 
     TRACE("Converting %ux%u pixels, pitches %u %u\n", w, h, pitch_in, pitch_out);
 
@@ -534,31 +534,17 @@ static void convert_yuy2_r5g6b5(const BYTE *src, BYTE *dst,
     {
         const BYTE *src_line = src + y * pitch_in;
         WORD *dst_line = (WORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+
+        for (x = 0; x + 1 < w; x += 2, src_line += 4)
         {
-            /* YUV to RGB conversion formulas from http://en.wikipedia.org/wiki/YUV:
-             *     C = Y - 16; D = U - 128; E = V - 128;
-             *     R = cliptobyte((298 * C + 409 * E + 128) >> 8);
-             *     G = cliptobyte((298 * C - 100 * D - 208 * E + 128) >> 8);
-             *     B = cliptobyte((298 * C + 516 * D + 128) >> 8);
-             * Two adjacent YUY2 pixels are stored as four bytes: Y0 U Y1 V .
-             * U and V are shared between the pixels. */
-            if (!(x & 1)) /* For every even pixel, read new U and V. */
-            {
-                d = (int) src_line[1] - 128;
-                e = (int) src_line[3] - 128;
-                r2 = 409 * e + 128;
-                g2 = - 100 * d - 208 * e + 128;
-                b2 = 516 * d + 128;
-            }
-            c2 = 298 * ((int) src_line[0] - 16);
-            dst_line[x] = (cliptobyte((c2 + r2) >> 8) >> 3) << 11   /* red   */
-                | (cliptobyte((c2 + g2) >> 8) >> 2) << 5            /* green */
-                | (cliptobyte((c2 + b2) >> 8) >> 3);                /* blue  */
-                /* Scale RGB values to 0..255 range,
-                 * then clip them if still not in range (may be negative),
-                 * then shift them within DWORD if necessary. */
-            src_line += 2;
+            yuy2_get_chroma(src_line, &chroma);
+            dst_line[x] = yuy2_to_r5g6b5(src_line[0], &chroma);
+            dst_line[x + 1] = yuy2_to_r5g6b5(src_line[2], &chroma);
+        }
+        if (x < w)
+        {
+            yuy2_get_chroma(src_line, &chroma);
+            dst_line[x] = yuy2_to_r5g6b5(src_line[0], &chroma);
         }
     }
 }
@@ -2522,6 +2508,7 @@ do { \
     }
     else
     {
+        BOOL dst_ckey = !!(flags & (WINED3D_BLT_DST_CKEY | WINED3D_BLT_DST_CKEY_OVERRIDE));
         LONG dstyinc = dst_map.row_pitch, dstxinc = bpp;
         DWORD keylow = 0xffffffff, keyhigh = 0, keymask = 0xffffffff;
         DWORD destkeylow = 0x0, destkeyhigh = 0xffffffff, destkeymask = 0xffffffff;
@@ -2671,16 +2658,44 @@ do { \
     } \
 } while(0)
 
+/* Source colour keying without destination keys or mirroring, by far the
+ * most common case for ddraw sprite blits. */
+#define COPY_SRC_COLORKEY(type) \
+do { \
+    const type *s; \
+    type *d = (type *)dbuf, tmp; \
+    for (y = sy = 0; y < dst_height; ++y, sy += yinc) \
+    { \
+        s = (const type *)(sbase + (sy >> 16) * src_map.row_pitch); \
+        for (x = sx = 0; x < dst_width; ++x, sx += xinc) \
+        { \
+            tmp = s[sx >> 16]; \
+            if ((tmp & keymask) < keylow || (tmp & keymask) > keyhigh) \
+                d[x] = tmp; \
+        } \
+        d = (type *)(((BYTE *)d) + dstyinc); \
+    } \
+} while(0)
+
         switch (bpp)
         {
             case 1:
-                COPY_COLORKEY_FX(BYTE);
+                if (!dst_ckey && dstxinc == bpp)
+                    COPY_SRC_COLORKEY(BYTE);
+                else
+                    COPY_COLORKEY_FX(BYTE);
                 break;
             case 2:
-                COPY_COLORKEY_FX(WORD);
+                if (!dst_ckey && dstxinc == bpp)
+                    COPY_SRC_COLORKEY(WORD);
+                else
+                    COPY_COLORKEY_FX(WORD);
                 break;
             case 4:
-                COPY_COLORKEY_FX(DWORD);
+                if (!dst_ckey && dstxinc == bpp)
+                    COPY_SRC_COLORKEY(DWORD);
+                else
+                    COPY_COLORKEY_FX(DWORD);
                 break;
             case 3:
             {
@@ -2715,6 +2730,7 @@ do { \
                 hr = WINED3DERR_NOTAVAILABLE;
                 goto error;
 #undef COPY_COLORKEY_FX
+#undef COPY_SRC_COLORKEY
         }
     }
 
@@ -537,6 +537,8 @@ static void swapchain_gl_present(struct wined3d_swapchain *swapchain,
     gl_info->gl_ops.wgl.p_wglSwapBuffers(context_gl->dc);
 
     wined3d_swapchain_gl_rotate(swapchain, context);
+    wined3d_upload_ring_end_frame(&wined3d_device_gl(swapchain->device)->upload_ring);
+    wined3d_state_stats_end_frame(&wined3d_device_gl(swapchain->device)->state_stats);
 
     TRACE("SwapBuffers called, Starting new frame\n");
     /* FPS support */
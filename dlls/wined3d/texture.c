@@ -1907,6 +1907,145 @@ HRESULT CDECL wined3d_texture_add_dirty_region(struct wined3d_texture *texture,
     return WINED3D_OK;
 }
 
+#define WINED3D_UPLOAD_RING_ALIGNMENT   256u
+#define WINED3D_UPLOAD_RING_MIN_SIZE    0x1000u
+
+/* Context activation is done by the caller. */
+static BOOL wined3d_upload_ring_init(struct wined3d_upload_ring *ring, struct wined3d_context *context)
+{
+    static const GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+
+    if (!gl_info->supported[ARB_BUFFER_STORAGE] || !gl_info->supported[ARB_SYNC]
+            || !gl_info->supported[ARB_PIXEL_BUFFER_OBJECT] || !gl_info->supported[ARB_MAP_BUFFER_RANGE])
+        return FALSE;
+
+    GL_EXTCALL(glGenBuffers(1, &ring->buffer_object));
+    GL_EXTCALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffer_object));
+    GL_EXTCALL(glBufferStorage(GL_PIXEL_UNPACK_BUFFER, WINED3D_UPLOAD_RING_SIZE, NULL, map_flags));
+    ring->map_ptr = GL_EXTCALL(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, WINED3D_UPLOAD_RING_SIZE, map_flags));
+    GL_EXTCALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    checkGLcall("create upload ring");
+
+    if (!ring->map_ptr)
+    {
+        WARN("Failed to map the upload ring.\n");
+        GL_EXTCALL(glDeleteBuffers(1, &ring->buffer_object));
+        ring->buffer_object = 0;
+        return FALSE;
+    }
+
+    TRACE("Created upload ring %u, %u bytes at %p.\n", ring->buffer_object,
+            WINED3D_UPLOAD_RING_SIZE, ring->map_ptr);
+
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+void wined3d_upload_ring_destroy(struct wined3d_upload_ring *ring, struct wined3d_context *context)
+{
+    const struct wined3d_gl_info *gl_info = context->gl_info;
+    unsigned int i;
+
+    if (ring->buffer_object)
+    {
+        GL_EXTCALL(glDeleteBuffers(1, &ring->buffer_object));
+        checkGLcall("glDeleteBuffers");
+    }
+
+    for (i = 0; i < ARRAY_SIZE(ring->fences); ++i)
+    {
+        if (ring->fences[i])
+            wined3d_fence_destroy(ring->fences[i]);
+    }
+
+    memset(ring, 0, sizeof(*ring));
+}
+
+/* Returns a pointer to "size" bytes of staging memory, and their offset in
+ * the ring's buffer object. Context activation is done by the caller. */
+static BYTE *wined3d_upload_ring_map(struct wined3d_upload_ring *ring, struct wined3d_device *device,
+        struct wined3d_context *context, SIZE_T size, SIZE_T *offset)
+{
+    const SIZE_T segment_size = WINED3D_UPLOAD_RING_SIZE / WINED3D_UPLOAD_RING_SEGMENT_COUNT;
+    unsigned int next;
+    SIZE_T head;
+    HRESULT hr;
+
+    if (ring->disabled || !size || size > segment_size)
+        return NULL;
+
+    if (!ring->buffer_object && !wined3d_upload_ring_init(ring, context))
+    {
+        ring->disabled = TRUE;
+        return NULL;
+    }
+
+    head = (ring->head + WINED3D_UPLOAD_RING_ALIGNMENT - 1) & ~(SIZE_T)(WINED3D_UPLOAD_RING_ALIGNMENT - 1);
+    if (head + size > (ring->segment + 1) * segment_size)
+    {
+        if (!ring->fences[ring->segment] && FAILED(hr = wined3d_fence_create(device, &ring->fences[ring->segment])))
+        {
+            ERR("Failed to create fence, hr %#x.\n", hr);
+            ring->disabled = TRUE;
+            return NULL;
+        }
+        wined3d_fence_issue(ring->fences[ring->segment], device);
+
+        next = (ring->segment + 1) % WINED3D_UPLOAD_RING_SEGMENT_COUNT;
+        if (ring->fences[next] && wined3d_fence_test(ring->fences[next], device, 0) == WINED3D_FENCE_WAITING)
+        {
+            ++ring->wait_count;
+            if (wined3d_fence_wait(ring->fences[next], device) == WINED3D_FENCE_ERROR)
+                context->gl_info->gl_ops.gl.p_glFinish();
+        }
+
+        ring->segment = next;
+        head = next * segment_size;
+    }
+
+    ring->head = head + size;
+    *offset = head;
+    return ring->map_ptr + head;
+}
+
+void wined3d_upload_ring_end_frame(struct wined3d_upload_ring *ring)
+{
+    LARGE_INTEGER frequency;
+
+    if (!ring->upload_count)
+        return;
+
+    if (TRACE_ON(d3d_perf))
+    {
+        QueryPerformanceFrequency(&frequency);
+        TRACE_(d3d_perf)("%u texture uploads (%u staged, %u ring waits), %s bytes, %s us.\n",
+                ring->upload_count, ring->staged_count, ring->wait_count,
+                wine_dbgstr_longlong(ring->upload_bytes),
+                wine_dbgstr_longlong(ring->upload_time * 1000000 / frequency.QuadPart));
+    }
+
+    ring->upload_count = ring->staged_count = ring->wait_count = 0;
+    ring->upload_bytes = 0;
+    ring->upload_time = 0;
+}
+
+/* The number of bytes an upload reads from its source, or 0 if unknown. */
+static SIZE_T wined3d_texture_get_upload_size(const struct wined3d_format *format,
+        unsigned int w, unsigned int h, unsigned int d, unsigned int row_pitch, unsigned int slice_pitch)
+{
+    unsigned int row_size, rows_size;
+
+    if (!w || !h || !d || (format->flags[WINED3D_GL_RES_TYPE_TEX_2D] & WINED3DFMT_FLAG_HEIGHT_SCALE))
+        return 0;
+
+    wined3d_format_calculate_pitch(format, 1, w, h, &row_size, &rows_size);
+    if (!row_size)
+        return 0;
+
+    return (SIZE_T)(d - 1) * slice_pitch + (SIZE_T)(rows_size / row_size - 1) * row_pitch + row_size;
+}
+
 /* This call just uploads data, the caller is responsible for binding the
  * correct texture. */
 /* Context activation is done by the caller. */
@@ -1915,15 +2054,19 @@ void wined3d_texture_upload_data(struct wined3d_texture *texture, unsigned int s
         const struct wined3d_const_bo_address *data, unsigned int src_row_pitch, unsigned int src_slice_pitch,
         unsigned int dst_x, unsigned int dst_y, unsigned int dst_z, BOOL srgb)
 {
+    struct wined3d_upload_ring *ring = &wined3d_device_gl(texture->resource.device)->upload_ring;
     struct wined3d_context_gl *context_gl = wined3d_context_gl(context);
     const struct wined3d_gl_info *gl_info = context->gl_info;
     unsigned int update_w = src_box->right - src_box->left;
     unsigned int update_h = src_box->bottom - src_box->top;
     unsigned int update_d = src_box->back - src_box->front;
     const struct wined3d_format_gl *format_gl;
+    LARGE_INTEGER start_time, end_time;
+    SIZE_T ring_offset, upload_size;
     struct wined3d_bo_address bo;
     void *converted_mem = NULL;
     struct wined3d_format_gl f;
+    BYTE *ring_mem = NULL;
     unsigned int level;
     BOOL decompress;
     GLenum target;
@@ -1977,12 +2120,17 @@ void wined3d_texture_upload_data(struct wined3d_texture *texture, unsigned int s
         bo.addr += src_box->left * format->byte_count;
     }
 
+    if (TRACE_ON(d3d_perf))
+        QueryPerformanceCounter(&start_time);
+    upload_size = wined3d_texture_get_upload_size(format, update_w, update_h, update_d,
+            src_row_pitch, src_slice_pitch);
+
     decompress = texture->resource.format_flags & WINED3DFMT_FLAG_DECOMPRESS;
     if (format->upload || decompress)
     {
         const struct wined3d_format *compressed_format = format;
         unsigned int dst_row_pitch, dst_slice_pitch;
-        void *src_mem;
+        void *src_mem, *dst_mem;
 
         if (decompress)
         {
@@ -2000,9 +2148,15 @@ void wined3d_texture_upload_data(struct wined3d_texture *texture, unsigned int s
 
         wined3d_format_calculate_pitch(format, 1, update_w, update_h, &dst_row_pitch, &dst_slice_pitch);
 
-        /* Note that uploading 3D textures may require quite some address
-         * space; it may make sense to upload them per-slice instead. */
-        if (!(converted_mem = heap_calloc(update_d, dst_slice_pitch)))
+        /* Convert straight into the upload ring if we can. Note that
+         * uploading 3D textures may require quite some address space; it may
+         * make sense to upload them per-slice instead. */
+        if ((ring_mem = wined3d_upload_ring_map(ring, texture->resource.device, context,
+                (SIZE_T)update_d * dst_slice_pitch, &ring_offset)))
+        {
+            dst_mem = ring_mem;
+        }
+        else if (!(dst_mem = converted_mem = heap_calloc(update_d, dst_slice_pitch)))
         {
             ERR("Failed to allocate upload buffer.\n");
             return;
@@ -2011,18 +2165,36 @@ void wined3d_texture_upload_data(struct wined3d_texture *texture, unsigned int s
         src_mem = wined3d_context_gl_map_bo_address(context_gl, &bo,
                 src_slice_pitch, GL_PIXEL_UNPACK_BUFFER, WINED3D_MAP_READ);
         if (decompress)
-            compressed_format->decompress(src_mem, converted_mem, src_row_pitch, src_slice_pitch,
+            compressed_format->decompress(src_mem, dst_mem, src_row_pitch, src_slice_pitch,
                     dst_row_pitch, dst_slice_pitch, update_w, update_h, update_d);
         else
-            format->upload(src_mem, converted_mem, src_row_pitch, src_slice_pitch,
+            format->upload(src_mem, dst_mem, src_row_pitch, src_slice_pitch,
                     dst_row_pitch, dst_slice_pitch, update_w, update_h, update_d);
         wined3d_context_gl_unmap_bo_address(context_gl, &bo, GL_PIXEL_UNPACK_BUFFER);
 
-        bo.buffer_object = 0;
-        bo.addr = converted_mem;
+        if (ring_mem)
+        {
+            bo.buffer_object = ring->buffer_object;
+            bo.addr = (BYTE *)ring_offset;
+        }
+        else
+        {
+            bo.buffer_object = 0;
+            bo.addr = converted_mem;
+        }
         src_row_pitch = dst_row_pitch;
         src_slice_pitch = dst_slice_pitch;
     }
+    else if (!bo.buffer_object && upload_size >= WINED3D_UPLOAD_RING_MIN_SIZE
+            && (ring_mem = wined3d_upload_ring_map(ring, texture->resource.device, context,
+            upload_size, &ring_offset)))
+    {
+        /* Staging the data in a buffer object lets the driver copy it to the
+         * texture asynchronously, instead of during glTexSubImage*(). */
+        memcpy(ring_mem, bo.addr, upload_size);
+        bo.buffer_object = ring->buffer_object;
+        bo.addr = (BYTE *)ring_offset;
+    }
 
     if (bo.buffer_object)
     {
@@ -2133,6 +2305,16 @@ void wined3d_texture_upload_data(struct wined3d_texture *texture, unsigned int s
     }
     heap_free(converted_mem);
 
+    ++ring->upload_count;
+    ring->upload_bytes += upload_size;
+    if (ring_mem)
+        ++ring->staged_count;
+    if (TRACE_ON(d3d_perf))
+    {
+        QueryPerformanceCounter(&end_time);
+        ring->upload_time += end_time.QuadPart - start_time.QuadPart;
+    }
+
     if (gl_info->quirks & WINED3D_QUIRK_FBO_TEX_UPDATE)
     {
         struct wined3d_device *device = texture->resource.device;
@@ -54,6 +54,7 @@
 @ cdecl wined3d_device_draw_primitive(ptr long long)
 @ cdecl wined3d_device_draw_primitive_instanced(ptr long long long long)
 @ cdecl wined3d_device_draw_primitive_instanced_indirect(ptr ptr long)
+@ cdecl wined3d_device_draw_primitive_up(ptr ptr long long)
 @ cdecl wined3d_device_end_scene(ptr)
 @ cdecl wined3d_device_end_stateblock(ptr ptr)
 @ cdecl wined3d_device_evict_managed_resources(ptr)
@@ -119,6 +119,9 @@ struct wined3d_settings wined3d_settings =
     ~0u,            /* No CS shader model limit by default. */
     WINED3D_RENDERER_AUTO,
     WINED3D_SHADER_BACKEND_AUTO,
+    NULL,           /* No persistent shader cache by default. */
+    64,             /* Shader cache size limit, in MiB. */
+    FALSE,          /* Don't batch draws from application memory by default. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -147,17 +150,47 @@ struct wined3d * CDECL wined3d_create(DWORD flags)
     return object;
 }
 
-static DWORD get_config_key(HKEY defkey, HKEY appkey, const char *name, char *buffer, DWORD size)
+/* The WINE_D3D_CONFIG environment variable holds comma-separated name=value
+ * pairs, which take precedence over the registry. */
+static BOOL get_env_config_key(const char *env, const char *name, char *buffer, DWORD size)
 {
+    size_t name_len = strlen(name), len;
+    const char *p, *end;
+
+    for (p = env; p; p = end ? end + 1 : NULL)
+    {
+        end = strchr(p, ',');
+        len = end ? end - p : strlen(p);
+        if (len <= name_len || p[name_len] != '=' || strncmp(p, name, name_len))
+            continue;
+        len -= name_len + 1;
+        if (len >= size)
+            return FALSE;
+        memcpy(buffer, p + name_len + 1, len);
+        buffer[len] = 0;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static DWORD get_config_key(HKEY defkey, HKEY appkey, const char *env, const char *name, char *buffer, DWORD size)
+{
+    if (env && get_env_config_key(env, name, buffer, size)) return 0;
     if (appkey && !RegQueryValueExA(appkey, name, 0, NULL, (BYTE *)buffer, &size)) return 0;
     if (defkey && !RegQueryValueExA(defkey, name, 0, NULL, (BYTE *)buffer, &size)) return 0;
     return ERROR_FILE_NOT_FOUND;
 }
 
-static DWORD get_config_key_dword(HKEY defkey, HKEY appkey, const char *name, DWORD *value)
+static DWORD get_config_key_dword(HKEY defkey, HKEY appkey, const char *env, const char *name, DWORD *value)
 {
     DWORD type, data, size;
+    char buffer[16], *end;
 
+    if (env && get_env_config_key(env, name, buffer, sizeof(buffer)))
+    {
+        data = strtoul(buffer, &end, 0);
+        if (*buffer && !*end) goto success;
+    }
     size = sizeof(data);
     if (appkey && !RegQueryValueExA(appkey, name, 0, &type, (BYTE *)&data, &size) && type == REG_DWORD) goto success;
     size = sizeof(data);
@@ -199,6 +232,7 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
     DWORD wined3d_context_tls_idx;
     char buffer[MAX_PATH+10];
     DWORD size = sizeof(buffer);
+    const char *env;
     HKEY hkey = 0;
     HKEY appkey = 0;
     DWORD tmpvalue;
@@ -256,17 +290,19 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
         }
     }
 
-    if (hkey || appkey)
+    env = getenv("WINE_D3D_CONFIG");
+
+    if (hkey || appkey || env)
     {
-        if (!get_config_key_dword(hkey, appkey, "csmt", &wined3d_settings.cs_multithreaded))
+        if (!get_config_key_dword(hkey, appkey, env, "csmt", &wined3d_settings.cs_multithreaded))
             ERR_(winediag)("Setting multithreaded command stream to %#x.\n", wined3d_settings.cs_multithreaded);
-        if (!get_config_key_dword(hkey, appkey, "MaxVersionGL", &tmpvalue))
+        if (!get_config_key_dword(hkey, appkey, env, "MaxVersionGL", &tmpvalue))
         {
             ERR_(winediag)("Setting maximum allowed wined3d GL version to %u.%u.\n",
                     tmpvalue >> 16, tmpvalue & 0xffff);
             wined3d_settings.max_gl_version = tmpvalue;
         }
-        if (!get_config_key(hkey, appkey, "shader_backend", buffer, size))
+        if (!get_config_key(hkey, appkey, env, "shader_backend", buffer, size))
         {
             if (!_strnicmp(buffer, "glsl", -1))
             {
@@ -284,7 +320,7 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
                 wined3d_settings.shader_backend = WINED3D_SHADER_BACKEND_NONE;
             }
         }
-        else if (!get_config_key(hkey, appkey, "UseGLSL", buffer, size) && !strcmp(buffer, "disabled"))
+        else if (!get_config_key(hkey, appkey, env, "UseGLSL", buffer, size) && !strcmp(buffer, "disabled"))
         {
             wined3d_settings.shader_backend = WINED3D_SHADER_BACKEND_ARB;
         }
@@ -294,10 +330,10 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             ERR_(winediag)("The GLSL shader backend has been disabled. You get to keep all the pieces if it breaks.\n");
             TRACE("Use of GL Shading Language disabled.\n");
         }
-        if (!get_config_key(hkey, appkey, "OffscreenRenderingMode", buffer, size)
+        if (!get_config_key(hkey, appkey, env, "OffscreenRenderingMode", buffer, size)
                 && !strcmp(buffer,"backbuffer"))
             wined3d_settings.offscreen_rendering_mode = ORM_BACKBUFFER;
-        if ( !get_config_key_dword( hkey, appkey, "VideoPciDeviceID", &tmpvalue) )
+        if ( !get_config_key_dword( hkey, appkey, env, "VideoPciDeviceID", &tmpvalue) )
         {
             int pci_device_id = tmpvalue;
 
@@ -312,7 +348,7 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
                 wined3d_settings.pci_device_id = pci_device_id;
             }
         }
-        if ( !get_config_key_dword( hkey, appkey, "VideoPciVendorID", &tmpvalue) )
+        if ( !get_config_key_dword( hkey, appkey, env, "VideoPciVendorID", &tmpvalue) )
         {
             int pci_vendor_id = tmpvalue;
 
@@ -327,7 +363,7 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
                 wined3d_settings.pci_vendor_id = pci_vendor_id;
             }
         }
-        if ( !get_config_key( hkey, appkey, "VideoMemorySize", buffer, size) )
+        if ( !get_config_key( hkey, appkey, env, "VideoMemorySize", buffer, size) )
         {
             int TmpVideoMemorySize = atoi(buffer);
             if(TmpVideoMemorySize > 0)
@@ -340,7 +376,7 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             else
                 ERR("VideoMemorySize is %i but must be >0\n", TmpVideoMemorySize);
         }
-        if ( !get_config_key( hkey, appkey, "WineLogo", buffer, size) )
+        if ( !get_config_key( hkey, appkey, env, "WineLogo", buffer, size) )
         {
             size_t len = strlen(buffer) + 1;
 
@@ -349,33 +385,50 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             else
                 memcpy(wined3d_settings.logo, buffer, len);
         }
-        if (!get_config_key_dword(hkey, appkey, "MultisampleTextures", &wined3d_settings.multisample_textures))
+        if (!get_config_key_dword(hkey, appkey, env, "MultisampleTextures", &wined3d_settings.multisample_textures))
             ERR_(winediag)("Setting multisample textures to %#x.\n", wined3d_settings.multisample_textures);
-        if (!get_config_key_dword(hkey, appkey, "SampleCount", &wined3d_settings.sample_count))
+        if (!get_config_key_dword(hkey, appkey, env, "SampleCount", &wined3d_settings.sample_count))
             ERR_(winediag)("Forcing sample count to %u. This may not be compatible with all applications.\n",
                     wined3d_settings.sample_count);
-        if (!get_config_key(hkey, appkey, "CheckFloatConstants", buffer, size)
+        if (!get_config_key(hkey, appkey, env, "CheckFloatConstants", buffer, size)
                 && !strcmp(buffer, "enabled"))
         {
             TRACE("Checking relative addressing indices in float constants.\n");
             wined3d_settings.check_float_constants = TRUE;
         }
-        if (!get_config_key_dword(hkey, appkey, "strict_shader_math", &wined3d_settings.strict_shader_math))
+        if (!get_config_key_dword(hkey, appkey, env, "strict_shader_math", &wined3d_settings.strict_shader_math))
             ERR_(winediag)("Setting strict shader math to %#x.\n", wined3d_settings.strict_shader_math);
-        if (!get_config_key_dword(hkey, appkey, "MaxShaderModelVS", &wined3d_settings.max_sm_vs))
+        if (!get_config_key_dword(hkey, appkey, env, "MaxShaderModelVS", &wined3d_settings.max_sm_vs))
             TRACE("Limiting VS shader model to %u.\n", wined3d_settings.max_sm_vs);
-        if (!get_config_key_dword(hkey, appkey, "MaxShaderModelHS", &wined3d_settings.max_sm_hs))
+        if (!get_config_key_dword(hkey, appkey, env, "MaxShaderModelHS", &wined3d_settings.max_sm_hs))
             TRACE("Limiting HS shader model to %u.\n", wined3d_settings.max_sm_hs);
-        if (!get_config_key_dword(hkey, appkey, "MaxShaderModelDS", &wined3d_settings.max_sm_ds))
+        if (!get_config_key_dword(hkey, appkey, env, "MaxShaderModelDS", &wined3d_settings.max_sm_ds))
             TRACE("Limiting DS shader model to %u.\n", wined3d_settings.max_sm_ds);
-        if (!get_config_key_dword(hkey, appkey, "MaxShaderModelGS", &wined3d_settings.max_sm_gs))
+        if (!get_config_key_dword(hkey, appkey, env, "MaxShaderModelGS", &wined3d_settings.max_sm_gs))
             TRACE("Limiting GS shader model to %u.\n", wined3d_settings.max_sm_gs);
-        if (!get_config_key_dword(hkey, appkey, "MaxShaderModelPS", &wined3d_settings.max_sm_ps))
+        if (!get_config_key_dword(hkey, appkey, env, "MaxShaderModelPS", &wined3d_settings.max_sm_ps))
             TRACE("Limiting PS shader model to %u.\n", wined3d_settings.max_sm_ps);
-        if (!get_config_key_dword(hkey, appkey, "MaxShaderModelCS", &wined3d_settings.max_sm_cs))
+        if (!get_config_key_dword(hkey, appkey, env, "MaxShaderModelCS", &wined3d_settings.max_sm_cs))
             TRACE("Limiting CS shader model to %u.\n", wined3d_settings.max_sm_cs);
-        if (!get_config_key(hkey, appkey, "renderer", buffer, size)
-                || !get_config_key(hkey, appkey, "DirectDrawRenderer", buffer, size))
+        if (!get_config_key(hkey, appkey, env, "ShaderCache", buffer, size))
+        {
+            size_t len = strlen(buffer) + 1;
+
+            if (!(wined3d_settings.shader_cache = heap_alloc(len)))
+                ERR("Failed to allocate shader cache path memory.\n");
+            else
+                memcpy(wined3d_settings.shader_cache, buffer, len);
+        }
+        if (!get_config_key_dword(hkey, appkey, env, "ShaderCacheSize", &wined3d_settings.shader_cache_size))
+            TRACE("Limiting shader cache size to %u MiB.\n", wined3d_settings.shader_cache_size);
+        if (!get_config_key(hkey, appkey, env, "BatchDrawPrimitiveUP", buffer, size)
+                && !strcmp(buffer, "enabled"))
+        {
+            TRACE("Batching draws from application memory.\n");
+            wined3d_settings.batch_draws_up = TRUE;
+        }
+        if (!get_config_key(hkey, appkey, env, "renderer", buffer, size)
+                || !get_config_key(hkey, appkey, env, "DirectDrawRenderer", buffer, size))
         {
             if (!strcmp(buffer, "vulkan"))
             {
@@ -432,6 +485,7 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     }
     heap_free(hook_table.hooks);
 
+    heap_free(wined3d_settings.shader_cache);
     heap_free(wined3d_settings.logo);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
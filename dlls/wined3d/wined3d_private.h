@@ -423,6 +423,9 @@ struct wined3d_settings
     unsigned int max_sm_cs;
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
+    char *shader_cache;
+    unsigned int shader_cache_size;
+    BOOL batch_draws_up;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -1456,6 +1459,23 @@ extern const struct wined3d_shader_backend_ops glsl_shader_backend DECLSPEC_HIDD
 extern const struct wined3d_shader_backend_ops arb_program_shader_backend DECLSPEC_HIDDEN;
 extern const struct wined3d_shader_backend_ops none_shader_backend DECLSPEC_HIDDEN;
 
+struct wined3d_shader_cache_key
+{
+    UINT64 hash[2];
+};
+
+struct wined3d_shader_cache;
+
+struct wined3d_shader_cache *wined3d_shader_cache_acquire(void) DECLSPEC_HIDDEN;
+BOOL wined3d_shader_cache_get(struct wined3d_shader_cache *cache, const struct wined3d_shader_cache_key *key,
+        DWORD *format, void **data, SIZE_T *size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_init(struct wined3d_shader_cache_key *key) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_update(struct wined3d_shader_cache_key *key,
+        const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_put(struct wined3d_shader_cache *cache, const struct wined3d_shader_cache_key *key,
+        DWORD format, const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_release(struct wined3d_shader_cache *cache) DECLSPEC_HIDDEN;
+
 #define GL_EXTCALL(f) (gl_info->gl_ops.ext.p_##f)
 
 #define D3DCOLOR_B_R(dw) (((dw) >> 16) & 0xff)
@@ -1734,6 +1754,8 @@ struct wined3d_fence
 HRESULT wined3d_fence_create(struct wined3d_device *device, struct wined3d_fence **fence) DECLSPEC_HIDDEN;
 void wined3d_fence_destroy(struct wined3d_fence *fence) DECLSPEC_HIDDEN;
 void wined3d_fence_issue(struct wined3d_fence *fence, struct wined3d_device *device) DECLSPEC_HIDDEN;
+enum wined3d_fence_result wined3d_fence_test(const struct wined3d_fence *fence,
+        struct wined3d_device *device, DWORD flags) DECLSPEC_HIDDEN;
 enum wined3d_fence_result wined3d_fence_wait(const struct wined3d_fence *fence,
         struct wined3d_device *device) DECLSPEC_HIDDEN;
 
@@ -1747,6 +1769,15 @@ enum wined3d_query_state
     QUERY_BUILDING
 };
 
+/* Two UINT64 values in a shared query buffer object. The result is
+ * available once both have been written with the same value. */
+struct wined3d_query_buffer_slot
+{
+    GLuint buffer_object;
+    unsigned int offset;
+    UINT64 *map_ptr;
+};
+
 struct wined3d_query_ops
 {
     BOOL (*query_poll)(struct wined3d_query *query, DWORD flags);
@@ -1769,9 +1800,9 @@ struct wined3d_query
 
     LONG counter_main, counter_retrieved;
     struct list poll_list_entry;
+    LONGLONG issue_time;
 
-    GLuint buffer_object;
-    UINT64 *map_ptr;
+    struct wined3d_query_buffer_slot buffer;
 };
 
 struct wined3d_event_query
@@ -1883,14 +1914,12 @@ struct wined3d_context
     const struct wined3d_d3d_info *d3d_info;
     const struct wined3d_state_entry *state_table;
     /* State dirtification
-     * dirtyArray is an array that contains markers for dirty states. numDirtyEntries states are dirty, their numbers are in indices
-     * 0...numDirtyEntries - 1. isStateDirty is a redundant copy of the dirtyArray. Technically only one of them would be needed,
-     * but with the help of both it is easy to find out if a state is dirty(just check the array index), and for applying dirty states
-     * only numDirtyEntries array elements have to be checked, not STATE_HIGHEST states.
+     * isStateDirty is a bitmap of the dirty graphics states, dirty_state_words has a bit set for every
+     * isStateDirty word that may have bits set. Applying dirty states only has to look at the words
+     * flagged in dirty_state_words, not at all STATE_HIGHEST states.
      */
-    DWORD                   dirtyArray[STATE_HIGHEST + 1]; /* Won't get bigger than that, a state is never marked dirty 2 times */
-    DWORD                   numDirtyEntries;
     DWORD isStateDirty[STATE_HIGHEST / (sizeof(DWORD) * CHAR_BIT) + 1]; /* Bitmap to find out quickly if a state is dirty */
+    DWORD dirty_state_words[(STATE_HIGHEST / (sizeof(DWORD) * CHAR_BIT)) / (sizeof(DWORD) * CHAR_BIT) + 1];
     unsigned int dirty_compute_states[STATE_COMPUTE_COUNT / (sizeof(unsigned int) * CHAR_BIT) + 1];
 
     struct wined3d_device *device;
@@ -3283,12 +3312,85 @@ static inline struct wined3d_device_no3d *wined3d_device_no3d(struct wined3d_dev
     return CONTAINING_RECORD(device, struct wined3d_device_no3d, d);
 }
 
+#define WINED3D_UPLOAD_RING_SIZE            0x1000000u
+#define WINED3D_UPLOAD_RING_SEGMENT_COUNT   4u
+
+/* A persistently mapped pixel unpack buffer used to stage texture uploads
+ * from system memory. Each segment gets a fence when we move past it, and
+ * we only wait for that fence when the ring wraps around to it again. */
+struct wined3d_upload_ring
+{
+    GLuint buffer_object;
+    BYTE *map_ptr;
+    SIZE_T head;
+    unsigned int segment;
+    struct wined3d_fence *fences[WINED3D_UPLOAD_RING_SEGMENT_COUNT];
+    BOOL disabled;
+
+    /* Per-frame statistics. */
+    unsigned int upload_count, staged_count, wait_count;
+    ULONGLONG upload_bytes;
+    LONGLONG upload_time;
+};
+
+void wined3d_upload_ring_destroy(struct wined3d_upload_ring *ring, struct wined3d_context *context) DECLSPEC_HIDDEN;
+void wined3d_upload_ring_end_frame(struct wined3d_upload_ring *ring) DECLSPEC_HIDDEN;
+
+struct wined3d_state_stats
+{
+    BOOL collect;
+    unsigned int draw_count;
+    unsigned int state_count;
+    unsigned int max_draw_state_count;
+};
+
+void wined3d_state_stats_end_frame(struct wined3d_state_stats *stats) DECLSPEC_HIDDEN;
+
+#define WINED3D_QUERY_BUFFER_CHUNK_SLOTS    256u
+
+/* Query buffer slots are suballocated from persistently mapped buffer
+ * objects. A slot that may still have a result write in flight is retired,
+ * and retired slots are returned to the free list in groups, once the fence
+ * issued after them has been reached. */
+struct wined3d_query_buffer_group
+{
+    struct wined3d_fence *fence;
+    unsigned int slot_count;
+};
+
+struct wined3d_query_buffer_pool
+{
+    GLuint *buffer_objects;
+    SIZE_T buffer_objects_size;
+    unsigned int buffer_object_count;
+
+    struct wined3d_query_buffer_slot *free_slots;
+    SIZE_T free_slots_size;
+    unsigned int free_slot_count;
+
+    struct wined3d_query_buffer_slot *retired_slots;
+    SIZE_T retired_slots_size;
+    unsigned int retired_slot_count;
+    unsigned int unfenced_slot_count;
+
+    struct wined3d_query_buffer_group *groups;
+    SIZE_T groups_size;
+    unsigned int group_count;
+};
+
+void wined3d_query_buffer_pool_destroy(struct wined3d_query_buffer_pool *pool,
+        struct wined3d_context *context) DECLSPEC_HIDDEN;
+
 struct wined3d_device_gl
 {
     struct wined3d_device d;
 
     /* Textures for when no other textures are bound. */
     struct wined3d_dummy_textures dummy_textures;
+
+    struct wined3d_upload_ring upload_ring;
+    struct wined3d_state_stats state_stats;
+    struct wined3d_query_buffer_pool query_buffer_pool;
 };
 
 static inline struct wined3d_device_gl *wined3d_device_gl(struct wined3d_device *device)
@@ -3867,12 +3969,54 @@ enum wined3d_push_constants
 
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x100000u
+#define WINED3D_CS_QUEUE_MAX_SIZE       0x1000000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_QUERY_POLL_WAIT      1u
+#define WINED3D_CS_INLINE_DATA_SIZE     0x10000u
+#define WINED3D_CS_DRAW_UP_BUFFER_SIZE  0x100000u
 
 struct wined3d_cs_queue
 {
     LONG head, tail;
-    BYTE data[WINED3D_CS_QUEUE_SIZE];
+    SIZE_T size;
+    BYTE *data;
+};
+
+struct wined3d_cs_stats
+{
+    /* Written by the application thread. */
+    ULONG stall_count;
+    LONGLONG stall_time;
+    ULONG grow_count;
+    ULONG inline_count;
+    ULONG draw_up_count;
+    ULONG draw_up_batch_count;
+
+    /* Written by the CS thread. */
+    ULONG packet_count;
+    ULONG query_count;
+    ULONG buffer_query_count;
+    LONGLONG query_latency;
+    LONGLONG max_query_latency;
+    LONGLONG idle_time;
+    LONGLONG idle_start;
+    LONGLONG report_time;
+    ULONG report_packet_count;
+    ULONG report_stall_count;
+    LONGLONG report_stall_time;
+    LONGLONG report_idle_time;
+};
+
+/* Draws from application memory that have not been submitted yet. Only
+ * accessed from the application thread. */
+struct wined3d_cs_draw_up_batch
+{
+    struct wined3d_buffer *buffer;
+    unsigned int offset;
+    GLenum primitive_type;
+    unsigned int stride;
+    unsigned int vertex_count;
+    BYTE *data;
 };
 
 struct wined3d_cs_ops
@@ -3903,10 +4047,16 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    BOOL collect_stats;
+    struct wined3d_cs_stats stats;
+
+    struct wined3d_cs_draw_up_batch draw_up_batch;
 };
 
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
+void wined3d_cs_cleanup_draw_up(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy_object(struct wined3d_cs *cs,
         void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_add_dirty_texture_region(struct wined3d_cs *cs,
@@ -3930,6 +4080,9 @@ void wined3d_cs_emit_dispatch_indirect(struct wined3d_cs *cs,
 void wined3d_cs_emit_draw(struct wined3d_cs *cs, GLenum primitive_type, unsigned int patch_vertex_count,
         int base_vertex_idx, unsigned int start_idx, unsigned int index_count,
         unsigned int start_instance, unsigned int instance_count, BOOL indexed) DECLSPEC_HIDDEN;
+HRESULT wined3d_cs_emit_draw_up(struct wined3d_cs *cs, GLenum primitive_type,
+        const void *data, unsigned int vertex_count, unsigned int stride) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_draw_up_batch(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, GLenum primitive_type, unsigned int patch_vertex_count,
         struct wined3d_buffer *buffer, unsigned int offset, BOOL indexed) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_flush(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
@@ -3999,8 +4152,17 @@ HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource,
 HRESULT wined3d_cs_unmap(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx) DECLSPEC_HIDDEN;
 
+/* Submits any pending draws from application memory. This needs to happen
+ * before anything else is emitted, and before waiting for the CS. */
+static inline void wined3d_cs_flush_draw_up(struct wined3d_cs *cs)
+{
+    if (cs->draw_up_batch.vertex_count && cs->thread_id != GetCurrentThreadId())
+        wined3d_cs_emit_draw_up_batch(cs);
+}
+
 static inline void wined3d_cs_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
+    wined3d_cs_flush_draw_up(cs);
     cs->ops->finish(cs, queue_id);
 }
 
@@ -4017,16 +4179,19 @@ void wined3d_destroy_gl_vr_context(struct wined3d_vr_gl_context *ctx) DECLSPEC_H
 static inline void wined3d_cs_push_constants(struct wined3d_cs *cs, enum wined3d_push_constants p,
         unsigned int start_idx, unsigned int count, const void *constants)
 {
+    wined3d_cs_flush_draw_up(cs);
     cs->ops->push_constants(cs, p, start_idx, count, constants);
 }
 
 static inline void wined3d_resource_wait_idle(struct wined3d_resource *resource)
 {
-    const struct wined3d_cs *cs = resource->device->cs;
+    struct wined3d_cs *cs = resource->device->cs;
 
     if (!cs->thread || cs->thread_id == GetCurrentThreadId())
         return;
 
+    wined3d_cs_flush_draw_up(cs);
+
     while (InterlockedCompareExchange(&resource->access_count, 0, 0))
         wined3d_pause();
 }
@@ -4085,6 +4250,17 @@ void wined3d_buffer_copy(struct wined3d_buffer *dst_buffer, unsigned int dst_off
 void wined3d_buffer_upload_data(struct wined3d_buffer *buffer, struct wined3d_context *context,
         const struct wined3d_box *box, const void *data) DECLSPEC_HIDDEN;
 
+#define WINED3D_BUFFER_GL_STREAM_BO_COUNT 4
+
+/* A persistently mapped copy of a dynamic buffer's storage. DISCARD maps
+ * switch to the next copy the GPU has finished with instead of orphaning. */
+struct wined3d_buffer_gl_stream_bo
+{
+    GLuint id;
+    BYTE *ptr;
+    struct wined3d_fence *fence;
+};
+
 struct wined3d_buffer_gl
 {
     struct wined3d_buffer b;
@@ -4092,6 +4268,9 @@ struct wined3d_buffer_gl
     GLuint buffer_object;
     GLenum buffer_object_usage;
     GLenum buffer_type_hint;
+
+    struct wined3d_buffer_gl_stream_bo stream_bos[WINED3D_BUFFER_GL_STREAM_BO_COUNT];
+    unsigned int stream_bo_count, stream_bo_idx;
 };
 
 static inline struct wined3d_buffer_gl *wined3d_buffer_gl(struct wined3d_buffer *buffer)
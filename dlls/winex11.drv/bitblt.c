@@ -1556,6 +1556,26 @@ DWORD get_pixmap_image( Pixmap pixmap, int width, int height, const XVisualInfo
 }
 
 
+#define MAX_DAMAGE_RECTS 8
+#define FLUSH_PERIOD 50  /* time in ms since drawing started for forcing a surface flush */
+
+/* small list of disjoint rectangles, coalesced when it overflows */
+struct surface_damage
+{
+    int                   count;
+    RECT                  rects[MAX_DAMAGE_RECTS];
+};
+
+#ifdef HAVE_LIBXXSHM
+struct shm_buffer
+{
+    XImage               *image;
+    XShmSegmentInfo       shminfo;
+    BOOL                  busy;   /* waiting for the ShmCompletion event of the last put */
+    struct surface_damage stale;  /* areas that were only flushed through the other buffer */
+};
+#endif
+
 struct x11drv_window_surface
 {
     struct window_surface header;
@@ -1563,6 +1583,9 @@ struct x11drv_window_surface
     GC                    gc;
     XImage               *image;
     RECT                  bounds;
+    struct surface_damage damage;
+    DWORD                 damage_ticks;
+    UINT                  lock_count;
     BOOL                  byteswap;
     BOOL                  is_argb;
     DWORD                 alpha_bits;
@@ -1570,8 +1593,11 @@ struct x11drv_window_surface
     HRGN                  region;
     void                 *bits;
 #ifdef HAVE_LIBXXSHM
-    XShmSegmentInfo       shminfo;
+    struct shm_buffer     shm[2];
+    int                   shm_current;
 #endif
+    ULONG                 flush_count;
+    ULONGLONG             flushed_bytes;
     CRITICAL_SECTION      crit;
     BITMAPINFO            info;   /* variable size, must be last */
 };
@@ -1581,6 +1607,59 @@ static struct x11drv_window_surface *get_x11_surface( struct window_surface *sur
     return (struct x11drv_window_surface *)surface;
 }
 
+static inline BOOL rects_touch( const RECT *a, const RECT *b )
+{
+    return a->left <= b->right && b->left <= a->right && a->top <= b->bottom && b->top <= a->bottom;
+}
+
+static inline LONGLONG rect_area( const RECT *rect )
+{
+    return (LONGLONG)(rect->right - rect->left) * (rect->bottom - rect->top);
+}
+
+static void add_damage_rect( struct surface_damage *damage, const RECT *rect )
+{
+    RECT rc = *rect, tmp;
+    LONGLONG growth, best_growth;
+    int i, best;
+
+    if (rc.left >= rc.right || rc.top >= rc.bottom) return;
+
+restart:
+    for (i = 0; i < damage->count; i++)
+    {
+        if (!rects_touch( &rc, &damage->rects[i] )) continue;
+        UnionRect( &rc, &rc, &damage->rects[i] );
+        damage->rects[i] = damage->rects[--damage->count];
+        goto restart;
+    }
+    if (damage->count == MAX_DAMAGE_RECTS)
+    {
+        /* merge with the rectangle that grows the least */
+        best = 0;
+        best_growth = -1;
+        for (i = 0; i < damage->count; i++)
+        {
+            UnionRect( &tmp, &rc, &damage->rects[i] );
+            growth = rect_area( &tmp ) - rect_area( &damage->rects[i] ) - rect_area( &rc );
+            if (best_growth != -1 && growth >= best_growth) continue;
+            best_growth = growth;
+            best = i;
+        }
+        UnionRect( &rc, &rc, &damage->rects[best] );
+        damage->rects[best] = damage->rects[--damage->count];
+        goto restart;
+    }
+    damage->rects[damage->count++] = rc;
+}
+
+static void add_surface_damage( struct x11drv_window_surface *surface, const RECT *rect )
+{
+    if (rect->left >= rect->right || rect->top >= rect->bottom) return;
+    if (!surface->damage.count) surface->damage_ticks = GetTickCount();
+    add_damage_rect( &surface->damage, rect );
+}
+
 static inline UINT get_color_component( UINT color, UINT mask )
 {
     int shift;
@@ -1811,6 +1890,58 @@ failed:
     XDestroyImage( image );
     return NULL;
 }
+
+static int shm_completion_type;
+
+static Bool is_shm_completion( Display *display, XEvent *event, XPointer arg )
+{
+    const XShmSegmentInfo *shminfo = (const XShmSegmentInfo *)arg;
+
+    return (event->type == shm_completion_type &&
+            ((XShmCompletionEvent *)event)->shmseg == shminfo->shmseg);
+}
+
+static void wait_shm_completion( struct shm_buffer *buffer )
+{
+    XEvent event;
+
+    if (!buffer->busy) return;
+    /* the buffer was sent a whole flush ago, so the event is normally queued already */
+    if (!XCheckIfEvent( gdi_display, &event, is_shm_completion, (XPointer)&buffer->shminfo ))
+    {
+        /* no event is generated if the put failed, so don't block waiting for it */
+        XSync( gdi_display, False );
+        XCheckIfEvent( gdi_display, &event, is_shm_completion, (XPointer)&buffer->shminfo );
+    }
+    buffer->busy = FALSE;
+}
+
+static void destroy_shm_buffer( struct shm_buffer *buffer )
+{
+    if (!buffer->image) return;
+    wait_shm_completion( buffer );
+    XShmDetach( gdi_display, &buffer->shminfo );
+    shmdt( buffer->shminfo.shmaddr );
+    buffer->image->data = NULL;
+    XDestroyImage( buffer->image );
+    buffer->image = NULL;
+}
+
+static BOOL create_shm_buffers( struct x11drv_window_surface *surface, const XVisualInfo *vis,
+                                int width, int height )
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE( surface->shm ); i++)
+    {
+        if ((surface->shm[i].image = create_shm_image( vis, width, height, &surface->shm[i].shminfo )))
+            continue;
+        while (i--) destroy_shm_buffer( &surface->shm[i] );
+        return FALSE;
+    }
+    if (!shm_completion_type) shm_completion_type = XShmGetEventBase( gdi_display ) + ShmCompletion;
+    return TRUE;
+}
 #endif /* HAVE_LIBXXSHM */
 
 /***********************************************************************
@@ -1821,6 +1952,7 @@ static void x11drv_surface_lock( struct window_surface *window_surface )
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
 
     EnterCriticalSection( &surface->crit );
+    surface->lock_count++;
 }
 
 /***********************************************************************
@@ -1829,8 +1961,16 @@ static void x11drv_surface_lock( struct window_surface *window_surface )
 static void x11drv_surface_unlock( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
+    BOOL flush;
 
+    /* collect the bounds of every locked operation separately, so that small
+     * updates far apart don't turn into one big rectangle */
+    add_surface_damage( surface, &surface->bounds );
+    reset_bounds( &surface->bounds );
+    flush = (!--surface->lock_count && surface->damage.count &&
+             GetTickCount() - surface->damage_ticks > FLUSH_PERIOD);
     LeaveCriticalSection( &surface->crit );
+    if (flush) window_surface->funcs->flush( window_surface );
 }
 
 /***********************************************************************
@@ -1846,6 +1986,9 @@ static void *x11drv_surface_get_bitmap_info( struct window_surface *window_surfa
 
 /***********************************************************************
  *           x11drv_surface_get_bounds
+ *
+ * The bounds only accumulate until the surface is unlocked, they are then
+ * moved to the damage list.
  */
 static RECT *x11drv_surface_get_bounds( struct window_surface *window_surface )
 {
@@ -1885,73 +2028,123 @@ static void x11drv_surface_set_region( struct window_surface *window_surface, HR
     window_surface->funcs->unlock( window_surface );
 }
 
+/* copy the surface bits of a rectangle to an image, and fix up the alpha channel */
+static void copy_surface_rect( struct x11drv_window_surface *surface, XImage *image, const RECT *rect )
+{
+    unsigned char *src = surface->bits;
+    unsigned char *dst = (unsigned char *)image->data;
+    int width_bytes = image->bytes_per_line;
+
+    if (src != dst)
+    {
+        const int *mapping = NULL;
+
+        if (image->bits_per_pixel == 4 || image->bits_per_pixel == 8)
+            mapping = X11DRV_PALETTE_PaletteToXPixel;
+
+        copy_image_byteswap( &surface->info, src + rect->top * width_bytes, dst + rect->top * width_bytes,
+                             width_bytes, width_bytes, rect->bottom - rect->top,
+                             surface->byteswap, mapping, ~0u, surface->alpha_bits );
+        if (surface->byteswap) return;  /* the alpha bits have been set already */
+    }
+    if (surface->alpha_bits)
+    {
+        int x, y, stride = width_bytes / sizeof(ULONG);
+        ULONG *ptr = (ULONG *)dst + rect->top * stride;
+
+        for (y = rect->top; y < rect->bottom; y++, ptr += stride)
+            for (x = rect->left; x < rect->right; x++)
+                ptr[x] |= surface->alpha_bits;
+    }
+}
+
+#ifdef HAVE_LIBXXSHM
+static void flush_shm_buffer( struct x11drv_window_surface *surface, const struct surface_damage *damage )
+{
+    struct shm_buffer *buffer = &surface->shm[surface->shm_current];
+    struct shm_buffer *other = &surface->shm[!surface->shm_current];
+    int i;
+
+    wait_shm_completion( buffer );
+
+    /* bring the buffer up to date, including what was sent through the other one */
+    for (i = 0; i < damage->count; i++) add_damage_rect( &buffer->stale, &damage->rects[i] );
+    for (i = 0; i < buffer->stale.count; i++) copy_surface_rect( surface, buffer->image, &buffer->stale.rects[i] );
+    buffer->stale.count = 0;
+
+    for (i = 0; i < damage->count; i++)
+    {
+        const RECT *rect = &damage->rects[i];
+
+        /* requests are processed in order, so one completion event is enough */
+        XShmPutImage( gdi_display, surface->window, surface->gc, buffer->image,
+                      rect->left, rect->top,
+                      surface->header.rect.left + rect->left, surface->header.rect.top + rect->top,
+                      rect->right - rect->left, rect->bottom - rect->top, i == damage->count - 1 );
+        add_damage_rect( &other->stale, rect );
+    }
+    buffer->busy = TRUE;
+    surface->shm_current = !surface->shm_current;
+}
+#endif
+
 /***********************************************************************
  *           x11drv_surface_flush
  */
 static void x11drv_surface_flush( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
-    unsigned char *src = surface->bits;
-    unsigned char *dst = (unsigned char *)surface->image->data;
-    struct bitblt_coords coords;
+    struct surface_damage damage;
+    ULONGLONG bytes = 0;
+    RECT rect, visrect;
+    int i;
 
     window_surface->funcs->lock( window_surface );
-    coords.x = 0;
-    coords.y = 0;
-    coords.width  = surface->header.rect.right - surface->header.rect.left;
-    coords.height = surface->header.rect.bottom - surface->header.rect.top;
-    SetRect( &coords.visrect, 0, 0, coords.width, coords.height );
-    if (IntersectRect( &coords.visrect, &coords.visrect, &surface->bounds ))
-    {
-        TRACE( "flushing %p %dx%d bounds %s bits %p\n",
-               surface, coords.width, coords.height,
-               wine_dbgstr_rect( &surface->bounds ), surface->bits );
-
-        if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
+    add_surface_damage( surface, &surface->bounds );
+    reset_bounds( &surface->bounds );
 
-        if (src != dst)
-        {
-            const int *mapping = NULL;
-            int width_bytes = surface->image->bytes_per_line;
+    SetRect( &visrect, 0, 0, surface->header.rect.right - surface->header.rect.left,
+             surface->header.rect.bottom - surface->header.rect.top );
+    damage.count = 0;
+    for (i = 0; i < surface->damage.count; i++)
+        if (IntersectRect( &rect, &surface->damage.rects[i], &visrect ))
+            damage.rects[damage.count++] = rect;
+    surface->damage.count = 0;
 
-            if (surface->image->bits_per_pixel == 4 || surface->image->bits_per_pixel == 8)
-                mapping = X11DRV_PALETTE_PaletteToXPixel;
+    if (damage.count)
+    {
+        TRACE( "flushing %p %dx%d %d rects bits %p\n", surface, visrect.right, visrect.bottom,
+               damage.count, surface->bits );
 
-            src += coords.visrect.top * width_bytes;
-            dst += coords.visrect.top * width_bytes;
-            copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
-                                 coords.visrect.bottom - coords.visrect.top,
-                                 surface->byteswap, mapping, ~0u, surface->alpha_bits );
-        }
-        else if (surface->alpha_bits)
-        {
-            int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
-            ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
+        if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
 
-            for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
-                for (x = coords.visrect.left; x < coords.visrect.right; x++)
-                    ptr[x] |= surface->alpha_bits;
-        }
+        for (i = 0; i < damage.count; i++)
+            bytes += (ULONGLONG)(damage.rects[i].bottom - damage.rects[i].top) *
+                     ((damage.rects[i].right - damage.rects[i].left) * surface->image->bits_per_pixel + 7) / 8;
 
 #ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                          coords.visrect.left, coords.visrect.top,
-                          surface->header.rect.left + coords.visrect.left,
-                          surface->header.rect.top + coords.visrect.top,
-                          coords.visrect.right - coords.visrect.left,
-                          coords.visrect.bottom - coords.visrect.top, False );
+        if (surface->shm[0].image)
+            flush_shm_buffer( surface, &damage );
         else
 #endif
-        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                   coords.visrect.left, coords.visrect.top,
-                   surface->header.rect.left + coords.visrect.left,
-                   surface->header.rect.top + coords.visrect.top,
-                   coords.visrect.right - coords.visrect.left,
-                   coords.visrect.bottom - coords.visrect.top );
+        for (i = 0; i < damage.count; i++)
+        {
+            const RECT *rc = &damage.rects[i];
+
+            TRACE( "  %s\n", wine_dbgstr_rect( rc ));
+            copy_surface_rect( surface, surface->image, rc );
+            XPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                       rc->left, rc->top,
+                       surface->header.rect.left + rc->left, surface->header.rect.top + rc->top,
+                       rc->right - rc->left, rc->bottom - rc->top );
+        }
         XFlush( gdi_display );
+
+        surface->flush_count++;
+        surface->flushed_bytes += bytes;
+        TRACE( "%p flushed %s bytes, total %u flushes %s bytes\n", surface, wine_dbgstr_longlong( bytes ),
+               surface->flush_count, wine_dbgstr_longlong( surface->flushed_bytes ));
     }
-    reset_bounds( &surface->bounds );
     window_surface->funcs->unlock( window_surface );
 }
 
@@ -1962,19 +2155,21 @@ static void x11drv_surface_destroy( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
 
-    TRACE( "freeing %p bits %p\n", surface, surface->bits );
+    TRACE( "freeing %p bits %p after %u flushes of %s bytes\n", surface, surface->bits,
+           surface->flush_count, wine_dbgstr_longlong( surface->flushed_bytes ));
     if (surface->gc) XFreeGC( gdi_display, surface->gc );
+#ifdef HAVE_LIBXXSHM
+    if (surface->shm[0].image)
+    {
+        HeapFree( GetProcessHeap(), 0, surface->bits );
+        destroy_shm_buffer( &surface->shm[0] );
+        destroy_shm_buffer( &surface->shm[1] );
+    }
+    else
+#endif
     if (surface->image)
     {
         if (surface->image->data != surface->bits) HeapFree( GetProcessHeap(), 0, surface->bits );
-#ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-        {
-            XShmDetach( gdi_display, &surface->shminfo );
-            shmdt( surface->shminfo.shmaddr );
-        }
-        else
-#endif
         HeapFree( GetProcessHeap(), 0, surface->image->data );
         surface->image->data = NULL;
         XDestroyImage( surface->image );
@@ -2006,6 +2201,7 @@ struct window_surface *create_surface( Window window, const XVisualInfo *vis, co
     struct x11drv_window_surface *surface;
     int width = rect->right - rect->left, height = rect->bottom - rect->top;
     int colors = format->bits_per_pixel <= 8 ? 1 << format->bits_per_pixel : 3;
+    BOOL double_buffered = FALSE;
 
     surface = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
                          FIELD_OFFSET( struct x11drv_window_surface, info.bmiColors[colors] ));
@@ -2030,8 +2226,9 @@ struct window_surface *create_surface( Window window, const XVisualInfo *vis, co
     reset_bounds( &surface->bounds );
 
 #ifdef HAVE_LIBXXSHM
-    surface->image = create_shm_image( vis, width, height, &surface->shminfo );
-    if (!surface->image)
+    if ((double_buffered = create_shm_buffers( surface, vis, width, height )))
+        surface->image = surface->shm[0].image;
+    else
 #endif
     {
         surface->image = XCreateImage( gdi_display, vis->visual, vis->depth, ZPixmap, 0, NULL,
@@ -2048,9 +2245,10 @@ struct window_surface *create_surface( Window window, const XVisualInfo *vis, co
     if (vis->depth == 32 && !surface->is_argb)
         surface->alpha_bits = ~(vis->red_mask | vis->green_mask | vis->blue_mask);
 
-    if (surface->byteswap || format->bits_per_pixel == 4 || format->bits_per_pixel == 8)
+    if (double_buffered || surface->byteswap || format->bits_per_pixel == 4 || format->bits_per_pixel == 8)
     {
-        /* allocate separate surface bits if byte swapping or palette mapping is required */
+        /* allocate separate surface bits if byte swapping or palette mapping is required,
+         * or to keep drawing while the X server reads from the shared memory images */
         if (!(surface->bits  = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
                                           surface->info.bmiHeader.biSizeImage )))
             goto failed;
@@ -135,8 +135,25 @@ typedef struct
     gsCacheEntryFormat *format[GLYPH_NBTYPES][AA_MAXVALUE];
     INT count;
     INT next;
+    DWORD size;       /* bytes of glyph data uploaded to the server */
+    DWORD last_used;
 } gsCacheEntry;
 
+/* glyphs are uploaded to the server in batches of at most this many */
+#define GLYPH_BATCH_COUNT 64
+#define GLYPH_BATCH_SIZE  65536
+
+struct glyph_batch
+{
+    gsCacheEntryFormat *format;
+    unsigned int count;
+    unsigned int size;
+    unsigned int alloc;
+    char        *data;
+    Glyph        gids[GLYPH_BATCH_COUNT];
+    XGlyphInfo   gis[GLYPH_BATCH_COUNT];
+};
+
 struct xrender_physdev
 {
     struct gdi_physdev dev;
@@ -145,6 +162,7 @@ struct xrender_physdev
     enum wxr_format    format;
     UINT               aa_flags;
     int                cache_index;
+    BOOL               share_glyphs;  /* characters can be drawn through their glyph index */
     BOOL               update_clip;
     Picture            pict;
     Picture            pict_src;
@@ -162,6 +180,10 @@ static gsCacheEntry *glyphsetCache = NULL;
 static DWORD glyphsetCacheSize = 0;
 static INT lastfree = -1;
 static INT mru = -1;
+static DWORD glyph_cache_size;
+static DWORD glyph_cache_clock;
+
+#define GLYPH_CACHE_BUDGET (16 * 1024 * 1024)  /* glyph data kept on the server */
 
 #define INIT_CACHE_SIZE 10
 
@@ -649,6 +671,30 @@ static void FreeEntry(int entry)
             glyphsetCache[entry].format[type][format] = NULL;
         }
     }
+    glyph_cache_size -= glyphsetCache[entry].size;
+    glyphsetCache[entry].size = 0;
+}
+
+/* free the glyphsets of the least recently drawn fonts until the glyph data fits
+ * in the budget again; the entries stay valid and simply upload glyphs again */
+static void evict_glyphsets( const gsCacheEntry *current )
+{
+    int i, best;
+
+    while (glyph_cache_size > GLYPH_CACHE_BUDGET)
+    {
+        best = -1;
+        for (i = mru; i >= 0; i = glyphsetCache[i].next)
+        {
+            if (glyphsetCache[i].count == -1) break;
+            if (glyphsetCache + i == current || !glyphsetCache[i].size) continue;
+            if (best == -1 || (int)(glyphsetCache[i].last_used - glyphsetCache[best].last_used) < 0)
+                best = i;
+        }
+        if (best == -1) break;
+        TRACE("freeing glyphsets of cache %d, %u bytes\n", best, glyphsetCache[best].size);
+        FreeEntry(best);
+    }
 }
 
 static int AllocEntry(void)
@@ -828,6 +874,7 @@ static UINT get_xft_aa_flags( const LOGFONTW *lf )
 static HFONT CDECL xrenderdrv_SelectFont( PHYSDEV dev, HFONT hfont, UINT *aa_flags )
 {
     LFANDSIZE lfsz;
+    TEXTMETRICW tm;
     struct xrender_physdev *physdev = get_xrender_dev( dev );
     PHYSDEV next = GET_NEXT_PHYSDEV( dev, pSelectFont );
     HFONT ret;
@@ -853,6 +900,12 @@ static HFONT CDECL xrenderdrv_SelectFont( PHYSDEV dev, HFONT hfont, UINT *aa_fla
         break;
     }
 
+    /* a character is rendered like its glyph index, unless it comes from a linked
+     * font or gets rotated differently in a vertical font */
+    next = GET_NEXT_PHYSDEV( dev, pGetTextMetrics );
+    physdev->share_glyphs = (lfsz.lf.lfFaceName[0] != '@' && next->funcs->pGetTextMetrics( next, &tm ) &&
+                             (tm.tmPitchAndFamily & TMPF_TRUETYPE));
+
     TRACE("h=%d w=%d weight=%d it=%d charset=%d name=%s\n",
           lfsz.lf.lfHeight, lfsz.lf.lfWidth, lfsz.lf.lfWeight,
           lfsz.lf.lfItalic, lfsz.lf.lfCharSet, debugstr_w(lfsz.lf.lfFaceName));
@@ -1023,7 +1076,42 @@ static void CDECL xrenderdrv_SetDeviceClipping( PHYSDEV dev, HRGN rgn )
  *
  * Helper to ExtTextOut.  Must be called inside xrender_cs
  */
-static void UploadGlyph(struct xrender_physdev *physDev, UINT glyph, enum glyph_type type)
+static void flush_glyph_batch( struct glyph_batch *batch )
+{
+    if (!batch->count) return;
+    TRACE("uploading %u glyphs, %u bytes\n", batch->count, batch->size);
+    if (batch->format->glyphset)
+        pXRenderAddGlyphs( gdi_display, batch->format->glyphset, batch->gids, batch->gis,
+                           batch->count, batch->data, batch->size );
+    batch->count = batch->size = 0;
+}
+
+static char *get_glyph_batch_buffer( struct glyph_batch *batch, gsCacheEntryFormat *format, unsigned int size )
+{
+    char *data;
+
+    if (batch->format != format || batch->count == GLYPH_BATCH_COUNT ||
+        (batch->count && batch->size + size > GLYPH_BATCH_SIZE))
+        flush_glyph_batch( batch );
+    batch->format = format;
+
+    if (batch->size + size > batch->alloc)
+    {
+        unsigned int alloc = max( batch->size + size, GLYPH_BATCH_SIZE );
+
+        if (batch->data) data = HeapReAlloc( GetProcessHeap(), 0, batch->data, alloc );
+        else data = HeapAlloc( GetProcessHeap(), 0, alloc );
+        if (!data) return NULL;
+        batch->data = data;
+        batch->alloc = alloc;
+    }
+    data = batch->data + batch->size;
+    memset( data, 0, size );
+    return data;
+}
+
+static void UploadGlyph(struct xrender_physdev *physDev, UINT glyph, enum glyph_type type,
+                        struct glyph_batch *batch)
 {
     unsigned int buflen;
     char *buf;
@@ -1035,7 +1123,6 @@ static void UploadGlyph(struct xrender_physdev *physDev, UINT glyph, enum glyph_
     UINT ggo_format = physDev->aa_flags;
     AA_Type format = aa_type_from_flags( physDev->aa_flags );
     enum wxr_format wxr_format;
-    static const char zero[4];
     static const MAT2 identity = { {0,1},{0,0},{0,0},{0,1} };
 
     if (type == GLYPH_INDEX) ggo_format |= GGO_GLYPH_INDEX;
@@ -1121,7 +1208,13 @@ static void UploadGlyph(struct xrender_physdev *physDev, UINT glyph, enum glyph_
     }
 
 
-    buf = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, buflen);
+    /*
+      XRenderCompositeText seems to ignore 0x0 glyphs when
+      AA_None, which means we lose the advance width of glyphs
+      like the space.  We'll pretend that such glyphs are 1x1
+      bitmaps, which take 4 bytes in any glyph format.
+    */
+    if (!(buf = get_glyph_batch_buffer( batch, formatEntry, buflen ? buflen : 4 ))) return;
     if (buflen)
         GetGlyphOutlineW(physDev->dev.hdc, glyph, ggo_format, &gm, buflen, buf, &identity);
     else
@@ -1198,21 +1291,19 @@ static void UploadGlyph(struct xrender_physdev *physDev, UINT glyph, enum glyph_
         }
 	gid = glyph;
 
-        /*
-          XRenderCompositeText seems to ignore 0x0 glyphs when
-          AA_None, which means we lose the advance width of glyphs
-          like the space.  We'll pretend that such glyphs are 1x1
-          bitmaps.
-        */
-
-        if(buflen == 0)
+        if(buflen == 0) {
             gi.width = gi.height = 1;
+            buflen = 4;
+        }
 
-	pXRenderAddGlyphs(gdi_display, formatEntry->glyphset, &gid, &gi, 1,
-                          buflen ? buf : zero, buflen ? buflen : sizeof(zero));
+        batch->gids[batch->count] = gid;
+        batch->gis[batch->count] = gi;
+        batch->count++;
+        batch->size += buflen;
+        entry->size += buflen + sizeof(gi);
+        glyph_cache_size += buflen + sizeof(gi);
     }
 
-    HeapFree(GetProcessHeap(), 0, buf);
     formatEntry->gis[glyph] = gi;
 }
 
@@ -1300,6 +1391,31 @@ static Picture get_mask_pict( int alpha )
     return pict;
 }
 
+/* map characters to glyph indices where they render the same, so that text
+ * drawn by character and by glyph index shares the uploaded glyphs */
+static void get_text_glyphs( struct xrender_physdev *physdev, const WCHAR *wstr, UINT count,
+                             enum glyph_type type, WCHAR *glyphs, BYTE *types )
+{
+    UINT i;
+
+    if (type == GLYPH_WCHAR && physdev->share_glyphs &&
+        GetGlyphIndicesW( physdev->dev.hdc, wstr, count, glyphs, GGI_MARK_NONEXISTING_GLYPHS ) == count)
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (glyphs[i] != 0xffff) types[i] = GLYPH_INDEX;
+            else
+            {
+                glyphs[i] = wstr[i];
+                types[i] = GLYPH_WCHAR;
+            }
+        }
+        return;
+    }
+    memcpy( glyphs, wstr, count * sizeof(*glyphs) );
+    for (i = 0; i < count; i++) types[i] = type;
+}
+
 /***********************************************************************
  *           xrenderdrv_ExtTextOut
  */
@@ -1309,6 +1425,7 @@ static BOOL CDECL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
     struct xrender_physdev *physdev = get_xrender_dev( dev );
     gsCacheEntry *entry;
     gsCacheEntryFormat *formatEntry;
+    XRenderPictFormat *font_format = NULL;
     unsigned int idx;
     Picture pict, tile_pict = 0;
     XGlyphElt16 *elts;
@@ -1316,6 +1433,11 @@ static BOOL CDECL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
     int render_op = PictOpOver;
     XRenderColor col;
     RECT rect, bounds;
+    WCHAR *glyphs;
+    BYTE *types;
+    XGlyphInfo *gi;
+    struct glyph_batch batch;
+    unsigned long serial = NextRequest( gdi_display );
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
 
     get_xrender_color( physdev, GetTextColor( physdev->dev.hdc ), &col );
@@ -1342,25 +1464,37 @@ static BOOL CDECL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
 
     if(count == 0) return TRUE;
 
+    glyphs = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*glyphs));
+    types = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*types));
+    get_text_glyphs( physdev, wstr, count, type, glyphs, types );
+
     EnterCriticalSection(&xrender_cs);
 
     entry = glyphsetCache + physdev->cache_index;
-    formatEntry = entry->format[type][aa_type_from_flags( physdev->aa_flags )];
+    entry->last_used = ++glyph_cache_clock;
+    if (glyph_cache_size > GLYPH_CACHE_BUDGET) evict_glyphsets( entry );
 
+    /* the format entry is re-evaluated for each glyph since aa_flags may have changed */
+    memset( &batch, 0, offsetof( struct glyph_batch, gids ));
     for(idx = 0; idx < count; idx++) {
-        if( !formatEntry ) {
-	    UploadGlyph(physdev, wstr[idx], type);
-            /* re-evaluate format entry since aa_flags may have changed */
-            formatEntry = entry->format[type][aa_type_from_flags( physdev->aa_flags )];
-        } else if( wstr[idx] >= formatEntry->nrealized || formatEntry->realized[wstr[idx]] == FALSE) {
-	    UploadGlyph(physdev, wstr[idx], type);
-	}
+        formatEntry = entry->format[types[idx]][aa_type_from_flags( physdev->aa_flags )];
+        if( !formatEntry || glyphs[idx] >= formatEntry->nrealized || !formatEntry->realized[glyphs[idx]])
+            UploadGlyph(physdev, glyphs[idx], types[idx], &batch);
     }
-    if (!formatEntry)
-    {
-        WARN("could not upload requested glyphs\n");
-        LeaveCriticalSection(&xrender_cs);
-        return FALSE;
+    flush_glyph_batch( &batch );
+    HeapFree(GetProcessHeap(), 0, batch.data);
+
+    for(idx = 0; idx < count; idx++) {
+        if (!(formatEntry = entry->format[types[idx]][aa_type_from_flags( physdev->aa_flags )]) ||
+            glyphs[idx] >= formatEntry->nrealized)
+        {
+            WARN("could not upload requested glyphs\n");
+            LeaveCriticalSection(&xrender_cs);
+            HeapFree(GetProcessHeap(), 0, glyphs);
+            HeapFree(GetProcessHeap(), 0, types);
+            return FALSE;
+        }
+        font_format = formatEntry->font_format;
     }
 
     TRACE("Writing %s at %d,%d\n", debugstr_wn(wstr,count),
@@ -1387,25 +1521,28 @@ static BOOL CDECL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
     reset_bounds( &bounds );
     for(idx = 0; idx < count; idx++)
     {
+        formatEntry = entry->format[types[idx]][aa_type_from_flags( physdev->aa_flags )];
+        gi = &formatEntry->gis[glyphs[idx]];
+
         elts[idx].glyphset = formatEntry->glyphset;
-        elts[idx].chars = wstr + idx;
+        elts[idx].chars = glyphs + idx;
         elts[idx].nchars = 1;
         elts[idx].xOff = desired.x - current.x;
         elts[idx].yOff = desired.y - current.y;
 
-        current.x += (elts[idx].xOff + formatEntry->gis[wstr[idx]].xOff);
-        current.y += (elts[idx].yOff + formatEntry->gis[wstr[idx]].yOff);
+        current.x += (elts[idx].xOff + gi->xOff);
+        current.y += (elts[idx].yOff + gi->yOff);
 
-        rect.left   = desired.x - physdev->x11dev->dc_rect.left - formatEntry->gis[wstr[idx]].x;
-        rect.top    = desired.y - physdev->x11dev->dc_rect.top - formatEntry->gis[wstr[idx]].y;
-        rect.right  = rect.left + formatEntry->gis[wstr[idx]].width;
-        rect.bottom = rect.top  + formatEntry->gis[wstr[idx]].height;
+        rect.left   = desired.x - physdev->x11dev->dc_rect.left - gi->x;
+        rect.top    = desired.y - physdev->x11dev->dc_rect.top - gi->y;
+        rect.right  = rect.left + gi->width;
+        rect.bottom = rect.top  + gi->height;
         add_bounds_rect( &bounds, &rect );
 
         if(!lpDx)
         {
-            desired.x += formatEntry->gis[wstr[idx]].xOff;
-            desired.y += formatEntry->gis[wstr[idx]].yOff;
+            desired.x += gi->xOff;
+            desired.y += gi->yOff;
         }
         else
         {
@@ -1426,12 +1563,15 @@ static BOOL CDECL xrenderdrv_ExtTextOut( PHYSDEV dev, INT x, INT y, UINT flags,
     pXRenderCompositeText16(gdi_display, render_op,
                             tile_pict,
                             pict,
-                            formatEntry->font_format,
+                            font_format,
                             0, 0, 0, 0, elts, count);
     HeapFree(GetProcessHeap(), 0, elts);
 
     LeaveCriticalSection(&xrender_cs);
+    HeapFree(GetProcessHeap(), 0, glyphs);
+    HeapFree(GetProcessHeap(), 0, types);
     add_device_bounds( physdev->x11dev, &bounds );
+    TRACE("%u glyphs drawn with %lu X requests\n", count, NextRequest( gdi_display ) - serial);
     return TRUE;
 }
 
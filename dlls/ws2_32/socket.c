@@ -26,6 +26,7 @@
  * clients and servers (www.winsite.com got a lot of those).
  */
 
+#define _GNU_SOURCE  /* for recvmmsg and sendmmsg */
 #include "config.h"
 #include "wine/port.h"
 
@@ -33,6 +34,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/types.h>
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
 #include <limits.h>
 #ifdef HAVE_SYS_IPC_H
 # include <sys/ipc.h>
@@ -131,6 +135,12 @@
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 
 #define NONAMELESSUNION
 #define NONAMELESSSTRUCT
@@ -159,6 +169,8 @@
 #include "wine/exception.h"
 #include "wine/unicode.h"
 #include "wine/heap.h"
+#include "wine/list.h"
+#include "wine/rbtree.h"
 
 #if defined(linux) && !defined(IP_UNICAST_IF)
 #define IP_UNICAST_IF 50
@@ -535,6 +547,7 @@ struct ws2_transmitfile_async
     TRANSMIT_FILE_BUFFERS buffers;
     DWORD                 flags;
     LARGE_INTEGER         offset;
+    BOOL                  no_sendfile;
     struct ws2_async      write;
 };
 
@@ -2357,47 +2370,42 @@ static void WINAPI ws2_async_apc( void *arg, IO_STATUS_BLOCK *iosb, ULONG reserv
     release_async_io( &wsa->io );
 }
 
-/***********************************************************************
- *              WS2_recv                (INTERNAL)
- *
- * Workhorse for both synchronous and asynchronous recv() operations.
- */
-static int WS2_recv( int fd, struct ws2_async *wsa, int flags )
+/* buffers for the parts of a received message that need conversion */
+struct ws2_recv_buffers
 {
+    union generic_unix_sockaddr addr;
 #ifndef HAVE_STRUCT_MSGHDR_MSG_ACCRIGHTS
-    char pktbuf[512];
+    char                        control[512];
 #endif
-    struct msghdr hdr;
-    union generic_unix_sockaddr unix_sockaddr;
-    int n;
+};
 
-    hdr.msg_name = NULL;
+static void init_recv_msghdr( struct ws2_async *wsa, struct msghdr *hdr, struct ws2_recv_buffers *buffers )
+{
+    hdr->msg_name = NULL;
 
     if (wsa->addr)
     {
-        hdr.msg_namelen = sizeof(unix_sockaddr);
-        hdr.msg_name = &unix_sockaddr;
+        hdr->msg_namelen = sizeof(buffers->addr);
+        hdr->msg_name = &buffers->addr;
     }
     else
-        hdr.msg_namelen = 0;
+        hdr->msg_namelen = 0;
 
-    hdr.msg_iov = wsa->iovec + wsa->first_iovec;
-    hdr.msg_iovlen = wsa->n_iovecs - wsa->first_iovec;
+    hdr->msg_iov = wsa->iovec + wsa->first_iovec;
+    hdr->msg_iovlen = wsa->n_iovecs - wsa->first_iovec;
 #ifdef HAVE_STRUCT_MSGHDR_MSG_ACCRIGHTS
-    hdr.msg_accrights = NULL;
-    hdr.msg_accrightslen = 0;
+    hdr->msg_accrights = NULL;
+    hdr->msg_accrightslen = 0;
 #else
-    hdr.msg_control = pktbuf;
-    hdr.msg_controllen = sizeof(pktbuf);
-    hdr.msg_flags = 0;
+    hdr->msg_control = buffers->control;
+    hdr->msg_controllen = sizeof(buffers->control);
+    hdr->msg_flags = 0;
 #endif
+}
 
-    while ((n = __wine_locked_recvmsg( fd, &hdr, flags )) == -1)
-    {
-        if (errno != EINTR)
-            return -1;
-    }
-
+/* convert the control headers and source address of a received message */
+static int finish_recv_msghdr( struct ws2_async *wsa, struct msghdr *hdr, struct ws2_recv_buffers *buffers )
+{
 #ifdef HAVE_STRUCT_MSGHDR_MSG_ACCRIGHTS
     if (wsa->control)
     {
@@ -2405,7 +2413,7 @@ static int WS2_recv( int fd, struct ws2_async *wsa, int flags )
         wsa->control->len = 0;
     }
 #else
-    if (wsa->control && !convert_control_headers(&hdr, wsa->control))
+    if (wsa->control && !convert_control_headers(hdr, wsa->control))
     {
         WARN("Application passed insufficient room for control headers.\n");
         *wsa->lpFlags |= WS_MSG_CTRUNC;
@@ -2424,9 +2432,32 @@ static int WS2_recv( int fd, struct ws2_async *wsa, int flags )
      * likewise MSDN says that lpFrom and lpFromlen are ignored for
      * connection-oriented sockets, so don't try to update lpFrom.
      */
-    if (wsa->addr && hdr.msg_namelen)
-        ws_sockaddr_u2ws( &unix_sockaddr.addr, wsa->addr, wsa->addrlen.ptr );
+    if (wsa->addr && hdr->msg_namelen)
+        ws_sockaddr_u2ws( &buffers->addr.addr, wsa->addr, wsa->addrlen.ptr );
+
+    return 0;
+}
+
+/***********************************************************************
+ *              WS2_recv                (INTERNAL)
+ *
+ * Workhorse for both synchronous and asynchronous recv() operations.
+ */
+static int WS2_recv( int fd, struct ws2_async *wsa, int flags )
+{
+    struct ws2_recv_buffers buffers;
+    struct msghdr hdr;
+    int n;
+
+    init_recv_msghdr( wsa, &hdr, &buffers );
 
+    while ((n = __wine_locked_recvmsg( fd, &hdr, flags )) == -1)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+
+    if (finish_recv_msghdr( wsa, &hdr, &buffers )) return -1;
     return n;
 }
 
@@ -2573,34 +2604,26 @@ finish:
     return status;
 }
 
-/***********************************************************************
- *              WS2_send                (INTERNAL)
- *
- * Workhorse for both synchronous and asynchronous send() operations.
- */
-static int WS2_send( int fd, struct ws2_async *wsa, int flags )
+static BOOL init_send_msghdr( int fd, struct ws2_async *wsa, struct msghdr *hdr,
+                              union generic_unix_sockaddr *unix_addr )
 {
-    struct msghdr hdr;
-    union generic_unix_sockaddr unix_addr;
-    int n, ret;
-
-    hdr.msg_name = NULL;
-    hdr.msg_namelen = 0;
+    hdr->msg_name = NULL;
+    hdr->msg_namelen = 0;
 
     if (wsa->addr)
     {
-        hdr.msg_name = &unix_addr;
-        hdr.msg_namelen = ws_sockaddr_ws2u( wsa->addr, wsa->addrlen.val, &unix_addr );
-        if ( !hdr.msg_namelen )
+        hdr->msg_name = unix_addr;
+        hdr->msg_namelen = ws_sockaddr_ws2u( wsa->addr, wsa->addrlen.val, unix_addr );
+        if ( !hdr->msg_namelen )
         {
             errno = EFAULT;
-            return -1;
+            return FALSE;
         }
 
 #if defined(HAS_IPX) && defined(SOL_IPX)
         if(wsa->addr->sa_family == WS_AF_IPX)
         {
-            struct sockaddr_ipx* uipx = (struct sockaddr_ipx*)hdr.msg_name;
+            struct sockaddr_ipx* uipx = (struct sockaddr_ipx*)hdr->msg_name;
             int val=0;
             socklen_t len = sizeof(int);
 
@@ -2615,16 +2638,43 @@ static int WS2_send( int fd, struct ws2_async *wsa, int flags )
 #endif
     }
 
-    hdr.msg_iov = wsa->iovec + wsa->first_iovec;
-    hdr.msg_iovlen = wsa->n_iovecs - wsa->first_iovec;
+    hdr->msg_iov = wsa->iovec + wsa->first_iovec;
+    hdr->msg_iovlen = wsa->n_iovecs - wsa->first_iovec;
 #ifdef HAVE_STRUCT_MSGHDR_MSG_ACCRIGHTS
-    hdr.msg_accrights = NULL;
-    hdr.msg_accrightslen = 0;
+    hdr->msg_accrights = NULL;
+    hdr->msg_accrightslen = 0;
 #else
-    hdr.msg_control = NULL;
-    hdr.msg_controllen = 0;
-    hdr.msg_flags = 0;
+    hdr->msg_control = NULL;
+    hdr->msg_controllen = 0;
+    hdr->msg_flags = 0;
 #endif
+    return TRUE;
+}
+
+/* skip the iovecs that have been sent */
+static void advance_send_iovecs( struct ws2_async *wsa, int n )
+{
+    while (wsa->first_iovec < wsa->n_iovecs && wsa->iovec[wsa->first_iovec].iov_len <= n)
+        n -= wsa->iovec[wsa->first_iovec++].iov_len;
+    if (wsa->first_iovec < wsa->n_iovecs)
+    {
+        wsa->iovec[wsa->first_iovec].iov_base = (char*)wsa->iovec[wsa->first_iovec].iov_base + n;
+        wsa->iovec[wsa->first_iovec].iov_len -= n;
+    }
+}
+
+/***********************************************************************
+ *              WS2_send                (INTERNAL)
+ *
+ * Workhorse for both synchronous and asynchronous send() operations.
+ */
+static int WS2_send( int fd, struct ws2_async *wsa, int flags )
+{
+    struct msghdr hdr;
+    union generic_unix_sockaddr unix_addr;
+    int ret;
+
+    if (!init_send_msghdr( fd, wsa, &hdr, &unix_addr )) return -1;
 
     while ((ret = sendmsg(fd, &hdr, flags)) == -1)
     {
@@ -2638,14 +2688,7 @@ static int WS2_send( int fd, struct ws2_async *wsa, int flags )
             return -1;
     }
 
-    n = ret;
-    while (wsa->first_iovec < wsa->n_iovecs && wsa->iovec[wsa->first_iovec].iov_len <= n)
-        n -= wsa->iovec[wsa->first_iovec++].iov_len;
-    if (wsa->first_iovec < wsa->n_iovecs)
-    {
-        wsa->iovec[wsa->first_iovec].iov_base = (char*)wsa->iovec[wsa->first_iovec].iov_base + n;
-        wsa->iovec[wsa->first_iovec].iov_len -= n;
-    }
+    advance_send_iovecs( wsa, ret );
     return ret;
 }
 
@@ -2703,6 +2746,559 @@ static NTSTATUS WS2_async_send( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS stat
     return status;
 }
 
+/**************************************************************************
+ * Client-side socket reactor
+ *
+ * When WINESOCKREACTOR is set, overlapped receives and sends that cannot
+ * complete immediately are performed by a per-process epoll thread instead
+ * of the thread that started them.  Each operation is still registered as
+ * an async with the server, so that it can be cancelled and gets terminated
+ * when its handle is closed; the reactor thread stores the result and has
+ * the server deliver the event, APC or completion.  A socket's fd is only
+ * kept while operations are queued on it.  Pending datagram requests on
+ * the same socket are drained with recvmmsg and sendmmsg.
+ **************************************************************************/
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE)
+
+struct reactor_socket
+{
+    struct wine_rb_entry entry;
+    SOCKET               s;
+    int                  fd;         /* private dup of the socket fd, -1 once detached */
+    ino_t                ino;        /* identifies the socket, since handle values get reused */
+    int                  type;       /* unix socket type */
+    unsigned int         events;     /* currently registered epoll events */
+    BOOL                 detached;   /* removed from the tree, the socket was closed */
+    struct list          ops[2];     /* pending reads and writes, in queue order */
+    unsigned int         completing; /* performed operations not reported yet */
+};
+
+struct reactor_op
+{
+    async_callback_t      *callback; /* must be the first field */
+    struct list            entry;
+    struct reactor_socket *sock;     /* socket the operation is queued or reported on */
+    int                    type;     /* ASYNC_TYPE_READ or ASYNC_TYPE_WRITE */
+    struct ws2_async      *wsa;
+    IO_STATUS_BLOCK       *iosb;
+    NTSTATUS               status;   /* STATUS_PENDING while queued */
+    LONG                   done;     /* set once the result is stored and the server refused it */
+};
+
+#define REACTOR_OPS(type) ((type) == ASYNC_TYPE_READ ? 0 : 1)
+
+static int reactor_socket_compare( const void *key, const struct wine_rb_entry *entry )
+{
+    SOCKET s = *(const SOCKET *)key;
+    const struct reactor_socket *sock = WINE_RB_ENTRY_VALUE( entry, const struct reactor_socket, entry );
+
+    return s < sock->s ? -1 : s > sock->s ? 1 : 0;
+}
+
+static struct wine_rb_tree reactor_sockets = { reactor_socket_compare };
+static int reactor_epfd = -1;
+
+static CRITICAL_SECTION reactor_cs;
+static CRITICAL_SECTION_DEBUG reactor_cs_debug =
+{
+    0, 0, &reactor_cs,
+    { &reactor_cs_debug.ProcessLocksList, &reactor_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": reactor_cs") }
+};
+static CRITICAL_SECTION reactor_cs = { &reactor_cs_debug, -1, 0, 0, 0, 0 };
+
+static BOOL sock_reactor_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINESOCKREACTOR" );
+        enabled = env && atoi( env );
+    }
+    return enabled;
+}
+
+/* update the epoll registration of a socket; called with reactor_cs held */
+static void reactor_update_events( struct reactor_socket *sock )
+{
+    struct epoll_event ev;
+    unsigned int events = 0;
+
+    if (sock->detached) return;
+    if (!list_empty( &sock->ops[REACTOR_OPS(ASYNC_TYPE_READ)] )) events |= EPOLLIN;
+    if (!list_empty( &sock->ops[REACTOR_OPS(ASYNC_TYPE_WRITE)] )) events |= EPOLLOUT;
+    if (events == sock->events) return;
+
+    /* hangups are reported even with an empty mask, so idle sockets are unregistered */
+    ev.events = events;
+    ev.data.u64 = sock->s;
+    if (epoll_ctl( reactor_epfd, !events ? EPOLL_CTL_DEL : !sock->events ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                   sock->fd, &ev ) == -1)
+        ERR( "epoll_ctl failed for socket %04lx: %s\n", sock->s, strerror(errno) );
+    sock->events = events;
+}
+
+/* stop watching a socket that got closed; called with reactor_cs held */
+static void reactor_detach_socket( struct reactor_socket *sock )
+{
+    wine_rb_remove( &reactor_sockets, &sock->entry );
+    if (sock->events) epoll_ctl( reactor_epfd, EPOLL_CTL_DEL, sock->fd, NULL );
+    close( sock->fd );
+    sock->fd = -1;
+    sock->events = 0;
+    sock->detached = TRUE;
+}
+
+/* free a socket once it has no operations left, so that its fd doesn't keep
+ * the connection open after the handle is closed; called with reactor_cs held */
+static void reactor_release_socket( struct reactor_socket *sock )
+{
+    if (!list_empty( &sock->ops[0] ) || !list_empty( &sock->ops[1] ) || sock->completing) return;
+    if (!sock->detached) reactor_detach_socket( sock );
+    HeapFree( GetProcessHeap(), 0, sock );
+}
+
+/* try to perform a pending operation; returns FALSE if the socket is not ready */
+static BOOL reactor_perform_op( struct reactor_socket *sock, struct reactor_op *op )
+{
+    struct ws2_async *wsa = op->wsa;
+    int result;
+
+    if (op->type == ASYNC_TYPE_READ)
+    {
+        if ((result = WS2_recv( sock->fd, wsa, convert_flags( wsa->flags ) )) >= 0)
+        {
+            op->iosb->Information = result;
+            op->status = STATUS_SUCCESS;
+            return TRUE;
+        }
+    }
+    else
+    {
+        while (wsa->first_iovec < wsa->n_iovecs)
+        {
+            if ((result = WS2_send( sock->fd, wsa, convert_flags( wsa->flags ) )) < 0) break;
+            op->iosb->Information += result;
+        }
+        if (wsa->first_iovec >= wsa->n_iovecs)
+        {
+            op->status = STATUS_SUCCESS;
+            return TRUE;
+        }
+    }
+
+    if (errno == EAGAIN) return FALSE;
+    if (op->type == ASYNC_TYPE_READ) op->iosb->Information = 0;
+    op->status = wsaErrStatus();
+    return TRUE;
+}
+
+/* Batching is only done here: without the reactor, the server wakes up one
+ * pending async per readiness event, so there is never more than one request
+ * ready to go into a recvmmsg or sendmmsg call. */
+#define REACTOR_BATCH 32
+
+/* Receive into several pending requests of a datagram socket with a single
+ * call. Returns TRUE if the remaining requests should be tried one by one. */
+static BOOL reactor_recv_batch( struct reactor_socket *sock, struct list *done )
+{
+#ifdef HAVE_RECVMMSG
+    struct ws2_recv_buffers buffers[REACTOR_BATCH];
+    struct mmsghdr msgs[REACTOR_BATCH];
+    struct reactor_op *ops[REACTOR_BATCH], *op;
+    int i, count, ret;
+
+    if (sock->type != SOCK_DGRAM) return TRUE;
+
+    for (;;)
+    {
+        count = 0;
+        LIST_FOR_EACH_ENTRY( op, &sock->ops[REACTOR_OPS(ASYNC_TYPE_READ)], struct reactor_op, entry )
+        {
+            /* flags such as MSG_PEEK need the single request path */
+            if (op->wsa->flags || count == REACTOR_BATCH) break;
+            init_recv_msghdr( op->wsa, &msgs[count].msg_hdr, &buffers[count] );
+            ops[count++] = op;
+        }
+        if (count < 2) return TRUE;
+
+        while ((ret = recvmmsg( sock->fd, msgs, count, 0, NULL )) == -1 && errno == EINTR);
+        /* errors such as EFAULT are reported through the single request path */
+        if (ret == -1) return errno != EAGAIN;
+
+        TRACE( "socket %04lx: received %d of %d datagrams\n", sock->s, ret, count );
+        for (i = 0; i < ret; i++)
+        {
+            op = ops[i];
+            if (finish_recv_msghdr( op->wsa, &msgs[i].msg_hdr, &buffers[i] ))
+            {
+                op->iosb->Information = 0;
+                op->status = wsaErrStatus();
+            }
+            else
+            {
+                op->iosb->Information = msgs[i].msg_len;
+                op->status = STATUS_SUCCESS;
+            }
+            list_remove( &op->entry );
+            list_add_tail( done, &op->entry );
+        }
+        if (ret < count) return FALSE;
+    }
+#else
+    return TRUE;
+#endif
+}
+
+/* Send the datagrams of several pending requests with a single call.
+ * Returns TRUE if the remaining requests should be tried one by one. */
+static BOOL reactor_send_batch( struct reactor_socket *sock, struct list *done )
+{
+#ifdef HAVE_SENDMMSG
+    union generic_unix_sockaddr addrs[REACTOR_BATCH];
+    struct mmsghdr msgs[REACTOR_BATCH];
+    struct reactor_op *ops[REACTOR_BATCH], *op;
+    int i, count, ret;
+
+    if (sock->type != SOCK_DGRAM) return TRUE;
+
+    for (;;)
+    {
+        count = 0;
+        LIST_FOR_EACH_ENTRY( op, &sock->ops[REACTOR_OPS(ASYNC_TYPE_WRITE)], struct reactor_op, entry )
+        {
+            if (op->wsa->flags || count == REACTOR_BATCH) break;
+            if (!init_send_msghdr( sock->fd, op->wsa, &msgs[count].msg_hdr, &addrs[count] )) break;
+            ops[count++] = op;
+        }
+        if (count < 2) return TRUE;
+
+        while ((ret = sendmmsg( sock->fd, msgs, count, 0 )) == -1 && errno == EINTR);
+        /* errors such as EISCONN are handled by the single request path */
+        if (ret == -1) return errno != EAGAIN;
+
+        TRACE( "socket %04lx: sent %d of %d datagrams\n", sock->s, ret, count );
+        for (i = 0; i < ret; i++)
+        {
+            op = ops[i];
+            advance_send_iovecs( op->wsa, msgs[i].msg_len );
+            op->iosb->Information += msgs[i].msg_len;
+            op->status = STATUS_SUCCESS;
+            list_remove( &op->entry );
+            list_add_tail( done, &op->entry );
+        }
+        if (ret < count) return FALSE;
+    }
+#else
+    return TRUE;
+#endif
+}
+
+/* store the result of a performed operation and have the server complete
+ * the async; called without reactor_cs held */
+static void reactor_complete_op( struct reactor_op *op )
+{
+    struct reactor_socket *sock = op->sock;
+    struct ws2_async *wsa = op->wsa;
+    NTSTATUS ret;
+
+    TRACE( "socket %04lx %s -> %08x, %lu bytes\n", sock->s, op->type == ASYNC_TYPE_READ ? "read" : "write",
+           op->status, op->iosb->Information );
+
+    op->iosb->u.Status = op->status;
+    if (op->type == ASYNC_TYPE_READ && op->status == STATUS_SUCCESS && !sock->detached)
+        _enable_event( SOCKET2HANDLE(sock->s), FD_READ, 0, 0 );
+
+    SERVER_START_REQ( complete_client_async )
+    {
+        req->user_arg = wine_server_client_ptr( op );
+        req->status   = op->status;
+        req->total    = op->iosb->Information;
+        ret = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+
+    EnterCriticalSection( &reactor_cs );
+    sock->completing--;
+    reactor_release_socket( sock );
+    op->sock = NULL;
+    LeaveCriticalSection( &reactor_cs );
+
+    if (!ret)
+    {
+        /* the completion routine is queued by the server and releases wsa */
+        if (!wsa->completion_func) release_async_io( &wsa->io );
+        HeapFree( GetProcessHeap(), 0, op );
+        return;
+    }
+
+    /* the async was cancelled or its handle closed; reactor_async_callback
+     * reports the result from the thread that started the operation */
+    InterlockedExchange( &op->done, 1 );
+    RtlWakeAddressAll( (void *)&op->done );
+}
+
+/* called through the server in the thread that started the operation,
+ * once the async got cancelled or its handle closed */
+static NTSTATUS reactor_async_callback( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS status )
+{
+    struct reactor_op *op = user;
+    struct reactor_socket *sock;
+    LONG zero = 0;
+
+    EnterCriticalSection( &reactor_cs );
+    if ((sock = op->sock) && op->status == STATUS_PENDING)
+    {
+        list_remove( &op->entry );
+        reactor_update_events( sock );
+        reactor_release_socket( sock );
+        LeaveCriticalSection( &reactor_cs );
+
+        if (op->type == ASYNC_TYPE_READ) iosb->Information = 0;
+        iosb->u.Status = status;
+    }
+    else
+    {
+        LeaveCriticalSection( &reactor_cs );
+
+        /* the reactor thread already performed it and is reporting the result */
+        while (!op->done) RtlWaitOnAddress( (void *)&op->done, &zero, sizeof(zero), NULL );
+        status = iosb->u.Status;
+    }
+
+    TRACE( "socket op %p -> %08x\n", op, status );
+    if (!op->wsa->completion_func) release_async_io( &op->wsa->io );
+    HeapFree( GetProcessHeap(), 0, op );
+    return status;
+}
+
+static DWORD WINAPI reactor_thread( void *arg )
+{
+    struct epoll_event events[64];
+    int i, count;
+
+    for (;;)
+    {
+        if ((count = epoll_wait( reactor_epfd, events, ARRAY_SIZE(events), -1 )) == -1)
+        {
+            if (errno != EINTR) ERR( "epoll_wait failed: %s\n", strerror(errno) );
+            continue;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            SOCKET s = events[i].data.u64;
+            struct reactor_op *op, *next;
+            struct reactor_socket *sock;
+            struct wine_rb_entry *entry;
+            struct list done;
+            unsigned int j;
+
+            list_init( &done );
+            EnterCriticalSection( &reactor_cs );
+            if ((entry = wine_rb_get( &reactor_sockets, &s )))
+            {
+                sock = WINE_RB_ENTRY_VALUE( entry, struct reactor_socket, entry );
+                for (j = 0; j < ARRAY_SIZE(sock->ops); j++)
+                {
+                    if (j == REACTOR_OPS(ASYNC_TYPE_READ) ? !reactor_recv_batch( sock, &done )
+                                                          : !reactor_send_batch( sock, &done ))
+                        continue;
+
+                    LIST_FOR_EACH_ENTRY_SAFE( op, next, &sock->ops[j], struct reactor_op, entry )
+                    {
+                        if (!reactor_perform_op( sock, op )) break;
+                        list_remove( &op->entry );
+                        list_add_tail( &done, &op->entry );
+                    }
+                }
+                LIST_FOR_EACH_ENTRY( op, &done, struct reactor_op, entry ) sock->completing++;
+                reactor_update_events( sock );
+            }
+            LeaveCriticalSection( &reactor_cs );
+
+            LIST_FOR_EACH_ENTRY_SAFE( op, next, &done, struct reactor_op, entry )
+                reactor_complete_op( op );
+        }
+    }
+    return 0;
+}
+
+/* start the reactor thread; called with reactor_cs held */
+static BOOL reactor_init(void)
+{
+    HANDLE thread;
+
+    if (reactor_epfd != -1) return TRUE;
+    if ((reactor_epfd = epoll_create( 64 )) == -1) return FALSE;
+    fcntl( reactor_epfd, F_SETFD, FD_CLOEXEC );
+
+    if (!(thread = CreateThread( NULL, 0, reactor_thread, NULL, 0, NULL )))
+    {
+        close( reactor_epfd );
+        reactor_epfd = -1;
+        return FALSE;
+    }
+    CloseHandle( thread );
+    return TRUE;
+}
+
+/* called with reactor_cs held */
+static struct reactor_socket *reactor_get_socket( SOCKET s )
+{
+    struct reactor_socket *sock;
+    struct wine_rb_entry *entry;
+    struct stat st;
+    int fd;
+
+    if ((fd = get_sock_fd( s, 0, NULL )) == -1) return NULL;
+    if (fstat( fd, &st ) == -1)
+    {
+        release_sock_fd( s, fd );
+        return NULL;
+    }
+
+    if ((entry = wine_rb_get( &reactor_sockets, &s )))
+    {
+        sock = WINE_RB_ENTRY_VALUE( entry, struct reactor_socket, entry );
+        if (sock->ino == st.st_ino)
+        {
+            release_sock_fd( s, fd );
+            return sock;
+        }
+        /* the handle was closed and reused, the old operations are terminated by the server */
+        TRACE( "socket %04lx was reused\n", s );
+        reactor_detach_socket( sock );
+        reactor_release_socket( sock );
+    }
+
+    if (!(sock = HeapAlloc( GetProcessHeap(), 0, sizeof(*sock) )))
+    {
+        release_sock_fd( s, fd );
+        return NULL;
+    }
+    sock->s          = s;
+    sock->fd         = dup( fd );
+    sock->ino        = st.st_ino;
+    sock->type       = _get_fd_type( fd );
+    sock->events     = 0;
+    sock->detached   = FALSE;
+    sock->completing = 0;
+    list_init( &sock->ops[0] );
+    list_init( &sock->ops[1] );
+    release_sock_fd( s, fd );
+
+    if (sock->fd != -1) fcntl( sock->fd, F_SETFD, FD_CLOEXEC );
+    else
+    {
+        WARN( "failed to duplicate fd for socket %04lx: %s\n", s, strerror(errno) );
+        HeapFree( GetProcessHeap(), 0, sock );
+        return NULL;
+    }
+    wine_rb_put( &reactor_sockets, &s, &sock->entry );
+    return sock;
+}
+
+/***********************************************************************
+ *              sock_reactor_queue      (INTERNAL)
+ *
+ * Queue a pending overlapped operation to the reactor. Returns
+ * STATUS_NOT_SUPPORTED if the operation must be registered with the server.
+ */
+static NTSTATUS sock_reactor_queue( int type, struct ws2_async *wsa, IO_STATUS_BLOCK *iosb,
+                                    HANDLE event, ULONG_PTR cvalue )
+{
+    struct reactor_socket *sock;
+    struct reactor_op *op;
+    NTSTATUS status;
+
+    if (!sock_reactor_enabled()) return STATUS_NOT_SUPPORTED;
+    if (!(op = HeapAlloc( GetProcessHeap(), 0, sizeof(*op) ))) return STATUS_NOT_SUPPORTED;
+
+    op->callback = reactor_async_callback;
+    op->sock     = NULL;
+    op->type     = type;
+    op->wsa      = wsa;
+    op->iosb     = iosb;
+    op->status   = STATUS_PENDING;
+    op->done     = 0;
+
+    EnterCriticalSection( &reactor_cs );
+    if (!reactor_init() || !(sock = reactor_get_socket( HANDLE2SOCKET(wsa->hSocket) )))
+    {
+        LeaveCriticalSection( &reactor_cs );
+        HeapFree( GetProcessHeap(), 0, op );
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    /* registered while holding the lock, so that the socket can't go away */
+    SERVER_START_REQ( register_client_async )
+    {
+        req->type              = type;
+        req->async.handle      = wine_server_obj_handle( wsa->hSocket );
+        req->async.user        = wine_server_client_ptr( op );
+        req->async.iosb        = wine_server_client_ptr( iosb );
+        req->async.event       = wine_server_obj_handle( event );
+        req->async.apc         = wine_server_client_ptr( wsa->completion_func ? ws2_async_apc : NULL );
+        req->async.apc_context = wine_server_client_ptr( wsa->completion_func ? (void *)wsa : (void *)cvalue );
+        status = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+
+    if (status)
+    {
+        reactor_release_socket( sock );
+        LeaveCriticalSection( &reactor_cs );
+        HeapFree( GetProcessHeap(), 0, op );
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    op->sock = sock;
+    list_add_tail( &sock->ops[REACTOR_OPS(type)], &op->entry );
+    reactor_update_events( sock );
+    LeaveCriticalSection( &reactor_cs );
+    return STATUS_PENDING;
+}
+
+/***********************************************************************
+ *              sock_reactor_close      (INTERNAL)
+ *
+ * Close the reactor's fd of a socket that is being closed. The pending
+ * operations are terminated by the server when the handle is closed.
+ */
+static void sock_reactor_close( SOCKET s )
+{
+    struct reactor_socket *sock;
+    struct wine_rb_entry *entry;
+
+    if (!sock_reactor_enabled()) return;
+
+    EnterCriticalSection( &reactor_cs );
+    if ((entry = wine_rb_get( &reactor_sockets, &s )))
+    {
+        sock = WINE_RB_ENTRY_VALUE( entry, struct reactor_socket, entry );
+        reactor_detach_socket( sock );
+        reactor_release_socket( sock );
+    }
+    LeaveCriticalSection( &reactor_cs );
+}
+
+#else  /* HAVE_SYS_EPOLL_H && HAVE_EPOLL_CREATE */
+
+static NTSTATUS sock_reactor_queue( int type, struct ws2_async *wsa, IO_STATUS_BLOCK *iosb,
+                                    HANDLE event, ULONG_PTR cvalue )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+static void sock_reactor_close( SOCKET s )
+{
+}
+
+#endif  /* HAVE_SYS_EPOLL_H && HAVE_EPOLL_CREATE */
+
 /***********************************************************************
  *              WS2_async_shutdown      (INTERNAL)
  *
@@ -3036,6 +3632,75 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
     return STATUS_SUCCESS;
 }
 
+/***********************************************************************
+ *     WS2_transmitfile_sendfile        (INTERNAL)
+ *
+ * Send the next part of the main file directly from the file descriptor,
+ * without copying it through a user buffer. Returns STATUS_NOT_SUPPORTED
+ * if the buffered path has to be used.
+ */
+static NTSTATUS WS2_transmitfile_sendfile( int fd, struct ws2_transmitfile_async *wsa )
+{
+#ifdef HAVE_SYS_SENDFILE_H
+    IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
+    DWORD bytes_per_send = wsa->bytes_per_send;
+    NTSTATUS status;
+    int file_fd;
+    ssize_t n;
+    off_t off;
+
+    /* the header and any incomplete write have to go out first */
+    if (wsa->no_sendfile || !wsa->file || wsa->buffers.Head || wsa->write.first_iovec < wsa->write.n_iovecs)
+        return STATUS_NOT_SUPPORTED;
+
+    if ((status = wine_server_handle_to_fd( wsa->file, FILE_READ_DATA, &file_fd, NULL )))
+        return status;
+
+    if (wsa->file_bytes != 0)
+        bytes_per_send = min(bytes_per_send, wsa->file_bytes - wsa->file_read);
+
+    do
+    {
+        if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        {
+            off = wsa->offset.QuadPart;
+            n = sendfile( fd, file_fd, &off, bytes_per_send );
+        }
+        else
+            n = sendfile( fd, file_fd, NULL, bytes_per_send );
+    }
+    while (n == -1 && errno == EINTR);
+
+    wine_server_release_fd( wsa->file, file_fd );
+
+    if (n == -1)
+    {
+        if (errno == EAGAIN) return STATUS_PENDING;
+        if (errno != EINVAL && errno != ENOSYS) return wsaErrStatus();
+
+        TRACE( "sendfile not supported for %p, falling back to buffered sends\n", wsa->file );
+        wsa->no_sendfile = TRUE;
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    if (!n)
+    {
+        wsa->file = NULL;  /* continue on to the footer */
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        wsa->offset.QuadPart += n;
+    wsa->file_read += n;
+    if (iosb) iosb->Information += n;
+    if (wsa->file_bytes != 0 && wsa->file_read >= wsa->file_bytes)
+        wsa->file = NULL;
+    return STATUS_PENDING;
+#else
+    return STATUS_NOT_SUPPORTED;
+#endif
+}
+
 /***********************************************************************
  *     WS2_transmitfile_base            (INTERNAL)
  *
@@ -3045,6 +3710,10 @@ static NTSTATUS WS2_transmitfile_base( int fd, struct ws2_transmitfile_async *ws
 {
     NTSTATUS status;
 
+    status = WS2_transmitfile_sendfile( fd, wsa );
+    if (status != STATUS_NOT_SUPPORTED)
+        return status;
+
     status = WS2_transmitfile_getbuffer( fd, wsa );
     if (status == STATUS_PENDING)
     {
@@ -3150,6 +3819,7 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     wsa->bytes_per_send        = bytes_per_send;
     wsa->flags                 = flags;
     wsa->offset.QuadPart       = FILE_USE_FILE_POINTER_POSITION;
+    wsa->no_sendfile           = FALSE;
     wsa->write.hSocket         = SOCKET2HANDLE(s);
     wsa->write.addr            = NULL;
     wsa->write.addrlen.val     = 0;
@@ -3433,6 +4103,7 @@ int WINAPI WS_closesocket(SOCKET s)
         if (fd >= 0)
         {
             release_sock_fd(s, fd);
+            sock_reactor_close(s);
             if (CloseHandle(SOCKET2HANDLE(s)))
                 res = 0;
         }
@@ -5640,11 +6311,18 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             iosb->Information = n == -1 ? 0 : n;
 
             if (wsa->completion_func)
-                err = register_async( ASYNC_TYPE_WRITE, wsa->hSocket, &wsa->io, NULL,
-                                      ws2_async_apc, wsa, iosb );
+            {
+                if ((err = sock_reactor_queue( ASYNC_TYPE_WRITE, wsa, iosb, NULL, 0 )) == STATUS_NOT_SUPPORTED)
+                    err = register_async( ASYNC_TYPE_WRITE, wsa->hSocket, &wsa->io, NULL,
+                                          ws2_async_apc, wsa, iosb );
+            }
             else
-                err = register_async( ASYNC_TYPE_WRITE, wsa->hSocket, &wsa->io, lpOverlapped->hEvent,
-                                      NULL, (void *)cvalue, iosb );
+            {
+                if ((err = sock_reactor_queue( ASYNC_TYPE_WRITE, wsa, iosb, lpOverlapped->hEvent,
+                                               cvalue )) == STATUS_NOT_SUPPORTED)
+                    err = register_async( ASYNC_TYPE_WRITE, wsa->hSocket, &wsa->io, lpOverlapped->hEvent,
+                                          NULL, (void *)cvalue, iosb );
+            }
 
             /* Enable the event only after starting the async. The server will deliver it as soon as
                the async is done. */
@@ -7418,9 +8096,29 @@ BOOL WINAPI WSAGetOverlappedResult( SOCKET s, LPWSAOVERLAPPED lpOverlapped,
             return FALSE;
         }
 
-        if (WaitForSingleObject( lpOverlapped->hEvent ? lpOverlapped->hEvent : SOCKET2HANDLE(s),
-                                 INFINITE ) == WAIT_FAILED)
-            return FALSE;
+        if (lpOverlapped->hEvent)
+        {
+            if (WaitForSingleObject( lpOverlapped->hEvent, INFINITE ) == WAIT_FAILED) return FALSE;
+        }
+        else
+        {
+            /* the socket is signaled when it is ready, not when the operation completes */
+            HANDLE wait = 0;
+
+            SERVER_START_REQ( get_async_wait_handle )
+            {
+                req->iosb = wine_server_client_ptr( lpOverlapped );
+                if (!wine_server_call( req )) wait = wine_server_ptr_handle( reply->wait );
+            }
+            SERVER_END_REQ;
+
+            if (WaitForSingleObject( wait ? wait : SOCKET2HANDLE(s), INFINITE ) == WAIT_FAILED)
+            {
+                if (wait) CloseHandle( wait );
+                return FALSE;
+            }
+            if (wait) CloseHandle( wait );
+        }
         status = lpOverlapped->Internal;
     }
 
@@ -8058,11 +8756,18 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                 iosb->Information = 0;
 
                 if (wsa->completion_func)
-                    err = register_async( ASYNC_TYPE_READ, wsa->hSocket, &wsa->io, NULL,
-                                          ws2_async_apc, wsa, iosb );
+                {
+                    if ((err = sock_reactor_queue( ASYNC_TYPE_READ, wsa, iosb, NULL, 0 )) == STATUS_NOT_SUPPORTED)
+                        err = register_async( ASYNC_TYPE_READ, wsa->hSocket, &wsa->io, NULL,
+                                              ws2_async_apc, wsa, iosb );
+                }
                 else
-                    err = register_async( ASYNC_TYPE_READ, wsa->hSocket, &wsa->io, lpOverlapped->hEvent,
-                                          NULL, (void *)cvalue, iosb );
+                {
+                    if ((err = sock_reactor_queue( ASYNC_TYPE_READ, wsa, iosb, lpOverlapped->hEvent,
+                                                   cvalue )) == STATUS_NOT_SUPPORTED)
+                        err = register_async( ASYNC_TYPE_READ, wsa->hSocket, &wsa->io, lpOverlapped->hEvent,
+                                              NULL, (void *)cvalue, iosb );
+                }
 
                 if (err != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
                 SetLastError(NtStatusToWSAError( err ));
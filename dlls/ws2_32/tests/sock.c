@@ -11514,9 +11514,212 @@ static void test_iocp(void)
     closesocket(dst);
 }
 
+static void test_udp_overlapped_recv(void)
+{
+    enum { count = 16 };
+    struct
+    {
+        WSAOVERLAPPED ov;
+        struct sockaddr_in from;
+        int fromlen;
+        DWORD flags;
+        char buffer[64];
+    } reqs[count];
+    struct sockaddr_in addr;
+    WSAOVERLAPPED *ovl;
+    SOCKET src, dst;
+    DWORD bytes, received;
+    ULONG_PTR key;
+    HANDLE port;
+    WSABUF wsabuf;
+    char buf[32];
+    int i, ret, len;
+
+    src = socket(AF_INET, SOCK_DGRAM, 0);
+    ok(src != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+    dst = WSASocketA(AF_INET, SOCK_DGRAM, 0, NULL, 0, WSA_FLAG_OVERLAPPED);
+    ok(dst != INVALID_SOCKET, "WSASocket failed, error %d\n", WSAGetLastError());
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    ret = bind(dst, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "bind failed, error %d\n", WSAGetLastError());
+    len = sizeof(addr);
+    ret = getsockname(dst, (struct sockaddr *)&addr, &len);
+    ok(!ret, "getsockname failed, error %d\n", WSAGetLastError());
+
+    port = CreateIoCompletionPort((HANDLE)dst, NULL, 125, 0);
+    ok(port != NULL, "CreateIoCompletionPort failed, error %u\n", GetLastError());
+
+    for (i = 0; i < count; i++)
+    {
+        memset(&reqs[i].ov, 0, sizeof(reqs[i].ov));
+        reqs[i].fromlen = sizeof(reqs[i].from);
+        reqs[i].flags = 0;
+        memset(reqs[i].buffer, 0, sizeof(reqs[i].buffer));
+        wsabuf.buf = reqs[i].buffer;
+        wsabuf.len = sizeof(reqs[i].buffer);
+        ret = WSARecvFrom(dst, &wsabuf, 1, NULL, &reqs[i].flags, (struct sockaddr *)&reqs[i].from,
+                          &reqs[i].fromlen, &reqs[i].ov, NULL);
+        ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+           "%d: WSARecvFrom returned %d, error %d\n", i, ret, WSAGetLastError());
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf(buf, "packet %d", i);
+        ret = sendto(src, buf, strlen(buf) + 1, 0, (struct sockaddr *)&addr, sizeof(addr));
+        ok(ret == (int)strlen(buf) + 1, "%d: sendto returned %d, error %d\n", i, ret, WSAGetLastError());
+    }
+
+    received = 0;
+    for (i = 0; i < count; i++)
+    {
+        ovl = NULL;
+        key = 0;
+        ret = GetQueuedCompletionStatus(port, &bytes, &key, &ovl, 1000);
+        ok(ret, "%d: GetQueuedCompletionStatus failed, error %u\n", i, GetLastError());
+        if (!ret) break;
+        ok(key == 125, "%d: got key %lu\n", i, key);
+        ok(ovl >= &reqs[0].ov && ovl <= &reqs[count - 1].ov, "%d: got overlapped %p\n", i, ovl);
+        ok(bytes >= sizeof("packet 0"), "%d: got %u bytes\n", i, bytes);
+        received++;
+    }
+    ok(received == count, "received %u packets\n", received);
+
+    for (i = 0; i < received; i++)
+    {
+        int index;
+
+        ok(!strncmp(reqs[i].buffer, "packet ", 7), "%d: got %s\n", i, reqs[i].buffer);
+        index = atoi(reqs[i].buffer + 7);
+        ok(index == i, "%d: completions out of order, got packet %d\n", i, index);
+    }
+
+    CloseHandle(port);
+    closesocket(src);
+    closesocket(dst);
+}
+
+static void test_overlapped_pending(void)
+{
+    static const char data[] = "some data";
+    WSAOVERLAPPED ov;
+    DWORD bytes, flags;
+    SOCKET src, dst;
+    struct timeval tv;
+    char buffer[64];
+    WSABUF wsabuf;
+    fd_set readfds;
+    HANDLE event;
+    BOOL bret;
+    int ret;
+
+    if (tcp_socketpair_ovl(&src, &dst))
+    {
+        skip("failed to create sockets\n");
+        return;
+    }
+    event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    wsabuf.buf = buffer;
+    wsabuf.len = sizeof(buffer);
+
+    /* without an event, waiting must not return before the receive is done */
+    memset(&ov, 0, sizeof(ov));
+    flags = 0;
+    ret = WSARecv(dst, &wsabuf, 1, NULL, &flags, &ov, NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+       "WSARecv returned %d, error %d\n", ret, WSAGetLastError());
+    ret = send(src, data, sizeof(data), 0);
+    ok(ret == sizeof(data), "send returned %d, error %d\n", ret, WSAGetLastError());
+    bytes = 0xdeadbeef;
+    bret = WSAGetOverlappedResult(dst, &ov, &bytes, TRUE, &flags);
+    ok(bret, "WSAGetOverlappedResult failed, error %d\n", WSAGetLastError());
+    ok(bytes == sizeof(data), "got %u bytes\n", bytes);
+    ok(!memcmp(buffer, data, sizeof(data)), "got %s\n", buffer);
+
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = event;
+    flags = 0;
+    ret = WSARecv(dst, &wsabuf, 1, NULL, &flags, &ov, NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+       "WSARecv returned %d, error %d\n", ret, WSAGetLastError());
+    bret = CancelIo((HANDLE)dst);
+    ok(bret, "CancelIo failed, error %u\n", GetLastError());
+    ret = WaitForSingleObject(event, 1000);
+    ok(!ret, "wait returned %d\n", ret);
+    bret = WSAGetOverlappedResult(dst, &ov, &bytes, FALSE, &flags);
+    ok(!bret && WSAGetLastError() == ERROR_OPERATION_ABORTED,
+       "WSAGetOverlappedResult returned %d, error %d\n", bret, WSAGetLastError());
+
+    /* the peer sees the connection closed even though a receive was pending */
+    memset(&ov, 0, sizeof(ov));
+    ov.hEvent = event;
+    ResetEvent(event);
+    flags = 0;
+    ret = WSARecv(dst, &wsabuf, 1, NULL, &flags, &ov, NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+       "WSARecv returned %d, error %d\n", ret, WSAGetLastError());
+    CloseHandle((HANDLE)dst);
+    ret = WaitForSingleObject(event, 1000);
+    ok(!ret, "wait returned %d\n", ret);
+    ok(ov.Internal != STATUS_PENDING, "receive still pending\n");
+
+    FD_ZERO(&readfds);
+    FD_SET(src, &readfds);
+    tv.tv_sec = 5;
+    tv.tv_usec = 0;
+    ret = select(0, &readfds, NULL, NULL, &tv);
+    ok(ret == 1, "select returned %d, error %d\n", ret, WSAGetLastError());
+    ret = recv(src, buffer, sizeof(buffer), 0);
+    ok(!ret, "recv returned %d, error %d\n", ret, WSAGetLastError());
+
+    closesocket(src);
+    CloseHandle(event);
+}
+
+static void test_reactor(void)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char cmdline[MAX_PATH];
+    char **argv;
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" sock reactor", argv[0]);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+
+    /* only used by Wine, harmless elsewhere */
+    SetEnvironmentVariableA("WINESOCKREACTOR", "1");
+    if (CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info))
+    {
+        winetest_wait_child_process(info.hProcess);
+        CloseHandle(info.hProcess);
+        CloseHandle(info.hThread);
+    }
+    else ok(0, "CreateProcess failed, error %u\n", GetLastError());
+    SetEnvironmentVariableA("WINESOCKREACTOR", NULL);
+}
+
 START_TEST( sock )
 {
     int i;
+    char **argv;
+
+    if (winetest_get_mainargs(&argv) >= 3 && !strcmp(argv[2], "reactor"))
+    {
+        /* overlapped I/O tests, run with the client-side socket reactor enabled */
+        Init();
+        test_WSARecv();
+        test_iocp();
+        test_udp_overlapped_recv();
+        test_overlapped_pending();
+        test_completion_port();
+        Exit();
+        return;
+    }
 
 /* Leave these tests at the beginning. They depend on WSAStartup not having been
  * called, which is done by Init() below. */
@@ -11572,6 +11775,9 @@ START_TEST( sock )
     test_WSAPoll();
     test_write_watch();
     test_iocp();
+    test_udp_overlapped_recv();
+    test_overlapped_pending();
+    test_reactor();
 
     test_events(0);
     test_events(1);
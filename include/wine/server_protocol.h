@@ -3399,6 +3399,50 @@ struct get_async_result_reply
 
 
 
+struct register_client_async_request
+{
+    struct request_header __header;
+    int            type;
+    async_data_t   async;
+};
+struct register_client_async_reply
+{
+    struct reply_header __header;
+};
+
+
+
+struct complete_client_async_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+    client_ptr_t   user_arg;
+    unsigned int   status;
+    char __pad_28[4];
+    apc_param_t    total;
+};
+struct complete_client_async_reply
+{
+    struct reply_header __header;
+};
+
+
+
+struct get_async_wait_handle_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+    client_ptr_t   iosb;
+};
+struct get_async_wait_handle_reply
+{
+    struct reply_header __header;
+    obj_handle_t   wait;
+    char __pad_12[4];
+};
+
+
+
 struct read_request
 {
     struct request_header __header;
@@ -6154,6 +6198,9 @@ enum request
     REQ_register_async,
     REQ_cancel_async,
     REQ_get_async_result,
+    REQ_register_client_async,
+    REQ_complete_client_async,
+    REQ_get_async_wait_handle,
     REQ_read,
     REQ_write,
     REQ_ioctl,
@@ -6470,6 +6517,9 @@ union generic_request
     struct register_async_request register_async_request;
     struct cancel_async_request cancel_async_request;
     struct get_async_result_request get_async_result_request;
+    struct register_client_async_request register_client_async_request;
+    struct complete_client_async_request complete_client_async_request;
+    struct get_async_wait_handle_request get_async_wait_handle_request;
     struct read_request read_request;
     struct write_request write_request;
     struct ioctl_request ioctl_request;
@@ -6784,6 +6834,9 @@ union generic_reply
     struct register_async_reply register_async_reply;
     struct cancel_async_reply cancel_async_reply;
     struct get_async_result_reply get_async_result_reply;
+    struct register_client_async_reply register_client_async_reply;
+    struct complete_client_async_reply complete_client_async_reply;
+    struct get_async_wait_handle_reply get_async_wait_handle_reply;
     struct read_reply read_reply;
     struct write_reply write_reply;
     struct ioctl_reply ioctl_reply;
@@ -6942,6 +6995,6 @@ union generic_reply
     struct get_fsync_apc_idx_reply get_fsync_apc_idx_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 609
+#define SERVER_PROTOCOL_VERSION 611
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -75,6 +75,7 @@ extern int winetest_get_mainargs( char*** pargv );
 extern LONG winetest_get_failures(void);
 extern void winetest_add_failures( LONG new_failures );
 extern void winetest_wait_child_process( HANDLE process );
+extern BOOL winetest_run_wine_child( const char *args, const char *var, const char *value );
 
 extern const char *wine_dbgstr_wn( const WCHAR *str, int n );
 extern const char *wine_dbgstr_guid( const GUID *guid );
@@ -485,6 +486,43 @@ void winetest_wait_child_process( HANDLE process )
     }
 }
 
+/* Runs the current test in a child process with the given arguments and with
+ * the environment variable var set to value, to exercise optional Wine code
+ * paths. Returns FALSE without running anything when not running on Wine. */
+BOOL winetest_run_wine_child( const char *args, const char *var, const char *value )
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char *cmdline, *old_value = NULL;
+    DWORD size;
+
+    if (strcmp( winetest_platform, "wine" )) return FALSE;
+
+    cmdline = malloc( strlen( winetest_argv[0] ) + strlen( current_test->name ) + strlen( args ) + 5 );
+    sprintf( cmdline, "\"%s\" %s %s", winetest_argv[0], current_test->name, args );
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+
+    if ((size = GetEnvironmentVariableA( var, NULL, 0 )) && (old_value = malloc( size )))
+        GetEnvironmentVariableA( var, old_value, size );
+    SetEnvironmentVariableA( var, value );
+    if (CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ))
+    {
+        winetest_wait_child_process( info.hProcess );
+        CloseHandle( info.hProcess );
+        CloseHandle( info.hThread );
+    }
+    else
+    {
+        printf( "%s: failed to create child process, error %u\n", current_test->name, GetLastError() );
+        InterlockedIncrement( &failures );
+    }
+    SetEnvironmentVariableA( var, old_value );
+    free( old_value );
+    free( cmdline );
+    return TRUE;
+}
+
 const char *wine_dbgstr_wn( const WCHAR *str, int n )
 {
     char *dst, *res;
@@ -2267,6 +2267,8 @@ void __cdecl wined3d_device_draw_primitive_instanced(struct wined3d_device *devi
         UINT start_vertex, UINT vertex_count, UINT start_instance, UINT instance_count);
 void __cdecl wined3d_device_draw_primitive_instanced_indirect(struct wined3d_device *device,
         struct wined3d_buffer *buffer, unsigned int offset);
+HRESULT __cdecl wined3d_device_draw_primitive_up(struct wined3d_device *device,
+        const void *data, UINT vertex_count, UINT stride);
 HRESULT __cdecl wined3d_device_end_scene(struct wined3d_device *device);
 HRESULT __cdecl wined3d_device_end_stateblock(struct wined3d_device *device, struct wined3d_stateblock **stateblock);
 void __cdecl wined3d_device_evict_managed_resources(struct wined3d_device *device);
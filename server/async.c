@@ -424,6 +424,17 @@ void async_set_result( struct object *obj, unsigned int status, apc_param_t tota
     }
 }
 
+/* complete an async whose I/O was performed by the client; fails if it was terminated in the meantime */
+static int async_complete_client( struct async *async, unsigned int status, apc_param_t total )
+{
+    if (async->status != STATUS_PENDING || status == STATUS_PENDING) return 0;
+
+    async->status = status;
+    async_set_result( &async->obj, status, total );
+    if (async->queue) release_object( async );  /* so that it gets destroyed now */
+    return 1;
+}
+
 /* check if an async operation is waiting to be alerted */
 int async_waiting( struct async_queue *queue )
 {
@@ -603,3 +614,34 @@ DECL_HANDLER(get_async_result)
     reply->size = iosb->result;
     set_error( iosb->status );
 }
+
+/* report the result of an async I/O performed by the client */
+DECL_HANDLER(complete_client_async)
+{
+    struct async *async;
+
+    LIST_FOR_EACH_ENTRY( async, &current->process->asyncs, struct async, process_entry )
+        if (async->data.user == req->user_arg)
+        {
+            /* if the async got terminated, the client callback will report the result instead */
+            if (!async_complete_client( async, req->status, req->total )) set_error( STATUS_CANCELLED );
+            return;
+        }
+
+    set_error( STATUS_INVALID_PARAMETER );
+}
+
+/* get a handle to wait for completion of an async, for objects whose signaled state doesn't reflect it */
+DECL_HANDLER(get_async_wait_handle)
+{
+    struct async *async;
+
+    LIST_FOR_EACH_ENTRY( async, &current->process->asyncs, struct async, process_entry )
+        if (async->data.iosb == req->iosb && !async->signaled)
+        {
+            reply->wait = alloc_handle( current->process, async, SYNCHRONIZE, 0 );
+            return;
+        }
+
+    set_error( STATUS_NOT_FOUND );
+}
@@ -478,58 +478,161 @@ static inline void fd_poll_event( struct fd *fd, int event )
 
 static int epoll_fd = -1;
 
+/* Interest changes are not passed to the kernel right away: set_fd_events() is
+ * often called several times for the same fd while processing a single event,
+ * so ADD and MOD operations are queued and flushed once per loop iteration,
+ * right before epoll_wait(). Removals are still done immediately since the
+ * unix fd may be closed before the next flush. */
+struct epoll_user
+{
+    int registered;    /* events currently registered with the kernel, -1 if not in the set */
+    int pending;       /* update queued in epoll_pending */
+};
+
+static struct epoll_user *epoll_users;     /* per-user epoll state, parallel to pollfd */
+static int *epoll_pending;                 /* users with a queued interest update */
+static int epoll_nb_pending;               /* number of entries in epoll_pending */
+static int epoll_allocated;                /* count of allocated entries in the arrays */
+static unsigned int epoll_ctl_calls;       /* epoll_ctl calls since the last report */
+static unsigned int epoll_coalesced;       /* updates that didn't need an epoll_ctl call */
+static timeout_t epoll_stats_time;         /* time of the last statistics report */
+
 static inline void init_epoll(void)
 {
     epoll_fd = epoll_create( 128 );
 }
 
-/* set the events that epoll waits for on this fd; helper for set_fd_events */
-static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
+/* give up on epoll and fall back to poll */
+static void disable_epoll(void)
+{
+    close( epoll_fd );
+    epoll_fd = -1;
+}
+
+static int do_epoll_ctl( int ctl, int unix_fd, int user, int events )
 {
     struct epoll_event ev;
-    int ctl;
 
+    ev.events = events;
+    memset(&ev.data, 0, sizeof(ev.data));
+    ev.data.u32 = user;
+
+    epoll_ctl_calls++;
+    if (epoll_ctl( epoll_fd, ctl, unix_fd, &ev ) == -1)
+    {
+        if (errno == ENOMEM)  /* not enough memory, give up on epoll */
+        {
+            disable_epoll();
+            return -1;
+        }
+        perror( "epoll_ctl" );  /* should not happen */
+    }
+    return 0;
+}
+
+/* make sure the epoll state arrays can hold the given user */
+static int grow_epoll_users( int user )
+{
+    struct epoll_user *new_users;
+    int *new_pending;
+    int i, new_count = allocated_users;
+
+    if (user < epoll_allocated) return 1;
+    if (new_count <= user) new_count = user + 1;
+
+    if (!(new_users = realloc( epoll_users, new_count * sizeof(*epoll_users) ))) return 0;
+    epoll_users = new_users;
+    if (!(new_pending = realloc( epoll_pending, new_count * sizeof(*epoll_pending) ))) return 0;
+    epoll_pending = new_pending;
+
+    for (i = epoll_allocated; i < new_count; i++)
+    {
+        epoll_users[i].registered = -1;
+        epoll_users[i].pending = 0;
+    }
+    epoll_allocated = new_count;
+    return 1;
+}
+
+/* set the events that epoll waits for on this fd; helper for set_fd_events */
+static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
+{
     if (epoll_fd == -1) return;
 
-    if (events == -1)  /* stop waiting on this fd completely */
+    if (!grow_epoll_users( user ))
     {
-        if (pollfd[user].fd == -1) return;  /* already removed */
-        ctl = EPOLL_CTL_DEL;
+        disable_epoll();
+        return;
     }
-    else if (pollfd[user].fd == -1)
+
+    if (events == -1)  /* stop waiting on this fd completely */
     {
-        if (pollfd[user].events) return;  /* stopped waiting on it, don't restart */
-        ctl = EPOLL_CTL_ADD;
+        if (epoll_users[user].registered == -1) return;  /* already removed */
+        epoll_users[user].registered = -1;
+        do_epoll_ctl( EPOLL_CTL_DEL, fd->unix_fd, user, 0 );
+        return;
     }
-    else
+
+    /* the actual state is computed from pollfd when the update is flushed */
+    if (epoll_users[user].pending)
     {
-        if (pollfd[user].events == events) return;  /* nothing to do */
-        ctl = EPOLL_CTL_MOD;
+        epoll_coalesced++;
+        return;
     }
+    epoll_users[user].pending = 1;
+    epoll_pending[epoll_nb_pending++] = user;
+}
 
-    ev.events = events;
-    memset(&ev.data, 0, sizeof(ev.data));
-    ev.data.u32 = user;
+/* pass the queued interest updates to the kernel */
+static void flush_epoll_updates(void)
+{
+    int i;
 
-    if (epoll_ctl( epoll_fd, ctl, fd->unix_fd, &ev ) == -1)
+    for (i = 0; i < epoll_nb_pending && epoll_fd != -1; i++)
     {
-        if (errno == ENOMEM)  /* not enough memory, give up on epoll */
+        int user = epoll_pending[i];
+        int registered = epoll_users[user].registered;
+
+        epoll_users[user].pending = 0;
+
+        /* removals are never deferred, and an unused entry has pollfd[user].fd == -1 */
+        if (pollfd[user].fd == -1) continue;
+
+        if (registered == -1)
+        {
+            if (!do_epoll_ctl( EPOLL_CTL_ADD, pollfd[user].fd, user, pollfd[user].events ))
+                epoll_users[user].registered = pollfd[user].events;
+        }
+        else if (registered != pollfd[user].events)
         {
-            close( epoll_fd );
-            epoll_fd = -1;
+            if (!do_epoll_ctl( EPOLL_CTL_MOD, pollfd[user].fd, user, pollfd[user].events ))
+                epoll_users[user].registered = pollfd[user].events;
         }
-        else perror( "epoll_ctl" );  /* should not happen */
+        else epoll_coalesced++;
     }
+    epoll_nb_pending = 0;
+}
+
+/* report the epoll_ctl rate when debugging is enabled */
+static void report_epoll_stats(void)
+{
+    if (current_time - epoll_stats_time < TICKS_PER_SEC) return;
+    if (epoll_stats_time && (epoll_ctl_calls || epoll_coalesced))
+        fprintf( stderr, "wineserver: epoll_ctl: %u calls/s, %u updates coalesced\n",
+                 (unsigned int)((ULONGLONG)epoll_ctl_calls * TICKS_PER_SEC / (current_time - epoll_stats_time)),
+                 epoll_coalesced );
+    epoll_ctl_calls = epoll_coalesced = 0;
+    epoll_stats_time = current_time;
 }
 
 static inline void remove_epoll_user( struct fd *fd, int user )
 {
     if (epoll_fd == -1) return;
 
-    if (pollfd[user].fd != -1)
+    if (user < epoll_allocated && epoll_users[user].registered != -1)
     {
-        struct epoll_event dummy;
-        epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd->unix_fd, &dummy );
+        epoll_users[user].registered = -1;
+        do_epoll_ctl( EPOLL_CTL_DEL, fd->unix_fd, user, 0 );
     }
 }
 
@@ -550,10 +653,13 @@ static inline void main_loop_epoll(void)
         timeout = get_next_timeout();
 
         if (!active_users) break;  /* last user removed by a timeout */
+
+        flush_epoll_updates();
         if (epoll_fd == -1) break;  /* an error occurred with epoll */
 
         ret = epoll_wait( epoll_fd, events, ARRAY_SIZE( events ), timeout );
         set_current_time();
+        if (debug_level) report_epoll_stats();
 
         /* put the events into the pollfd array first, like poll does */
         for (i = 0; i < ret; i++)
@@ -2670,6 +2776,41 @@ DECL_HANDLER(register_async)
     }
 }
 
+/* queue an async I/O on a regular file or socket that the client performs itself */
+DECL_HANDLER(register_client_async)
+{
+    unsigned int access;
+    struct async *async;
+    struct fd *fd;
+
+    switch(req->type)
+    {
+    case ASYNC_TYPE_READ:
+        access = FILE_READ_DATA;
+        break;
+    case ASYNC_TYPE_WRITE:
+        access = FILE_WRITE_DATA;
+        break;
+    default:
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+
+    if ((fd = get_handle_fd_obj( current->process, req->async.handle, access )))
+    {
+        if (!fd->inode && fd->fd_ops->get_fd_type( fd ) != FD_TYPE_SOCKET)
+            set_error( STATUS_OBJECT_TYPE_MISMATCH );
+        else if ((async = create_async( fd, current, &req->async, NULL )))
+        {
+            /* the wait queue is never woken up by fd events, so the async stays
+             * pending until the client completes it or it gets cancelled */
+            fd_queue_async( fd, async, ASYNC_TYPE_WAIT );
+            release_object( async );
+        }
+        release_object( fd );
+    }
+}
+
 /* attach completion object to a fd */
 DECL_HANDLER(set_completion_info)
 {
@@ -265,6 +265,9 @@ DECL_HANDLER(set_serial_info);
 DECL_HANDLER(register_async);
 DECL_HANDLER(cancel_async);
 DECL_HANDLER(get_async_result);
+DECL_HANDLER(register_client_async);
+DECL_HANDLER(complete_client_async);
+DECL_HANDLER(get_async_wait_handle);
 DECL_HANDLER(read);
 DECL_HANDLER(write);
 DECL_HANDLER(ioctl);
@@ -580,6 +583,9 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_register_async,
     (req_handler)req_cancel_async,
     (req_handler)req_get_async_result,
+    (req_handler)req_register_client_async,
+    (req_handler)req_complete_client_async,
+    (req_handler)req_get_async_wait_handle,
     (req_handler)req_read,
     (req_handler)req_write,
     (req_handler)req_ioctl,
@@ -1656,6 +1662,17 @@ C_ASSERT( FIELD_OFFSET(struct get_async_result_request, user_arg) == 16 );
 C_ASSERT( sizeof(struct get_async_result_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_async_result_reply, size) == 8 );
 C_ASSERT( sizeof(struct get_async_result_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct register_client_async_request, type) == 12 );
+C_ASSERT( FIELD_OFFSET(struct register_client_async_request, async) == 16 );
+C_ASSERT( sizeof(struct register_client_async_request) == 56 );
+C_ASSERT( FIELD_OFFSET(struct complete_client_async_request, user_arg) == 16 );
+C_ASSERT( FIELD_OFFSET(struct complete_client_async_request, status) == 24 );
+C_ASSERT( FIELD_OFFSET(struct complete_client_async_request, total) == 32 );
+C_ASSERT( sizeof(struct complete_client_async_request) == 40 );
+C_ASSERT( FIELD_OFFSET(struct get_async_wait_handle_request, iosb) == 16 );
+C_ASSERT( sizeof(struct get_async_wait_handle_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_async_wait_handle_reply, wait) == 8 );
+C_ASSERT( sizeof(struct get_async_wait_handle_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct read_request, async) == 16 );
 C_ASSERT( FIELD_OFFSET(struct read_request, pos) == 56 );
 C_ASSERT( sizeof(struct read_request) == 64 );
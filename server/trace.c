@@ -2978,6 +2978,29 @@ static void dump_get_async_result_reply( const struct get_async_result_reply *re
     dump_varargs_bytes( ", out_data=", cur_size );
 }
 
+static void dump_register_client_async_request( const struct register_client_async_request *req )
+{
+    fprintf( stderr, " type=%d", req->type );
+    dump_async_data( ", async=", &req->async );
+}
+
+static void dump_complete_client_async_request( const struct complete_client_async_request *req )
+{
+    dump_uint64( " user_arg=", &req->user_arg );
+    fprintf( stderr, ", status=%08x", req->status );
+    dump_uint64( ", total=", &req->total );
+}
+
+static void dump_get_async_wait_handle_request( const struct get_async_wait_handle_request *req )
+{
+    dump_uint64( " iosb=", &req->iosb );
+}
+
+static void dump_get_async_wait_handle_reply( const struct get_async_wait_handle_reply *req )
+{
+    fprintf( stderr, " wait=%04x", req->wait );
+}
+
 static void dump_read_request( const struct read_request *req )
 {
     dump_async_data( " async=", &req->async );
@@ -4878,6 +4901,9 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_register_async_request,
     (dump_func)dump_cancel_async_request,
     (dump_func)dump_get_async_result_request,
+    (dump_func)dump_register_client_async_request,
+    (dump_func)dump_complete_client_async_request,
+    (dump_func)dump_get_async_wait_handle_request,
     (dump_func)dump_read_request,
     (dump_func)dump_write_request,
     (dump_func)dump_ioctl_request,
@@ -5190,6 +5216,9 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     (dump_func)dump_get_async_result_reply,
+    NULL,
+    NULL,
+    (dump_func)dump_get_async_wait_handle_reply,
     (dump_func)dump_read_reply,
     (dump_func)dump_write_reply,
     (dump_func)dump_ioctl_reply,
@@ -5502,6 +5531,9 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "register_async",
     "cancel_async",
     "get_async_result",
+    "register_client_async",
+    "complete_client_async",
+    "get_async_wait_handle",
     "read",
     "write",
     "ioctl",
@@ -5768,6 +5800,7 @@ static const struct
     { "PIPE_CLOSING",                STATUS_PIPE_CLOSING },
     { "PIPE_CONNECTED",              STATUS_PIPE_CONNECTED },
     { "PIPE_DISCONNECTED",           STATUS_PIPE_DISCONNECTED },
+    { "PIPE_EMPTY",                  STATUS_PIPE_EMPTY },
     { "PIPE_LISTENING",              STATUS_PIPE_LISTENING },
     { "PIPE_NOT_AVAILABLE",          STATUS_PIPE_NOT_AVAILABLE },
     { "PRIVILEGE_NOT_HELD",          STATUS_PRIVILEGE_NOT_HELD },